@@ -45,6 +45,8 @@ extern "C" {
  * When filling in the desired audio spec structure,
  * - 'desired->freq' should be the desired audio frequency in samples-per-second.
  * - 'desired->format' should be the desired audio format.
+ *     None of the audio drivers play 32-bit samples, so AUDIO_S32 and
+ *     AUDIO_F32 are always converted, and 'obtained' should be NULL for them.
  * - 'desired->samples' is the desired size of the audio buffer, in samples.
  *     This number should be a power of two, and may be adjusted by the audio
  *     driver to a value more suitable for the hardware.  Good values seem to
@@ -64,7 +66,8 @@ extern "C" {
  *     to the audio buffer, and the length in bytes of the audio buffer.
  *     This function usually runs in a separate thread, and so you should
  *     protect data structures that it accesses by calling SDL_LockAudio()
- *     and SDL_UnlockAudio() in your code.
+ *     and SDL_UnlockAudio() in your code.  If it is NULL, the application
+ *     feeds the device with SDL_QueueAudio() instead.
  * - 'desired->userdata' is passed as the first parameter to your callback
  *     function.
  *
@@ -105,6 +108,12 @@ typedef struct SDL_AudioSpec {
 #define AUDIO_S16MSB	0x9010	/**< As above, but big-endian byte order */
 #define AUDIO_U16	AUDIO_U16LSB
 #define AUDIO_S16	AUDIO_S16LSB
+#define AUDIO_S32LSB	0x8020	/**< 32-bit integer samples */
+#define AUDIO_S32MSB	0x9020	/**< As above, but big-endian byte order */
+#define AUDIO_S32	AUDIO_S32LSB
+#define AUDIO_F32LSB	0x8120	/**< 32-bit floating point samples, -1.0 to 1.0 */
+#define AUDIO_F32MSB	0x9120	/**< As above, but big-endian byte order */
+#define AUDIO_F32	AUDIO_F32LSB
 
 /**
  *  @name Native audio byte ordering
@@ -113,9 +122,13 @@ typedef struct SDL_AudioSpec {
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 #define AUDIO_U16SYS	AUDIO_U16LSB
 #define AUDIO_S16SYS	AUDIO_S16LSB
+#define AUDIO_S32SYS	AUDIO_S32LSB
+#define AUDIO_F32SYS	AUDIO_F32LSB
 #else
 #define AUDIO_U16SYS	AUDIO_U16MSB
 #define AUDIO_S16SYS	AUDIO_S16MSB
+#define AUDIO_S32SYS	AUDIO_S32MSB
+#define AUDIO_F32SYS	AUDIO_F32MSB
 #endif
 /*@}*/
 
@@ -195,6 +208,36 @@ extern DECLSPEC SDL_audiostatus SDLCALL SDL_GetAudioStatus(void);
  */
 extern DECLSPEC void SDLCALL SDL_PauseAudio(int pause_on);
 
+/**
+ * @name Queued Audio
+ * When the audio device is opened with a NULL callback, the application
+ * pushes audio data in the format it asked for with SDL_QueueAudio(),
+ * and the audio thread plays it from there, with silence when it runs
+ * out.  The queue is a fixed size ring with room for at least half a
+ * second of audio, and neither side takes the audio lock to use it.
+ *
+ * Only one thread at a time may queue or clear audio.
+ */
+/*@{*/
+/**
+ * Adds as much of 'len' bytes of audio data to the queue as will fit,
+ * in whole sample frames.  Returns the number of bytes queued, which is
+ * less than 'len' when the queue is full, or -1 if the audio device
+ * wasn't opened for queueing.
+ */
+extern DECLSPEC int SDLCALL SDL_QueueAudio(const void *data, Uint32 len);
+
+/** Returns the number of bytes of audio data still waiting to be played */
+extern DECLSPEC Uint32 SDLCALL SDL_GetQueuedAudioSize(void);
+
+/**
+ * Throws away the audio data still waiting to be played.  Data queued
+ * afterwards plays as usual, but the space is only freed the next time
+ * the audio thread takes from the queue.
+ */
+extern DECLSPEC void SDLCALL SDL_ClearQueuedAudio(void);
+/*@}*/
+
 /**
  * This function loads a WAVE from the data source, automatically freeing
  * that source if 'freesrc' is non-zero.  For example, to load a WAVE file,
@@ -223,6 +266,37 @@ extern DECLSPEC SDL_AudioSpec * SDLCALL SDL_LoadWAV_RW(SDL_RWops *src, int frees
  */
 extern DECLSPEC void SDLCALL SDL_FreeWAV(Uint8 *audio_buf);
 
+/**
+ * @name WAV Streams
+ * A WAV stream reads a WAVE file a little at a time, decoding ADPCM data
+ * a block at a time as it goes, instead of loading the whole file into
+ * memory like SDL_LoadWAV_RW() does.  The data source is read from as
+ * the stream is read, so it mustn't be used for anything else meanwhile.
+ */
+/*@{*/
+typedef struct SDL_WAVStream SDL_WAVStream;
+
+/**
+ * Opens a WAV stream on a data source, closing the source along with the
+ * stream if 'freesrc' is non-zero.  Fills in 'spec' with the format of
+ * the audio data that reading the stream gives, like SDL_LoadWAV_RW().
+ * Returns NULL and sets the SDL error message if it fails.
+ */
+extern DECLSPEC SDL_WAVStream * SDLCALL SDL_OpenWAVStream(SDL_RWops *src, int freesrc, SDL_AudioSpec *spec);
+
+/**
+ * Reads up to 'frames' sample frames into 'buf'.  Returns the number of
+ * frames read, 0 at the end of the data, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_ReadWAVStream(SDL_WAVStream *stream, void *buf, int frames);
+
+/** Moves to sample frame 'frame', returning 0, or -1 if it can't */
+extern DECLSPEC int SDLCALL SDL_SeekWAVStream(SDL_WAVStream *stream, Uint32 frame);
+
+/** Closes a WAV stream, and its data source if it was asked to */
+extern DECLSPEC void SDLCALL SDL_CloseWAVStream(SDL_WAVStream *stream);
+/*@}*/
+
 /**
  * This function takes a source format and rate and a destination format
  * and rate, and initializes the 'cvt' structure with information needed
@@ -246,6 +320,67 @@ extern DECLSPEC int SDLCALL SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
  */
 extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
 
+/**
+ * @name Audio Streams
+ * An audio stream converts audio data from one format, channel count and
+ * rate to another, like SDL_ConvertAudio(), but takes its input a piece
+ * at a time.  Data of any length can be put into the stream, and the
+ * converted data read back out whenever some is available.  The filter
+ * state carries over from one piece to the next, so a long sound
+ * converted in pieces comes out the same as if it had been converted all
+ * at once, with no clicks where the pieces meet.
+ *
+ * Converted data is kept in the stream until it is read, so the stream
+ * grows if data is put in faster than it is taken out.  An audio stream
+ * can only be used by one thread at a time.
+ */
+/*@{*/
+typedef struct SDL_AudioStream SDL_AudioStream;
+
+/**
+ * Create an audio stream converting between the given formats, or return
+ * NULL if the conversion isn't supported or there isn't enough memory.
+ */
+extern DECLSPEC SDL_AudioStream * SDLCALL SDL_NewAudioStream(
+		Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate);
+
+/**
+ * Add 'len' bytes of audio data in the source format to the stream.
+ * The data doesn't have to end on a whole sample frame; any part left
+ * over is kept until the rest of it arrives.
+ *
+ * @return 0, or -1 if there wasn't enough memory.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len);
+
+/**
+ * Read up to 'len' bytes of converted audio data from the stream.
+ * Only whole sample frames are read.
+ *
+ * @return The number of bytes read, which may be 0.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len);
+
+/** Get the number of converted bytes that are ready to be read */
+extern DECLSPEC int SDLCALL SDL_AudioStreamAvailable(SDL_AudioStream *stream);
+
+/**
+ * Tell the stream that no more data is coming for now, so that the audio
+ * still held back for filtering is converted and can be read.  Data put
+ * in after this starts over, as if the stream were new.
+ *
+ * @return 0, or -1 if there wasn't enough memory.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamFlush(SDL_AudioStream *stream);
+
+/** Throw away all the data in the stream, converted or not */
+extern DECLSPEC void SDLCALL SDL_AudioStreamClear(SDL_AudioStream *stream);
+
+/** Free an audio stream created with SDL_NewAudioStream() */
+extern DECLSPEC void SDLCALL SDL_FreeAudioStream(SDL_AudioStream *stream);
+/*@}*/
+
 
 #define SDL_MIX_MAXVOLUME 128
 /**
@@ -253,10 +388,20 @@ extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
  * them, performing addition, volume adjustment, and overflow clipping.
  * The volume ranges from 0 - 128, and should be set to SDL_MIX_MAXVOLUME
  * for full audio volume.  Note this does not change hardware volume.
+ * Floating point samples are clipped to the range -1.0 to 1.0.
  * This is provided for convenience -- you can mix your own audio data.
  */
 extern DECLSPEC void SDLCALL SDL_MixAudio(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
 
+/**
+ * This mixes 'num_src' audio buffers of the playing audio format into
+ * 'dst' at once, each at its own volume from 0 - 128.  The sources are
+ * added up at full precision and only clipped once at the end, so mixing
+ * many voices this way is faster than calling SDL_MixAudio() for each of
+ * them, and sounds better when they get loud.
+ */
+extern DECLSPEC void SDLCALL SDL_MixAudioMany(Uint8 *dst, const Uint8 * const *src, const int *volume, int num_src, Uint32 len);
+
 /**
  * @name Audio Locks
  * The lock manipulated by these functions protects the callback function.
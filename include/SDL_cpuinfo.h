@@ -57,6 +57,9 @@ extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE(void);
 /** This function returns true if the CPU has SSE2 features */
 extern DECLSPEC SDL_bool SDLCALL SDL_HasSSE2(void);
 
+/** This function returns true if the CPU and OS support AVX2 features */
+extern DECLSPEC SDL_bool SDLCALL SDL_HasAVX2(void);
+
 /** This function returns true if the CPU has AltiVec features */
 extern DECLSPEC SDL_bool SDLCALL SDL_HasAltiVec(void);
 
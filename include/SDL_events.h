@@ -289,12 +289,49 @@ extern DECLSPEC int SDLCALL SDL_PollEvent(SDL_Event *event);
  */
 extern DECLSPEC int SDLCALL SDL_WaitEvent(SDL_Event *event);
 
+/** Waits up to 'timeout' milliseconds for the next available event, returning
+ *  1, or 0 if the timeout ran out or there was an error while waiting for
+ *  events.  A negative timeout waits indefinitely, like SDL_WaitEvent().
+ *  If 'event' is not NULL, the next event is removed from the queue and
+ *  stored in that area.
+ */
+extern DECLSPEC int SDLCALL SDL_WaitEventTimeout(SDL_Event *event, int timeout);
+
 /** Add an event to the event queue.
  *  This function returns 0 on success, or -1 if the event queue was full
  *  or there was some other error.
  */
 extern DECLSPEC int SDLCALL SDL_PushEvent(SDL_Event *event);
 
+/**
+ *  Set the maximum number of events the event queue may hold.
+ *
+ *  The queue starts out small and grows as needed up to this size, after
+ *  which new events are dropped.  If this isn't called, the maximum is
+ *  taken from the SDL_EVENT_QUEUE_SIZE environment variable, or 65535.
+ *  It can be called before or after the video subsystem is initialized,
+ *  but the queue won't shrink below what it has already grown to.
+ *
+ *  @return 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_SetEventQueueSize(int maxevents);
+
+/** Event queue usage, for sizing the queue in production */
+typedef struct SDL_EventQueueStats {
+	int size;		/**< Number of events the queue has room for now */
+	int maxsize;		/**< Number of events the queue may grow to */
+	int used;		/**< Number of events currently queued */
+	int highwater;		/**< Most events ever queued at once */
+	Uint32 dropped;		/**< Events lost because the queue was full */
+	Uint32 dropped_type[SDL_NUMEVENTS];	/**< Dropped events by type */
+} SDL_EventQueueStats;
+
+/**
+ *  Fill in 'stats' with the state of the event queue.  The counts start
+ *  from zero whenever the video subsystem is initialized.
+ */
+extern DECLSPEC void SDLCALL SDL_GetEventQueueStats(SDL_EventQueueStats *stats);
+
 /** @name Event Filtering */
 /*@{*/
 typedef int (SDLCALL *SDL_EventFilter)(const SDL_Event *event);
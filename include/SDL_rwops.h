@@ -90,6 +90,22 @@ typedef struct SDL_RWops {
 	    } unknown;
 	} hidden;
 
+	/* These come last, so the ones above stay where they were.
+	 * SDL_AllocRW() sets them to NULL, and marks the data source in
+	 * 'type' as one that has them.  They aren't used on data sources
+	 * allocated any other way, or whose 'type' has been changed.
+	 */
+
+	/** Seek as 'seek' does, with 64-bit offsets.
+	 *  If NULL, SDL_RWseek64() uses 'seek' for offsets that fit.
+	 */
+	Sint64 (SDLCALL *seek64)(struct SDL_RWops *context, Sint64 offset, int whence);
+
+	/** Return the size of the data source in bytes, or -1 if it's unknown.
+	 *  If NULL, SDL_RWsize() seeks to the end and back.
+	 */
+	Sint64 (SDLCALL *size)(struct SDL_RWops *context);
+
 } SDL_RWops;
 
 
@@ -105,6 +121,36 @@ extern DECLSPEC SDL_RWops * SDLCALL SDL_RWFromFP(FILE *fp, int autoclose);
 extern DECLSPEC SDL_RWops * SDLCALL SDL_RWFromMem(void *mem, int size);
 extern DECLSPEC SDL_RWops * SDLCALL SDL_RWFromConstMem(const void *mem, int size);
 
+/**
+ * Open a file for reading by mapping it into memory, where it can be read
+ * without copying it through stdio.  Where files can't be mapped, the
+ * whole file is read into memory instead.  The file can't be written to.
+ */
+extern DECLSPEC SDL_RWops * SDLCALL SDL_RWFromMappedFile(const char *file);
+
+/**
+ * Get the memory a data source reads from, for data sources created by
+ * SDL_RWFromMappedFile(), SDL_RWFromMem() or SDL_RWFromConstMem().
+ * The data stays valid until the data source is closed.
+ *
+ * @param size If not NULL, set to the size of the data in bytes
+ * @return A pointer to the start of the data, whatever the current
+ *         position is, or NULL if the data source isn't in memory
+ */
+extern DECLSPEC const void * SDLCALL SDL_RWGetMapping(SDL_RWops *context, int *size);
+
+/**
+ * Read and write another data source through a buffer, in blocks of
+ * 'bufsize' bytes, or a default size if it's 0.  Small reads and writes,
+ * like those SDL_LoadBMP_RW() and SDL_LoadWAV_RW() make, and seeks
+ * within the buffer then don't call the data source at all.
+ *
+ * Reading ahead moves the data source past what's been read, until the
+ * buffered data source is closed.  If 'autoclose' is non-zero, closing
+ * it closes 'src' as well.
+ */
+extern DECLSPEC SDL_RWops * SDLCALL SDL_RWFromBuffered(SDL_RWops *src, int bufsize, int autoclose);
+
 extern DECLSPEC SDL_RWops * SDLCALL SDL_AllocRW(void);
 extern DECLSPEC void SDLCALL SDL_FreeRW(SDL_RWops *area);
 
@@ -126,6 +172,63 @@ extern DECLSPEC void SDLCALL SDL_FreeRW(SDL_RWops *area);
 #define SDL_RWclose(ctx)		(ctx)->close(ctx)
 /*@}*/
 
+#ifdef SDL_HAS_64BIT_TYPE
+/** @name 64-bit seeking, for data sources larger than 2 GB */
+/*@{*/
+/**
+ * Seek to 'offset' relative to whence, and return the final offset in the
+ * data source, or -1 if the seek failed.  Data sources that can only seek
+ * with 32-bit offsets fail if the offset or the result doesn't fit.
+ */
+extern DECLSPEC Sint64 SDLCALL SDL_RWseek64(SDL_RWops *context, Sint64 offset, int whence);
+
+/** Return the size of the data source in bytes, or -1 if it's unknown */
+extern DECLSPEC Sint64 SDLCALL SDL_RWsize(SDL_RWops *context);
+
+#define SDL_RWtell64(ctx)		SDL_RWseek64(ctx, 0, RW_SEEK_CUR)
+/*@}*/
+
+/** @name Asynchronous reads, done by a pool of I/O threads */
+/*@{*/
+typedef struct SDL_RWAsync SDL_RWAsync;
+
+/**
+ * Start reading 'size' bytes into 'ptr' from 'offset' in the data source,
+ * or from wherever it is if 'offset' is negative, and return right away.
+ * Requests for the same data source are read one at a time, but the data
+ * source shouldn't be used in any other way until they're finished.
+ *
+ * If 'event_type' isn't SDL_NOEVENT, an event of that type (usually one
+ * from SDL_USEREVENT on) is pushed onto the event queue when the read is
+ * done, with the number of bytes read, or -1, in 'code', the request in
+ * 'data1' and 'userdata' in 'data2'.  Otherwise, use SDL_RWpollAsync().
+ *
+ * Every request has to be finished with SDL_RWwaitAsync() or
+ * SDL_RWcancelAsync(), which frees it, even after its event arrives.
+ *
+ * @return The request, or NULL if it couldn't be made
+ */
+extern DECLSPEC SDL_RWAsync * SDLCALL SDL_RWreadAsync(SDL_RWops *context, Sint64 offset, void *ptr, int size, Uint8 event_type, void *userdata);
+
+/** Return 1 if the read is done, and 0 if it's still in progress */
+extern DECLSPEC int SDLCALL SDL_RWpollAsync(SDL_RWAsync *request);
+
+/**
+ * Wait for the read to be done, and free the request.
+ * @return The number of bytes read, or -1 if the read failed
+ */
+extern DECLSPEC int SDLCALL SDL_RWwaitAsync(SDL_RWAsync *request);
+
+/**
+ * Cancel the read if it hasn't started, otherwise wait for it to be done,
+ * and free the request.
+ * @return The number of bytes read, or -1 if the read failed or was
+ *         cancelled
+ */
+extern DECLSPEC int SDLCALL SDL_RWcancelAsync(SDL_RWAsync *request);
+/*@}*/
+#endif /* SDL_HAS_64BIT_TYPE */
+
 /** @name Read an item of the specified endianness and return in native format */
 /*@{*/
 extern DECLSPEC Uint16 SDLCALL SDL_ReadLE16(SDL_RWops *src);
@@ -39,7 +39,7 @@ extern "C" {
 /** This is the OS scheduler timeslice, in milliseconds */
 #define SDL_TIMESLICE		10
 
-/** This is the maximum resolution of the SDL timer on all platforms */
+/** This is the coarsest resolution of the SDL timer on any platform */
 #define TIMER_RESOLUTION	10	/**< Experimentally determined */
 
 /**
@@ -51,6 +51,18 @@ extern DECLSPEC Uint32 SDLCALL SDL_GetTicks(void);
 /** Wait a specified number of milliseconds before returning */
 extern DECLSPEC void SDLCALL SDL_Delay(Uint32 ms);
 
+#ifdef SDL_HAS_64BIT_TYPE
+/**
+ * Get the current value of the high resolution counter, for timing short
+ * stretches of code.  The counter starts at an arbitrary value, never goes
+ * backwards, and ticks SDL_GetPerformanceFrequency() times a second.
+ */
+extern DECLSPEC Uint64 SDLCALL SDL_GetPerformanceCounter(void);
+
+/** Get the number of ticks per second of the high resolution counter */
+extern DECLSPEC Uint64 SDLCALL SDL_GetPerformanceFrequency(void);
+#endif /* SDL_HAS_64BIT_TYPE */
+
 /** Function prototype for the timer callback function */
 typedef Uint32 (SDLCALL *SDL_TimerCallback)(Uint32 interval);
 
@@ -67,12 +79,11 @@ typedef Uint32 (SDLCALL *SDL_TimerCallback)(Uint32 interval);
  * The timer callback function may run in a different thread than your
  * main code, and so shouldn't call any functions from within itself.
  *
- * The maximum resolution of this timer is 10 ms, which means that if
- * you request a 16 ms timer, your callback will run approximately 20 ms
- * later on an unloaded system.  If you wanted to set a flag signaling
- * a frame update at 30 frames per second (every 33 ms), you might set a 
- * timer for 30 ms:
- *   @code SDL_SetTimer((33/10)*10, flag_update); @endcode
+ * Where SDL runs timers from a thread of its own, as it does on UNIX,
+ * intervals are kept to the millisecond, so a 16 ms timer runs every
+ * 16 ms on an unloaded system.  Elsewhere the resolution of this timer
+ * may only be TIMER_RESOLUTION (10 ms), which means that if you request
+ * a 16 ms timer, your callback will run approximately 20 ms later.
  *
  * If you use this function, you need to pass SDL_INIT_TIMER to SDL_Init().
  *
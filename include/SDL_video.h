@@ -481,6 +481,11 @@ extern DECLSPEC int SDLCALL SDL_SetColors(SDL_Surface *surface,
  *
  * SDL_SetColors() is equivalent to calling this function with
  *     flags = (SDL_LOGPAL|SDL_PHYSPAL).
+ *
+ * SDL caches how colors map to a surface's logical palette.  If you write
+ * to its colors directly, pass them to this function afterwards, or
+ * SDL_MapRGB() may go on matching the old colors until the palette is
+ * next blitted to.
  */
 extern DECLSPEC int SDLCALL SDL_SetPalette(SDL_Surface *surface, int flags,
 				   SDL_Color *colors, int firstcolor,
@@ -941,6 +946,28 @@ extern DECLSPEC SDL_GrabMode SDLCALL SDL_WM_GrabInput(SDL_GrabMode mode);
 /** @internal Not in public API at the moment - do not use! */
 extern DECLSPEC int SDLCALL SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                                     SDL_Surface *dst, SDL_Rect *dstrect);
+
+/** How SDL_SoftStretchFiltered() works out each destination pixel */
+typedef enum {
+	SDL_STRETCH_NEAREST,	/**< The nearest source pixel, as SDL_SoftStretch() */
+	SDL_STRETCH_BILINEAR,	/**< Between the four nearest source pixels */
+	SDL_STRETCH_BOX		/**< The average of the source pixels it covers */
+} SDL_StretchFilter;
+
+/**
+ * Stretch a rectangle of one surface into a rectangle of another,
+ * using the given filter.  A NULL rectangle means the whole surface.
+ *
+ * Surfaces of the same format can be stretched with SDL_STRETCH_NEAREST,
+ * otherwise both surfaces need 16, 24 or 32 bits per pixel, and the
+ * pixels are converted between their formats.  SDL_STRETCH_BOX is best
+ * for shrinking, since it takes every source pixel into account.
+ *
+ * @return 0 if the stretch succeeded, or -1 if there was an error
+ */
+extern DECLSPEC int SDLCALL SDL_SoftStretchFiltered(SDL_Surface *src, SDL_Rect *srcrect,
+                                    SDL_Surface *dst, SDL_Rect *dstrect,
+                                    SDL_StretchFilter filter);
                     
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
@@ -47,6 +47,14 @@ extern void SDL_StartTicks(void);
 extern int  SDL_TimerInit(void);
 extern void SDL_TimerQuit(void);
 #endif
+#if !SDL_VIDEO_DISABLED
+extern void SDL_InitBlitThreads(void);
+extern void SDL_QuitBlitThreads(void);
+#endif
+#ifdef SDL_HAS_64BIT_TYPE
+extern void SDL_RWInitAsync(void);
+extern void SDL_RWQuitAsync(void);
+#endif
 
 /* The current SDL version */
 static SDL_version version = 
@@ -158,6 +166,13 @@ int SDL_Init(Uint32 flags)
 	/* Clear the error message */
 	SDL_ClearError();
 
+#if !SDL_VIDEO_DISABLED
+	SDL_InitBlitThreads();
+#endif
+#ifdef SDL_HAS_64BIT_TYPE
+	SDL_RWInitAsync();
+#endif
+
 	/* Initialize the desired subsystems */
 	if ( SDL_InitSubSystem(flags) < 0 ) {
 		return(-1);
@@ -218,8 +233,16 @@ void SDL_Quit(void)
 	/* Quit all subsystems */
 #ifdef DEBUG_BUILD
   printf("[SDL_Quit] : Enter! Calling QuitSubSystem()\n"); fflush(stdout);
+#endif
+	/* The I/O threads can still be pushing events */
+#ifdef SDL_HAS_64BIT_TYPE
+	SDL_RWQuitAsync();
 #endif
 	SDL_QuitSubSystem(SDL_INIT_EVERYTHING);
+#if !SDL_VIDEO_DISABLED
+	/* Software blits work without the video subsystem */
+	SDL_QuitBlitThreads();
+#endif
 
 #ifdef CHECK_LEAKS
 #ifdef DEBUG_BUILD
@@ -27,6 +27,7 @@
 #include "SDL_audio_c.h"
 #include "SDL_audiomem.h"
 #include "SDL_sysaudio.h"
+#include "../thread/SDL_atomic_c.h"
 
 #ifdef __OS2__
 /* We'll need the DosSetPriority() API! */
@@ -124,15 +125,125 @@ SDL_AudioDevice *current_audio = NULL;
 int SDL_AudioInit(const char *driver_name);
 void SDL_AudioQuit(void);
 
+/* Queued audio
+
+   The application adds to the head of the ring and the audio thread
+   takes from the tail, each only writing its own position, so with
+   atomic operations neither has to wait for the other.  Clearing the
+   queue can't move the tail from the application's side, so it leaves
+   the head where the tail should skip to and counts a request, which
+   the audio thread answers by moving the tail itself.  The count is odd
+   while the clear position is being written, so the audio thread never
+   takes a position that doesn't go with the count it saw.  Without
+   atomic operations, the audio lock covers the queue.
+ */
+#if SDL_HAVE_ATOMICS
+#define QUEUE_GET(x)		SDL_AtomicGet(&(x))
+#define QUEUE_SET(x, v)		SDL_AtomicSet(&(x), (v))
+#define QUEUE_LOCK()
+#define QUEUE_UNLOCK()
+#else
+#define QUEUE_GET(x)		(x)
+#define QUEUE_SET(x, v)		((x) = (v))
+#define QUEUE_LOCK()		SDL_LockAudio()
+#define QUEUE_UNLOCK()		SDL_UnlockAudio()
+#endif
+
+static SDL_AudioQueue *SDL_CreateAudioQueue(SDL_AudioSpec *spec)
+{
+	SDL_AudioQueue *queue;
+	int frame, size;
+
+	/* Room for half a second, and at least four buffers */
+	frame = (spec->format & 0xFF) / 8 * spec->channels;
+	size = 1;
+	while ( (size < spec->freq / 2 * frame) ||
+	        (size < (int)spec->size * 4) ) {
+		size *= 2;
+	}
+	queue = (SDL_AudioQueue *)SDL_malloc(sizeof(*queue));
+	if ( queue ) {
+		SDL_memset(queue, 0, sizeof(*queue));
+		queue->data = (Uint8 *)SDL_malloc(size);
+		if ( ! queue->data ) {
+			SDL_free(queue);
+			queue = NULL;
+		}
+	}
+	if ( ! queue ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	queue->size = size;
+	queue->frame = frame;
+	return(queue);
+}
+
+static void SDL_FreeAudioQueue(SDL_AudioQueue *queue)
+{
+	SDL_free(queue->data);
+	SDL_free(queue);
+}
+
+/* Where the audio thread will take from next, after any clearing it
+   hasn't done yet.  Read this before the head, which is never behind it.
+   If 'request' isn't NULL, it's set to the clear this position goes
+   with, or to the last one done if a clear is being written. */
+static int SDL_AudioQueueTail(SDL_AudioQueue *queue, int *request)
+{
+	int done = QUEUE_GET(queue->clear_done);	/* Written after the tail */
+	int tail = QUEUE_GET(queue->tail);
+	int r = QUEUE_GET(queue->clear_request);
+	int clear;
+
+	if ( r != done && !(r & 1) ) {
+		clear = QUEUE_GET(queue->clear);
+		if ( QUEUE_GET(queue->clear_request) == r ) {
+			tail = clear;
+			done = r;
+		}
+	}
+	if ( request ) {
+		*request = done;
+	}
+	return(tail);
+}
+
+/* The callback for the audio thread when the application queues audio */
+static void SDLCALL SDL_DrainAudioQueue(void *userdata, Uint8 *stream, int len)
+{
+	SDL_AudioQueue *queue = ((SDL_AudioDevice *)userdata)->queue;
+	int head, tail, pos, n, first, request;
+
+	/* Take any clearing requested since the last time */
+	tail = SDL_AudioQueueTail(queue, &request);
+	if ( request != queue->clear_done ) {
+		QUEUE_SET(queue->tail, tail);
+		QUEUE_SET(queue->clear_done, request);
+	}
+	head = QUEUE_GET(queue->head);
+	n = (int)((unsigned)head - (unsigned)tail);
+	if ( n > len ) {
+		n = len - (len % queue->frame);
+	}
+	pos = tail & (queue->size - 1);
+	first = SDL_min(n, queue->size - pos);
+	SDL_memcpy(stream, queue->data + pos, first);
+	SDL_memcpy(stream + first, queue->data, n - first);
+	QUEUE_SET(queue->tail, (int)((unsigned)tail + n));
+}
+
 /* The general mixing thread function */
 int SDLCALL SDL_RunAudio(void *audiop)
 {
 	SDL_AudioDevice *audio = (SDL_AudioDevice *)audiop;
 	Uint8 *stream;
 	int    stream_len;
+	int    len;
 	void  *udata;
 	void (SDLCALL *fill)(void *userdata,Uint8 *stream, int len);
 	int    silence;
+	int    lock;
 
 	/* Perform any thread setup */
 	if ( audio->ThreadInit ) {
@@ -143,8 +254,13 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	/* Set up the mixing function */
 	fill  = audio->spec.callback;
 	udata = audio->spec.userdata;
+#if SDL_HAVE_ATOMICS
+	lock  = (audio->queue == NULL);
+#else
+	lock  = 1;
+#endif
 
-	if ( audio->convert.needed ) {
+	if ( audio->stream ) {
 		if ( audio->convert.src_format == AUDIO_U8 ) {
 			silence = 0x80;
 		} else {
@@ -181,36 +297,44 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	while ( audio->enabled ) {
 
 		/* Fill the current buffer with sound */
-		if ( audio->convert.needed ) {
-			if ( audio->convert.buf ) {
-				stream = audio->convert.buf;
-			} else {
-				continue;
-			}
-		} else {
-			stream = audio->GetAudioBuf(audio);
-			if ( stream == NULL ) {
-				stream = audio->fake_stream;
-			}
+		stream = audio->GetAudioBuf(audio);
+		if ( stream == NULL ) {
+			stream = audio->fake_stream;
 		}
 
-		SDL_memset(stream, silence, stream_len);
-
-		if ( ! audio->paused ) {
-			SDL_mutexP(audio->mixer_lock);
-			(*fill)(udata, stream, stream_len);
-			SDL_mutexV(audio->mixer_lock);
-		}
+		if ( audio->stream ) {
+			/* Convert as much as it takes to fill the device buffer */
+			while ( SDL_AudioStreamAvailable(audio->stream) < (int)audio->spec.size ) {
+				SDL_memset(audio->convert.buf, silence, stream_len);
+				if ( ! audio->paused ) {
+					if ( lock ) {
+						SDL_mutexP(audio->mixer_lock);
+					}
+					(*fill)(udata, audio->convert.buf, stream_len);
+					if ( lock ) {
+						SDL_mutexV(audio->mixer_lock);
+					}
+				}
+				if ( SDL_AudioStreamPut(audio->stream, audio->convert.buf, stream_len) < 0 ) {
+					break;
+				}
+			}
+			len = SDL_AudioStreamGet(audio->stream, stream, audio->spec.size);
+			if ( len < (int)audio->spec.size ) {
+				SDL_memset(stream + len, audio->spec.silence, audio->spec.size - len);
+			}
+		} else {
+			SDL_memset(stream, silence, stream_len);
 
-		/* Convert the audio if necessary */
-		if ( audio->convert.needed ) {
-			SDL_ConvertAudio(&audio->convert);
-			stream = audio->GetAudioBuf(audio);
-			if ( stream == NULL ) {
-				stream = audio->fake_stream;
+			if ( ! audio->paused ) {
+				if ( lock ) {
+					SDL_mutexP(audio->mixer_lock);
+				}
+				(*fill)(udata, stream, stream_len);
+				if ( lock ) {
+					SDL_mutexV(audio->mixer_lock);
+				}
 			}
-			SDL_memcpy(stream, audio->convert.buf,
-			               audio->convert.len_cvt);
 		}
 
 		/* Ready current buffer for play and change current buffer */
@@ -268,6 +392,10 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 		++string;
 		format |= 0x8000;
 		break;
+	    case 'F':
+		++string;
+		format |= 0x8100;
+		break;
 	    default:
 		return 0;
 	}
@@ -277,8 +405,9 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 		format |= 8;
 		break;
 	    case 16:
+	    case 32:
+		format |= SDL_atoi(string);
 		string += 2;
-		format |= 16;
 		if ( SDL_strcmp(string, "LSB") == 0
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 		     || SDL_strcmp(string, "SYS") == 0
@@ -297,6 +426,13 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 	    default:
 		return 0;
 	}
+	/* Only 32-bit samples come as floats, and only signed */
+	if ( (format & 0x0100) && ((format & 0xFF) != 32) ) {
+		return 0;
+	}
+	if ( ((format & 0xFF) == 32) && !(format & 0x8000) ) {
+		return 0;
+	}
 	return format;
 }
 
@@ -397,6 +533,32 @@ char *SDL_AudioDriverName(char *namebuf, int maxlen)
 	return(NULL);
 }
 
+/* Drivers that convert in place (opened == 2) fill each device buffer
+   from exactly one application buffer, with no history between them,
+   so only doubling or halving the rate comes out to whole buffers.
+   They get the desired rate doubled or halved as close to the device
+   rate as it goes, and the rest of the difference is left alone.  Only
+   the ratio of the rates passed back matters to the conversion.
+ */
+static void SDL_InPlaceAudioRates(int *src_rate, int *dst_rate)
+{
+	int rate = *src_rate;
+	int mult = 1;
+
+	if ( rate < *dst_rate ) {
+		while ( ((rate*mult*2)/100) <= (*dst_rate/100) ) {
+			mult *= 2;
+		}
+		*dst_rate = rate*mult;
+	} else {
+		while ( ((rate/(mult*2))/100) >= (*dst_rate/100) ) {
+			mult *= 2;
+		}
+		*src_rate = rate*mult;
+		*dst_rate = rate;
+	}
+}
+
 int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 {
 	SDL_AudioDevice *audio;
@@ -472,11 +634,6 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 		}
 		desired->samples = power2;
 	}
-	if ( desired->callback == NULL ) {
-		SDL_SetError("SDL_OpenAudio() passed a NULL callback");
-		return(-1);
-	}
-
 #if SDL_THREADS_DISABLED
 	/* Uses interrupt driven audio, without thread */
 #else
@@ -492,9 +649,28 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	/* Calculate the silence and size of the audio specification */
 	SDL_CalculateAudioSpec(desired);
 
+	/* Without a callback, the application queues audio for us */
+	if ( desired->callback == NULL ) {
+		audio->queue = SDL_CreateAudioQueue(desired);
+		if ( audio->queue == NULL ) {
+			SDL_CloseAudio();
+			return(-1);
+		}
+	}
+
 	/* Open the audio subsystem */
 	SDL_memcpy(&audio->spec, desired, sizeof(audio->spec));
+	if ( audio->queue ) {
+		audio->spec.callback = SDL_DrainAudioQueue;
+		audio->spec.userdata = audio;
+	}
+	if ( (audio->spec.format & 0xFF) == 32 ) {
+		/* None of the drivers play 32-bit samples, so convert them */
+		audio->spec.format = AUDIO_S16SYS;
+		SDL_CalculateAudioSpec(&audio->spec);
+	}
 	audio->convert.needed = 0;
+	audio->stream = NULL;
 	audio->enabled = 1;
 	audio->paused  = 1;
 
@@ -522,21 +698,47 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	/* See if we need to do any conversion */
 	if ( obtained != NULL ) {
 		SDL_memcpy(obtained, &audio->spec, sizeof(audio->spec));
+		obtained->callback = desired->callback;
+		obtained->userdata = desired->userdata;
 	} else if ( desired->freq != audio->spec.freq ||
                     desired->format != audio->spec.format ||
 	            desired->channels != audio->spec.channels ) {
+		int src_freq = desired->freq;
+		int dst_freq = audio->spec.freq;
+
+		if ( audio->opened == 2 ) {
+			SDL_InPlaceAudioRates(&src_freq, &dst_freq);
+		}
+
 		/* Build an audio conversion block */
 		if ( SDL_BuildAudioCVT(&audio->convert,
 			desired->format, desired->channels,
-					desired->freq,
+					src_freq,
 			audio->spec.format, audio->spec.channels,
-					audio->spec.freq) < 0 ) {
+					dst_freq) < 0 ) {
 			SDL_CloseAudio();
 			return(-1);
 		}
-		if ( audio->convert.needed ) {
+		if ( audio->convert.needed && (audio->opened == 1) ) {
+			/* The audio thread converts through a stream, so the
+			   callback can fill buffers of the size it asked for */
+			audio->stream = SDL_NewAudioStream(
+				desired->format, desired->channels, desired->freq,
+				audio->spec.format, audio->spec.channels, audio->spec.freq);
+			audio->convert.len = desired->size;
+			audio->convert.buf = (Uint8 *)SDL_AllocAudioMem(audio->convert.len);
+			if ( (audio->stream == NULL) || (audio->convert.buf == NULL) ) {
+				SDL_CloseAudio();
+				SDL_OutOfMemory();
+				return(-1);
+			}
+		} else if ( audio->convert.needed ) {
+			int frame = ((desired->format & 0xFF) / 8) * desired->channels;
+
+			/* Whole frames, which convert to exactly spec.size */
 			audio->convert.len = (int) ( ((double) audio->spec.size) /
                                           audio->convert.len_ratio );
+			audio->convert.len -= audio->convert.len % frame;
 			audio->convert.buf =(Uint8 *)SDL_AllocAudioMem(
 			   audio->convert.len*audio->convert.len_mult);
 			if ( audio->convert.buf == NULL ) {
@@ -597,6 +799,69 @@ void SDL_PauseAudio (int pause_on)
 	}
 }
 
+int SDL_QueueAudio (const void *data, Uint32 len)
+{
+	SDL_AudioDevice *audio = current_audio;
+	SDL_AudioQueue *queue;
+	int head, pos, n, first;
+
+	if ( ! audio || ! audio->queue ) {
+		SDL_SetError("Audio device isn't open for queueing");
+		return(-1);
+	}
+	queue = audio->queue;
+
+	QUEUE_LOCK();
+	head = queue->head;
+	n = queue->size - (int)((unsigned)head - (unsigned)SDL_AudioQueueTail(queue, NULL));
+	if ( n < 0 ) {
+		QUEUE_UNLOCK();
+		SDL_SetError("Audio queue is corrupt");
+		return(-1);
+	}
+	if ( (Uint32)n > len ) {
+		n = (int)len;
+	}
+	n -= (n % queue->frame);
+	pos = head & (queue->size - 1);
+	first = SDL_min(n, queue->size - pos);
+	SDL_memcpy(queue->data + pos, data, first);
+	SDL_memcpy(queue->data, (const Uint8 *)data + first, n - first);
+	QUEUE_SET(queue->head, (int)((unsigned)head + n));
+	QUEUE_UNLOCK();
+	return(n);
+}
+
+Uint32 SDL_GetQueuedAudioSize (void)
+{
+	SDL_AudioDevice *audio = current_audio;
+	int tail, used;
+
+	if ( ! audio || ! audio->queue ) {
+		return(0);
+	}
+	QUEUE_LOCK();
+	tail = SDL_AudioQueueTail(audio->queue, NULL);
+	used = (int)((unsigned)QUEUE_GET(audio->queue->head) - (unsigned)tail);
+	QUEUE_UNLOCK();
+	return(used);
+}
+
+void SDL_ClearQueuedAudio (void)
+{
+	SDL_AudioDevice *audio = current_audio;
+
+	if ( audio && audio->queue ) {
+		QUEUE_LOCK();
+		QUEUE_SET(audio->queue->clear_request,
+		          audio->queue->clear_request + 1);
+		QUEUE_SET(audio->queue->clear, audio->queue->head);
+		QUEUE_SET(audio->queue->clear_request,
+		          audio->queue->clear_request + 1);
+		QUEUE_UNLOCK();
+	}
+}
+
 void SDL_LockAudio (void)
 {
 	SDL_AudioDevice *audio = current_audio;
@@ -641,6 +906,12 @@ void SDL_AudioQuit(void)
 			SDL_FreeAudioMem(audio->convert.buf);
 
 		}
+		if ( audio->stream != NULL ) {
+			SDL_FreeAudioStream(audio->stream);
+		}
+		if ( audio->queue != NULL ) {
+			SDL_FreeAudioQueue(audio->queue);
+		}
 		if ( audio->opened ) {
 			audio->CloseAudio(audio);
 			audio->opened = 0;
@@ -649,6 +920,7 @@ void SDL_AudioQuit(void)
 		audio->free(audio);
 		current_audio = NULL;
 	}
+	SDL_FreeResampleTables();
 }
 
 #define NUM_FORMATS	6
@@ -33,3 +33,6 @@ extern void SDL_CalculateAudioSpec(SDL_AudioSpec *spec);
 /* The actual mixing thread function */
 extern int SDLCALL SDL_RunAudio(void *audiop);
 
+/* Free the rate conversion filters kept by SDL_BuildAudioCVT() */
+extern void SDL_FreeResampleTables(void);
+
@@ -24,6 +24,14 @@
 /* Functions for audio drivers to perform runtime conversion of audio format */
 
 #include "SDL_audio.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_audio_c.h"
+#include "../cpuinfo/SDL_simd.h"
+#include "../thread/SDL_atomic_c.h"
+
+#ifdef HAVE_MATH_H
+#include <math.h>	/* Used for building the resampling filters */
+#endif
 
 
 /* Effectively mix right and left channels into a single channel */
@@ -856,203 +864,193 @@ void SDLCALL SDL_ConvertEndian(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
-/* Convert rate up by multiple of 2 */
-void SDLCALL SDL_RateMUL2(SDL_AudioCVT *cvt, Uint16 format)
-{
-	int i;
-	Uint8 *src, *dst;
+/* 32-bit samples
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * 2\n");
+   The other filters only know 8 and 16-bit samples, so 32-bit ones are
+   converted to native 16-bit samples first, and back again at the end,
+   unless all that changes is the kind of 32-bit sample.  Float samples
+   are clipped to -1.0 to 1.0 and scaled by 32768 (or 2^31), truncating
+   the same way the SSE2 code does.
+ */
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+#define SDL_AUDIO_SWAPPED(format)	((format) & 0x1000)
+#else
+#define SDL_AUDIO_SWAPPED(format)	(!((format) & 0x1000))
 #endif
-	src = cvt->buf+cvt->len_cvt;
-	dst = cvt->buf+cvt->len_cvt*2;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt; i; --i ) {
-				src -= 1;
-				dst -= 2;
-				dst[0] = src[0];
-				dst[1] = src[0];
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/2; i; --i ) {
-				src -= 2;
-				dst -= 4;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[0];
-				dst[3] = src[1];
-			}
-			break;
+
+typedef union {
+	Uint32 u;
+	float f;
+} SDL_AudioSample32;
+
+static Sint16 SDL_FloatToS16(float f)
+{
+	if ( !(f >= -1.0f) ) {	/* NaN ends up here too, like with SSE2 */
+		return(-32768);
 	}
-	cvt->len_cvt *= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+	if ( f >= 1.0f ) {
+		return(32767);
+	}
+	return((Sint16)(f * 32768.0f));
+}
+
+static Sint32 SDL_FloatToS32(float f)
+{
+	if ( !(f >= -1.0f) ) {
+		return((Sint32)0x80000000);
 	}
+	if ( f >= 1.0f ) {
+		return(0x7FFFFFFF);
+	}
+	return((Sint32)(f * 2147483648.0f));
 }
 
+#if SDL_SSE2_INTRINSICS
+/* Clip floats to -1.0 to 1.0 and scale them, max() takes NaN to -1.0 */
+#define SSE2_CLIP_FLOAT(x, scale) \
+	_mm_mul_ps(_mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f)), scale)
 
-/* Convert rate up by multiple of 2, for stereo */
-void SDLCALL SDL_RateMUL2_c2(SDL_AudioCVT *cvt, Uint16 format)
+static int SDL_Convert32To16SSE2(const Uint8 *src, Sint16 *dst, int n, int is_float)
 {
+	const __m128 scale = _mm_set1_ps(32768.0f);
+	__m128i lo, hi;
 	int i;
-	Uint8 *src, *dst;
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * 2\n");
-#endif
-	src = cvt->buf+cvt->len_cvt;
-	dst = cvt->buf+cvt->len_cvt*2;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/2; i; --i ) {
-				src -= 2;
-				dst -= 4;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[0];
-				dst[3] = src[1];
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/4; i; --i ) {
-				src -= 4;
-				dst -= 8;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[0];
-				dst[5] = src[1];
-				dst[6] = src[2];
-				dst[7] = src[3];
-			}
-			break;
+	for ( i = 0; i + 8 <= n; i += 8 ) {
+		lo = _mm_loadu_si128((const __m128i *)(src + i*4));
+		hi = _mm_loadu_si128((const __m128i *)(src + i*4 + 16));
+		if ( is_float ) {
+			/* 32768 packs down to 32767 */
+			lo = _mm_cvttps_epi32(SSE2_CLIP_FLOAT(_mm_castsi128_ps(lo), scale));
+			hi = _mm_cvttps_epi32(SSE2_CLIP_FLOAT(_mm_castsi128_ps(hi), scale));
+		} else {
+			lo = _mm_srai_epi32(lo, 16);
+			hi = _mm_srai_epi32(hi, 16);
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
 	}
-	cvt->len_cvt *= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+	return(i);
+}
+
+/* Works backwards, so the output can overwrite the input */
+static int SDL_Convert16To32SSE2(const Sint16 *src, Uint8 *dst, int n, int is_float)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i x, lo, hi;
+
+	for ( ; n >= 8; n -= 8 ) {
+		x = _mm_loadu_si128((const __m128i *)(src + n - 8));
+		lo = _mm_unpacklo_epi16(zero, x);
+		hi = _mm_unpackhi_epi16(zero, x);
+		if ( is_float ) {
+			lo = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(lo, 16)), scale));
+			hi = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(hi, 16)), scale));
+		}
+		_mm_storeu_si128((__m128i *)(dst + (n - 8)*4), lo);
+		_mm_storeu_si128((__m128i *)(dst + (n - 4)*4), hi);
 	}
+	return(n);
 }
 
-/* Convert rate up by multiple of 2, for quad */
-void SDLCALL SDL_RateMUL2_c4(SDL_AudioCVT *cvt, Uint16 format)
+static int SDL_Convert32SSE2(Uint8 *data, int n, int to_float)
 {
+	const __m128 scale = _mm_set1_ps(2147483648.0f);
+	const __m128 unscale = _mm_set1_ps(1.0f / 2147483648.0f);
+	__m128i x;
+	__m128 f;
 	int i;
-	Uint8 *src, *dst;
+
+	for ( i = 0; i + 4 <= n; i += 4 ) {
+		x = _mm_loadu_si128((const __m128i *)(data + i*4));
+		if ( to_float ) {
+			x = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(x), unscale));
+		} else {
+			/* 2^31 comes out as 0x80000000, flip that to 0x7FFFFFFF */
+			f = SSE2_CLIP_FLOAT(_mm_castsi128_ps(x), scale);
+			x = _mm_xor_si128(_mm_cvttps_epi32(f),
+			                  _mm_castps_si128(_mm_cmpge_ps(f, scale)));
+		}
+		_mm_storeu_si128((__m128i *)(data + i*4), x);
+	}
+	return(i);
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+/* Convert 32-bit samples to native 16-bit */
+void SDLCALL SDL_Convert32To16(SDL_AudioCVT *cvt, Uint16 format)
+{
+	int i, n, swap;
+	const Uint32 *src;
+	Sint16 *dst;
+	SDL_AudioSample32 x;
 
 #ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * 2\n");
+	fprintf(stderr, "Converting 32-bit to 16-bit\n");
 #endif
-	src = cvt->buf+cvt->len_cvt;
-	dst = cvt->buf+cvt->len_cvt*2;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/4; i; --i ) {
-				src -= 4;
-				dst -= 8;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[0];
-				dst[5] = src[1];
-				dst[6] = src[2];
-				dst[7] = src[3];
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/8; i; --i ) {
-				src -= 8;
-				dst -= 16;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[6];
-				dst[7] = src[7];
-				dst[8] = src[0];
-				dst[9] = src[1];
-				dst[10] = src[2];
-				dst[11] = src[3];
-				dst[12] = src[4];
-				dst[13] = src[5];
-				dst[14] = src[6];
-				dst[15] = src[7];
-			}
-			break;
+	src = (const Uint32 *)cvt->buf;
+	dst = (Sint16 *)cvt->buf;
+	n = cvt->len_cvt / 4;
+	swap = SDL_AUDIO_SWAPPED(format);
+	i = 0;
+#if SDL_SSE2_INTRINSICS
+	if ( !swap && SDL_HasSSE2() ) {
+		i = SDL_Convert32To16SSE2(cvt->buf, dst, n, (format & 0x0100));
 	}
-	cvt->len_cvt *= 2;
+#endif
+	for ( ; i < n; ++i ) {
+		x.u = swap ? SDL_Swap32(src[i]) : src[i];
+		if ( format & 0x0100 ) {
+			dst[i] = SDL_FloatToS16(x.f);
+		} else {
+			dst[i] = (Sint16)((Sint32)x.u >> 16);
+		}
+	}
+	format = AUDIO_S16SYS;
+	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
 		cvt->filters[cvt->filter_index](cvt, format);
 	}
 }
 
-
-/* Convert rate up by multiple of 2, for 5.1 */
-void SDLCALL SDL_RateMUL2_c6(SDL_AudioCVT *cvt, Uint16 format)
+/* Convert native 16-bit samples to the 32-bit destination format */
+void SDLCALL SDL_Convert16To32(SDL_AudioCVT *cvt, Uint16 format)
 {
-	int i;
-	Uint8 *src, *dst;
+	int i, swap, is_float;
+	const Sint16 *src;
+	Uint32 *dst;
+	SDL_AudioSample32 x;
 
 #ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * 2\n");
+	fprintf(stderr, "Converting 16-bit to 32-bit\n");
 #endif
-	src = cvt->buf+cvt->len_cvt;
-	dst = cvt->buf+cvt->len_cvt*2;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/6; i; --i ) {
-				src -= 6;
-				dst -= 12;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[0];
-				dst[7] = src[1];
-				dst[8] = src[2];
-				dst[9] = src[3];
-				dst[10] = src[4];
-				dst[11] = src[5];
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/12; i; --i ) {
-				src -= 12;
-				dst -= 24;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[6];
-				dst[7] = src[7];
-				dst[8] = src[8];
-				dst[9] = src[9];
-				dst[10] = src[10];
-				dst[11] = src[11];
-				dst[12] = src[0];
-				dst[13] = src[1];
-				dst[14] = src[2];
-				dst[15] = src[3];
-				dst[16] = src[4];
-				dst[17] = src[5];
-				dst[18] = src[6];
-				dst[19] = src[7];
-				dst[20] = src[8];
-				dst[21] = src[9];
-				dst[22] = src[10];
-				dst[23] = src[11];
+	format = cvt->dst_format;
+	src = (const Sint16 *)cvt->buf;
+	dst = (Uint32 *)cvt->buf;
+	swap = SDL_AUDIO_SWAPPED(format);
+	is_float = (format & 0x0100);
+	i = cvt->len_cvt / 2;
+	/* The tail goes first, since this works from the end */
+#if SDL_SSE2_INTRINSICS
+	if ( !swap && SDL_HasSSE2() ) {
+		for ( ; i % 8; --i ) {
+			if ( is_float ) {
+				x.f = src[i-1] * (1.0f / 32768.0f);
+			} else {
+				x.u = (Uint32)src[i-1] << 16;
 			}
-			break;
+			dst[i-1] = x.u;
+		}
+		i = SDL_Convert16To32SSE2(src, cvt->buf, i, is_float);
+	}
+#endif
+	for ( ; i; --i ) {
+		if ( is_float ) {
+			x.f = src[i-1] * (1.0f / 32768.0f);
+		} else {
+			x.u = (Uint32)src[i-1] << 16;
+		}
+		dst[i-1] = swap ? SDL_Swap32(x.u) : x.u;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1060,246 +1058,752 @@ void SDLCALL SDL_RateMUL2_c6(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
-/* Convert rate down by multiple of 2 */
-void SDLCALL SDL_RateDIV2(SDL_AudioCVT *cvt, Uint16 format)
+/* Convert between 32-bit integer and float samples, and byte orders */
+void SDLCALL SDL_Convert32(SDL_AudioCVT *cvt, Uint16 format)
 {
-	int i;
-	Uint8 *src, *dst;
+	int i, n, src_swap, dst_swap, to_float;
+	Uint32 *data;
+	SDL_AudioSample32 x;
 
 #ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate / 2\n");
+	fprintf(stderr, "Converting 32-bit samples\n");
 #endif
-	src = cvt->buf;
-	dst = cvt->buf;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/2; i; --i ) {
-				dst[0] = src[0];
-				src += 2;
-				dst += 1;
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/4; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				src += 4;
-				dst += 2;
+	data = (Uint32 *)cvt->buf;
+	n = cvt->len_cvt / 4;
+	src_swap = SDL_AUDIO_SWAPPED(format);
+	dst_swap = SDL_AUDIO_SWAPPED(cvt->dst_format);
+	to_float = (cvt->dst_format & 0x0100);
+	if ( (format & 0x0100) == to_float ) {
+		/* Only the byte order changes */
+		for ( i = 0; i < n; ++i ) {
+			data[i] = SDL_Swap32(data[i]);
+		}
+	} else {
+		i = 0;
+#if SDL_SSE2_INTRINSICS
+		if ( !src_swap && !dst_swap && SDL_HasSSE2() ) {
+			i = SDL_Convert32SSE2(cvt->buf, n, to_float);
+		}
+#endif
+		for ( ; i < n; ++i ) {
+			x.u = src_swap ? SDL_Swap32(data[i]) : data[i];
+			if ( to_float ) {
+				x.f = (Sint32)x.u * (1.0f / 2147483648.0f);
+			} else {
+				x.u = (Uint32)SDL_FloatToS32(x.f);
 			}
-			break;
+			data[i] = dst_swap ? SDL_Swap32(x.u) : x.u;
+		}
 	}
-	cvt->len_cvt /= 2;
+	format = cvt->dst_format;
 	if ( cvt->filters[++cvt->filter_index] ) {
 		cvt->filters[cvt->filter_index](cvt, format);
 	}
 }
 
+/* Fused conversion
+
+   A chain of filters makes a pass over the whole buffer for each step,
+   so where the sample format and a mono/stereo change can be done at
+   once, SDL_BuildAudioCVT() uses a single filter instead.  It works a
+   block of frames at a time, going through signed 16-bit samples in a
+   buffer small enough to stay in the cache.  With a rate change too, the
+   resampler does the lot as it reads and writes the samples.
+   Stereo is mixed down to mono at 16 bits, so the result can be a bit
+   more accurate than with separate filters.
+ */
+#define FUSED_BLOCK	256	/* Frames converted at a time */
+
+#if SDL_SSE2_INTRINSICS
+static int SDL_ConvertToS16SSE2(Uint16 format, const Uint8 *src, Sint16 *dst, int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i flip8 = _mm_set1_epi8((format & 0x8000) ? 0 : (char)0x80);
+	const __m128i flip16 = _mm_set1_epi16((format & 0x8000) ? 0 : (short)0x8000);
+	const int swap = ((format & 0xFF) == 16) && SDL_AUDIO_SWAPPED(format);
+	__m128i x;
+	int i = 0;
+
+	if ( (format & 0xFF) == 8 ) {
+		for ( ; i + 16 <= n; i += 16 ) {
+			x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), flip8);
+			_mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi8(zero, x));
+			_mm_storeu_si128((__m128i *)(dst + i + 8), _mm_unpackhi_epi8(zero, x));
+		}
+	} else {
+		for ( ; i + 8 <= n; i += 8 ) {
+			x = _mm_loadu_si128((const __m128i *)(src + i*2));
+			if ( swap ) {
+				x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+			}
+			_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(x, flip16));
+		}
+	}
+	return(i);
+}
+
+static int SDL_ConvertFromS16SSE2(Uint16 format, const Sint16 *src, Uint8 *dst, int n)
+{
+	const __m128i flip8 = _mm_set1_epi8((format & 0x8000) ? 0 : (char)0x80);
+	const __m128i flip16 = _mm_set1_epi16((format & 0x8000) ? 0 : (short)0x8000);
+	const int swap = ((format & 0xFF) == 16) && SDL_AUDIO_SWAPPED(format);
+	__m128i x, y;
+	int i = 0;
+
+	if ( (format & 0xFF) == 8 ) {
+		for ( ; i + 16 <= n; i += 16 ) {
+			x = _mm_srai_epi16(_mm_loadu_si128((const __m128i *)(src + i)), 8);
+			y = _mm_srai_epi16(_mm_loadu_si128((const __m128i *)(src + i + 8)), 8);
+			x = _mm_xor_si128(_mm_packs_epi16(x, y), flip8);
+			_mm_storeu_si128((__m128i *)(dst + i), x);
+		}
+	} else {
+		for ( ; i + 8 <= n; i += 8 ) {
+			x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), flip16);
+			if ( swap ) {
+				x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+			}
+			_mm_storeu_si128((__m128i *)(dst + i*2), x);
+		}
+	}
+	return(i);
+}
+#endif /* SDL_SSE2_INTRINSICS */
 
-/* Convert rate down by multiple of 2, for stereo */
-void SDLCALL SDL_RateDIV2_c2(SDL_AudioCVT *cvt, Uint16 format)
+/* Convert 'n' samples of an 8 or 16-bit format to signed 16-bit */
+static void SDL_ConvertToS16(Uint16 format, const Uint8 *src, Sint16 *dst, int n)
 {
-	int i;
-	Uint8 *src, *dst;
+	const Uint16 *src16 = (const Uint16 *)src;
+	int i = 0;
+
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		i = SDL_ConvertToS16SSE2(format, src, dst, n);
+	}
+#endif
+	switch (format) {
+	    case AUDIO_U8:
+		for ( ; i < n; ++i ) {
+			dst[i] = (Sint16)((src[i] - 128) * 256);
+		}
+		break;
+	    case AUDIO_S8:
+		for ( ; i < n; ++i ) {
+			dst[i] = (Sint16)(((const Sint8 *)src)[i] * 256);
+		}
+		break;
+	    case AUDIO_U16LSB:
+		for ( ; i < n; ++i ) {
+			dst[i] = (Sint16)(SDL_SwapLE16(src16[i]) ^ 0x8000);
+		}
+		break;
+	    case AUDIO_S16LSB:
+		for ( ; i < n; ++i ) {
+			dst[i] = (Sint16)SDL_SwapLE16(src16[i]);
+		}
+		break;
+	    case AUDIO_U16MSB:
+		for ( ; i < n; ++i ) {
+			dst[i] = (Sint16)(SDL_SwapBE16(src16[i]) ^ 0x8000);
+		}
+		break;
+	    case AUDIO_S16MSB:
+		for ( ; i < n; ++i ) {
+			dst[i] = (Sint16)SDL_SwapBE16(src16[i]);
+		}
+		break;
+	}
+}
+
+/* Convert 'n' signed 16-bit samples to an 8 or 16-bit format */
+static void SDL_ConvertFromS16(Uint16 format, const Sint16 *src, Uint8 *dst, int n)
+{
+	Uint16 *dst16 = (Uint16 *)dst;
+	int i = 0;
+
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		i = SDL_ConvertFromS16SSE2(format, src, dst, n);
+	}
+#endif
+	switch (format) {
+	    case AUDIO_U8:
+		for ( ; i < n; ++i ) {
+			dst[i] = (Uint8)((src[i] >> 8) + 128);
+		}
+		break;
+	    case AUDIO_S8:
+		for ( ; i < n; ++i ) {
+			dst[i] = (Uint8)(src[i] >> 8);
+		}
+		break;
+	    case AUDIO_U16LSB:
+		for ( ; i < n; ++i ) {
+			dst16[i] = SDL_SwapLE16((Uint16)(src[i] ^ 0x8000));
+		}
+		break;
+	    case AUDIO_S16LSB:
+		for ( ; i < n; ++i ) {
+			dst16[i] = SDL_SwapLE16((Uint16)src[i]);
+		}
+		break;
+	    case AUDIO_U16MSB:
+		for ( ; i < n; ++i ) {
+			dst16[i] = SDL_SwapBE16((Uint16)(src[i] ^ 0x8000));
+		}
+		break;
+	    case AUDIO_S16MSB:
+		for ( ; i < n; ++i ) {
+			dst16[i] = SDL_SwapBE16((Uint16)src[i]);
+		}
+		break;
+	}
+}
+
+/* Convert to cvt->dst_format, and from 'channels' to 'dst_channels' */
+static void SDL_ConvertFused(SDL_AudioCVT *cvt, Uint16 format,
+                             int channels, int dst_channels)
+{
+	Sint16 tmp[FUSED_BLOCK * 2];
+	Uint16 dst_format;
+	int src_frame, dst_frame, frames, first, n, i;
 
 #ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate / 2\n");
+	fprintf(stderr, "Converting format and channels in one pass\n");
 #endif
-	src = cvt->buf;
-	dst = cvt->buf;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/4; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				src += 4;
-				dst += 2;
+	dst_format = cvt->dst_format;
+	src_frame = ((format & 0xFF) / 8) * channels;
+	dst_frame = ((dst_format & 0xFF) / 8) * dst_channels;
+	frames = cvt->len_cvt / src_frame;
+
+	/* When the output is bigger, go backwards so it doesn't overwrite
+	   input that hasn't been read yet */
+	for ( i = 0; i < frames; i += n ) {
+		n = SDL_min(frames - i, FUSED_BLOCK);
+		first = (dst_frame > src_frame) ? frames - i - n : i;
+		SDL_ConvertToS16(format, cvt->buf + first * src_frame, tmp, n * channels);
+		if ( dst_channels < channels ) {
+			int k;
+			for ( k = 0; k < n; ++k ) {
+				tmp[k] = (Sint16)((tmp[k*2] + tmp[k*2+1]) / 2);
 			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/8; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				src += 8;
-				dst += 4;
+		} else if ( dst_channels > channels ) {
+			int k;
+			for ( k = n - 1; k >= 0; --k ) {
+				tmp[k*2+1] = tmp[k*2] = tmp[k];
 			}
-			break;
+		}
+		SDL_ConvertFromS16(dst_format, tmp, cvt->buf + first * dst_frame, n * dst_channels);
 	}
-	cvt->len_cvt /= 2;
+	cvt->len_cvt = frames * dst_frame;
 	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+		cvt->filters[cvt->filter_index](cvt, dst_format);
 	}
 }
 
+/* The channel count doesn't matter if it stays the same */
+void SDLCALL SDL_ConvertFused_c1(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_ConvertFused(cvt, format, 1, 1);
+}
 
-/* Convert rate down by multiple of 2, for quad */
-void SDLCALL SDL_RateDIV2_c4(SDL_AudioCVT *cvt, Uint16 format)
+void SDLCALL SDL_ConvertFused_c1_c2(SDL_AudioCVT *cvt, Uint16 format)
 {
-	int i;
-	Uint8 *src, *dst;
+	SDL_ConvertFused(cvt, format, 1, 2);
+}
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate / 2\n");
+void SDLCALL SDL_ConvertFused_c2_c1(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_ConvertFused(cvt, format, 2, 1);
+}
+
+/* Rate conversion
+
+   Any rate is converted with a windowed sinc filter, kept in a table of
+   RESAMPLE_PHASES phases of fixed-point coefficients.  Each output sample
+   is filtered with the two phases either side of where it falls between
+   two input samples, and the results blended.
+   When the rate goes down the cutoff is lowered to the new Nyquist
+   frequency, and the filter widened to match, so each ratio gets its own
+   table.  Tables are built by SDL_BuildAudioCVT() and then kept until
+   SDL_AudioQuit(), so the audio thread never has to build one.
+
+   cvt->rate_incr holds the input rate divided by the output rate.  The
+   buffer is resampled one channel at a time through a 16-bit work area
+   after the output, which is where the extra room in len_mult goes.
+ */
+#define RESAMPLE_PHASE_BITS	9
+#define RESAMPLE_PHASES		(1 << RESAMPLE_PHASE_BITS)
+#define RESAMPLE_TAPS		64	/* Filter length at the full cutoff */
+#define RESAMPLE_COEF_BITS	14	/* Sums stay in 32 bits for any input */
+#define RESAMPLE_ROLLOFF	0.90	/* Passband, as part of Nyquist */
+#define RESAMPLE_KEY_ONE	1024	/* Key of a table at the full cutoff */
+#define RESAMPLE_MAX_TABLES	64
+
+typedef struct {
+	int key;	/* Cutoff, in 1/RESAMPLE_KEY_ONE of the input Nyquist */
+	int taps;	/* Coefficients per phase, a multiple of 8 */
+	Sint16 *coef;	/* (RESAMPLE_PHASES+1) phases, 16 byte aligned */
+	void *mem;
+} SDL_ResampleTable;
+
+static SDL_ResampleTable *SDL_resample_table[RESAMPLE_MAX_TABLES];
+static volatile int SDL_resample_tables = 0;
+#if SDL_HAVE_ATOMICS
+static volatile int SDL_resample_lock = 0;
 #endif
-	src = cvt->buf;
-	dst = cvt->buf;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/8; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				src += 8;
-				dst += 4;
+
+#ifndef M_PI
+#define M_PI	3.14159265358979323846
+#endif
+
+#ifdef HAVE_MATH_H
+#define SDL_ResampleSin(x)	sin(x)
+#else
+/* sin(x) from its Taylor series, good to double precision near zero */
+static double SDL_ResampleSin(double x)
+{
+	double term, sum, x2;
+	int n, neg;
+
+	neg = (x < 0.0);
+	if ( neg ) {
+		x = -x;
+	}
+	/* Bring x into [0, pi/2] */
+	x -= (int)(x / (2.0*M_PI)) * (2.0*M_PI);
+	if ( x > M_PI ) {
+		x -= M_PI;
+		neg = !neg;
+	}
+	if ( x > M_PI/2 ) {
+		x = M_PI - x;
+	}
+	x2 = x * x;
+	term = x;
+	sum = x;
+	for ( n = 1; n < 12; ++n ) {
+		term *= -x2 / ((2*n) * (2*n+1));
+		sum += term;
+	}
+	return neg ? -sum : sum;
+}
+#endif /* HAVE_MATH_H */
+
+/* The table key for a rate ratio, which sets the filter cutoff */
+static int SDL_ResampleKey(double rate_incr)
+{
+	int key;
+
+	if ( rate_incr <= 1.0 ) {
+		return RESAMPLE_KEY_ONE;
+	}
+	key = (int)(RESAMPLE_KEY_ONE / rate_incr);
+	return (key > 0) ? key : 1;
+}
+
+static SDL_ResampleTable *SDL_BuildResampleTable(int key)
+{
+	double cutoff, window, half, t, x, row[RESAMPLE_TAPS * 16];
+	SDL_ResampleTable *table;
+	Sint16 *coef;
+	int taps, phase, k, c, total, center;
+
+	taps = (RESAMPLE_TAPS * RESAMPLE_KEY_ONE + key - 1) / key;
+	taps = (taps + 7) & ~7;
+	if ( taps > SDL_arraysize(row) ) {
+		taps = SDL_arraysize(row);
+	}
+	table = (SDL_ResampleTable *)SDL_malloc(sizeof(*table));
+	if ( ! table ) {
+		return NULL;
+	}
+	table->mem = SDL_malloc((RESAMPLE_PHASES+1) * taps * sizeof(Sint16) + 16);
+	if ( ! table->mem ) {
+		SDL_free(table);
+		return NULL;
+	}
+	coef = (Sint16 *)(((size_t)table->mem + 15) & ~(size_t)15);
+
+	cutoff = RESAMPLE_ROLLOFF * key / RESAMPLE_KEY_ONE;
+	half = taps / 2;
+	center = taps/2 - 1;
+	for ( phase = 0; phase <= RESAMPLE_PHASES; ++phase ) {
+		double sum = 0.0;
+
+		/* Tap k sits at input sample (k - center), relative to the
+		   sample just before the output position */
+		for ( k = 0; k < taps; ++k ) {
+			t = (k - center) - (double)phase / RESAMPLE_PHASES;
+			x = M_PI * cutoff * t;
+			row[k] = (x == 0.0) ? cutoff : cutoff * SDL_ResampleSin(x) / x;
+
+			/* Blackman-Harris window over [-half, half] */
+			x = M_PI * (t / half + 1.0);
+			if ( (x > 0.0) && (x < 2.0*M_PI) ) {
+				window = 0.35875 - 0.48829 * SDL_ResampleSin(x + M_PI/2)
+				                 + 0.14128 * SDL_ResampleSin(2*x + M_PI/2)
+				                 - 0.01168 * SDL_ResampleSin(3*x + M_PI/2);
+				row[k] *= window;
+			} else {
+				row[k] = 0.0;
 			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/16; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[6];
-				dst[7] = src[7];
-				src += 16;
-				dst += 8;
+			sum += row[k];
+		}
+
+		/* Round, then keep unity gain exactly by nudging whichever of
+		   the middle taps rounded the furthest the wrong way.  Nudging
+		   the outer taps would skew the phase of low frequencies. */
+		total = 0;
+		for ( k = 0; k < taps; ++k ) {
+			row[k] *= (1 << RESAMPLE_COEF_BITS) / sum;
+			c = (int)(row[k] + (row[k] < 0.0 ? -0.5 : 0.5));
+			coef[phase*taps + k] = (Sint16)c;
+			total += c;
+		}
+		while ( total != (1 << RESAMPLE_COEF_BITS) ) {
+			int dir = (total < (1 << RESAMPLE_COEF_BITS)) ? 1 : -1;
+			int best = center;
+			double err, worst = -1.0;
+
+			for ( k = center-7; k <= center+8; ++k ) {
+				err = (row[k] - coef[phase*taps + k]) * dir;
+				if ( err > worst ) {
+					worst = err;
+					best = k;
+				}
 			}
-			break;
+			coef[phase*taps + best] += dir;
+			total += dir;
+		}
 	}
-	cvt->len_cvt /= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+	table->key = key;
+	table->taps = taps;
+	table->coef = coef;
+	return table;
+}
+
+static void SDL_FreeResampleTable(SDL_ResampleTable *table)
+{
+	SDL_free(table->mem);
+	SDL_free(table);
+}
+
+/* Find the table for a key, building it if it isn't there yet.
+   SDL_BuildAudioCVT() builds them up front; the filters only build one
+   if SDL_AudioQuit() has freed it since.  Tables are built outside the
+   lock, so a thread only waits for another to add one to the list.
+ */
+static SDL_ResampleTable *SDL_FindResampleTable(int key)
+{
+	int i, numtables;
+
+#if SDL_HAVE_ATOMICS
+	numtables = SDL_AtomicGet(&SDL_resample_tables);
+#else
+	numtables = SDL_resample_tables;
+#endif
+	for ( i = 0; i < numtables; ++i ) {
+		if ( SDL_resample_table[i]->key == key ) {
+			return SDL_resample_table[i];
+		}
 	}
+	return NULL;
 }
 
-/* Convert rate down by multiple of 2, for 5.1 */
-void SDLCALL SDL_RateDIV2_c6(SDL_AudioCVT *cvt, Uint16 format)
+static SDL_ResampleTable *SDL_GetResampleTable(int key)
 {
-	int i;
-	Uint8 *src, *dst;
+	SDL_ResampleTable *table, *found;
+	int numtables;
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate / 2\n");
+	found = SDL_FindResampleTable(key);
+	if ( found ) {
+		return found;
+	}
+	table = SDL_BuildResampleTable(key);
+	if ( ! table ) {
+		SDL_OutOfMemory();
+		return NULL;
+	}
+#if SDL_HAVE_ATOMICS
+	while ( ! SDL_AtomicCAS(&SDL_resample_lock, 0, 1) )
+		;
 #endif
-	src = cvt->buf;
-	dst = cvt->buf;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/12; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				src += 12;
-				dst += 6;
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/24; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[6];
-				dst[7] = src[7];
-				dst[8] = src[8];
-				dst[9] = src[9];
-				dst[10] = src[10];
-				dst[11] = src[11];
-				src += 24;
-				dst += 12;
-			}
-			break;
+	/* Someone may have added it while we were building ours */
+	found = SDL_FindResampleTable(key);
+	numtables = SDL_resample_tables;
+	if ( ! found && (numtables < RESAMPLE_MAX_TABLES) ) {
+		SDL_resample_table[numtables] = table;
+#if SDL_HAVE_ATOMICS
+		SDL_AtomicSet(&SDL_resample_tables, numtables+1);
+#else
+		SDL_resample_tables = numtables+1;
+#endif
+		found = table;
+		table = NULL;
 	}
-	cvt->len_cvt /= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+#if SDL_HAVE_ATOMICS
+	SDL_AtomicSet(&SDL_resample_lock, 0);
+#endif
+	if ( table ) {
+		SDL_FreeResampleTable(table);
+		if ( ! found ) {
+			SDL_SetError("Too many different audio rate conversions");
+		}
+	}
+	return found;
+}
+
+/* Nothing may be converting audio while the tables are freed */
+void SDL_FreeResampleTables(void)
+{
+	int i, numtables;
+
+	numtables = SDL_resample_tables;
+	SDL_resample_tables = 0;
+	for ( i = 0; i < numtables; ++i ) {
+		SDL_FreeResampleTable(SDL_resample_table[i]);
+		SDL_resample_table[i] = NULL;
 	}
 }
 
-/* Very slow rate conversion routine */
-void SDLCALL SDL_RateSLOW(SDL_AudioCVT *cvt, Uint16 format)
+typedef void (*SDL_ResampleDotFunc)(const Sint16 *x, const Sint16 *coef, int taps, int *sums);
+
+/* Multiply and add up a run of samples against two neighbouring phases */
+static void SDL_ResampleDot(const Sint16 *x, const Sint16 *coef, int taps, int *sums)
 {
-	double ipos;
-	int i, clen;
+	const Sint16 *next = coef + taps;
+	int k, sum0, sum1;
+
+	sum0 = sum1 = 0;
+	for ( k = 0; k < taps; ++k ) {
+		sum0 += x[k] * coef[k];
+		sum1 += x[k] * next[k];
+	}
+	sums[0] = sum0;
+	sums[1] = sum1;
+}
+
+#if SDL_SSE2_INTRINSICS
+static void SDL_ResampleDotSSE2(const Sint16 *x, const Sint16 *coef, int taps, int *sums)
+{
+	const Sint16 *next = coef + taps;
+	__m128i sum0 = _mm_setzero_si128();
+	__m128i sum1 = _mm_setzero_si128();
+	int k;
+
+	for ( k = 0; k < taps; k += 8 ) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(x + k));
+		sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(a, _mm_load_si128((const __m128i *)(coef + k))));
+		sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(a, _mm_load_si128((const __m128i *)(next + k))));
+	}
+	/* Fold both sets of four partial sums down into the low two lanes */
+	sum0 = _mm_add_epi32(_mm_unpacklo_epi32(sum0, sum1), _mm_unpackhi_epi32(sum0, sum1));
+	sum0 = _mm_add_epi32(sum0, _mm_shuffle_epi32(sum0, _MM_SHUFFLE(1,0,3,2)));
+	sums[0] = _mm_cvtsi128_si32(sum0);
+	sums[1] = _mm_cvtsi128_si32(_mm_shuffle_epi32(sum0, _MM_SHUFFLE(1,1,1,1)));
+}
+#endif
+
+static SDL_ResampleDotFunc SDL_ResampleGetDot(void)
+{
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		return SDL_ResampleDotSSE2;
+	}
+#endif
+	return SDL_ResampleDot;
+}
+
+/* Each step is rate_incr input frames, in 32.32 fixed point */
+static void SDL_ResampleStep(double rate_incr, Uint32 *step_int, Uint32 *step_frac)
+{
+	*step_int = (Uint32)rate_incr;
+	*step_frac = (Uint32)((rate_incr - *step_int) * 4294967296.0);
+}
+
+/* Filter one output sample at a position in a plane of input samples,
+   repeating the first and last samples where the filter runs off the end
+ */
+static int SDL_ResampleSample(const SDL_ResampleTable *table,
+                              SDL_ResampleDotFunc dot,
+                              const Sint16 *plane, int frames,
+                              Uint32 pos_int, Uint32 pos_frac)
+{
+	const Sint16 *x, *coef;
+	Sint16 edge[RESAMPLE_TAPS * 16];
+	int taps, phase, sample, first, i, k, sums[2];
+
+	/* The phase just before the output position, and how far it is on
+	   to the next one */
+	taps = table->taps;
+	phase = (int)(pos_frac >> (32 - RESAMPLE_PHASE_BITS));
+	coef = table->coef + phase * taps;
+	first = (int)pos_int - (taps/2 - 1);
+	if ( (first >= 0) && (first + taps <= frames) ) {
+		x = plane + first;
+	} else {
+		for ( k = 0; k < taps; ++k ) {
+			i = first + k;
+			edge[k] = plane[(i < 0) ? 0 : (i >= frames) ? frames-1 : i];
+		}
+		x = edge;
+	}
+	dot(x, coef, taps, sums);
+	sample = sums[0] + (int)(((double)sums[1] - sums[0]) *
+	         ((pos_frac << RESAMPLE_PHASE_BITS) * (1.0 / 4294967296.0)));
+	sample = (sample + (1 << (RESAMPLE_COEF_BITS-1))) >> RESAMPLE_COEF_BITS;
+	if ( sample > 32767 ) {
+		sample = 32767;
+	} else if ( sample < -32768 ) {
+		sample = -32768;
+	}
+	return sample;
+}
+
+/* Resample, converting to 'dst_format' and from 'channels' to
+   'dst_channels' on the way, for the fused filters */
+static void SDL_Resample(SDL_AudioCVT *cvt, Uint16 format, int channels,
+                         Uint16 dst_format, int dst_channels)
+{
+	SDL_ResampleTable *table;
+	SDL_ResampleDotFunc dot;
+	Sint16 tmp[FUSED_BLOCK * 6];
+	Sint16 *work, *plane;
+	int samplesize, dst_samplesize, planes, in_frames, out_frames, out_bytes;
+	int offset, first, i, c, k, n;
+	Uint32 step_frac, step_int;
+	Uint32 pos_frac, pos_int;
 
 #ifdef DEBUG_CONVERT
 	fprintf(stderr, "Converting audio rate * %4.4f\n", 1.0/cvt->rate_incr);
 #endif
-	clen = (int)((double)cvt->len_cvt / cvt->rate_incr);
-	if ( cvt->rate_incr > 1.0 ) {
-		switch (format & 0xFF) {
-			case 8: {
-				Uint8 *output;
-
-				output = cvt->buf;
-				ipos = 0.0;
-				for ( i=clen; i; --i ) {
-					*output = cvt->buf[(int)ipos];
-					ipos += cvt->rate_incr;
-					output += 1;
-				}
+	table = SDL_GetResampleTable(SDL_ResampleKey(cvt->rate_incr));
+	samplesize = (format & 0xFF) / 8;
+	dst_samplesize = (dst_format & 0xFF) / 8;
+	in_frames = cvt->len_cvt / (samplesize * channels);
+	/* Exact ratios can land a hair under a whole frame; no real rate
+	   ratio leaves a fraction that small any other way */
+	out_frames = (int)((double)in_frames / cvt->rate_incr + 0.000001);
+	out_bytes = out_frames * dst_channels * dst_samplesize;
+	if ( ! table || (in_frames == 0) ) {
+		/* Only if we ran out of memory */
+		cvt->len_cvt = 0;
+		goto done;
+	}
+	SDL_ResampleStep(cvt->rate_incr, &step_int, &step_frac);
+	dot = SDL_ResampleGetDot();
+
+	/* Spread the input out into one plane of 16-bit samples per channel,
+	   mixing stereo down to mono if that's where it's going */
+	planes = SDL_min(channels, dst_channels);
+	offset = SDL_max(out_bytes, cvt->len_cvt);
+	work = (Sint16 *)(cvt->buf + ((offset + 1) & ~1));
+	for ( first = 0; first < in_frames; first += n ) {
+		n = SDL_min(in_frames - first, FUSED_BLOCK);
+		SDL_ConvertToS16(format, cvt->buf + first * samplesize * channels,
+		                 tmp, n * channels);
+		if ( planes < channels ) {
+			for ( k = 0; k < n; ++k ) {
+				work[first + k] = (Sint16)((tmp[k*2] + tmp[k*2+1]) / 2);
 			}
-			break;
-
-			case 16: {
-				Uint16 *output;
-
-				clen &= ~1;
-				output = (Uint16 *)cvt->buf;
-				ipos = 0.0;
-				for ( i=clen/2; i; --i ) {
-					*output=((Uint16 *)cvt->buf)[(int)ipos];
-					ipos += cvt->rate_incr;
-					output += 1;
+		} else {
+			for ( c = 0; c < channels; ++c ) {
+				plane = work + c * in_frames + first;
+				for ( k = 0; k < n; ++k ) {
+					plane[k] = tmp[k*channels + c];
 				}
 			}
-			break;
 		}
-	} else {
-		switch (format & 0xFF) {
-			case 8: {
-				Uint8 *output;
-
-				output = cvt->buf+clen;
-				ipos = (double)cvt->len_cvt;
-				for ( i=clen; i; --i ) {
-					ipos -= cvt->rate_incr;
-					output -= 1;
-					*output = cvt->buf[(int)ipos];
-				}
-			}
-			break;
-
-			case 16: {
-				Uint16 *output;
+	}
 
-				clen &= ~1;
-				output = (Uint16 *)(cvt->buf+clen);
-				ipos = (double)cvt->len_cvt/2;
-				for ( i=clen/2; i; --i ) {
-					ipos -= cvt->rate_incr;
-					output -= 1;
-					*output=((Uint16 *)cvt->buf)[(int)ipos];
+	/* Run the filter over each plane a block at a time, and write the
+	   block out interleaved, twice over if mono is going to stereo */
+	pos_int = 0;
+	pos_frac = 0;
+	for ( first = 0; first < out_frames; first += n ) {
+		Uint32 block_int = pos_int, block_frac = pos_frac;
+
+		n = SDL_min(out_frames - first, FUSED_BLOCK);
+		for ( c = 0; c < planes; ++c ) {
+			plane = work + c * in_frames;
+			pos_int = block_int;
+			pos_frac = block_frac;
+			for ( k = 0; k < n; ++k ) {
+				i = SDL_ResampleSample(table, dot, plane, in_frames,
+				                       pos_int, pos_frac);
+				tmp[k*dst_channels + c] = (Sint16)i;
+				if ( planes < dst_channels ) {
+					tmp[k*dst_channels + c + 1] = (Sint16)i;
+				}
+				pos_int += step_int;
+				if ( (pos_frac += step_frac) < step_frac ) {
+					++pos_int;
 				}
 			}
-			break;
 		}
+		SDL_ConvertFromS16(dst_format, tmp,
+		                   cvt->buf + first * dst_channels * dst_samplesize,
+		                   n * dst_channels);
 	}
-	cvt->len_cvt = clen;
+	cvt->len_cvt = out_bytes;
+done:
 	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+		cvt->filters[cvt->filter_index](cvt, dst_format);
 	}
 }
 
+void SDLCALL SDL_Resample_c1(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 1, format, 1);
+}
+
+void SDLCALL SDL_Resample_c2(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 2, format, 2);
+}
+
+void SDLCALL SDL_Resample_c4(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 4, format, 4);
+}
+
+void SDLCALL SDL_Resample_c6(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 6, format, 6);
+}
+
+/* The fused filters also convert to cvt->dst_format */
+void SDLCALL SDL_ResampleFused_c1(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 1, cvt->dst_format, 1);
+}
+
+void SDLCALL SDL_ResampleFused_c2(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 2, cvt->dst_format, 2);
+}
+
+void SDLCALL SDL_ResampleFused_c4(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 4, cvt->dst_format, 4);
+}
+
+void SDLCALL SDL_ResampleFused_c6(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 6, cvt->dst_format, 6);
+}
+
+void SDLCALL SDL_ResampleFused_c1_c2(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 1, cvt->dst_format, 2);
+}
+
+void SDLCALL SDL_ResampleFused_c2_c1(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_Resample(cvt, format, 2, cvt->dst_format, 1);
+}
+
 int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 {
 	/* Make sure there's data to convert */
@@ -1328,6 +1832,10 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	Uint16 src_format, Uint8 src_channels, int src_rate,
 	Uint16 dst_format, Uint8 dst_channels, int dst_rate)
 {
+	Uint16 from = src_format, to = dst_format;
+	Uint8 from_channels = src_channels, to_channels = dst_channels;
+	const char *env;
+
 /*printf("Build format %04x->%04x, channels %u->%u, rate %d->%d\n",
 		src_format, dst_format, src_channels, dst_channels, src_rate, dst_rate);*/
 	/* Start off with no conversion necessary */
@@ -1337,6 +1845,25 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	cvt->len_mult = 1;
 	cvt->len_ratio = 1.0;
 
+	/* 32-bit samples are filtered as native 16-bit ones, unless all
+	   that changes is the kind of 32-bit sample */
+	if ( ((src_format & 0xFF) == 32) && ((dst_format & 0xFF) == 32) &&
+	     (src_channels == dst_channels) && (src_rate == dst_rate) ) {
+		if ( src_format != dst_format ) {
+			cvt->filters[cvt->filter_index++] = SDL_Convert32;
+		}
+		src_format = dst_format;
+	} else {
+		if ( (src_format & 0xFF) == 32 ) {
+			cvt->filters[cvt->filter_index++] = SDL_Convert32To16;
+			cvt->len_ratio /= 2;
+			src_format = AUDIO_S16SYS;
+		}
+		if ( (dst_format & 0xFF) == 32 ) {
+			dst_format = AUDIO_S16SYS;
+		}
+	}
+
 	/* First filter:  Endian conversion from src to dst */
 	if ( (src_format & 0x1000) != (dst_format & 0x1000)
 	     && ((src_format & 0xff) == 16) && ((dst_format & 0xff) == 16)) {
@@ -1435,76 +1962,513 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 
 	/* Do rate conversion */
 	cvt->rate_incr = 0.0;
-	if ( (src_rate/100) != (dst_rate/100) ) {
-		Uint32 hi_rate, lo_rate;
-		int len_mult;
-		double len_ratio;
+	if ( src_rate != dst_rate ) {
 		void (SDLCALL *rate_cvt)(SDL_AudioCVT *cvt, Uint16 format);
+		int len_mult;
 
-		if ( src_rate > dst_rate ) {
-			hi_rate = src_rate;
-			lo_rate = dst_rate;
-			switch (src_channels) {
-				case 1: rate_cvt = SDL_RateDIV2; break;
-				case 2: rate_cvt = SDL_RateDIV2_c2; break;
-				case 4: rate_cvt = SDL_RateDIV2_c4; break;
-				case 6: rate_cvt = SDL_RateDIV2_c6; break;
-				default: return -1;
-			}
-			len_mult = 1;
-			len_ratio = 0.5;
-		} else {
-			hi_rate = dst_rate;
-			lo_rate = src_rate;
-			switch (src_channels) {
-				case 1: rate_cvt = SDL_RateMUL2; break;
-				case 2: rate_cvt = SDL_RateMUL2_c2; break;
-				case 4: rate_cvt = SDL_RateMUL2_c4; break;
-				case 6: rate_cvt = SDL_RateMUL2_c6; break;
-				default: return -1;
+		if ( (src_rate <= 0) || (dst_rate <= 0) ) {
+			SDL_SetError("Invalid audio rate");
+			return(-1);
+		}
+		switch (src_channels) {
+			case 1: rate_cvt = SDL_Resample_c1; break;
+			case 2: rate_cvt = SDL_Resample_c2; break;
+			case 4: rate_cvt = SDL_Resample_c4; break;
+			case 6: rate_cvt = SDL_Resample_c6; break;
+			default: return -1;
+		}
+		cvt->rate_incr = (double)src_rate / dst_rate;
+		if ( ! SDL_GetResampleTable(SDL_ResampleKey(cvt->rate_incr)) ) {
+			return(-1);
+		}
+		cvt->filters[cvt->filter_index++] = rate_cvt;
+
+		/* Room for the output, then 16-bit copies of the input */
+		len_mult = (int)(cvt->len_ratio *
+		           ((dst_rate + src_rate - 1) / src_rate + 2)) + 1;
+		if ( cvt->len_mult < len_mult ) {
+			cvt->len_mult = len_mult;
+		}
+		cvt->len_ratio /= cvt->rate_incr;
+	}
+
+	/* Widen to 32-bit samples at the very end */
+	if ( dst_format != to ) {
+		cvt->filters[cvt->filter_index++] = SDL_Convert16To32;
+		cvt->len_ratio *= 2;
+		if ( cvt->len_mult < (int)cvt->len_ratio + 1 ) {
+			cvt->len_mult = (int)cvt->len_ratio + 1;
+		}
+	}
+
+	/* Do it all in one pass if the chain is more than one filter */
+	env = SDL_getenv("SDL_AUDIO_FUSED");
+	if ( (cvt->filter_index > 1) && (!env || SDL_atoi(env) != 0) &&
+	     ((from & 0xFF) <= 16) && ((to & 0xFF) <= 16) ) {
+		void (SDLCALL *fused_cvt)(SDL_AudioCVT *cvt, Uint16 format);
+
+		fused_cvt = NULL;
+		if ( from_channels == to_channels ) {
+			if ( src_rate == dst_rate ) {
+				fused_cvt = SDL_ConvertFused_c1;
+			} else switch (from_channels) {
+				case 1: fused_cvt = SDL_ResampleFused_c1; break;
+				case 2: fused_cvt = SDL_ResampleFused_c2; break;
+				case 4: fused_cvt = SDL_ResampleFused_c4; break;
+				case 6: fused_cvt = SDL_ResampleFused_c6; break;
 			}
-			len_mult = 2;
-			len_ratio = 2.0;
-		}
-		/* If hi_rate = lo_rate*2^x then conversion is easy */
-		while ( ((lo_rate*2)/100) <= (hi_rate/100) ) {
-			cvt->filters[cvt->filter_index++] = rate_cvt;
-			cvt->len_mult *= len_mult;
-			lo_rate *= 2;
-			cvt->len_ratio *= len_ratio;
-		}
-		/* We may need a slow conversion here to finish up */
-		if ( (lo_rate/100) != (hi_rate/100) ) {
-#if 1
-			/* The problem with this is that if the input buffer is
-			   say 1K, and the conversion rate is say 1.1, then the
-			   output buffer is 1.1K, which may not be an acceptable
-			   buffer size for the audio driver (not a power of 2)
-			*/
-			/* For now, punt and hope the rate distortion isn't great.
-			*/
-#else
-			if ( src_rate < dst_rate ) {
-				cvt->rate_incr = (double)lo_rate/hi_rate;
-				cvt->len_mult *= 2;
-				cvt->len_ratio /= cvt->rate_incr;
-			} else {
-				cvt->rate_incr = (double)hi_rate/lo_rate;
-				cvt->len_ratio *= cvt->rate_incr;
+		} else if ( (from_channels == 1) && (to_channels == 2) ) {
+			fused_cvt = (src_rate == dst_rate) ?
+				SDL_ConvertFused_c1_c2 : SDL_ResampleFused_c1_c2;
+		} else if ( (from_channels == 2) && (to_channels == 1) ) {
+			fused_cvt = (src_rate == dst_rate) ?
+				SDL_ConvertFused_c2_c1 : SDL_ResampleFused_c2_c1;
+		}
+		if ( fused_cvt ) {
+			cvt->filter_index = 0;
+			cvt->filters[cvt->filter_index++] = fused_cvt;
+
+			/* The chain has room for the output already, but the
+			   resampler wants 16-bit copies of the whole input */
+			if ( src_rate != dst_rate ) {
+				int in_frame = (from & 0xFF) / 8 * from_channels;
+				int planes = SDL_min(from_channels, to_channels);
+				int len_mult = (int)(SDL_max(cvt->len_ratio, 1.0) +
+				                     2.0 * planes / in_frame) + 2;
+				if ( cvt->len_mult < len_mult ) {
+					cvt->len_mult = len_mult;
+				}
 			}
-			cvt->filters[cvt->filter_index++] = SDL_RateSLOW;
-#endif
 		}
 	}
 
 	/* Set up the filter information */
 	if ( cvt->filter_index != 0 ) {
 		cvt->needed = 1;
-		cvt->src_format = src_format;
-		cvt->dst_format = dst_format;
+		cvt->src_format = from;
+		cvt->dst_format = to;
 		cvt->len = 0;
 		cvt->buf = NULL;
 		cvt->filters[cvt->filter_index] = NULL;
 	}
 	return(cvt->needed);
 }
+
+/* Streaming conversion
+
+   An audio stream runs the same filters as SDL_ConvertAudio(), a block at
+   a time.  Source data is converted to 16-bit samples, with as few
+   channels as either end has, then resampled from a history of input
+   that carries over between blocks.  The result is converted on to the
+   destination format and kept in a ring until it's read.  Without a rate
+   change there's no history, and the source goes straight through a
+   single set of filters.
+ */
+#define AUDIOSTREAM_BLOCK	1024	/* Source frames converted at once */
+#define AUDIOSTREAM_MAXFRAME	32	/* Largest sample frame, in bytes */
+
+struct SDL_AudioStream {
+	SDL_AudioCVT pre;	/* Source to 16-bit, at the source rate */
+	SDL_AudioCVT post;	/* 16-bit to the destination, at its rate */
+	int resample;
+	int src_frame;		/* Bytes in a source sample frame */
+	int dst_frame;		/* Bytes in a destination sample frame */
+	int channels;		/* Channels going through the resampler */
+
+	/* The start of a source frame, waiting for the rest of it */
+	Uint8 partial[AUDIOSTREAM_MAXFRAME];
+	int partial_len;
+
+	/* Room for the conversion filters to work in */
+	Uint8 *work;
+	int work_max;
+
+	/* Input history for the resampler, one plane per channel.  The table
+	   is looked up by key each time, in case SDL_AudioQuit() freed it. */
+	int key;
+	int taps;
+	SDL_ResampleDotFunc dot;
+	Sint16 *history;
+	int history_max;
+	int history_frames;
+
+	/* Positions count whole source frames plus a remainder in
+	   1/dst_rate of a frame, so they never drift */
+	int src_rate, dst_rate;
+	Uint32 step_int, step_rem;
+	Uint32 pos_int, pos_rem;
+
+	/* Converted data, waiting to be read */
+	Uint8 *queue;
+	int queue_max;
+	int queue_head;
+	int queue_len;
+};
+
+static int SDL_AudioStreamReserve(SDL_AudioStream *stream, int len)
+{
+	if ( len > stream->work_max ) {
+		Uint8 *work = (Uint8 *)SDL_realloc(stream->work, len);
+		if ( ! work ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		stream->work = work;
+		stream->work_max = len;
+	}
+	return(0);
+}
+
+/* Copy out the oldest queued data, optionally taking it off the queue */
+static void SDL_AudioStreamPeek(SDL_AudioStream *stream, Uint8 *buf, int len, int take)
+{
+	int n = SDL_min(len, stream->queue_max - stream->queue_head);
+
+	SDL_memcpy(buf, stream->queue + stream->queue_head, n);
+	SDL_memcpy(buf + n, stream->queue, len - n);
+	if ( take ) {
+		stream->queue_head = (stream->queue_head + len) % stream->queue_max;
+		stream->queue_len -= len;
+		if ( stream->queue_len == 0 ) {
+			stream->queue_head = 0;
+		}
+	}
+}
+
+static int SDL_AudioStreamQueue(SDL_AudioStream *stream, const Uint8 *data, int len)
+{
+	int tail, n;
+
+	if ( len <= 0 ) {
+		return(0);
+	}
+	if ( stream->queue_len + len > stream->queue_max ) {
+		int max = (stream->queue_len + len) * 2;
+		Uint8 *queue = (Uint8 *)SDL_malloc(max);
+		if ( ! queue ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		if ( stream->queue_len ) {
+			SDL_AudioStreamPeek(stream, queue, stream->queue_len, 0);
+		}
+		SDL_free(stream->queue);
+		stream->queue = queue;
+		stream->queue_max = max;
+		stream->queue_head = 0;
+	}
+	tail = (stream->queue_head + stream->queue_len) % stream->queue_max;
+	n = SDL_min(len, stream->queue_max - tail);
+	SDL_memcpy(stream->queue + tail, data, n);
+	SDL_memcpy(stream->queue, data + n, len - n);
+	stream->queue_len += len;
+	return(0);
+}
+
+/* Add interleaved 16-bit frames to the history, or silence if data is NULL */
+static int SDL_AudioStreamAppend(SDL_AudioStream *stream, const Sint16 *data, int frames)
+{
+	Sint16 *plane;
+	int c, i;
+
+	if ( stream->history_frames + frames > stream->history_max ) {
+		int max = stream->history_frames + frames + AUDIOSTREAM_BLOCK;
+		Sint16 *history = (Sint16 *)SDL_malloc(max * stream->channels * sizeof(Sint16));
+		if ( ! history ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		for ( c = 0; c < stream->channels; ++c ) {
+			SDL_memcpy(history + c * max,
+			           stream->history + c * stream->history_max,
+			           stream->history_frames * sizeof(Sint16));
+		}
+		SDL_free(stream->history);
+		stream->history = history;
+		stream->history_max = max;
+	}
+	for ( c = 0; c < stream->channels; ++c ) {
+		plane = stream->history + c * stream->history_max + stream->history_frames;
+		if ( data ) {
+			for ( i = 0; i < frames; ++i ) {
+				plane[i] = data[i * stream->channels + c];
+			}
+		} else {
+			SDL_memset(plane, 0, frames * sizeof(Sint16));
+		}
+	}
+	stream->history_frames += frames;
+	return(0);
+}
+
+/* Start the resampler over, as if it had only heard silence before */
+static void SDL_AudioStreamResetHistory(SDL_AudioStream *stream)
+{
+	if ( stream->resample ) {
+		stream->history_frames = 0;
+		stream->pos_int = stream->taps/2 - 1;
+		stream->pos_rem = 0;
+		SDL_AudioStreamAppend(stream, NULL, stream->pos_int);
+	}
+}
+
+/* Filter as many frames as the history allows, stopping at the frame
+   'end' if it isn't negative, and queue them in the destination format.
+ */
+static int SDL_AudioStreamResample(SDL_AudioStream *stream, int end)
+{
+	SDL_ResampleTable *table;
+	Sint16 *out;
+	Uint32 pos_frac;
+	int taps, center, max_out, n, c, used;
+
+	table = SDL_GetResampleTable(stream->key);
+	if ( ! table ) {
+		return(-1);
+	}
+	taps = table->taps;
+	center = taps/2 - 1;
+	max_out = (int)(stream->history_frames / stream->post.rate_incr) + 2;
+	if ( SDL_AudioStreamReserve(stream, max_out * stream->channels *
+	                            sizeof(Sint16) * stream->post.len_mult) < 0 ) {
+		return(-1);
+	}
+	out = (Sint16 *)stream->work;
+	for ( n = 0; n < max_out; ++n ) {
+		if ( ((int)stream->pos_int - center + taps > stream->history_frames) ||
+		     ((end >= 0) && ((int)stream->pos_int >= end)) ) {
+			break;
+		}
+		pos_frac = (Uint32)(stream->pos_rem * (4294967296.0 / stream->dst_rate));
+		for ( c = 0; c < stream->channels; ++c ) {
+			*out++ = (Sint16)SDL_ResampleSample(table, stream->dot,
+			             stream->history + c * stream->history_max,
+			             stream->history_frames,
+			             stream->pos_int, pos_frac);
+		}
+		stream->pos_int += stream->step_int;
+		stream->pos_rem += stream->step_rem;
+		if ( stream->pos_rem >= (Uint32)stream->dst_rate ) {
+			stream->pos_rem -= stream->dst_rate;
+			++stream->pos_int;
+		}
+	}
+
+	/* Forget the history the filter has moved past */
+	used = (int)stream->pos_int - center;
+	if ( used > stream->history_frames ) {
+		used = stream->history_frames;
+	}
+	if ( used > 0 ) {
+		for ( c = 0; c < stream->channels; ++c ) {
+			Sint16 *plane = stream->history + c * stream->history_max;
+			SDL_memmove(plane, plane + used,
+			            (stream->history_frames - used) * sizeof(Sint16));
+		}
+		stream->history_frames -= used;
+		stream->pos_int -= used;
+	}
+
+	if ( n == 0 ) {
+		return(0);
+	}
+	stream->post.buf = stream->work;
+	stream->post.len = n * stream->channels * sizeof(Sint16);
+	SDL_ConvertAudio(&stream->post);
+	return SDL_AudioStreamQueue(stream, stream->post.buf, stream->post.len_cvt);
+}
+
+/* Convert whole source frames and pass them along */
+static int SDL_AudioStreamConvert(SDL_AudioStream *stream, const Uint8 *data, int frames)
+{
+	int len = frames * stream->src_frame;
+
+	if ( SDL_AudioStreamReserve(stream, len * stream->pre.len_mult) < 0 ) {
+		return(-1);
+	}
+	SDL_memcpy(stream->work, data, len);
+	stream->pre.buf = stream->work;
+	stream->pre.len = len;
+	SDL_ConvertAudio(&stream->pre);
+	if ( ! stream->resample ) {
+		return SDL_AudioStreamQueue(stream, stream->pre.buf, stream->pre.len_cvt);
+	}
+	if ( SDL_AudioStreamAppend(stream, (Sint16 *)stream->pre.buf,
+	        stream->pre.len_cvt / (stream->channels * 2)) < 0 ) {
+		return(-1);
+	}
+	return SDL_AudioStreamResample(stream, -1);
+}
+
+SDL_AudioStream *SDL_NewAudioStream(
+	Uint16 src_format, Uint8 src_channels, int src_rate,
+	Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+	SDL_AudioStream *stream;
+	SDL_ResampleTable *table;
+	SDL_AudioCVT cvt;
+	int status;
+
+	/* Make sure the whole conversion is possible before going further */
+	if ( SDL_BuildAudioCVT(&cvt, src_format, src_channels, src_rate,
+	                       dst_format, dst_channels, dst_rate) < 0 ) {
+		return(NULL);
+	}
+	stream = (SDL_AudioStream *)SDL_malloc(sizeof(*stream));
+	if ( ! stream ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(stream, 0, sizeof(*stream));
+	stream->src_frame = (src_format & 0xFF) / 8 * src_channels;
+	stream->dst_frame = (dst_format & 0xFF) / 8 * dst_channels;
+	stream->resample = (src_rate != dst_rate);
+	if ( stream->resample ) {
+		stream->channels = SDL_min(src_channels, dst_channels);
+		status = SDL_BuildAudioCVT(&stream->pre,
+		             src_format, src_channels, src_rate,
+		             AUDIO_S16SYS, stream->channels, src_rate);
+		if ( status >= 0 ) {
+			status = SDL_BuildAudioCVT(&stream->post,
+			             AUDIO_S16SYS, stream->channels, dst_rate,
+			             dst_format, dst_channels, dst_rate);
+		}
+		stream->post.rate_incr = (double)src_rate / dst_rate;
+		stream->key = SDL_ResampleKey(stream->post.rate_incr);
+		table = SDL_GetResampleTable(stream->key);
+		if ( table ) {
+			stream->taps = table->taps;
+		} else {
+			status = -1;
+		}
+	} else {
+		stream->channels = dst_channels;
+		status = SDL_BuildAudioCVT(&stream->pre,
+		             src_format, src_channels, src_rate,
+		             dst_format, dst_channels, dst_rate);
+	}
+	if ( status < 0 ) {
+		SDL_FreeAudioStream(stream);
+		return(NULL);
+	}
+	if ( stream->resample ) {
+		stream->src_rate = src_rate;
+		stream->dst_rate = dst_rate;
+		stream->step_int = src_rate / dst_rate;
+		stream->step_rem = src_rate % dst_rate;
+		stream->dot = SDL_ResampleGetDot();
+
+		/* Make room for a full block of history up front */
+		if ( SDL_AudioStreamAppend(stream, NULL,
+		        AUDIOSTREAM_BLOCK + stream->taps) < 0 ) {
+			SDL_FreeAudioStream(stream);
+			return(NULL);
+		}
+		SDL_AudioStreamResetHistory(stream);
+	}
+	return(stream);
+}
+
+int SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len)
+{
+	const Uint8 *data = (const Uint8 *)buf;
+	int n, frames;
+
+	if ( ! stream ) {
+		SDL_SetError("Passed a NULL audio stream");
+		return(-1);
+	}
+
+	/* Finish off a frame left over from last time */
+	if ( stream->partial_len && (len > 0) ) {
+		n = SDL_min(len, stream->src_frame - stream->partial_len);
+		SDL_memcpy(stream->partial + stream->partial_len, data, n);
+		stream->partial_len += n;
+		data += n;
+		len -= n;
+		if ( stream->partial_len < stream->src_frame ) {
+			return(0);
+		}
+		stream->partial_len = 0;
+		if ( SDL_AudioStreamConvert(stream, stream->partial, 1) < 0 ) {
+			return(-1);
+		}
+	}
+
+	while ( len >= stream->src_frame ) {
+		frames = SDL_min(len / stream->src_frame, AUDIOSTREAM_BLOCK);
+		if ( SDL_AudioStreamConvert(stream, data, frames) < 0 ) {
+			return(-1);
+		}
+		data += frames * stream->src_frame;
+		len -= frames * stream->src_frame;
+	}
+
+	if ( len > 0 ) {
+		SDL_memcpy(stream->partial, data, len);
+		stream->partial_len = len;
+	}
+	return(0);
+}
+
+int SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len)
+{
+	if ( ! stream ) {
+		SDL_SetError("Passed a NULL audio stream");
+		return(-1);
+	}
+	len = SDL_min(len, stream->queue_len);
+	len -= len % stream->dst_frame;
+	if ( len > 0 ) {
+		SDL_AudioStreamPeek(stream, (Uint8 *)buf, len, 1);
+	}
+	return(len);
+}
+
+int SDL_AudioStreamAvailable(SDL_AudioStream *stream)
+{
+	return stream ? stream->queue_len : 0;
+}
+
+int SDL_AudioStreamFlush(SDL_AudioStream *stream)
+{
+	int end, status;
+
+	if ( ! stream ) {
+		SDL_SetError("Passed a NULL audio stream");
+		return(-1);
+	}
+	stream->partial_len = 0;
+	if ( ! stream->resample ) {
+		return(0);
+	}
+
+	/* Run the last of the input out against silence */
+	end = stream->history_frames;
+	status = SDL_AudioStreamAppend(stream, NULL, stream->taps);
+	if ( status == 0 ) {
+		status = SDL_AudioStreamResample(stream, end);
+	}
+	SDL_AudioStreamResetHistory(stream);
+	return(status);
+}
+
+void SDL_AudioStreamClear(SDL_AudioStream *stream)
+{
+	if ( stream ) {
+		stream->partial_len = 0;
+		stream->queue_head = 0;
+		stream->queue_len = 0;
+		SDL_AudioStreamResetHistory(stream);
+	}
+}
+
+void SDL_FreeAudioStream(SDL_AudioStream *stream)
+{
+	if ( stream ) {
+		SDL_free(stream->work);
+		SDL_free(stream->history);
+		SDL_free(stream->queue);
+		SDL_free(stream);
+	}
+}
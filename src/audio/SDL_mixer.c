@@ -30,6 +30,9 @@
 #include "SDL_mixer_MMX.h"
 #include "SDL_mixer_MMX_VC.h"
 #include "SDL_mixer_m68k.h"
+#include "../cpuinfo/SDL_simd.h"
+
+
 
 /* This table is used to add two sound values together and pin
  * the value to avoid overflow.  (used with permission from ARDI)
@@ -90,24 +93,254 @@ static const Uint8 mix8[] =
 #define ADJUST_VOLUME(s, v)	(s = (s*v)/SDL_MIX_MAXVOLUME)
 #define ADJUST_VOLUME_U8(s, v)	(s = (((s-128)*v)/SDL_MIX_MAXVOLUME)+128)
 
-void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+/* 32-bit samples are read and written whole, swapped if they need it */
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+#define SWAPPED_32(format)	((format) & 0x1000)
+#else
+#define SWAPPED_32(format)	(!((format) & 0x1000))
+#endif
+#define GET_32(p, swap)		((swap) ? SDL_Swap32(*(const Uint32 *)(p)) : *(const Uint32 *)(p))
+#define PUT_32(p, x, swap)	(*(Uint32 *)(p) = (swap) ? SDL_Swap32(x) : (x))
+
+typedef union {
+	Uint32 u;
+	float f;
+} SDL_MixSample32;
+
+#if SDL_SSE2_INTRINSICS
+/* The SIMD mixers give exactly the same results as the C code below.
+   Volume scaling is a 32-bit multiply for 16-bit samples, then a divide
+   by 128 that rounds towards zero like C does.  8-bit samples are mixed
+   as signed; unsigned ones are flipped to signed and back, and capped at
+   0xFE like the mix8 table.  Each returns how many bytes it mixed, and
+   the C code finishes off whatever is left.
+ */
+#define SSE2_SIGNED_DIV128_32(p) \
+	_mm_srai_epi32(_mm_add_epi32(p, _mm_srli_epi32(_mm_srai_epi32(p, 31), 25)), 7)
+#define SSE2_SIGNED_DIV128_16(p) \
+	_mm_srai_epi16(_mm_add_epi16(p, _mm_srli_epi16(_mm_srai_epi16(p, 15), 9)), 7)
+
+static Uint32 SDL_MixAudio_SSE2_8(Uint8 *dst, const Uint8 *src, Uint32 len,
+                                  int volume, int is_unsigned)
 {
-	Uint16 format;
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	const __m128i flip = _mm_set1_epi8(is_unsigned ? (char)0x80 : 0);
+	const __m128i cap = _mm_set1_epi8(is_unsigned ? (char)0xFE : (char)0xFF);
+	Uint32 i;
 
-	if ( volume == 0 ) {
-		return;
+	for ( i = 0; i + 16 <= len; i += 16 ) {
+		__m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), flip);
+		__m128i d = _mm_xor_si128(_mm_loadu_si128((__m128i *)(dst + i)), flip);
+		__m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(s, s), 8);
+		__m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(s, s), 8);
+
+		lo = SSE2_SIGNED_DIV128_16(_mm_mullo_epi16(lo, vol));
+		hi = SSE2_SIGNED_DIV128_16(_mm_mullo_epi16(hi, vol));
+		d = _mm_adds_epi8(d, _mm_packs_epi16(lo, hi));
+		d = _mm_min_epu8(_mm_xor_si128(d, flip), cap);
+		_mm_storeu_si128((__m128i *)(dst + i), d);
+	}
+	return i;
+}
+
+static Uint32 SDL_MixAudio_SSE2_S16(Uint8 *dst, const Uint8 *src, Uint32 len,
+                                    int volume, int swap)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	Uint32 i;
+
+	for ( i = 0; i + 16 <= len; i += 16 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+		__m128i plo, phi;
+
+		if ( swap ) {
+			s = _mm_or_si128(_mm_slli_epi16(s, 8), _mm_srli_epi16(s, 8));
+			d = _mm_or_si128(_mm_slli_epi16(d, 8), _mm_srli_epi16(d, 8));
+		}
+		plo = _mm_mullo_epi16(s, vol);
+		phi = _mm_mulhi_epi16(s, vol);
+		s = _mm_packs_epi32(
+			SSE2_SIGNED_DIV128_32(_mm_unpacklo_epi16(plo, phi)),
+			SSE2_SIGNED_DIV128_32(_mm_unpackhi_epi16(plo, phi)));
+		d = _mm_adds_epi16(d, s);
+		if ( swap ) {
+			d = _mm_or_si128(_mm_slli_epi16(d, 8), _mm_srli_epi16(d, 8));
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), d);
+	}
+	return i;
+}
+
+/* Float samples are clipped to -1.0 to 1.0, and NaN goes through like in C */
+static Uint32 SDL_MixAudio_SSE2_F32(Uint8 *dst, const Uint8 *src, Uint32 len,
+                                    int volume)
+{
+	const __m128 vol = _mm_set1_ps((float)volume / SDL_MIX_MAXVOLUME);
+	const __m128 max = _mm_set1_ps(1.0f);
+	const __m128 min = _mm_set1_ps(-1.0f);
+	Uint32 i;
+
+	for ( i = 0; i + 16 <= len; i += 16 ) {
+		__m128 s = _mm_loadu_ps((const float *)(src + i));
+		__m128 d = _mm_loadu_ps((const float *)(dst + i));
+
+		d = _mm_add_ps(d, _mm_mul_ps(s, vol));
+		d = _mm_min_ps(max, _mm_max_ps(min, d));
+		_mm_storeu_ps((float *)(dst + i), d);
+	}
+	return i;
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+#define AVX2_SIGNED_DIV128_32(p) \
+	_mm256_srai_epi32(_mm256_add_epi32(p, _mm256_srli_epi32(_mm256_srai_epi32(p, 31), 25)), 7)
+#define AVX2_SIGNED_DIV128_16(p) \
+	_mm256_srai_epi16(_mm256_add_epi16(p, _mm256_srli_epi16(_mm256_srai_epi16(p, 15), 9)), 7)
+
+/* The same as the SSE2 mixers, 32 bytes at a time.  The unpacks and packs
+   work within each 128-bit half, so the samples come back in order. */
+SDL_TARGETING_AVX2
+static Uint32 SDL_MixAudio_AVX2_8(Uint8 *dst, const Uint8 *src, Uint32 len,
+                                  int volume, int is_unsigned)
+{
+	const __m256i vol = _mm256_set1_epi16((short)volume);
+	const __m256i flip = _mm256_set1_epi8(is_unsigned ? (char)0x80 : 0);
+	const __m256i cap = _mm256_set1_epi8(is_unsigned ? (char)0xFE : (char)0xFF);
+	Uint32 i;
+
+	for ( i = 0; i + 32 <= len; i += 32 ) {
+		__m256i s = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(src + i)), flip);
+		__m256i d = _mm256_xor_si256(_mm256_loadu_si256((__m256i *)(dst + i)), flip);
+		__m256i lo = _mm256_srai_epi16(_mm256_unpacklo_epi8(s, s), 8);
+		__m256i hi = _mm256_srai_epi16(_mm256_unpackhi_epi8(s, s), 8);
+
+		lo = AVX2_SIGNED_DIV128_16(_mm256_mullo_epi16(lo, vol));
+		hi = AVX2_SIGNED_DIV128_16(_mm256_mullo_epi16(hi, vol));
+		d = _mm256_adds_epi8(d, _mm256_packs_epi16(lo, hi));
+		d = _mm256_min_epu8(_mm256_xor_si256(d, flip), cap);
+		_mm256_storeu_si256((__m256i *)(dst + i), d);
+	}
+	return i;
+}
+
+SDL_TARGETING_AVX2
+static Uint32 SDL_MixAudio_AVX2_S16(Uint8 *dst, const Uint8 *src, Uint32 len,
+                                    int volume, int swap)
+{
+	const __m256i vol = _mm256_set1_epi16((short)volume);
+	Uint32 i;
+
+	for ( i = 0; i + 32 <= len; i += 32 ) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+		__m256i plo, phi;
+
+		if ( swap ) {
+			s = _mm256_or_si256(_mm256_slli_epi16(s, 8), _mm256_srli_epi16(s, 8));
+			d = _mm256_or_si256(_mm256_slli_epi16(d, 8), _mm256_srli_epi16(d, 8));
+		}
+		plo = _mm256_mullo_epi16(s, vol);
+		phi = _mm256_mulhi_epi16(s, vol);
+		s = _mm256_packs_epi32(
+			AVX2_SIGNED_DIV128_32(_mm256_unpacklo_epi16(plo, phi)),
+			AVX2_SIGNED_DIV128_32(_mm256_unpackhi_epi16(plo, phi)));
+		d = _mm256_adds_epi16(d, s);
+		if ( swap ) {
+			d = _mm256_or_si256(_mm256_slli_epi16(d, 8), _mm256_srli_epi16(d, 8));
+		}
+		_mm256_storeu_si256((__m256i *)(dst + i), d);
 	}
-	/* Mix the user-level audio format */
+	return i;
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
+#if SDL_SSE2_INTRINSICS
+/* Mix as much as the SIMD code can, and return how many bytes that was */
+static Uint32 SDL_MixAudio_SIMD(Uint16 format, Uint8 *dst, const Uint8 *src,
+                                Uint32 len, int volume)
+{
+	Uint32 done = 0;
+
+	/* The C code wraps louder volumes around, which isn't worth copying */
+	if ( (volume < 0) || (volume > SDL_MIX_MAXVOLUME) ) {
+		return 0;
+	}
+#if SDL_AVX2_INTRINSICS
+	if ( SDL_HasAVX2() ) {
+		switch (format) {
+		    case AUDIO_U8:
+			done = SDL_MixAudio_AVX2_8(dst, src, len, volume, 1);
+			break;
+		    case AUDIO_S8:
+			done = SDL_MixAudio_AVX2_8(dst, src, len, volume, 0);
+			break;
+		    case AUDIO_S16LSB:
+			done = SDL_MixAudio_AVX2_S16(dst, src, len, volume, 0);
+			break;
+		    case AUDIO_S16MSB:
+			done = SDL_MixAudio_AVX2_S16(dst, src, len, volume, 1);
+			break;
+		}
+		dst += done;
+		src += done;
+		len -= done;
+	}
+#endif
+	if ( SDL_HasSSE2() ) {
+		switch (format) {
+		    case AUDIO_U8:
+			done += SDL_MixAudio_SSE2_8(dst, src, len, volume, 1);
+			break;
+		    case AUDIO_S8:
+			done += SDL_MixAudio_SSE2_8(dst, src, len, volume, 0);
+			break;
+		    case AUDIO_S16LSB:
+			done += SDL_MixAudio_SSE2_S16(dst, src, len, volume, 0);
+			break;
+		    case AUDIO_S16MSB:
+			done += SDL_MixAudio_SSE2_S16(dst, src, len, volume, 1);
+			break;
+		    case AUDIO_F32SYS:
+			done += SDL_MixAudio_SSE2_F32(dst, src, len, volume);
+			break;
+		}
+	}
+	return done;
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+/* Mix the user-level audio format */
+static Uint16 SDL_MixFormat(void)
+{
 	if ( current_audio ) {
 		if ( current_audio->convert.needed ) {
-			format = current_audio->convert.src_format;
-		} else {
-			format = current_audio->spec.format;
+			return current_audio->convert.src_format;
 		}
-	} else {
-  		/* HACK HACK HACK */
-		format = AUDIO_S16;
+		return current_audio->spec.format;
 	}
+	/* HACK HACK HACK */
+	return AUDIO_S16;
+}
+
+void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	Uint16 format;
+#if SDL_SSE2_INTRINSICS
+	Uint32 done;
+#endif
+
+	if ( volume == 0 ) {
+		return;
+	}
+	format = SDL_MixFormat();
+#if SDL_SSE2_INTRINSICS
+	done = SDL_MixAudio_SIMD(format, dst, src, len, volume);
+	dst += done;
+	src += done;
+	len -= done;
+#endif
 	switch (format) {
 
 		case AUDIO_U8: {
@@ -256,9 +489,576 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		}
 		break;
 
+		case AUDIO_S32LSB:
+		case AUDIO_S32MSB: {
+			/* Doubles hold the product exactly, and the sum too */
+			const int swap = SWAPPED_32(format);
+			const double max_audioval = 2147483647.0;
+			const double min_audioval = -2147483648.0;
+			double dst_sample;
+			Sint32 src_sample;
+
+			/* Louder volumes would overflow the scaled sample */
+			volume = SDL_max(0, SDL_min(volume, SDL_MIX_MAXVOLUME));
+			len /= 4;
+			while ( len-- ) {
+				src_sample = (Sint32)GET_32(src, swap);
+				src_sample = (Sint32)(src_sample * (double)volume / SDL_MIX_MAXVOLUME);
+				dst_sample = (Sint32)GET_32(dst, swap) + (double)src_sample;
+				if ( dst_sample > max_audioval ) {
+					dst_sample = max_audioval;
+				} else
+				if ( dst_sample < min_audioval ) {
+					dst_sample = min_audioval;
+				}
+				PUT_32(dst, (Uint32)(Sint32)dst_sample, swap);
+				src += 4;
+				dst += 4;
+			}
+		}
+		break;
+
+		case AUDIO_F32LSB:
+		case AUDIO_F32MSB: {
+			const int swap = SWAPPED_32(format);
+			const float fvolume = (float)volume / SDL_MIX_MAXVOLUME;
+			const float max_audioval = 1.0f;
+			const float min_audioval = -1.0f;
+			SDL_MixSample32 src_sample, dst_sample;
+
+			len /= 4;
+			while ( len-- ) {
+				src_sample.u = GET_32(src, swap);
+				dst_sample.u = GET_32(dst, swap);
+				dst_sample.f = dst_sample.f + src_sample.f * fvolume;
+				if ( dst_sample.f > max_audioval ) {
+					dst_sample.f = max_audioval;
+				} else
+				if ( dst_sample.f < min_audioval ) {
+					dst_sample.f = min_audioval;
+				}
+				PUT_32(dst, dst_sample.u, swap);
+				src += 4;
+				dst += 4;
+			}
+		}
+		break;
+
 		default: /* If this happens... FIXME! */
 			SDL_SetError("SDL_MixAudio(): unknown audio format");
 			return;
 	}
 }
 
+/* Batched mixing
+
+   Each voice is multiplied by its volume and the products are added up
+   at full precision, then divided by 128 and added to the destination,
+   which is only clipped when it's written back.  A single voice comes out
+   exactly like SDL_MixAudio() would mix it.  The work is done a chunk of
+   samples at a time, so the sums stay in the cache, and up to MIX_GROUP
+   voices at a time, so the products can't overflow 32 bits.
+ */
+#define MIX_CHUNK	512	/* Samples summed at a time */
+#define MIX_GROUP	256	/* Voices summed at a time */
+
+/* Start the sums off with the destination samples */
+static void SDL_MixLoad(Uint16 format, Sint32 *sum, const Uint8 *dst, int samples)
+{
+	int i;
+
+	switch (format) {
+	    case AUDIO_U8:
+		for ( i = 0; i < samples; ++i ) {
+			sum[i] = dst[i] - 128;
+		}
+		break;
+	    case AUDIO_S8:
+		for ( i = 0; i < samples; ++i ) {
+			sum[i] = ((const Sint8 *)dst)[i];
+		}
+		break;
+	    case AUDIO_S16LSB:
+		for ( i = 0; i < samples; ++i ) {
+			sum[i] = (Sint16)((dst[i*2+1] << 8) | dst[i*2]);
+		}
+		break;
+	    case AUDIO_S16MSB:
+		for ( i = 0; i < samples; ++i ) {
+			sum[i] = (Sint16)((dst[i*2] << 8) | dst[i*2+1]);
+		}
+		break;
+	}
+}
+
+#if SDL_SSE2_INTRINSICS
+/* The SIMD versions take the voices two at a time, interleaving their
+   samples so one multiply-add gives both products summed in 32 bits.
+   There's always an even number of voices, padded out with a silent one.
+   Each returns how many samples it got through.
+ */
+static int SDL_MixAudioMany_SSE2_8(Sint32 *sum, const Uint8 * const *voice,
+                                   const int *level, int num, int samples,
+                                   int is_unsigned)
+{
+	const __m128i flip = _mm_set1_epi8(is_unsigned ? (char)0x80 : 0);
+	__m128i a, b, alo, ahi, blo, bhi, vol, p0, p1, p2, p3;
+	int i, j;
+
+	for ( i = 0; i + 16 <= samples; i += 16 ) {
+		p0 = p1 = p2 = p3 = _mm_setzero_si128();
+		for ( j = 0; j < num; j += 2 ) {
+			vol = _mm_set1_epi32((level[j+1] << 16) | level[j]);
+			a = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(voice[j] + i)), flip);
+			b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(voice[j+1] + i)), flip);
+			alo = _mm_srai_epi16(_mm_unpacklo_epi8(a, a), 8);
+			ahi = _mm_srai_epi16(_mm_unpackhi_epi8(a, a), 8);
+			blo = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
+			bhi = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+			p0 = _mm_add_epi32(p0, _mm_madd_epi16(_mm_unpacklo_epi16(alo, blo), vol));
+			p1 = _mm_add_epi32(p1, _mm_madd_epi16(_mm_unpackhi_epi16(alo, blo), vol));
+			p2 = _mm_add_epi32(p2, _mm_madd_epi16(_mm_unpacklo_epi16(ahi, bhi), vol));
+			p3 = _mm_add_epi32(p3, _mm_madd_epi16(_mm_unpackhi_epi16(ahi, bhi), vol));
+		}
+		_mm_storeu_si128((__m128i *)(sum + i), _mm_add_epi32(
+			_mm_loadu_si128((__m128i *)(sum + i)), SSE2_SIGNED_DIV128_32(p0)));
+		_mm_storeu_si128((__m128i *)(sum + i + 4), _mm_add_epi32(
+			_mm_loadu_si128((__m128i *)(sum + i + 4)), SSE2_SIGNED_DIV128_32(p1)));
+		_mm_storeu_si128((__m128i *)(sum + i + 8), _mm_add_epi32(
+			_mm_loadu_si128((__m128i *)(sum + i + 8)), SSE2_SIGNED_DIV128_32(p2)));
+		_mm_storeu_si128((__m128i *)(sum + i + 12), _mm_add_epi32(
+			_mm_loadu_si128((__m128i *)(sum + i + 12)), SSE2_SIGNED_DIV128_32(p3)));
+	}
+	return i;
+}
+
+static int SDL_MixAudioMany_SSE2_S16(Sint32 *sum, const Uint8 * const *voice,
+                                     const int *level, int num, int samples,
+                                     int swap)
+{
+	__m128i a, b, vol, p0, p1;
+	int i, j;
+
+	for ( i = 0; i + 8 <= samples; i += 8 ) {
+		p0 = p1 = _mm_setzero_si128();
+		for ( j = 0; j < num; j += 2 ) {
+			vol = _mm_set1_epi32((level[j+1] << 16) | level[j]);
+			a = _mm_loadu_si128((const __m128i *)(voice[j] + i*2));
+			b = _mm_loadu_si128((const __m128i *)(voice[j+1] + i*2));
+			if ( swap ) {
+				a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+				b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+			}
+			p0 = _mm_add_epi32(p0, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), vol));
+			p1 = _mm_add_epi32(p1, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), vol));
+		}
+		_mm_storeu_si128((__m128i *)(sum + i), _mm_add_epi32(
+			_mm_loadu_si128((__m128i *)(sum + i)), SSE2_SIGNED_DIV128_32(p0)));
+		_mm_storeu_si128((__m128i *)(sum + i + 4), _mm_add_epi32(
+			_mm_loadu_si128((__m128i *)(sum + i + 4)), SSE2_SIGNED_DIV128_32(p1)));
+	}
+	return i;
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+/* The unpacks work within each 128-bit half, so the products come out
+   with the halves crossed over, and get put back in order at the end. */
+SDL_TARGETING_AVX2
+static int SDL_MixAudioMany_AVX2_8(Sint32 *sum, const Uint8 * const *voice,
+                                   const int *level, int num, int samples,
+                                   int is_unsigned)
+{
+	const __m256i flip = _mm256_set1_epi8(is_unsigned ? (char)0x80 : 0);
+	__m256i a, b, alo, ahi, blo, bhi, vol, p0, p1, p2, p3;
+	int i, j;
+
+	for ( i = 0; i + 32 <= samples; i += 32 ) {
+		p0 = p1 = p2 = p3 = _mm256_setzero_si256();
+		for ( j = 0; j < num; j += 2 ) {
+			vol = _mm256_set1_epi32((level[j+1] << 16) | level[j]);
+			a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(voice[j] + i)), flip);
+			b = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(voice[j+1] + i)), flip);
+			alo = _mm256_srai_epi16(_mm256_unpacklo_epi8(a, a), 8);
+			ahi = _mm256_srai_epi16(_mm256_unpackhi_epi8(a, a), 8);
+			blo = _mm256_srai_epi16(_mm256_unpacklo_epi8(b, b), 8);
+			bhi = _mm256_srai_epi16(_mm256_unpackhi_epi8(b, b), 8);
+			p0 = _mm256_add_epi32(p0, _mm256_madd_epi16(_mm256_unpacklo_epi16(alo, blo), vol));
+			p1 = _mm256_add_epi32(p1, _mm256_madd_epi16(_mm256_unpackhi_epi16(alo, blo), vol));
+			p2 = _mm256_add_epi32(p2, _mm256_madd_epi16(_mm256_unpacklo_epi16(ahi, bhi), vol));
+			p3 = _mm256_add_epi32(p3, _mm256_madd_epi16(_mm256_unpackhi_epi16(ahi, bhi), vol));
+		}
+		/* p0..p3 hold samples 0-3,4-7,8-11,12-15 in their low halves
+		   and 16-19,20-23,24-27,28-31 in their high halves */
+		a = _mm256_permute2x128_si256(p0, p1, 0x20);
+		b = _mm256_permute2x128_si256(p2, p3, 0x20);
+		alo = _mm256_permute2x128_si256(p0, p1, 0x31);
+		blo = _mm256_permute2x128_si256(p2, p3, 0x31);
+		_mm256_storeu_si256((__m256i *)(sum + i), _mm256_add_epi32(
+			_mm256_loadu_si256((__m256i *)(sum + i)), AVX2_SIGNED_DIV128_32(a)));
+		_mm256_storeu_si256((__m256i *)(sum + i + 8), _mm256_add_epi32(
+			_mm256_loadu_si256((__m256i *)(sum + i + 8)), AVX2_SIGNED_DIV128_32(b)));
+		_mm256_storeu_si256((__m256i *)(sum + i + 16), _mm256_add_epi32(
+			_mm256_loadu_si256((__m256i *)(sum + i + 16)), AVX2_SIGNED_DIV128_32(alo)));
+		_mm256_storeu_si256((__m256i *)(sum + i + 24), _mm256_add_epi32(
+			_mm256_loadu_si256((__m256i *)(sum + i + 24)), AVX2_SIGNED_DIV128_32(blo)));
+	}
+	return i;
+}
+
+SDL_TARGETING_AVX2
+static int SDL_MixAudioMany_AVX2_S16(Sint32 *sum, const Uint8 * const *voice,
+                                     const int *level, int num, int samples,
+                                     int swap)
+{
+	__m256i a, b, vol, p0, p1;
+	int i, j;
+
+	for ( i = 0; i + 16 <= samples; i += 16 ) {
+		p0 = p1 = _mm256_setzero_si256();
+		for ( j = 0; j < num; j += 2 ) {
+			vol = _mm256_set1_epi32((level[j+1] << 16) | level[j]);
+			a = _mm256_loadu_si256((const __m256i *)(voice[j] + i*2));
+			b = _mm256_loadu_si256((const __m256i *)(voice[j+1] + i*2));
+			if ( swap ) {
+				a = _mm256_or_si256(_mm256_slli_epi16(a, 8), _mm256_srli_epi16(a, 8));
+				b = _mm256_or_si256(_mm256_slli_epi16(b, 8), _mm256_srli_epi16(b, 8));
+			}
+			p0 = _mm256_add_epi32(p0, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), vol));
+			p1 = _mm256_add_epi32(p1, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), vol));
+		}
+		a = _mm256_permute2x128_si256(p0, p1, 0x20);
+		b = _mm256_permute2x128_si256(p0, p1, 0x31);
+		_mm256_storeu_si256((__m256i *)(sum + i), _mm256_add_epi32(
+			_mm256_loadu_si256((__m256i *)(sum + i)), AVX2_SIGNED_DIV128_32(a)));
+		_mm256_storeu_si256((__m256i *)(sum + i + 8), _mm256_add_epi32(
+			_mm256_loadu_si256((__m256i *)(sum + i + 8)), AVX2_SIGNED_DIV128_32(b)));
+	}
+	return i;
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
+/* Add in a group of voices, which already start at this chunk */
+static void SDL_MixAccumulate(Uint16 format, Sint32 *sum, const Uint8 * const *voice,
+                              const int *level, int num, int samples)
+{
+	int i = 0, j, total;
+
+#if SDL_AVX2_INTRINSICS
+	if ( SDL_HasAVX2() ) {
+		switch (format) {
+		    case AUDIO_U8:
+		    case AUDIO_S8:
+			i = SDL_MixAudioMany_AVX2_8(sum, voice, level, num, samples,
+			                            (format == AUDIO_U8));
+			break;
+		    case AUDIO_S16LSB:
+		    case AUDIO_S16MSB:
+			i = SDL_MixAudioMany_AVX2_S16(sum, voice, level, num, samples,
+			                              (format == AUDIO_S16MSB));
+			break;
+		}
+	}
+#endif
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		/* Take up where the AVX2 code left off */
+		const Uint8 *rest[MIX_GROUP];
+		int size = (format & 0xFF) / 8;
+
+		for ( j = 0; j < num; ++j ) {
+			rest[j] = voice[j] + i * size;
+		}
+		switch (format) {
+		    case AUDIO_U8:
+		    case AUDIO_S8:
+			i += SDL_MixAudioMany_SSE2_8(sum + i, rest, level, num, samples - i,
+			                             (format == AUDIO_U8));
+			break;
+		    case AUDIO_S16LSB:
+		    case AUDIO_S16MSB:
+			i += SDL_MixAudioMany_SSE2_S16(sum + i, rest, level, num, samples - i,
+			                               (format == AUDIO_S16MSB));
+			break;
+		}
+	}
+#endif
+
+	for ( ; i < samples; ++i ) {
+		total = 0;
+		switch (format) {
+		    case AUDIO_U8:
+			for ( j = 0; j < num; ++j ) {
+				total += (voice[j][i] - 128) * level[j];
+			}
+			break;
+		    case AUDIO_S8:
+			for ( j = 0; j < num; ++j ) {
+				total += ((const Sint8 *)voice[j])[i] * level[j];
+			}
+			break;
+		    case AUDIO_S16LSB:
+			for ( j = 0; j < num; ++j ) {
+				total += (Sint16)((voice[j][i*2+1] << 8) | voice[j][i*2]) * level[j];
+			}
+			break;
+		    case AUDIO_S16MSB:
+			for ( j = 0; j < num; ++j ) {
+				total += (Sint16)((voice[j][i*2] << 8) | voice[j][i*2+1]) * level[j];
+			}
+			break;
+		}
+		sum[i] += total / SDL_MIX_MAXVOLUME;
+	}
+}
+
+/* Clip the sums and write them back to the destination */
+static void SDL_MixStore(Uint16 format, Uint8 *dst, const Sint32 *sum, int samples)
+{
+	int i = 0, sample;
+
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		__m128i lo, hi;
+
+		switch (format) {
+		    case AUDIO_U8:
+		    case AUDIO_S8:
+			for ( ; i + 16 <= samples; i += 16 ) {
+				/* Both packs saturate, which does the clipping */
+				lo = _mm_packs_epi32(_mm_loadu_si128((const __m128i *)(sum + i)),
+				                     _mm_loadu_si128((const __m128i *)(sum + i + 4)));
+				hi = _mm_packs_epi32(_mm_loadu_si128((const __m128i *)(sum + i + 8)),
+				                     _mm_loadu_si128((const __m128i *)(sum + i + 12)));
+				lo = _mm_packs_epi16(lo, hi);
+				if ( format == AUDIO_U8 ) {
+					lo = _mm_min_epu8(_mm_xor_si128(lo, _mm_set1_epi8((char)0x80)),
+					                  _mm_set1_epi8((char)0xFE));
+				}
+				_mm_storeu_si128((__m128i *)(dst + i), lo);
+			}
+			break;
+		    case AUDIO_S16LSB:
+		    case AUDIO_S16MSB:
+			for ( ; i + 8 <= samples; i += 8 ) {
+				lo = _mm_packs_epi32(_mm_loadu_si128((const __m128i *)(sum + i)),
+				                     _mm_loadu_si128((const __m128i *)(sum + i + 4)));
+				if ( format == AUDIO_S16MSB ) {
+					lo = _mm_or_si128(_mm_slli_epi16(lo, 8), _mm_srli_epi16(lo, 8));
+				}
+				_mm_storeu_si128((__m128i *)(dst + i*2), lo);
+			}
+			break;
+		}
+	}
+#endif /* SDL_SSE2_INTRINSICS */
+
+	for ( ; i < samples; ++i ) {
+		sample = sum[i];
+		switch (format) {
+		    case AUDIO_U8:
+			/* Like the mix8 table, top out at 0xFE */
+			sample = SDL_max(-128, SDL_min(sample, 126));
+			dst[i] = (Uint8)(sample + 128);
+			break;
+		    case AUDIO_S8:
+			sample = SDL_max(-128, SDL_min(sample, 127));
+			dst[i] = (Uint8)sample;
+			break;
+		    case AUDIO_S16LSB:
+			sample = SDL_max(-32768, SDL_min(sample, 32767));
+			dst[i*2] = sample & 0xFF;
+			dst[i*2+1] = (sample >> 8) & 0xFF;
+			break;
+		    case AUDIO_S16MSB:
+			sample = SDL_max(-32768, SDL_min(sample, 32767));
+			dst[i*2+1] = sample & 0xFF;
+			dst[i*2] = (sample >> 8) & 0xFF;
+			break;
+		}
+	}
+}
+
+/* 32-bit samples are summed as floats or doubles, without SIMD except for
+   native floats.  Float voices are scaled and added in turn, just the
+   way SDL_MixAudio() does it.
+ */
+static void SDL_MixLoad32(Uint16 format, void *sum, const Uint8 *dst, int samples)
+{
+	const int swap = SWAPPED_32(format);
+	SDL_MixSample32 x;
+	int i;
+
+	if ( format & 0x0100 ) {
+		for ( i = 0; i < samples; ++i ) {
+			x.u = GET_32(dst + i*4, swap);
+			((float *)sum)[i] = x.f;
+		}
+	} else {
+		for ( i = 0; i < samples; ++i ) {
+			((double *)sum)[i] = (Sint32)GET_32(dst + i*4, swap);
+		}
+	}
+}
+
+/* Round towards zero, past where it would clip anyway */
+static double SDL_MixTruncate(double x)
+{
+	if ( x >= 0.0 ) {
+		return (x < 4294967295.0) ? (double)(Uint32)x : 4294967295.0;
+	}
+	return (x > -4294967295.0) ? -(double)(Uint32)-x : -4294967295.0;
+}
+
+static void SDL_MixAccumulate32(Uint16 format, void *sum, const Uint8 * const *voice,
+                                const int *level, int num, int samples)
+{
+	const int swap = SWAPPED_32(format);
+	SDL_MixSample32 x;
+	double total;
+	int i = 0, j;
+
+	if ( format & 0x0100 ) {
+		float *fsum = (float *)sum;
+		float fvolume[MIX_GROUP];
+
+		for ( j = 0; j < num; ++j ) {
+			fvolume[j] = (float)level[j] / SDL_MIX_MAXVOLUME;
+		}
+#if SDL_SSE2_INTRINSICS
+		if ( !swap && SDL_HasSSE2() ) {
+			__m128 acc;
+
+			for ( ; i + 4 <= samples; i += 4 ) {
+				acc = _mm_loadu_ps(fsum + i);
+				for ( j = 0; j < num; ++j ) {
+					acc = _mm_add_ps(acc, _mm_mul_ps(
+						_mm_loadu_ps((const float *)(voice[j] + i*4)),
+						_mm_set1_ps(fvolume[j])));
+				}
+				_mm_storeu_ps(fsum + i, acc);
+			}
+		}
+#endif
+		for ( ; i < samples; ++i ) {
+			for ( j = 0; j < num; ++j ) {
+				x.u = GET_32(voice[j] + i*4, swap);
+				fsum[i] = fsum[i] + x.f * fvolume[j];
+			}
+		}
+	} else {
+		/* The products are exact, and so is their sum */
+		for ( ; i < samples; ++i ) {
+			total = 0.0;
+			for ( j = 0; j < num; ++j ) {
+				total += (double)(Sint32)GET_32(voice[j] + i*4, swap) * level[j];
+			}
+			((double *)sum)[i] += SDL_MixTruncate(total / SDL_MIX_MAXVOLUME);
+		}
+	}
+}
+
+static void SDL_MixStore32(Uint16 format, Uint8 *dst, const void *sum, int samples)
+{
+	const int swap = SWAPPED_32(format);
+	SDL_MixSample32 x;
+	double sample;
+	int i;
+
+	if ( format & 0x0100 ) {
+		for ( i = 0; i < samples; ++i ) {
+			x.f = ((const float *)sum)[i];
+			if ( x.f > 1.0f ) {
+				x.f = 1.0f;
+			} else if ( x.f < -1.0f ) {
+				x.f = -1.0f;
+			}
+			PUT_32(dst + i*4, x.u, swap);
+		}
+	} else {
+		for ( i = 0; i < samples; ++i ) {
+			sample = ((const double *)sum)[i];
+			sample = SDL_max(-2147483648.0, SDL_min(sample, 2147483647.0));
+			PUT_32(dst + i*4, (Uint32)(Sint32)sample, swap);
+		}
+	}
+}
+
+void SDL_MixAudioMany (Uint8 *dst, const Uint8 * const *src, const int *volume, int num_src, Uint32 len)
+{
+	const Uint8 *voice[MIX_GROUP+1];
+	int level[MIX_GROUP+1];
+	union {
+		Sint32 i[MIX_CHUNK];
+		float f[MIX_CHUNK];
+		double d[MIX_CHUNK];
+	} sum;
+	Uint16 format;
+	Uint32 pos;
+	int samplesize, samples, loaded, i, n, v;
+
+	format = SDL_MixFormat();
+	switch (format) {
+	    case AUDIO_U8:
+	    case AUDIO_S8:
+		samplesize = 1;
+		break;
+	    case AUDIO_S16LSB:
+	    case AUDIO_S16MSB:
+		samplesize = 2;
+		break;
+	    case AUDIO_S32LSB:
+	    case AUDIO_S32MSB:
+	    case AUDIO_F32LSB:
+	    case AUDIO_F32MSB:
+		samplesize = 4;
+		break;
+	    default: /* If this happens... FIXME! */
+		SDL_SetError("SDL_MixAudioMany(): unknown audio format");
+		return;
+	}
+
+	for ( pos = 0; pos + samplesize <= len; pos += samples * samplesize ) {
+		samples = SDL_min((len - pos) / samplesize, MIX_CHUNK);
+		loaded = 0;
+		i = 0;
+		while ( i < num_src ) {
+			/* Gather up the next group of voices that can be heard */
+			for ( n = 0; (i < num_src) && (n < MIX_GROUP); ++i ) {
+				v = SDL_max(0, SDL_min(volume[i], SDL_MIX_MAXVOLUME));
+				if ( v > 0 ) {
+					voice[n] = src[i] + pos;
+					level[n] = v;
+					++n;
+				}
+			}
+			if ( n == 0 ) {
+				break;
+			}
+			if ( n & 1 ) {
+				voice[n] = voice[n-1];
+				level[n] = 0;
+				++n;
+			}
+			if ( samplesize == 4 ) {
+				if ( !loaded ) {
+					SDL_MixLoad32(format, &sum, dst + pos, samples);
+					loaded = 1;
+				}
+				SDL_MixAccumulate32(format, &sum, voice, level, n, samples);
+			} else {
+				if ( !loaded ) {
+					SDL_MixLoad(format, sum.i, dst + pos, samples);
+					loaded = 1;
+				}
+				SDL_MixAccumulate(format, sum.i, voice, level, n, samples);
+			}
+		}
+		/* Silence leaves the destination alone, like SDL_MixAudio() */
+		if ( loaded && (samplesize == 4) ) {
+			SDL_MixStore32(format, dst + pos, &sum, samples);
+		} else if ( loaded ) {
+			SDL_MixStore(format, dst + pos, sum.i, samples);
+		}
+	}
+}
@@ -30,6 +30,22 @@
 /* The SDL audio driver */
 typedef struct SDL_AudioDevice SDL_AudioDevice;
 
+/* The ring that SDL_QueueAudio() fills when there's no callback.  Only
+   one thread adds to it, and only the audio thread takes from it, so
+   where there are atomic operations neither needs a lock.  Positions
+   count bytes and wrap around, and 'size' is a power of two.
+ */
+typedef struct SDL_AudioQueue {
+	Uint8 *data;
+	int size;
+	int frame;		/* Data goes in and out in whole frames */
+	volatile int head;	/* Where SDL_QueueAudio() adds data */
+	volatile int tail;	/* Where the audio thread takes it from */
+	volatile int clear;	/* The head at the last SDL_ClearQueuedAudio() */
+	volatile int clear_request;	/* Two for each SDL_ClearQueuedAudio() */
+	volatile int clear_done;	/* The last one the audio thread took */
+} SDL_AudioQueue;
+
 /* Define the SDL audio driver structure */
 #define _THIS	SDL_AudioDevice *_this
 #ifndef _STATUS
@@ -70,6 +86,13 @@ struct SDL_AudioDevice {
 	/* An audio conversion block for audio format emulation */
 	SDL_AudioCVT convert;
 
+	/* The conversion the audio thread feeds the callback's output
+	   through, with convert.buf holding what the callback writes */
+	SDL_AudioStream *stream;
+
+	/* Audio data queued by the application, if there's no callback */
+	SDL_AudioQueue *queue;
+
 	/* Current state flags */
 	int enabled;
 	int paused;
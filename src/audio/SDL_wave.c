@@ -24,369 +24,589 @@
 /* Microsoft WAVE file loading routines */
 
 #include "SDL_audio.h"
+#include "SDL_thread.h"
 #include "SDL_wave.h"
 
 
 static int ReadChunk(SDL_RWops *src, Chunk *chunk);
+static int MapChunk(SDL_RWops *src, Chunk *chunk, const Uint8 *base, int size);
 
-struct MS_ADPCM_decodestate {
-	Uint8 hPredictor;
-	Uint16 iDelta;
-	Sint16 iSamp1;
-	Sint16 iSamp2;
-};
-static struct MS_ADPCM_decoder {
+/* Each block starts over, so the decoders keep no state between blocks,
+   and separate blocks can be decoded at the same time.
+ */
+#define ADPCM_MAX_CHANNELS	2
+
+struct MS_ADPCM_decoder {
 	WaveFMT wavefmt;
 	Uint16 wSamplesPerBlock;
 	Uint16 wNumCoef;
 	Sint16 aCoeff[7][2];
-	/* * * */
-	struct MS_ADPCM_decodestate state[2];
-} MS_ADPCM_state;
+};
 
-static int InitMS_ADPCM(WaveFMT *format)
+static int InitMS_ADPCM(struct MS_ADPCM_decoder *dec, WaveFMT *format)
 {
 	Uint8 *rogue_feel;
 	int i;
 
 	/* Set the rogue pointer to the MS_ADPCM specific data */
-	MS_ADPCM_state.wavefmt.encoding = SDL_SwapLE16(format->encoding);
-	MS_ADPCM_state.wavefmt.channels = SDL_SwapLE16(format->channels);
-	MS_ADPCM_state.wavefmt.frequency = SDL_SwapLE32(format->frequency);
-	MS_ADPCM_state.wavefmt.byterate = SDL_SwapLE32(format->byterate);
-	MS_ADPCM_state.wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
-	MS_ADPCM_state.wavefmt.bitspersample =
+	dec->wavefmt.encoding = SDL_SwapLE16(format->encoding);
+	dec->wavefmt.channels = SDL_SwapLE16(format->channels);
+	dec->wavefmt.frequency = SDL_SwapLE32(format->frequency);
+	dec->wavefmt.byterate = SDL_SwapLE32(format->byterate);
+	dec->wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
+	dec->wavefmt.bitspersample =
 					 SDL_SwapLE16(format->bitspersample);
 	rogue_feel = (Uint8 *)format+sizeof(*format);
 	if ( sizeof(*format) == 16 ) {
 		rogue_feel += sizeof(Uint16);
 	}
-	MS_ADPCM_state.wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
+	dec->wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
 	rogue_feel += sizeof(Uint16);
-	MS_ADPCM_state.wNumCoef = ((rogue_feel[1]<<8)|rogue_feel[0]);
+	dec->wNumCoef = ((rogue_feel[1]<<8)|rogue_feel[0]);
 	rogue_feel += sizeof(Uint16);
-	if ( MS_ADPCM_state.wNumCoef != 7 ) {
+	if ( dec->wNumCoef != 7 ) {
 		SDL_SetError("Unknown set of MS_ADPCM coefficients");
 		return(-1);
 	}
-	for ( i=0; i<MS_ADPCM_state.wNumCoef; ++i ) {
-		MS_ADPCM_state.aCoeff[i][0] = ((rogue_feel[1]<<8)|rogue_feel[0]);
+	for ( i=0; i<dec->wNumCoef; ++i ) {
+		dec->aCoeff[i][0] = ((rogue_feel[1]<<8)|rogue_feel[0]);
 		rogue_feel += sizeof(Uint16);
-		MS_ADPCM_state.aCoeff[i][1] = ((rogue_feel[1]<<8)|rogue_feel[0]);
+		dec->aCoeff[i][1] = ((rogue_feel[1]<<8)|rogue_feel[0]);
 		rogue_feel += sizeof(Uint16);
 	}
+
+	/* Make sure a block holds what it says it does */
+	if ( dec->wavefmt.channels > ADPCM_MAX_CHANNELS ) {
+		SDL_SetError("MS ADPCM decoder can only handle %d channels",
+					ADPCM_MAX_CHANNELS);
+		return(-1);
+	}
+	if ( (dec->wSamplesPerBlock < 2) ||
+	     (((dec->wSamplesPerBlock-2)*dec->wavefmt.channels) % 2) ||
+	     (7*dec->wavefmt.channels +
+	      (dec->wSamplesPerBlock-2)*dec->wavefmt.channels/2 >
+	      dec->wavefmt.blockalign) ) {
+		SDL_SetError("Invalid MS ADPCM block size");
+		return(-1);
+	}
 	return(0);
 }
 
-static Sint32 MS_ADPCM_nibble(struct MS_ADPCM_decodestate *state,
-					Uint8 nybble, Sint16 *coeff)
+static const Sint32 MS_ADPCM_adaptive[16] = {
+	230, 230, 230, 230, 307, 409, 512, 614,
+	768, 614, 512, 409, 307, 230, 230, 230
+};
+
+/* The nybbles are signed */
+static const Sint32 MS_ADPCM_signed[16] = {
+	0, 1, 2, 3, 4, 5, 6, 7, -8, -7, -6, -5, -4, -3, -2, -1
+};
+
+/* Where a channel is, part way through a block */
+struct MS_ADPCM_decodestate {
+	Sint32 iDelta;
+	Sint32 iSamp1;
+	Sint32 iSamp2;
+	Sint32 coeff1;
+	Sint32 coeff2;
+};
+
+static __inline__ Sint16 MS_ADPCM_nibble(struct MS_ADPCM_decodestate *state,
+							Uint8 nybble)
 {
 	const Sint32 max_audioval = ((1<<(16-1))-1);
 	const Sint32 min_audioval = -(1<<(16-1));
-	const Sint32 adaptive[] = {
-		230, 230, 230, 230, 307, 409, 512, 614,
-		768, 614, 512, 409, 307, 230, 230, 230
-	};
 	Sint32 new_sample, delta;
 
-	new_sample = ((state->iSamp1 * coeff[0]) +
-		      (state->iSamp2 * coeff[1]))/256;
-	if ( nybble & 0x08 ) {
-		new_sample += state->iDelta * (nybble-0x10);
-	} else {
-		new_sample += state->iDelta * nybble;
-	}
+	new_sample = ((state->iSamp1 * state->coeff1) +
+		      (state->iSamp2 * state->coeff2))/256;
+	new_sample += state->iDelta * MS_ADPCM_signed[nybble];
 	if ( new_sample < min_audioval ) {
 		new_sample = min_audioval;
 	} else
 	if ( new_sample > max_audioval ) {
 		new_sample = max_audioval;
 	}
-	delta = ((Sint32)state->iDelta * adaptive[nybble])/256;
+	delta = (state->iDelta * MS_ADPCM_adaptive[nybble])/256;
 	if ( delta < 16 ) {
 		delta = 16;
 	}
 	state->iDelta = (Uint16)delta;
 	state->iSamp2 = state->iSamp1;
-	state->iSamp1 = (Sint16)new_sample;
-	return(new_sample);
+	state->iSamp1 = new_sample;
+	return((Sint16)new_sample);
 }
 
-static int MS_ADPCM_decode(Uint8 **audio_buf, Uint32 *audio_len)
+/* Decode a block of encoded data into 'wSamplesPerBlock' frames */
+static void MS_ADPCM_decode(struct MS_ADPCM_decoder *dec,
+				Uint8 *encoded, Uint8 *decoded)
 {
-	struct MS_ADPCM_decodestate *state[2];
-	Uint8 *freeable, *encoded, *decoded;
-	Sint32 encoded_len, samplesleft;
-	Sint8 nybble, stereo;
-	Sint16 *coeff[2];
-	Sint32 new_sample;
-
-	/* Allocate the proper sized output buffer */
-	encoded_len = *audio_len;
-	encoded = *audio_buf;
-	freeable = *audio_buf;
-	*audio_len = (encoded_len/MS_ADPCM_state.wavefmt.blockalign) * 
-				MS_ADPCM_state.wSamplesPerBlock*
-				MS_ADPCM_state.wavefmt.channels*sizeof(Sint16);
-	*audio_buf = (Uint8 *)SDL_malloc(*audio_len);
-	if ( *audio_buf == NULL ) {
-		SDL_Error(SDL_ENOMEM);
-		return(-1);
-	}
-	decoded = *audio_buf;
-
-	/* Get ready... Go! */
-	stereo = (MS_ADPCM_state.wavefmt.channels == 2);
-	state[0] = &MS_ADPCM_state.state[0];
-	state[1] = &MS_ADPCM_state.state[stereo];
-	while ( encoded_len >= MS_ADPCM_state.wavefmt.blockalign ) {
-		/* Grab the initial information for this block */
-		state[0]->hPredictor = *encoded++;
-		if ( stereo ) {
-			state[1]->hPredictor = *encoded++;
-		}
-		state[0]->iDelta = ((encoded[1]<<8)|encoded[0]);
-		encoded += sizeof(Sint16);
-		if ( stereo ) {
-			state[1]->iDelta = ((encoded[1]<<8)|encoded[0]);
-			encoded += sizeof(Sint16);
-		}
-		state[0]->iSamp1 = ((encoded[1]<<8)|encoded[0]);
-		encoded += sizeof(Sint16);
-		if ( stereo ) {
-			state[1]->iSamp1 = ((encoded[1]<<8)|encoded[0]);
-			encoded += sizeof(Sint16);
-		}
-		state[0]->iSamp2 = ((encoded[1]<<8)|encoded[0]);
-		encoded += sizeof(Sint16);
-		if ( stereo ) {
-			state[1]->iSamp2 = ((encoded[1]<<8)|encoded[0]);
-			encoded += sizeof(Sint16);
+	struct MS_ADPCM_decodestate state[ADPCM_MAX_CHANNELS];
+	Sint16 *out = (Sint16 *)decoded;
+	unsigned int c, channels;
+	Uint8 predictor;
+	Sint32 bytesleft;
+
+	/* Grab the initial information for this block */
+	channels = dec->wavefmt.channels;
+	for ( c=0; c<channels; ++c ) {
+		predictor = encoded[c];
+		if ( predictor >= 7 ) {
+			/* Corrupt data, don't read past the coefficients */
+			predictor = 0;
 		}
-		coeff[0] = MS_ADPCM_state.aCoeff[state[0]->hPredictor];
-		coeff[1] = MS_ADPCM_state.aCoeff[state[1]->hPredictor];
+		state[c].coeff1 = dec->aCoeff[predictor][0];
+		state[c].coeff2 = dec->aCoeff[predictor][1];
+		state[c].iDelta = (Uint16)((encoded[channels+c*2+1]<<8)|
+		                           encoded[channels+c*2]);
+		state[c].iSamp1 = (Sint16)((encoded[channels*3+c*2+1]<<8)|
+		                           encoded[channels*3+c*2]);
+		state[c].iSamp2 = (Sint16)((encoded[channels*5+c*2+1]<<8)|
+		                           encoded[channels*5+c*2]);
 
 		/* Store the two initial samples we start with */
-		decoded[0] = state[0]->iSamp2&0xFF;
-		decoded[1] = state[0]->iSamp2>>8;
-		decoded += 2;
-		if ( stereo ) {
-			decoded[0] = state[1]->iSamp2&0xFF;
-			decoded[1] = state[1]->iSamp2>>8;
-			decoded += 2;
-		}
-		decoded[0] = state[0]->iSamp1&0xFF;
-		decoded[1] = state[0]->iSamp1>>8;
-		decoded += 2;
-		if ( stereo ) {
-			decoded[0] = state[1]->iSamp1&0xFF;
-			decoded[1] = state[1]->iSamp1>>8;
-			decoded += 2;
+		out[c] = SDL_SwapLE16((Sint16)state[c].iSamp2);
+		out[channels+c] = SDL_SwapLE16((Sint16)state[c].iSamp1);
+	}
+	encoded += channels*7;
+	out += channels*2;
+
+	/* Decode and store the other samples in this block, the high
+	   nybble of each byte first, alternating channels for stereo.
+	 */
+	bytesleft = (dec->wSamplesPerBlock-2)*channels/2;
+	if ( channels == 2 ) {
+		while ( bytesleft-- > 0 ) {
+			out[0] = SDL_SwapLE16(MS_ADPCM_nibble(&state[0], *encoded>>4));
+			out[1] = SDL_SwapLE16(MS_ADPCM_nibble(&state[1], *encoded&0x0F));
+			out += 2;
+			++encoded;
 		}
-
-		/* Decode and store the other samples in this block */
-		samplesleft = (MS_ADPCM_state.wSamplesPerBlock-2)*
-					MS_ADPCM_state.wavefmt.channels;
-		while ( samplesleft > 0 ) {
-			nybble = (*encoded)>>4;
-			new_sample = MS_ADPCM_nibble(state[0],nybble,coeff[0]);
-			decoded[0] = new_sample&0xFF;
-			new_sample >>= 8;
-			decoded[1] = new_sample&0xFF;
-			decoded += 2;
-
-			nybble = (*encoded)&0x0F;
-			new_sample = MS_ADPCM_nibble(state[1],nybble,coeff[1]);
-			decoded[0] = new_sample&0xFF;
-			new_sample >>= 8;
-			decoded[1] = new_sample&0xFF;
-			decoded += 2;
-
+	} else {
+		while ( bytesleft-- > 0 ) {
+			out[0] = SDL_SwapLE16(MS_ADPCM_nibble(&state[0], *encoded>>4));
+			out[1] = SDL_SwapLE16(MS_ADPCM_nibble(&state[0], *encoded&0x0F));
+			out += 2;
 			++encoded;
-			samplesleft -= 2;
 		}
-		encoded_len -= MS_ADPCM_state.wavefmt.blockalign;
 	}
-	SDL_free(freeable);
-	return(0);
 }
 
-struct IMA_ADPCM_decodestate {
-	Sint32 sample;
-	Sint8 index;
-};
-static struct IMA_ADPCM_decoder {
+struct IMA_ADPCM_decoder {
 	WaveFMT wavefmt;
 	Uint16 wSamplesPerBlock;
-	/* * * */
-	struct IMA_ADPCM_decodestate state[2];
-} IMA_ADPCM_state;
+};
 
-static int InitIMA_ADPCM(WaveFMT *format)
+static int InitIMA_ADPCM(struct IMA_ADPCM_decoder *dec, WaveFMT *format)
 {
 	Uint8 *rogue_feel;
 
 	/* Set the rogue pointer to the IMA_ADPCM specific data */
-	IMA_ADPCM_state.wavefmt.encoding = SDL_SwapLE16(format->encoding);
-	IMA_ADPCM_state.wavefmt.channels = SDL_SwapLE16(format->channels);
-	IMA_ADPCM_state.wavefmt.frequency = SDL_SwapLE32(format->frequency);
-	IMA_ADPCM_state.wavefmt.byterate = SDL_SwapLE32(format->byterate);
-	IMA_ADPCM_state.wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
-	IMA_ADPCM_state.wavefmt.bitspersample =
+	dec->wavefmt.encoding = SDL_SwapLE16(format->encoding);
+	dec->wavefmt.channels = SDL_SwapLE16(format->channels);
+	dec->wavefmt.frequency = SDL_SwapLE32(format->frequency);
+	dec->wavefmt.byterate = SDL_SwapLE32(format->byterate);
+	dec->wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
+	dec->wavefmt.bitspersample =
 					 SDL_SwapLE16(format->bitspersample);
 	rogue_feel = (Uint8 *)format+sizeof(*format);
 	if ( sizeof(*format) == 16 ) {
 		rogue_feel += sizeof(Uint16);
 	}
-	IMA_ADPCM_state.wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
+	dec->wSamplesPerBlock = ((rogue_feel[1]<<8)|rogue_feel[0]);
+
+	/* Make sure a block holds what it says it does */
+	if ( dec->wavefmt.channels > ADPCM_MAX_CHANNELS ) {
+		SDL_SetError("IMA ADPCM decoder can only handle %d channels",
+					ADPCM_MAX_CHANNELS);
+		return(-1);
+	}
+	if ( (dec->wSamplesPerBlock < 1) ||
+	     ((dec->wSamplesPerBlock-1) % 8) ||
+	     (4*dec->wavefmt.channels +
+	      (dec->wSamplesPerBlock-1)*dec->wavefmt.channels/2 >
+	      dec->wavefmt.blockalign) ) {
+		SDL_SetError("Invalid IMA ADPCM block size");
+		return(-1);
+	}
 	return(0);
 }
 
-static Sint32 IMA_ADPCM_nibble(struct IMA_ADPCM_decodestate *state,Uint8 nybble)
+static const Sint8 IMA_ADPCM_index[16] = {
+	-1, -1, -1, -1,  2,  4,  6,  8,
+	-1, -1, -1, -1,  2,  4,  6,  8
+};
+
+/* The difference each step size makes for the low three bits of a
+   nybble: (step>>3) plus step, step>>1 and step>>2 for bits 2, 1 and 0.
+ */
+static const Uint16 IMA_ADPCM_delta[89][8] = {
+	{ 0, 1, 3, 4, 7, 8, 10, 11 },
+	{ 1, 3, 5, 7, 9, 11, 13, 15 },
+	{ 1, 3, 5, 7, 10, 12, 14, 16 },
+	{ 1, 3, 6, 8, 11, 13, 16, 18 },
+	{ 1, 3, 6, 8, 12, 14, 17, 19 },
+	{ 1, 4, 7, 10, 13, 16, 19, 22 },
+	{ 1, 4, 7, 10, 14, 17, 20, 23 },
+	{ 1, 4, 8, 11, 15, 18, 22, 25 },
+	{ 2, 6, 10, 14, 18, 22, 26, 30 },
+	{ 2, 6, 10, 14, 19, 23, 27, 31 },
+	{ 2, 6, 11, 15, 21, 25, 30, 34 },
+	{ 2, 7, 12, 17, 23, 28, 33, 38 },
+	{ 2, 7, 13, 18, 25, 30, 36, 41 },
+	{ 3, 9, 15, 21, 28, 34, 40, 46 },
+	{ 3, 10, 17, 24, 31, 38, 45, 52 },
+	{ 3, 10, 18, 25, 34, 41, 49, 56 },
+	{ 4, 12, 21, 29, 38, 46, 55, 63 },
+	{ 4, 13, 22, 31, 41, 50, 59, 68 },
+	{ 5, 15, 25, 35, 46, 56, 66, 76 },
+	{ 5, 16, 27, 38, 50, 61, 72, 83 },
+	{ 6, 18, 31, 43, 56, 68, 81, 93 },
+	{ 6, 19, 33, 46, 61, 74, 88, 101 },
+	{ 7, 22, 37, 52, 67, 82, 97, 112 },
+	{ 8, 24, 41, 57, 74, 90, 107, 123 },
+	{ 9, 27, 45, 63, 82, 100, 118, 136 },
+	{ 10, 30, 50, 70, 90, 110, 130, 150 },
+	{ 11, 33, 55, 77, 99, 121, 143, 165 },
+	{ 12, 36, 60, 84, 109, 133, 157, 181 },
+	{ 13, 39, 66, 92, 120, 146, 173, 199 },
+	{ 14, 43, 73, 102, 132, 161, 191, 220 },
+	{ 16, 48, 81, 113, 146, 178, 211, 243 },
+	{ 17, 52, 88, 123, 160, 195, 231, 266 },
+	{ 19, 58, 97, 136, 176, 215, 254, 293 },
+	{ 21, 64, 107, 150, 194, 237, 280, 323 },
+	{ 23, 70, 118, 165, 213, 260, 308, 355 },
+	{ 26, 78, 130, 182, 235, 287, 339, 391 },
+	{ 28, 85, 143, 200, 258, 315, 373, 430 },
+	{ 31, 94, 157, 220, 284, 347, 410, 473 },
+	{ 34, 103, 173, 242, 313, 382, 452, 521 },
+	{ 38, 114, 191, 267, 345, 421, 498, 574 },
+	{ 42, 126, 210, 294, 379, 463, 547, 631 },
+	{ 46, 138, 231, 323, 417, 509, 602, 694 },
+	{ 51, 153, 255, 357, 459, 561, 663, 765 },
+	{ 56, 168, 280, 392, 505, 617, 729, 841 },
+	{ 61, 184, 308, 431, 555, 678, 802, 925 },
+	{ 68, 204, 340, 476, 612, 748, 884, 1020 },
+	{ 74, 223, 373, 522, 672, 821, 971, 1120 },
+	{ 82, 246, 411, 575, 740, 904, 1069, 1233 },
+	{ 90, 271, 452, 633, 814, 995, 1176, 1357 },
+	{ 99, 298, 497, 696, 895, 1094, 1293, 1492 },
+	{ 109, 328, 547, 766, 985, 1204, 1423, 1642 },
+	{ 120, 360, 601, 841, 1083, 1323, 1564, 1804 },
+	{ 132, 397, 662, 927, 1192, 1457, 1722, 1987 },
+	{ 145, 436, 728, 1019, 1311, 1602, 1894, 2185 },
+	{ 160, 480, 801, 1121, 1442, 1762, 2083, 2403 },
+	{ 176, 528, 881, 1233, 1587, 1939, 2292, 2644 },
+	{ 194, 582, 970, 1358, 1746, 2134, 2522, 2910 },
+	{ 213, 639, 1066, 1492, 1920, 2346, 2773, 3199 },
+	{ 234, 703, 1173, 1642, 2112, 2581, 3051, 3520 },
+	{ 258, 774, 1291, 1807, 2324, 2840, 3357, 3873 },
+	{ 284, 852, 1420, 1988, 2556, 3124, 3692, 4260 },
+	{ 312, 936, 1561, 2185, 2811, 3435, 4060, 4684 },
+	{ 343, 1030, 1717, 2404, 3092, 3779, 4466, 5153 },
+	{ 378, 1134, 1890, 2646, 3402, 4158, 4914, 5670 },
+	{ 415, 1246, 2078, 2909, 3742, 4573, 5405, 6236 },
+	{ 457, 1372, 2287, 3202, 4117, 5032, 5947, 6862 },
+	{ 503, 1509, 2516, 3522, 4529, 5535, 6542, 7548 },
+	{ 553, 1660, 2767, 3874, 4981, 6088, 7195, 8302 },
+	{ 608, 1825, 3043, 4260, 5479, 6696, 7914, 9131 },
+	{ 669, 2008, 3348, 4687, 6027, 7366, 8706, 10045 },
+	{ 736, 2209, 3683, 5156, 6630, 8103, 9577, 11050 },
+	{ 810, 2431, 4052, 5673, 7294, 8915, 10536, 12157 },
+	{ 891, 2674, 4457, 6240, 8023, 9806, 11589, 13372 },
+	{ 980, 2941, 4902, 6863, 8825, 10786, 12747, 14708 },
+	{ 1078, 3235, 5393, 7550, 9708, 11865, 14023, 16180 },
+	{ 1186, 3559, 5932, 8305, 10679, 13052, 15425, 17798 },
+	{ 1305, 3915, 6526, 9136, 11747, 14357, 16968, 19578 },
+	{ 1435, 4306, 7178, 10049, 12922, 15793, 18665, 21536 },
+	{ 1579, 4737, 7896, 11054, 14214, 17372, 20531, 23689 },
+	{ 1737, 5211, 8686, 12160, 15636, 19110, 22585, 26059 },
+	{ 1911, 5733, 9555, 13377, 17200, 21022, 24844, 28666 },
+	{ 2102, 6306, 10511, 14715, 18920, 23124, 27329, 31533 },
+	{ 2312, 6937, 11562, 16187, 20812, 25437, 30062, 34687 },
+	{ 2543, 7630, 12718, 17805, 22893, 27980, 33068, 38155 },
+	{ 2798, 8394, 13990, 19586, 25183, 30779, 36375, 41971 },
+	{ 3077, 9232, 15388, 21543, 27700, 33855, 40011, 46166 },
+	{ 3385, 10156, 16928, 23699, 30471, 37242, 44014, 50785 },
+	{ 3724, 11172, 18621, 26069, 33518, 40966, 48415, 55863 },
+	{ 4095, 12286, 20478, 28669, 36862, 45053, 53245, 61436 },
+};
+
+static __inline__ Sint16 IMA_ADPCM_nibble(Sint32 *sample, int *index,
+							Uint8 nybble)
 {
 	const Sint32 max_audioval = ((1<<(16-1))-1);
 	const Sint32 min_audioval = -(1<<(16-1));
-	const int index_table[16] = {
-		-1, -1, -1, -1,
-		 2,  4,  6,  8,
-		-1, -1, -1, -1,
-		 2,  4,  6,  8
-	};
-	const Sint32 step_table[89] = {
-		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
-		34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
-		143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
-		449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282,
-		1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
-		3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
-		9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
-		22385, 24623, 27086, 29794, 32767
-	};
-	Sint32 delta, step;
-
-	/* Compute difference and new sample value */
-	step = step_table[state->index];
-	delta = step >> 3;
-	if ( nybble & 0x04 ) delta += step;
-	if ( nybble & 0x02 ) delta += (step >> 1);
-	if ( nybble & 0x01 ) delta += (step >> 2);
-	if ( nybble & 0x08 ) delta = -delta;
-	state->sample += delta;
+	Sint32 delta, sign;
+
+	/* Compute difference and new sample value, without a branch on
+	   the sign bit, which is as good as random.
+	 */
+	delta = IMA_ADPCM_delta[*index][nybble & 0x07];
+	sign = -(Sint32)(nybble >> 3);
+	*sample += (delta ^ sign) - sign;
 
 	/* Update index value */
-	state->index += index_table[nybble];
-	if ( state->index > 88 ) {
-		state->index = 88;
+	*index += IMA_ADPCM_index[nybble];
+	if ( *index > 88 ) {
+		*index = 88;
 	} else
-	if ( state->index < 0 ) {
-		state->index = 0;
+	if ( *index < 0 ) {
+		*index = 0;
 	}
 
 	/* Clamp output sample */
-	if ( state->sample > max_audioval ) {
-		state->sample = max_audioval;
+	if ( *sample > max_audioval ) {
+		*sample = max_audioval;
 	} else
-	if ( state->sample < min_audioval ) {
-		state->sample = min_audioval;
+	if ( *sample < min_audioval ) {
+		*sample = min_audioval;
 	}
-	return(state->sample);
+	return((Sint16)*sample);
 }
 
-/* Fill the decode buffer with a channel block of data (8 samples) */
-static void Fill_IMA_ADPCM_block(Uint8 *decoded, Uint8 *encoded,
-	int channel, int numchannels, struct IMA_ADPCM_decodestate *state)
+/* Decode a block of encoded data into 'wSamplesPerBlock' frames */
+static void IMA_ADPCM_decode(struct IMA_ADPCM_decoder *dec,
+				Uint8 *encoded, Uint8 *decoded)
 {
-	int i;
-	Sint8 nybble;
-	Sint32 new_sample;
-
-	decoded += (channel * 2);
-	for ( i=0; i<4; ++i ) {
-		nybble = (*encoded)&0x0F;
-		new_sample = IMA_ADPCM_nibble(state, nybble);
-		decoded[0] = new_sample&0xFF;
-		new_sample >>= 8;
-		decoded[1] = new_sample&0xFF;
-		decoded += 2 * numchannels;
-
-		nybble = (*encoded)>>4;
-		new_sample = IMA_ADPCM_nibble(state, nybble);
-		decoded[0] = new_sample&0xFF;
-		new_sample >>= 8;
-		decoded[1] = new_sample&0xFF;
-		decoded += 2 * numchannels;
-
-		++encoded;
+	Sint16 *out = (Sint16 *)decoded;
+	Uint8 *header, *data;
+	unsigned int c, channels, groups, g, i;
+	Sint32 sample;
+	int index;
+
+	/* After the headers, the data comes in groups of 8 samples,
+	   4 bytes per channel, low nybble first.  Decode one channel
+	   at a time, so its state stays put through the whole block.
+	 */
+	channels = dec->wavefmt.channels;
+	groups = (dec->wSamplesPerBlock-1)/8;
+	for ( c=0; c<channels; ++c ) {
+		/* Grab the initial information for this channel */
+		header = encoded + c*4;
+		sample = (Sint16)((header[1]<<8)|header[0]);
+		index = header[2];
+		if ( index > 88 ) {
+			/* Corrupt data, don't read past the step table */
+			index = 88;
+		}
+		/* header[3] is reserved, and should be 0 */
+
+		/* Store the initial sample we start with */
+		out[c] = SDL_SwapLE16((Sint16)sample);
+
+		/* Decode and store the other samples of this channel */
+		data = encoded + channels*4 + c*4;
+		for ( g=0; g<groups; ++g ) {
+			Sint16 *dst = out + channels*(1 + g*8) + c;
+			for ( i=0; i<4; ++i ) {
+				dst[0] = SDL_SwapLE16(IMA_ADPCM_nibble(&sample, &index, data[i]&0x0F));
+				dst += channels;
+				dst[0] = SDL_SwapLE16(IMA_ADPCM_nibble(&sample, &index, data[i]>>4));
+				dst += channels;
+			}
+			data += channels*4;
+		}
 	}
 }
 
-static int IMA_ADPCM_decode(Uint8 **audio_buf, Uint32 *audio_len)
+/* What it takes to decode a WAVE file's data, a block at a time */
+typedef struct WaveDecoder {
+	Uint16 encoding;
+	Uint32 blockalign;	/* Bytes in a block of encoded data */
+	Uint32 blockframes;	/* Frames in a decoded block */
+	Uint32 framesize;	/* Bytes in a decoded frame */
+	struct MS_ADPCM_decoder ms;
+	struct IMA_ADPCM_decoder ima;
+} WaveDecoder;
+
+/* Check the magic header, and return the length the RIFF chunk gives */
+static int ReadWaveMagic(SDL_RWops *src, Uint32 *wavelen)
 {
-	struct IMA_ADPCM_decodestate *state;
-	Uint8 *freeable, *encoded, *decoded;
-	Sint32 encoded_len, samplesleft;
-	unsigned int c, channels;
+	Uint32 RIFFchunk;
+	Uint32 WAVEmagic;
 
-	/* Check to make sure we have enough variables in the state array */
-	channels = IMA_ADPCM_state.wavefmt.channels;
-	if ( channels > SDL_arraysize(IMA_ADPCM_state.state) ) {
-		SDL_SetError("IMA ADPCM decoder can only handle %d channels",
-					SDL_arraysize(IMA_ADPCM_state.state));
-		return(-1);
+	RIFFchunk	= SDL_ReadLE32(src);
+	*wavelen	= SDL_ReadLE32(src);
+	if ( *wavelen == WAVE ) { /* The RIFFchunk has already been read */
+		WAVEmagic = *wavelen;
+		*wavelen  = RIFFchunk;
+		RIFFchunk = RIFF;
+	} else {
+		WAVEmagic = SDL_ReadLE32(src);
 	}
-	state = IMA_ADPCM_state.state;
-
-	/* Allocate the proper sized output buffer */
-	encoded_len = *audio_len;
-	encoded = *audio_buf;
-	freeable = *audio_buf;
-	*audio_len = (encoded_len/IMA_ADPCM_state.wavefmt.blockalign) * 
-				IMA_ADPCM_state.wSamplesPerBlock*
-				IMA_ADPCM_state.wavefmt.channels*sizeof(Sint16);
-	*audio_buf = (Uint8 *)SDL_malloc(*audio_len);
-	if ( *audio_buf == NULL ) {
-		SDL_Error(SDL_ENOMEM);
+	if ( (RIFFchunk != RIFF) || (WAVEmagic != WAVE) ) {
+		SDL_SetError("Unrecognized file type (not WAVE)");
 		return(-1);
 	}
-	decoded = *audio_buf;
-
-	/* Get ready... Go! */
-	while ( encoded_len >= IMA_ADPCM_state.wavefmt.blockalign ) {
-		/* Grab the initial information for this block */
-		for ( c=0; c<channels; ++c ) {
-			/* Fill the state information for this block */
-			state[c].sample = ((encoded[1]<<8)|encoded[0]);
-			encoded += 2;
-			if ( state[c].sample & 0x8000 ) {
-				state[c].sample -= 0x10000;
+	return(0);
+}
+
+/* Set up to decode the data in 'format', and fill in 'spec' to match */
+static int InitWaveDecoder(WaveDecoder *dec, WaveFMT *format,
+				SDL_AudioSpec *spec)
+{
+	int was_error = 0;
+
+	SDL_memset(dec, 0, (sizeof *dec));
+	dec->encoding = SDL_SwapLE16(format->encoding);
+	switch (dec->encoding) {
+		case PCM_CODE:
+			/* We can understand this */
+			break;
+		case MS_ADPCM_CODE:
+			/* Try to understand this */
+			if ( InitMS_ADPCM(&dec->ms, format) < 0 ) {
+				return(-1);
 			}
-			state[c].index = *encoded++;
-			/* Reserved byte in buffer header, should be 0 */
-			if ( *encoded++ != 0 ) {
-				/* Uh oh, corrupt data?  Buggy code? */;
+			dec->blockalign = dec->ms.wavefmt.blockalign;
+			dec->blockframes = dec->ms.wSamplesPerBlock;
+			break;
+		case IMA_ADPCM_CODE:
+			/* Try to understand this */
+			if ( InitIMA_ADPCM(&dec->ima, format) < 0 ) {
+				return(-1);
 			}
+			dec->blockalign = dec->ima.wavefmt.blockalign;
+			dec->blockframes = dec->ima.wSamplesPerBlock;
+			break;
+		case MP3_CODE:
+			SDL_SetError("MPEG Layer 3 data not supported",
+					SDL_SwapLE16(format->encoding));
+			return(-1);
+		default:
+			SDL_SetError("Unknown WAVE data format: 0x%.4x",
+					SDL_SwapLE16(format->encoding));
+			return(-1);
+	}
+	SDL_memset(spec, 0, (sizeof *spec));
+	spec->freq = SDL_SwapLE32(format->frequency);
+	switch (SDL_SwapLE16(format->bitspersample)) {
+		case 4:
+			if ( dec->encoding != PCM_CODE ) {
+				spec->format = AUDIO_S16;
+			} else {
+				was_error = 1;
+			}
+			break;
+		case 8:
+			spec->format = AUDIO_U8;
+			break;
+		case 16:
+			spec->format = AUDIO_S16;
+			break;
+		default:
+			was_error = 1;
+			break;
+	}
+	if ( was_error ) {
+		SDL_SetError("Unknown %d-bit PCM data format",
+			SDL_SwapLE16(format->bitspersample));
+		return(-1);
+	}
+	spec->channels = (Uint8)SDL_SwapLE16(format->channels);
+	spec->samples = 4096;		/* Good default buffer size */
+
+	dec->framesize = ((spec->format & 0xFF)/8)*spec->channels;
+	if ( dec->encoding == PCM_CODE ) {
+		dec->blockalign = dec->framesize;
+		dec->blockframes = 1;
+	}
+	if ( dec->framesize == 0 ) {
+		SDL_SetError("WAVE file has no channels");
+		return(-1);
+	}
+	return(0);
+}
+
+static void DecodeWaveBlock(WaveDecoder *dec, Uint8 *encoded, Uint8 *decoded)
+{
+	if ( dec->encoding == MS_ADPCM_CODE ) {
+		MS_ADPCM_decode(&dec->ms, encoded, decoded);
+	} else {
+		IMA_ADPCM_decode(&dec->ima, encoded, decoded);
+	}
+}
+
+/*
+ * Big ADPCM files can be decoded on several threads at once, each taking
+ * a run of blocks.  This is opt-in, by setting the SDL_AUDIO_WAVE_THREADS
+ * environment variable to the number of threads (including the calling
+ * one) that should share the work.
+ */
+#define MAX_DECODE_THREADS	16
+#define MIN_DECODE_BLOCKS	256	/* per thread */
+
+typedef struct WaveDecodeJob {
+	WaveDecoder *dec;
+	Uint8 *encoded;
+	Uint8 *decoded;
+	Uint32 blocks;
+} WaveDecodeJob;
+
+static int SDLCALL DecodeWaveBlocks(void *data)
+{
+	WaveDecodeJob *job = (WaveDecodeJob *)data;
+	WaveDecoder *dec = job->dec;
+	Uint32 i;
 
-			/* Store the initial sample we start with */
-			decoded[0] = (Uint8)(state[c].sample&0xFF);
-			decoded[1] = (Uint8)(state[c].sample>>8);
-			decoded += 2;
+	for ( i = 0; i < job->blocks; ++i ) {
+		DecodeWaveBlock(dec, job->encoded + i * dec->blockalign,
+		    job->decoded + i * dec->blockframes * dec->framesize);
+	}
+	return(0);
+}
+
+static void DecodeWaveData(WaveDecoder *dec, Uint8 *encoded, Uint8 *decoded,
+								Uint32 blocks)
+{
+	WaveDecodeJob jobs[MAX_DECODE_THREADS];
+#if !SDL_THREADS_DISABLED
+	SDL_Thread *threads[MAX_DECODE_THREADS];
+	const char *env;
+	int i, numthreads;
+	Uint32 block, extra;
+
+	env = SDL_getenv("SDL_AUDIO_WAVE_THREADS");
+	numthreads = env ? SDL_atoi(env) : 0;
+	if ( numthreads > MAX_DECODE_THREADS ) {
+		numthreads = MAX_DECODE_THREADS;
+	}
+	if ( numthreads > (int)(blocks / MIN_DECODE_BLOCKS) ) {
+		numthreads = (int)(blocks / MIN_DECODE_BLOCKS);
+	}
+	if ( numthreads > 1 ) {
+		block = 0;
+		extra = blocks % numthreads;
+		for ( i = 0; i < numthreads; ++i ) {
+			jobs[i].dec = dec;
+			jobs[i].encoded = encoded + block * dec->blockalign;
+			jobs[i].decoded = decoded +
+			    block * dec->blockframes * dec->framesize;
+			jobs[i].blocks = blocks / numthreads + (i < extra);
+			block += jobs[i].blocks;
 		}
 
-		/* Decode and store the other samples in this block */
-		samplesleft = (IMA_ADPCM_state.wSamplesPerBlock-1)*channels;
-		while ( samplesleft > 0 ) {
-			for ( c=0; c<channels; ++c ) {
-				Fill_IMA_ADPCM_block(decoded, encoded,
-						c, channels, &state[c]);
-				encoded += 4;
-				samplesleft -= 8;
+		/* The calling thread decodes the first run itself */
+		for ( i = 1; i < numthreads; ++i ) {
+			threads[i] = SDL_CreateThread(DecodeWaveBlocks, &jobs[i]);
+		}
+		DecodeWaveBlocks(&jobs[0]);
+		for ( i = 1; i < numthreads; ++i ) {
+			if ( threads[i] != NULL ) {
+				SDL_WaitThread(threads[i], NULL);
+			} else {
+				DecodeWaveBlocks(&jobs[i]);
 			}
-			decoded += (channels * 8 * 2);
 		}
-		encoded_len -= IMA_ADPCM_state.wavefmt.blockalign;
+		return;
 	}
-	SDL_free(freeable);
-	return(0);
+#endif /* !SDL_THREADS_DISABLED */
+	jobs[0].dec = dec;
+	jobs[0].encoded = encoded;
+	jobs[0].decoded = decoded;
+	jobs[0].blocks = blocks;
+	DecodeWaveBlocks(&jobs[0]);
 }
 
 SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
@@ -395,13 +615,12 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 	int was_error;
 	Chunk chunk;
 	int lenread;
-	int MS_ADPCM_encoded, IMA_ADPCM_encoded;
-	int samplesize;
+	WaveDecoder dec;
+	const Uint8 *mapped;
+	int mapped_size;
 
 	/* WAV magic header */
-	Uint32 RIFFchunk;
 	Uint32 wavelen = 0;
-	Uint32 WAVEmagic;
 	Uint32 headerDiff = 0;
 
 	/* FMT chunk */
@@ -415,17 +634,7 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 	}
 		
 	/* Check the magic header */
-	RIFFchunk	= SDL_ReadLE32(src);
-	wavelen		= SDL_ReadLE32(src);
-	if ( wavelen == WAVE ) { /* The RIFFchunk has already been read */
-		WAVEmagic = wavelen;
-		wavelen   = RIFFchunk;
-		RIFFchunk = RIFF;
-	} else {
-		WAVEmagic = SDL_ReadLE32(src);
-	}
-	if ( (RIFFchunk != RIFF) || (WAVEmagic != WAVE) ) {
-		SDL_SetError("Unrecognized file type (not WAVE)");
+	if ( ReadWaveMagic(src, &wavelen) < 0 ) {
 		was_error = 1;
 		goto done;
 	}
@@ -454,74 +663,30 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 		was_error = 1;
 		goto done;
 	}
-	MS_ADPCM_encoded = IMA_ADPCM_encoded = 0;
-	switch (SDL_SwapLE16(format->encoding)) {
-		case PCM_CODE:
-			/* We can understand this */
-			break;
-		case MS_ADPCM_CODE:
-			/* Try to understand this */
-			if ( InitMS_ADPCM(format) < 0 ) {
-				was_error = 1;
-				goto done;
-			}
-			MS_ADPCM_encoded = 1;
-			break;
-		case IMA_ADPCM_CODE:
-			/* Try to understand this */
-			if ( InitIMA_ADPCM(format) < 0 ) {
-				was_error = 1;
-				goto done;
-			}
-			IMA_ADPCM_encoded = 1;
-			break;
-		case MP3_CODE:
-			SDL_SetError("MPEG Layer 3 data not supported",
-					SDL_SwapLE16(format->encoding));
-			was_error = 1;
-			goto done;
-		default:
-			SDL_SetError("Unknown WAVE data format: 0x%.4x",
-					SDL_SwapLE16(format->encoding));
-			was_error = 1;
-			goto done;
-	}
-	SDL_memset(spec, 0, (sizeof *spec));
-	spec->freq = SDL_SwapLE32(format->frequency);
-	switch (SDL_SwapLE16(format->bitspersample)) {
-		case 4:
-			if ( MS_ADPCM_encoded || IMA_ADPCM_encoded ) {
-				spec->format = AUDIO_S16;
-			} else {
-				was_error = 1;
-			}
-			break;
-		case 8:
-			spec->format = AUDIO_U8;
-			break;
-		case 16:
-			spec->format = AUDIO_S16;
-			break;
-		default:
-			was_error = 1;
-			break;
-	}
-	if ( was_error ) {
-		SDL_SetError("Unknown %d-bit PCM data format",
-			SDL_SwapLE16(format->bitspersample));
+	if ( InitWaveDecoder(&dec, format, spec) < 0 ) {
+		was_error = 1;
 		goto done;
 	}
-	spec->channels = (Uint8)SDL_SwapLE16(format->channels);
-	spec->samples = 4096;		/* Good default buffer size */
 
-	/* Read the audio data chunk */
+	/* Read the audio data chunk, or if it's ADPCM data that's already
+	   in memory, decode it from where it is */
+	mapped = NULL;
+	if ( dec.encoding != PCM_CODE ) {
+		mapped = (const Uint8 *)SDL_RWGetMapping(src, &mapped_size);
+	}
 	*audio_buf = NULL;
 	do {
 		if ( *audio_buf != NULL ) {
-			SDL_free(*audio_buf);
+			if ( ! mapped ) {
+				SDL_free(*audio_buf);
+			}
 			*audio_buf = NULL;
 		}
-		lenread = ReadChunk(src, &chunk);
+		if ( mapped ) {
+			lenread = MapChunk(src, &chunk, mapped, mapped_size);
+		} else {
+			lenread = ReadChunk(src, &chunk);
+		}
 		if ( lenread < 0 ) {
 			was_error = 1;
 			goto done;
@@ -532,22 +697,29 @@ SDL_AudioSpec * SDL_LoadWAV_RW (SDL_RWops *src, int freesrc,
 	} while ( chunk.magic != DATA );
 	headerDiff += 2 * sizeof(Uint32); /* for the data chunk and len */
 
-	if ( MS_ADPCM_encoded ) {
-		if ( MS_ADPCM_decode(audio_buf, audio_len) < 0 ) {
+	if ( dec.encoding != PCM_CODE ) {
+		/* Decode it all, a block at a time */
+		Uint8 *encoded = *audio_buf;
+		Uint32 blocks = *audio_len / dec.blockalign;
+
+		*audio_len = blocks * dec.blockframes * dec.framesize;
+		*audio_buf = (Uint8 *)SDL_malloc(*audio_len);
+		if ( *audio_buf == NULL ) {
+			if ( ! mapped ) {
+				SDL_free(encoded);
+			}
+			SDL_Error(SDL_ENOMEM);
 			was_error = 1;
 			goto done;
 		}
-	}
-	if ( IMA_ADPCM_encoded ) {
-		if ( IMA_ADPCM_decode(audio_buf, audio_len) < 0 ) {
-			was_error = 1;
-			goto done;
+		DecodeWaveData(&dec, encoded, *audio_buf, blocks);
+		if ( ! mapped ) {
+			SDL_free(encoded);
 		}
 	}
 
 	/* Don't return a buffer that isn't a multiple of samplesize */
-	samplesize = ((spec->format & 0xFF)/8)*spec->channels;
-	*audio_len &= ~(samplesize-1);
+	*audio_len -= (*audio_len % dec.framesize);
 
 done:
 	if ( format != NULL ) {
@@ -577,6 +749,217 @@ void SDL_FreeWAV(Uint8 *audio_buf)
 	}
 }
 
+/* Streaming WAVE files
+
+   Rather than loading the whole file, a stream keeps the data source
+   open and decodes the data as it's read: PCM data straight into the
+   caller's buffer, ADPCM data a block at a time into a buffer of its
+   own.  Seeking to a frame in the middle of an ADPCM block decodes the
+   block it's in again.
+ */
+struct SDL_WAVStream {
+	SDL_RWops *src;
+	int freesrc;
+	WaveDecoder dec;
+	Uint32 data_start;	/* Where the data chunk starts in 'src' */
+	Uint32 frames;		/* Frames in the whole file */
+	Uint32 position;	/* The next frame to read */
+	Uint32 next_block;	/* The block 'src' is at */
+	Uint8 *encoded;		/* One block of ADPCM data, and ... */
+	Uint8 *decoded;		/* ... what it decodes to */
+	Uint32 decoded_block;	/* The block in 'decoded', or ~0 */
+};
+
+SDL_WAVStream * SDL_OpenWAVStream (SDL_RWops *src, int freesrc,
+						SDL_AudioSpec *spec)
+{
+	SDL_WAVStream *stream;
+	WaveFMT *format = NULL;
+	Uint32 wavelen, magic, length;
+	Uint32 header[2];
+	int was_error;
+	long pos;
+
+	if ( src == NULL ) {
+		return(NULL);
+	}
+	stream = (SDL_WAVStream *)SDL_malloc(sizeof(*stream));
+	if ( stream == NULL ) {
+		SDL_Error(SDL_ENOMEM);
+		if ( freesrc ) {
+			SDL_RWclose(src);
+		}
+		return(NULL);
+	}
+	SDL_memset(stream, 0, sizeof(*stream));
+	stream->src = src;
+	stream->freesrc = freesrc;
+	stream->decoded_block = ~0;
+
+	/* Read the format, and skip everything else up to the data */
+	was_error = ( ReadWaveMagic(src, &wavelen) < 0 );
+	while ( ! was_error ) {
+		/* Running out of chunks before the data is an error */
+		if ( SDL_RWread(src, header, sizeof(header), 1) != 1 ) {
+			SDL_Error(SDL_EFREAD);
+			was_error = 1;
+			break;
+		}
+		magic = SDL_SwapLE32(header[0]);
+		length = SDL_SwapLE32(header[1]);
+		if ( magic == DATA ) {
+			break;
+		}
+		if ( magic == FMT && format == NULL ) {
+			format = (WaveFMT *)SDL_malloc(SDL_max(length, sizeof(*format)));
+			if ( format == NULL ) {
+				SDL_Error(SDL_ENOMEM);
+				was_error = 1;
+			} else if ( (length < sizeof(*format)) ||
+			            (SDL_RWread(src, format, length, 1) != 1) ||
+			            (InitWaveDecoder(&stream->dec, format, spec) < 0) ) {
+				if ( length < sizeof(*format) ) {
+					SDL_SetError("Complex WAVE files not supported");
+				}
+				was_error = 1;
+			}
+		} else if ( SDL_RWseek(src, length, RW_SEEK_CUR) < 0 ) {
+			SDL_Error(SDL_EFREAD);
+			was_error = 1;
+		}
+	}
+	if ( ! was_error && format == NULL ) {
+		SDL_SetError("Complex WAVE files not supported");
+		was_error = 1;
+	}
+	if ( ! was_error ) {
+		pos = SDL_RWtell(src);
+		stream->data_start = (Uint32)pos;
+		stream->frames = (length / stream->dec.blockalign) *
+		                 stream->dec.blockframes;
+		if ( pos < 0 ) {
+			SDL_Error(SDL_EFSEEK);
+			was_error = 1;
+		}
+	}
+	if ( ! was_error && stream->dec.encoding != PCM_CODE ) {
+		stream->encoded = (Uint8 *)SDL_malloc(stream->dec.blockalign);
+		stream->decoded = (Uint8 *)SDL_malloc(
+			stream->dec.blockframes * stream->dec.framesize);
+		if ( stream->encoded == NULL || stream->decoded == NULL ) {
+			SDL_Error(SDL_ENOMEM);
+			was_error = 1;
+		}
+	}
+	if ( format != NULL ) {
+		SDL_free(format);
+	}
+	if ( was_error ) {
+		SDL_CloseWAVStream(stream);
+		return(NULL);
+	}
+	return(stream);
+}
+
+int SDL_ReadWAVStream (SDL_WAVStream *stream, void *buf, int frames)
+{
+	WaveDecoder *dec;
+	Uint8 *dst = (Uint8 *)buf;
+	Uint32 block, offset, n;
+	int total;
+
+	if ( stream == NULL ) {
+		SDL_SetError("Passed a NULL WAV stream");
+		return(-1);
+	}
+	dec = &stream->dec;
+	if ( frames > (int)(stream->frames - stream->position) ) {
+		frames = (int)(stream->frames - stream->position);
+	}
+	if ( frames <= 0 ) {
+		return(0);
+	}
+
+	/* PCM data is already what the caller wants */
+	if ( dec->encoding == PCM_CODE ) {
+		total = SDL_RWread(stream->src, dst, dec->framesize, frames);
+		if ( total < 0 ) {
+			return(-1);
+		}
+		stream->position += total;
+		return(total);
+	}
+
+	for ( total = 0; total < frames; total += n ) {
+		block = stream->position / dec->blockframes;
+		offset = stream->position % dec->blockframes;
+		if ( block != stream->decoded_block ) {
+			if ( (block != stream->next_block) &&
+			     (SDL_RWseek(stream->src,
+			                 stream->data_start + block * dec->blockalign,
+			                 RW_SEEK_SET) < 0) ) {
+				break;
+			}
+			stream->next_block = block;
+			if ( SDL_RWread(stream->src, stream->encoded,
+			                dec->blockalign, 1) != 1 ) {
+				SDL_Error(SDL_EFREAD);
+				break;
+			}
+			stream->next_block = block + 1;
+			DecodeWaveBlock(dec, stream->encoded, stream->decoded);
+			stream->decoded_block = block;
+		}
+		n = SDL_min(dec->blockframes - offset, (Uint32)(frames - total));
+		SDL_memcpy(dst, stream->decoded + offset * dec->framesize,
+		           n * dec->framesize);
+		dst += n * dec->framesize;
+		stream->position += n;
+	}
+	if ( total == 0 ) {
+		return(-1);
+	}
+	return(total);
+}
+
+int SDL_SeekWAVStream (SDL_WAVStream *stream, Uint32 frame)
+{
+	if ( stream == NULL ) {
+		SDL_SetError("Passed a NULL WAV stream");
+		return(-1);
+	}
+	if ( frame > stream->frames ) {
+		SDL_SetError("Seek past the end of the WAV stream");
+		return(-1);
+	}
+	if ( stream->dec.encoding == PCM_CODE ) {
+		/* ADPCM streams seek to a block when they read it */
+		if ( SDL_RWseek(stream->src,
+		                stream->data_start + frame * stream->dec.framesize,
+		                RW_SEEK_SET) < 0 ) {
+			return(-1);
+		}
+	}
+	stream->position = frame;
+	return(0);
+}
+
+void SDL_CloseWAVStream (SDL_WAVStream *stream)
+{
+	if ( stream != NULL ) {
+		if ( stream->freesrc ) {
+			SDL_RWclose(stream->src);
+		}
+		if ( stream->encoded != NULL ) {
+			SDL_free(stream->encoded);
+		}
+		if ( stream->decoded != NULL ) {
+			SDL_free(stream->decoded);
+		}
+		SDL_free(stream);
+	}
+}
+
 static int ReadChunk(SDL_RWops *src, Chunk *chunk)
 {
 	chunk->magic	= SDL_ReadLE32(src);
@@ -594,3 +977,22 @@ static int ReadChunk(SDL_RWops *src, Chunk *chunk)
 	}
 	return(chunk->length);
 }
+
+/* Point a chunk at its data in memory, rather than reading it */
+static int MapChunk(SDL_RWops *src, Chunk *chunk, const Uint8 *base, int size)
+{
+	int pos;
+
+	chunk->magic	= SDL_ReadLE32(src);
+	chunk->length	= SDL_ReadLE32(src);
+	chunk->data = NULL;
+	pos = SDL_RWtell(src);
+	if ( (pos < 0) || (pos > size) ||
+	     (chunk->length > (Uint32)(size - pos)) ) {
+		SDL_Error(SDL_EFREAD);
+		return(-1);
+	}
+	chunk->data = (Uint8 *)base + pos;
+	SDL_RWseek(src, chunk->length, RW_SEEK_CUR);
+	return(chunk->length);
+}
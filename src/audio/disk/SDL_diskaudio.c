@@ -23,7 +23,8 @@
 */
 #include "SDL_config.h"
 
-/* Output raw audio data to a file. */
+/* Output audio data to a WAV or raw file, in real time or as fast as
+   it can go. */
 
 #if HAVE_STDIO_H
 #include <stdio.h>
@@ -44,7 +45,10 @@
 #define DISKENVR_OUTFILE         "SDL_DISKAUDIOFILE"
 #define DISKDEFAULT_OUTFILE      "sdlaudio.raw"
 #define DISKENVR_WRITEDELAY      "SDL_DISKAUDIODELAY"
-#define DISKDEFAULT_WRITEDELAY   150
+
+/* If it falls this far behind, start the clock again instead of
+   rushing to catch up */
+#define DISK_MAXLATE             1000
 
 /* Audio driver functions */
 static int DISKAUD_OpenAudio(_THIS, SDL_AudioSpec *spec);
@@ -96,8 +100,9 @@ static SDL_AudioDevice *DISKAUD_CreateDevice(int devindex)
 	}
 	SDL_memset(this->hidden, 0, (sizeof *this->hidden));
 
+	/* Without a delay, it runs in real time once the buffer size is known */
 	envr = SDL_getenv(DISKENVR_WRITEDELAY);
-	this->hidden->write_delay = (envr) ? SDL_atoi(envr) : DISKDEFAULT_WRITEDELAY;
+	this->hidden->write_delay = (envr && *envr) ? SDL_atof(envr) : -1.0;
 
 	/* Set the function pointers */
 	this->OpenAudio = DISKAUD_OpenAudio;
@@ -116,10 +121,27 @@ AudioBootStrap DISKAUD_bootstrap = {
 	DISKAUD_Available, DISKAUD_CreateDevice
 };
 
-/* This function waits until it is possible to write a full sound buffer */
+/* This function waits until it is possible to write a full sound buffer.
+   Each buffer has its own deadline counted from when the clock started,
+   so the time it takes to get here doesn't add up.
+ */
 static void DISKAUD_WaitAudio(_THIS)
 {
-	SDL_Delay(this->hidden->write_delay);
+	Uint32 now, deadline;
+
+	if ( this->hidden->write_delay <= 0.0 ) {
+		return;
+	}
+	++this->hidden->buffers;
+	deadline = this->hidden->start +
+	           (Uint32)(this->hidden->buffers * this->hidden->write_delay);
+	now = SDL_GetTicks();
+	if ( (Sint32)(deadline - now) > 0 ) {
+		SDL_Delay(deadline - now);
+	} else if ( (Sint32)(now - deadline) > DISK_MAXLATE ) {
+		this->hidden->start = now;
+		this->hidden->buffers = 0;
+	}
 }
 
 static void DISKAUD_PlayAudio(_THIS)
@@ -135,6 +157,7 @@ static void DISKAUD_PlayAudio(_THIS)
 	if ( (Uint32)written != this->hidden->mixlen ) {
 		this->enabled = 0;
 	}
+	this->hidden->written += written;
 #ifdef DEBUG_AUDIO
 	fprintf(stderr, "Wrote %d bytes of audio data\n", written);
 #endif
@@ -145,6 +168,39 @@ static Uint8 *DISKAUD_GetAudioBuf(_THIS)
 	return(this->hidden->mixbuf);
 }
 
+/* The sizes are only known once all the data is written.  The header
+   written at the start has the largest sizes possible, and that is what
+   is left for pipes and other outputs that can't seek back to fix them.
+ */
+#define WAVE_UNKNOWN_SIZE	0xFFFFFFFF
+
+static int DISKAUD_WriteWaveHeader(_THIS, Uint32 datalen)
+{
+	SDL_RWops *output = this->hidden->output;
+	Uint16 bits = this->spec.format & 0xFF;
+	Uint16 block = (bits / 8) * this->spec.channels;
+	Uint32 riffsize = WAVE_UNKNOWN_SIZE;
+
+	if ( datalen != WAVE_UNKNOWN_SIZE ) {
+		riffsize = 36 + datalen;
+	}
+	SDL_RWwrite(output, "RIFF", 4, 1);
+	SDL_WriteLE32(output, riffsize);
+	SDL_RWwrite(output, "WAVEfmt ", 8, 1);
+	SDL_WriteLE32(output, 16);
+	SDL_WriteLE16(output, 1);	/* PCM */
+	SDL_WriteLE16(output, this->spec.channels);
+	SDL_WriteLE32(output, this->spec.freq);
+	SDL_WriteLE32(output, this->spec.freq * block);
+	SDL_WriteLE16(output, block);
+	SDL_WriteLE16(output, bits);
+	SDL_RWwrite(output, "data", 4, 1);
+	if ( ! SDL_WriteLE32(output, datalen) ) {
+		return(-1);
+	}
+	return(0);
+}
+
 static void DISKAUD_CloseAudio(_THIS)
 {
 	if ( this->hidden->mixbuf != NULL ) {
@@ -152,6 +208,10 @@ static void DISKAUD_CloseAudio(_THIS)
 		this->hidden->mixbuf = NULL;
 	}
 	if ( this->hidden->output != NULL ) {
+		if ( this->hidden->wave &&
+		     SDL_RWseek(this->hidden->output, 0, RW_SEEK_SET) == 0 ) {
+			DISKAUD_WriteWaveHeader(this, this->hidden->written);
+		}
 		SDL_RWclose(this->hidden->output);
 		this->hidden->output = NULL;
 	}
@@ -160,6 +220,7 @@ static void DISKAUD_CloseAudio(_THIS)
 static int DISKAUD_OpenAudio(_THIS, SDL_AudioSpec *spec)
 {
 	const char *fname = DISKAUD_GetOutputFilename();
+	size_t len = SDL_strlen(fname);
 
 	/* Open the audio device */
 	this->hidden->output = SDL_RWFromFile(fname, "wb");
@@ -167,6 +228,22 @@ static int DISKAUD_OpenAudio(_THIS, SDL_AudioSpec *spec)
 		return(-1);
 	}
 
+	/* Only .wav files get a header; they take little-endian data,
+	   with 8-bit samples unsigned */
+	this->hidden->wave = (len >= 4 && SDL_strcasecmp(fname + len - 4, ".wav") == 0);
+	if ( this->hidden->wave ) {
+		if ( (spec->format & 0xFF) == 8 ) {
+			spec->format = AUDIO_U8;
+		} else {
+			spec->format = AUDIO_S16LSB;
+		}
+		SDL_CalculateAudioSpec(spec);
+		if ( DISKAUD_WriteWaveHeader(this, WAVE_UNKNOWN_SIZE) < 0 ) {
+			SDL_SetError("Couldn't write WAV header to %s", fname);
+			return(-1);
+		}
+	}
+
 #if HAVE_STDIO_H
 	fprintf(stderr, "WARNING: You are using the SDL disk writer"
                     " audio driver!\n Writing to file [%s].\n", fname);
@@ -180,6 +257,13 @@ static int DISKAUD_OpenAudio(_THIS, SDL_AudioSpec *spec)
 	}
 	SDL_memset(this->hidden->mixbuf, spec->silence, spec->size);
 
+	/* Play in real time, unless told otherwise */
+	if ( this->hidden->write_delay < 0.0 ) {
+		this->hidden->write_delay = (spec->samples * 1000.0) / spec->freq;
+	}
+	this->hidden->start = SDL_GetTicks();
+	this->hidden->buffers = 0;
+
 	/* We're ready to rock and roll. :-) */
 	return(0);
 }
@@ -35,7 +35,11 @@ struct SDL_PrivateAudioData {
 	SDL_RWops *output;
 	Uint8 *mixbuf;
 	Uint32 mixlen;
-	Uint32 write_delay;
+	double write_delay;	/* Milliseconds per buffer, 0 to not wait */
+	Uint32 start;		/* When the clock started */
+	Uint32 buffers;		/* Buffers written since then */
+	int wave;		/* Write a WAV header */
+	Uint32 written;		/* Bytes of audio data written */
 };
 
 #endif /* _SDL_diskaudio_h */
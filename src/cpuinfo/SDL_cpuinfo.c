@@ -41,6 +41,7 @@
 #define CPU_HAS_SSE	0x00000040
 #define CPU_HAS_SSE2	0x00000080
 #define CPU_HAS_ALTIVEC	0x00000100
+#define CPU_HAS_AVX2	0x00000200
 
 #if SDL_ALTIVEC_BLITTERS && HAVE_SETJMP && !__MACOSX__
 /* This is the brute force way of detecting instruction sets...
@@ -356,6 +357,84 @@ static __inline__ int CPU_haveSSE2(void)
 	return 0;
 }
 
+static __inline__ void CPU_cpuid(int func, int regs[4])
+{
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#if defined(__GNUC__) && defined(i386)
+	/* Shuffle %ebx through %esi; it may be the PIC register */
+	__asm__ __volatile__ (
+"        movl    %%ebx,%%esi                                           \n"
+"        cpuid                                                         \n"
+"        xchgl   %%ebx,%%esi                                           \n"
+	: "=a" (regs[0]), "=S" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+	: "a" (func), "c" (0)
+	);
+#elif defined(__GNUC__) && defined(__x86_64__)
+	__asm__ __volatile__ (
+"        cpuid                                                         \n"
+	: "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+	: "a" (func), "c" (0)
+	);
+#elif (defined(_MSC_VER) && defined(_M_IX86)) || defined(__WATCOMC__)
+	__asm {
+        mov     esi, regs
+        mov     eax, func
+        xor     ecx, ecx
+        push    ebx
+        cpuid
+        mov     [esi+0], eax
+        mov     [esi+4], ebx
+        mov     [esi+8], ecx
+        mov     [esi+12], edx
+        pop     ebx
+	}
+#endif
+}
+
+static __inline__ int CPU_OSSavesYMM(void)
+{
+	int lo = 0;
+#if defined(__GNUC__) && (defined(i386) || defined(__x86_64__))
+	int hi;
+	/* xgetbv, spelled out for assemblers that don't know it */
+	__asm__ __volatile__ (
+"        .byte   0x0f,0x01,0xd0                                        \n"
+	: "=a" (lo), "=d" (hi)
+	: "c" (0)
+	);
+#elif (defined(_MSC_VER) && defined(_M_IX86)) || defined(__WATCOMC__)
+	__asm {
+        xor     ecx, ecx
+        _emit   0x0f
+        _emit   0x01
+        _emit   0xd0
+        mov     lo, eax
+	}
+#endif
+	/* The OS must save both the XMM and the YMM state on context switch */
+	return ((lo & 0x06) == 0x06);
+}
+
+static __inline__ int CPU_haveAVX2(void)
+{
+	int regs[4];
+
+	if ( ! CPU_haveCPUID() ) {
+		return 0;
+	}
+	CPU_cpuid(0, regs);
+	if ( regs[0] < 7 ) {
+		return 0;
+	}
+	/* AVX and OSXSAVE, then ask the OS before trusting the AVX2 bit */
+	CPU_cpuid(1, regs);
+	if ( (regs[2] & 0x18000000) != 0x18000000 || ! CPU_OSSavesYMM() ) {
+		return 0;
+	}
+	CPU_cpuid(7, regs);
+	return (regs[1] & 0x00000020);
+}
+
 static __inline__ int CPU_haveAltiVec(void)
 {
 	volatile int altivec = 0;
@@ -408,6 +487,9 @@ static Uint32 SDL_GetCPUFeatures(void)
 		if ( CPU_haveSSE2() ) {
 			SDL_CPUFeatures |= CPU_HAS_SSE2;
 		}
+		if ( CPU_haveAVX2() ) {
+			SDL_CPUFeatures |= CPU_HAS_AVX2;
+		}
 		if ( CPU_haveAltiVec() ) {
 			SDL_CPUFeatures |= CPU_HAS_ALTIVEC;
 		}
@@ -471,6 +553,14 @@ SDL_bool SDL_HasSSE2(void)
 	return SDL_FALSE;
 }
 
+SDL_bool SDL_HasAVX2(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_AVX2 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
 SDL_bool SDL_HasAltiVec(void)
 {
 	if ( SDL_GetCPUFeatures() & CPU_HAS_ALTIVEC ) {
@@ -492,6 +582,7 @@ int main()
 	printf("3DNowExt: %d\n", SDL_Has3DNowExt());
 	printf("SSE: %d\n", SDL_HasSSE());
 	printf("SSE2: %d\n", SDL_HasSSE2());
+	printf("AVX2: %d\n", SDL_HasAVX2());
 	printf("AltiVec: %d\n", SDL_HasAltiVec());
 	return 0;
 }
@@ -0,0 +1,65 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_simd_h
+#define _SDL_simd_h
+
+/* Which SIMD intrinsics the compiler gives us.
+
+   SDL_SSE2_INTRINSICS is set when SSE2 code can be compiled as is, which
+   it always can on x86-64.  Code using it still checks SDL_HasSSE2().
+
+   SDL_AVX2_INTRINSICS is set when AVX2 code can be compiled one function
+   at a time, by marking it SDL_TARGETING_AVX2.  Only code chosen at run
+   time after checking SDL_HasAVX2() may call those functions.
+ */
+
+#if SDL_ASSEMBLY_ROUTINES
+#  if (defined(__GNUC__) && defined(__SSE2__)) || \
+      (defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))))
+#    define SDL_SSE2_INTRINSICS 1
+#    if defined(__clang__)
+#      if (__clang_major__ > 3) || ((__clang_major__ == 3) && (__clang_minor__ >= 8))
+#        define SDL_AVX2_INTRINSICS 1
+#        define SDL_TARGETING_AVX2 __attribute__((target("avx2")))
+#      endif
+#    elif defined(__GNUC__)
+#      if (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))
+#        define SDL_AVX2_INTRINSICS 1
+#        define SDL_TARGETING_AVX2 __attribute__((target("avx2")))
+#      endif
+#    elif defined(_MSC_VER) && (_MSC_VER >= 1800) && defined(_M_X64)
+#      define SDL_AVX2_INTRINSICS 1
+#      define SDL_TARGETING_AVX2
+#    endif
+#  endif
+#endif /* SDL_ASSEMBLY_ROUTINES */
+
+#if SDL_SSE2_INTRINSICS
+#include <emmintrin.h>
+#endif
+#if SDL_AVX2_INTRINSICS
+#include <immintrin.h>
+#endif
+
+#endif /* _SDL_simd_h */
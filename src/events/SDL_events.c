@@ -28,26 +28,90 @@
 #include "SDL_sysevents.h"
 #include "SDL_events_c.h"
 #include "../timer/SDL_timer_c.h"
+#include "../thread/SDL_atomic_c.h"
 #if !SDL_JOYSTICK_DISABLED
 #include "../joystick/SDL_joystick_c.h"
 #endif
 
+/* Where the video driver gives us a file descriptor, waiting threads
+   sleep on it with select(), and a pipe lets other threads wake them.
+ */
+#if SDL_THREAD_PTHREAD
+#define SDL_EVENTS_WAIT_FD	1
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#endif
+
 /* Public data -- the event filter */
 SDL_EventFilter SDL_EventOK = NULL;
 Uint8 SDL_ProcessEvents[SDL_NUMEVENTS];
 static Uint32 SDL_eventstate = 0;
 
-/* Private data -- event queue */
-#define MAXEVENTS	128
+/* Private data -- event queue
+
+   The queue starts out with room for MAXEVENTS-1 events and doubles in
+   size whenever it fills up, until it holds the maximum set by
+   SDL_SetEventQueueSize() or the SDL_EVENT_QUEUE_SIZE environment
+   variable.  Only events arriving after that are dropped.
+
+   Each queued event is also on a list of the queued events of its type,
+   so a masked search only visits the events it returns.  Events taken
+   from the middle of the queue are just marked as cut, and the queue is
+   packed again when it fills up.
+
+   The window manager message of a queued SDL_SYSWMEVENT is kept in its
+   slot.  Messages handed back to the application are copied into a
+   ring of the last MAXEVENTS, so they stay put when the queue moves.
+ */
+#define MAXEVENTS		128
+#define DEFAULT_MAXEVENTS	65535
+#define CUT_EVENT		-2	/* 'link' of an event taken from the queue */
 static struct {
 	SDL_mutex *lock;
 	int active;
 	int head;
 	int tail;
-	SDL_Event event[MAXEVENTS];
+	int size;
+	int maxsize;
+	SDL_Event *event;
+	int *link;	/* Next queued event of the same type, or -1 */
+	struct SDL_SysWMmsg *slot_wmmsg;	/* Messages of queued events */
+	int cut;	/* Number of cut events between head and tail */
+	int type_head[SDL_NUMEVENTS];
+	int type_tail[SDL_NUMEVENTS];
 	int wmmsg_next;
 	struct SDL_SysWMmsg wmmsg[MAXEVENTS];
+	int highwater;
+	Uint32 dropped;
+	Uint32 dropped_type[SDL_NUMEVENTS];
 } SDL_EventQ;
+static int SDL_EventQMax = 0;	/* 0 means not set by the application */
+
+static int SDL_RepackEventQueue(int size);
+
+#if SDL_HAVE_ATOMICS
+/* Private data -- lock-free queue of newly pushed events
+
+   Any thread can add to this without taking SDL_EventQ.lock.  Whoever
+   holds the lock moves these events into SDL_EventQ before looking at
+   it, so they are seen in the order they were pushed.  Each slot has a
+   sequence number saying whose turn it is: a producer may fill slot
+   'pos' when its sequence is 'pos', and the consumer may empty it when
+   its sequence is 'pos+1'.
+ */
+#define MAXPUSHEVENTS	128	/* Must be a power of two */
+static struct {
+	volatile int enqueue_pos;
+	int dequeue_pos;
+	struct {
+		volatile int sequence;
+		SDL_Event event;
+		struct SDL_SysWMmsg wmmsg;
+	} slot[MAXPUSHEVENTS];
+} SDL_PushQ;
+#endif /* SDL_HAVE_ATOMICS */
 
 /* Private data -- event locking structure */
 static struct {
@@ -55,6 +119,26 @@ static struct {
 	int safe;
 } SDL_EventLock;
 
+/* Private data -- threads sleeping in SDL_WaitEventTimeout()
+
+   A waiter counts itself in 'waiting' before its last look at the queue,
+   and anyone adding events checks 'waiting' afterwards, so one of them
+   always sees the other.  The condition is signalled with the queue lock
+   held, and a waiter only lets go of the lock by waiting on it.
+
+   Only one waiter at a time sleeps in select(), since a single byte in
+   the pipe wakes it.  The others wait on the condition, and are woken
+   when it comes out so one of them can take its place.
+ */
+static struct {
+	SDL_cond *cond;
+	volatile int waiting;
+#if SDL_EVENTS_WAIT_FD
+	int wakefd[2];	/* Pipe to break waiters out of select() */
+	int selecting;	/* A waiter is sleeping on the descriptor */
+#endif
+} SDL_EventWait;
+
 /* Thread functions */
 static SDL_Thread *SDL_EventThread = NULL;	/* Thread handle */
 static Uint32 event_thread;			/* The event thread id */
@@ -160,6 +244,10 @@ static int SDL_StartEventThread(Uint32 flags)
 #endif /* !SDL_THREADS_DISABLED */
 	SDL_EventQ.active = 1;
 
+	/* Waiting threads fall back to polling if this fails */
+	SDL_EventWait.waiting = 0;
+	SDL_EventWait.cond = SDL_CreateCond();
+
 	if ( (flags&SDL_INIT_EVENTTHREAD) == SDL_INIT_EVENTTHREAD ) {
 		SDL_EventLock.lock = SDL_CreateMutex();
 		if ( SDL_EventLock.lock == NULL ) {
@@ -193,6 +281,17 @@ static void SDL_StopEventThread(void)
 		SDL_DestroyMutex(SDL_EventLock.lock);
 		SDL_EventLock.lock = NULL;
 	}
+	if ( SDL_EventWait.cond ) {
+		SDL_DestroyCond(SDL_EventWait.cond);
+		SDL_EventWait.cond = NULL;
+	}
+#if SDL_EVENTS_WAIT_FD
+	if ( SDL_EventWait.wakefd[0] >= 0 ) {
+		close(SDL_EventWait.wakefd[0]);
+		close(SDL_EventWait.wakefd[1]);
+		SDL_EventWait.wakefd[0] = SDL_EventWait.wakefd[1] = -1;
+	}
+#endif
 #ifndef IPOD
 	SDL_DestroyMutex(SDL_EventQ.lock);
 	SDL_EventQ.lock = NULL;
@@ -221,6 +320,32 @@ void SDL_StopEventLoop(void)
 	SDL_EventQ.head = 0;
 	SDL_EventQ.tail = 0;
 	SDL_EventQ.wmmsg_next = 0;
+	if ( SDL_EventQ.event ) {
+		SDL_free(SDL_EventQ.event);
+		SDL_EventQ.event = NULL;
+	}
+	if ( SDL_EventQ.link ) {
+		SDL_free(SDL_EventQ.link);
+		SDL_EventQ.link = NULL;
+	}
+	if ( SDL_EventQ.slot_wmmsg ) {
+		SDL_free(SDL_EventQ.slot_wmmsg);
+		SDL_EventQ.slot_wmmsg = NULL;
+	}
+	SDL_EventQ.size = 0;
+	SDL_EventQ.cut = 0;
+#if SDL_HAVE_ATOMICS
+	{
+		int i;
+
+		SDL_PushQ.enqueue_pos = 0;
+		SDL_PushQ.dequeue_pos = 0;
+		for ( i = 0; i < MAXPUSHEVENTS; ++i ) {
+			SDL_PushQ.slot[i].sequence = i;
+		}
+		SDL_MemoryBarrier();
+	}
+#endif
 }
 
 /* This function (and associated calls) may be called more than once */
@@ -231,6 +356,11 @@ int SDL_StartEventLoop(Uint32 flags)
 	/* Clean out the event queue */
 	SDL_EventThread = NULL;
 	SDL_EventQ.lock = NULL;
+	SDL_EventWait.cond = NULL;
+#if SDL_EVENTS_WAIT_FD
+	SDL_EventWait.wakefd[0] = SDL_EventWait.wakefd[1] = -1;
+	SDL_EventWait.selecting = 0;
+#endif
 	SDL_StopEventLoop();
 
 	/* No filter to start with, process most event types */
@@ -252,6 +382,26 @@ int SDL_StartEventLoop(Uint32 flags)
 		return(-1);
 	}
 
+	/* Allocate the event queue */
+	SDL_EventQ.maxsize = SDL_EventQMax;
+	if ( SDL_EventQ.maxsize <= 0 ) {
+		const char *env = SDL_getenv("SDL_EVENT_QUEUE_SIZE");
+		SDL_EventQ.maxsize = env ? SDL_atoi(env) : 0;
+		if ( SDL_EventQ.maxsize <= 0 ) {
+			SDL_EventQ.maxsize = DEFAULT_MAXEVENTS;
+		}
+	}
+	/* One slot is always left empty to tell a full queue from an empty one */
+	++SDL_EventQ.maxsize;
+	if ( ! SDL_RepackEventQueue(SDL_min(MAXEVENTS, SDL_EventQ.maxsize)) ) {
+		SDL_OutOfMemory();
+		SDL_StopEventLoop();
+		return(-1);
+	}
+	SDL_EventQ.highwater = 0;
+	SDL_EventQ.dropped = 0;
+	SDL_memset(SDL_EventQ.dropped_type, 0, sizeof(SDL_EventQ.dropped_type));
+
 	/* Create the lock and event thread */
 	if ( SDL_StartEventThread(flags) < 0 ) {
 		SDL_StopEventLoop();
@@ -261,60 +411,257 @@ int SDL_StartEventLoop(Uint32 flags)
 }
 
 
+/* Put an event on the list for its type -- called with the queue locked */
+static void SDL_LinkEvent(int spot)
+{
+	int type = SDL_EventQ.event[spot].type % SDL_NUMEVENTS;
+
+	SDL_EventQ.link[spot] = -1;
+	if ( SDL_EventQ.type_tail[type] < 0 ) {
+		SDL_EventQ.type_head[type] = spot;
+	} else {
+		SDL_EventQ.link[SDL_EventQ.type_tail[type]] = spot;
+	}
+	SDL_EventQ.type_tail[type] = spot;
+}
+
+/* Move the queued events into new space of the given size, leaving out
+   the cut ones -- called with the queue locked */
+static int SDL_RepackEventQueue(int size)
+{
+	SDL_Event *event;
+	int *link;
+	struct SDL_SysWMmsg *wmmsg;
+	int i, used;
+
+	event = (SDL_Event *)SDL_malloc(size*sizeof(SDL_Event));
+	link = (int *)SDL_malloc(size*sizeof(int));
+	wmmsg = (struct SDL_SysWMmsg *)SDL_malloc(size*sizeof(*wmmsg));
+	if ( (event == NULL) || (link == NULL) || (wmmsg == NULL) ) {
+		if ( event ) {
+			SDL_free(event);
+		}
+		if ( link ) {
+			SDL_free(link);
+		}
+		if ( wmmsg ) {
+			SDL_free(wmmsg);
+		}
+		return(0);
+	}
+
+	/* Unwrap the queue into the start of the new space */
+	used = 0;
+	while ( SDL_EventQ.head != SDL_EventQ.tail ) {
+		if ( SDL_EventQ.link[SDL_EventQ.head] != CUT_EVENT ) {
+			event[used] = SDL_EventQ.event[SDL_EventQ.head];
+			if ( event[used].type == SDL_SYSWMEVENT ) {
+				wmmsg[used] = SDL_EventQ.slot_wmmsg[SDL_EventQ.head];
+				event[used].syswm.msg = &wmmsg[used];
+			}
+			++used;
+		}
+		SDL_EventQ.head = (SDL_EventQ.head+1)%SDL_EventQ.size;
+	}
+	if ( SDL_EventQ.event ) {
+		SDL_free(SDL_EventQ.event);
+	}
+	if ( SDL_EventQ.link ) {
+		SDL_free(SDL_EventQ.link);
+	}
+	if ( SDL_EventQ.slot_wmmsg ) {
+		SDL_free(SDL_EventQ.slot_wmmsg);
+	}
+	SDL_EventQ.event = event;
+	SDL_EventQ.link = link;
+	SDL_EventQ.slot_wmmsg = wmmsg;
+	SDL_EventQ.size = size;
+	SDL_EventQ.head = 0;
+	SDL_EventQ.tail = used;
+	SDL_EventQ.cut = 0;
+
+	/* The slots have all moved, so rebuild the per-type lists */
+	for ( i=0; i<SDL_NUMEVENTS; ++i ) {
+		SDL_EventQ.type_head[i] = -1;
+		SDL_EventQ.type_tail[i] = -1;
+	}
+	for ( i=0; i<used; ++i ) {
+		SDL_LinkEvent(i);
+	}
+	return(1);
+}
+
+/* The number of events in the queue -- called with the queue locked */
+static int SDL_QueuedEvents(void)
+{
+	return ((SDL_EventQ.tail - SDL_EventQ.head + SDL_EventQ.size) %
+	        SDL_EventQ.size) - SDL_EventQ.cut;
+}
+
+/* Note an event lost to overflow -- called with the queue locked */
+static void SDL_DropEvent(SDL_Event *event)
+{
+	++SDL_EventQ.dropped;
+	++SDL_EventQ.dropped_type[event->type % SDL_NUMEVENTS];
+}
+
 /* Add an event to the event queue -- called with the queue locked */
 static int SDL_AddEvent(SDL_Event *event)
 {
-	int tail, added;
+	int tail, added, used;
+
+	tail = (SDL_EventQ.tail+1)%SDL_EventQ.size;
+	if ( tail == SDL_EventQ.head ) {
+		/* Full; pack out the cut events, and grow unless that's enough */
+		int size = SDL_EventQ.size;
 
-	tail = (SDL_EventQ.tail+1)%MAXEVENTS;
+		if ( (SDL_EventQ.cut < size/4) && (size < SDL_EventQ.maxsize) ) {
+			size = SDL_min(size*2, SDL_EventQ.maxsize);
+		}
+		if ( (size > SDL_EventQ.size || SDL_EventQ.cut > 0) &&
+		     SDL_RepackEventQueue(size) ) {
+			tail = (SDL_EventQ.tail+1)%SDL_EventQ.size;
+		}
+	}
 	if ( tail == SDL_EventQ.head ) {
 		/* Overflow, drop event */
 		added = 0;
 	} else {
 		SDL_EventQ.event[SDL_EventQ.tail] = *event;
 		if (event->type == SDL_SYSWMEVENT) {
-			/* Note that it's possible to lose an event */
-			int next = SDL_EventQ.wmmsg_next;
-			SDL_EventQ.wmmsg[next] = *event->syswm.msg;
+			SDL_EventQ.slot_wmmsg[SDL_EventQ.tail] = *event->syswm.msg;
 		        SDL_EventQ.event[SDL_EventQ.tail].syswm.msg =
-						&SDL_EventQ.wmmsg[next];
-			SDL_EventQ.wmmsg_next = (next+1)%MAXEVENTS;
+					&SDL_EventQ.slot_wmmsg[SDL_EventQ.tail];
 		}
+		SDL_LinkEvent(SDL_EventQ.tail);
 		SDL_EventQ.tail = tail;
 		added = 1;
+
+		used = SDL_QueuedEvents();
+		if ( used > SDL_EventQ.highwater ) {
+			SDL_EventQ.highwater = used;
+		}
 	}
 	return(added);
 }
 
-/* Cut an event, and return the next valid spot, or the tail */
-/*                           -- called with the queue locked */
-static int SDL_CutEvent(int spot)
-{
-	if ( spot == SDL_EventQ.head ) {
-		SDL_EventQ.head = (SDL_EventQ.head+1)%MAXEVENTS;
-		return(SDL_EventQ.head);
-	} else
-	if ( (spot+1)%MAXEVENTS == SDL_EventQ.tail ) {
-		SDL_EventQ.tail = spot;
-		return(SDL_EventQ.tail);
-	} else
-	/* We cut the middle -- shift everything over */
-	{
-		int here, next;
+#if SDL_HAVE_ATOMICS
+/* Add an event to the lock-free push queue -- safe from any thread */
+static int SDL_PushAddEvent(SDL_Event *event)
+{
+	int pos, diff;
 
-		/* This can probably be optimized with SDL_memcpy() -- careful! */
-		if ( --SDL_EventQ.tail < 0 ) {
-			SDL_EventQ.tail = MAXEVENTS-1;
-		}
-		for ( here=spot; here != SDL_EventQ.tail; here = next ) {
-			next = (here+1)%MAXEVENTS;
-			SDL_EventQ.event[here] = SDL_EventQ.event[next];
+	pos = SDL_AtomicGet(&SDL_PushQ.enqueue_pos);
+	for ( ; ; ) {
+		int index = pos & (MAXPUSHEVENTS-1);
+
+		diff = (int)((unsigned)SDL_AtomicGet(&SDL_PushQ.slot[index].sequence) - (unsigned)pos);
+		if ( diff == 0 ) {
+			/* This slot is free; try to claim it */
+			int next = (int)((unsigned)pos + 1);
+			if ( SDL_AtomicCAS(&SDL_PushQ.enqueue_pos, pos, next) ) {
+				SDL_PushQ.slot[index].event = *event;
+				if ( event->type == SDL_SYSWMEVENT ) {
+					/* The message may not outlive the caller */
+					SDL_PushQ.slot[index].wmmsg = *event->syswm.msg;
+					SDL_PushQ.slot[index].event.syswm.msg =
+						&SDL_PushQ.slot[index].wmmsg;
+				}
+				SDL_AtomicSet(&SDL_PushQ.slot[index].sequence, next);
+				return(1);
+			}
+		} else if ( diff < 0 ) {
+			/* The push queue is full */
+			return(0);
 		}
-		return(spot);
+		pos = SDL_AtomicGet(&SDL_PushQ.enqueue_pos);
 	}
 	/* NOTREACHED */
 }
 
+/* Move pushed events into the event queue -- called with the queue locked */
+static void SDL_FlushPushedEvents(void)
+{
+	for ( ; ; ) {
+		int pos = SDL_PushQ.dequeue_pos;
+		int next = (int)((unsigned)pos + 1);
+		int index = pos & (MAXPUSHEVENTS-1);
+
+		if ( SDL_AtomicGet(&SDL_PushQ.slot[index].sequence) != next ) {
+			break;	/* Empty, or the producer isn't done yet */
+		}
+		if ( ! SDL_AddEvent(&SDL_PushQ.slot[index].event) ) {
+			break;	/* No room yet, leave it queued */
+		}
+		SDL_PushQ.dequeue_pos = next;
+		SDL_AtomicSet(&SDL_PushQ.slot[index].sequence,
+		              (int)((unsigned)pos + MAXPUSHEVENTS));
+	}
+}
+#else
+#define SDL_FlushPushedEvents()
+#endif /* SDL_HAVE_ATOMICS */
+
+/* Wake up threads waiting for events -- called with the queue locked */
+static void SDL_WakeWaiters(void)
+{
+	if ( SDL_EventWait.cond ) {
+		SDL_CondBroadcast(SDL_EventWait.cond);
+	}
+#if SDL_EVENTS_WAIT_FD
+	if ( SDL_EventWait.wakefd[1] >= 0 ) {
+		char c = 0;
+		/* If the pipe is full, they're already awake */
+		if ( write(SDL_EventWait.wakefd[1], &c, 1) < 0 ) {
+			;
+		}
+	}
+#endif
+}
+
+/* Copy a queued event out for the application -- called with the queue locked */
+static void SDL_CopyOutEvent(SDL_Event *event, int spot)
+{
+	*event = SDL_EventQ.event[spot];
+	if ( event->type == SDL_SYSWMEVENT ) {
+		/* Note that it's possible to lose an event */
+		int next = SDL_EventQ.wmmsg_next;
+		SDL_EventQ.wmmsg[next] = SDL_EventQ.slot_wmmsg[spot];
+		event->syswm.msg = &SDL_EventQ.wmmsg[next];
+		SDL_EventQ.wmmsg_next = (next+1)%MAXEVENTS;
+	}
+}
+
+/* Cut an event, which must be the first queued event of its type */
+/*                           -- called with the queue locked */
+static void SDL_CutEvent(int spot)
+{
+	int type = SDL_EventQ.event[spot].type % SDL_NUMEVENTS;
+	int last;
+
+	SDL_EventQ.type_head[type] = SDL_EventQ.link[spot];
+	if ( SDL_EventQ.type_head[type] < 0 ) {
+		SDL_EventQ.type_tail[type] = -1;
+	}
+	SDL_EventQ.link[spot] = CUT_EVENT;
+	++SDL_EventQ.cut;
+
+	/* Trim cut events off both ends of the queue */
+	while ( (SDL_EventQ.head != SDL_EventQ.tail) &&
+	        (SDL_EventQ.link[SDL_EventQ.head] == CUT_EVENT) ) {
+		SDL_EventQ.head = (SDL_EventQ.head+1)%SDL_EventQ.size;
+		--SDL_EventQ.cut;
+	}
+	while ( SDL_EventQ.head != SDL_EventQ.tail ) {
+		last = (SDL_EventQ.tail+SDL_EventQ.size-1)%SDL_EventQ.size;
+		if ( SDL_EventQ.link[last] != CUT_EVENT ) {
+			break;
+		}
+		SDL_EventQ.tail = last;
+		--SDL_EventQ.cut;
+	}
+}
+
 /* Lock the event queue, take a peep at it, and unlock it */
 int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 								Uint32 mask)
@@ -325,12 +672,51 @@ int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 	if ( ! SDL_EventQ.active ) {
 		return(-1);
 	}
-	/* Lock the event queue */
 	used = 0;
+#if SDL_HAVE_ATOMICS
+	/* Events are added without waiting for the queue lock.  They all go
+	   through the push queue, so each thread's events stay in order. */
+	if ( action == SDL_ADDEVENT ) {
+		for ( i=0; i<numevents; ++i ) {
+			if ( ! SDL_PushAddEvent(&events[i]) ) {
+				/* Make room by moving pushed events along */
+				if ( SDL_mutexP(SDL_EventQ.lock) < 0 ) {
+					break;
+				}
+				SDL_FlushPushedEvents();
+				if ( ! SDL_PushAddEvent(&events[i]) ) {
+					/* Overflow, drop event */
+					SDL_DropEvent(&events[i]);
+					SDL_mutexV(SDL_EventQ.lock);
+					break;
+				}
+				SDL_mutexV(SDL_EventQ.lock);
+			}
+			++used;
+		}
+		/* The events went in before this read of 'waiting' */
+		SDL_MemoryBarrier();
+		if ( used && SDL_EventWait.waiting &&
+		     (SDL_mutexP(SDL_EventQ.lock) == 0) ) {
+			SDL_WakeWaiters();
+			SDL_mutexV(SDL_EventQ.lock);
+		}
+		return(used);
+	}
+#endif
+	/* Lock the event queue */
 	if ( SDL_mutexP(SDL_EventQ.lock) == 0 ) {
+		SDL_FlushPushedEvents();
 		if ( action == SDL_ADDEVENT ) {
 			for ( i=0; i<numevents; ++i ) {
-				used += SDL_AddEvent(&events[i]);
+				if ( SDL_AddEvent(&events[i]) ) {
+					++used;
+				} else {
+					SDL_DropEvent(&events[i]);
+				}
+			}
+			if ( used && SDL_EventWait.waiting ) {
+				SDL_WakeWaiters();
 			}
 		} else {
 			SDL_Event tmpevent;
@@ -342,17 +728,57 @@ int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 				numevents = 1;
 				events = &tmpevent;
 			}
-			spot = SDL_EventQ.head;
-			while ((used < numevents)&&(spot != SDL_EventQ.tail)) {
-				if ( mask & SDL_EVENTMASK(SDL_EventQ.event[spot].type) ) {
-					events[used++] = SDL_EventQ.event[spot];
+			if ( mask == SDL_ALLEVENTS ) {
+				/* Everything matches, so just walk the queue */
+				spot = SDL_EventQ.head;
+				while ((used < numevents)&&(spot != SDL_EventQ.tail)) {
+					if ( SDL_EventQ.link[spot] == CUT_EVENT ) {
+						spot = (spot+1)%SDL_EventQ.size;
+						continue;
+					}
+					SDL_CopyOutEvent(&events[used++], spot);
 					if ( action == SDL_GETEVENT ) {
-						spot = SDL_CutEvent(spot);
+						SDL_CutEvent(spot);
+						spot = SDL_EventQ.head;
 					} else {
-						spot = (spot+1)%MAXEVENTS;
+						spot = (spot+1)%SDL_EventQ.size;
+					}
+				}
+			} else {
+				/* Merge the lists of the wanted types, oldest first */
+				int cursor[SDL_NUMEVENTS];
+				int numtypes, type, best, dist, bestdist;
+
+				numtypes = 0;
+				for ( type=0; type<SDL_NUMEVENTS; ++type ) {
+					if ( (mask & SDL_EVENTMASK(type)) &&
+					     (SDL_EventQ.type_head[type] >= 0) ) {
+						cursor[numtypes++] = SDL_EventQ.type_head[type];
+					}
+				}
+				while ( used < numevents ) {
+					best = -1;
+					bestdist = SDL_EventQ.size;
+					for ( i=0; i<numtypes; ++i ) {
+						if ( cursor[i] < 0 ) {
+							continue;
+						}
+						dist = (cursor[i] - SDL_EventQ.head +
+						        SDL_EventQ.size) % SDL_EventQ.size;
+						if ( dist < bestdist ) {
+							best = i;
+							bestdist = dist;
+						}
+					}
+					if ( best < 0 ) {
+						break;
+					}
+					spot = cursor[best];
+					cursor[best] = SDL_EventQ.link[spot];
+					SDL_CopyOutEvent(&events[used++], spot);
+					if ( action == SDL_GETEVENT ) {
+						SDL_CutEvent(spot);
 					}
-				} else {
-					spot = (spot+1)%MAXEVENTS;
 				}
 			}
 		}
@@ -388,6 +814,155 @@ void SDL_PumpEvents(void)
 	}
 }
 
+#if SDL_EVENTS_WAIT_FD
+/* Sleep on the video driver's descriptor and our wakeup pipe
+	-- called with the queue locked, which is dropped while sleeping */
+static void SDL_SleepOnEventFD(int fd, int ms)
+{
+	fd_set fdset;
+	struct timeval tv, *timeout;
+	char buf[32];
+
+	FD_ZERO(&fdset);
+	FD_SET(fd, &fdset);
+	FD_SET(SDL_EventWait.wakefd[0], &fdset);
+	timeout = NULL;
+	if ( ms >= 0 ) {
+		tv.tv_sec = ms / 1000;
+		tv.tv_usec = (ms % 1000) * 1000;
+		timeout = &tv;
+	}
+	SDL_EventWait.selecting = 1;
+	SDL_mutexV(SDL_EventQ.lock);
+	select(SDL_max(fd, SDL_EventWait.wakefd[0])+1, &fdset, NULL, NULL, timeout);
+	SDL_mutexP(SDL_EventQ.lock);
+	SDL_EventWait.selecting = 0;
+
+	/* Empty the pipe for next time */
+	while ( read(SDL_EventWait.wakefd[0], buf, sizeof(buf)) > 0 ) {
+		;
+	}
+
+	/* Let another waiter watch the descriptor, if we're not coming back */
+	if ( SDL_EventWait.cond ) {
+		SDL_CondBroadcast(SDL_EventWait.cond);
+	}
+}
+
+/* Make the pipe other threads use to wake us -- called with the queue locked */
+static int SDL_OpenWakeupPipe(void)
+{
+	int i;
+
+	if ( SDL_EventWait.wakefd[0] >= 0 ) {
+		return(0);
+	}
+	if ( pipe(SDL_EventWait.wakefd) < 0 ) {
+		SDL_EventWait.wakefd[0] = SDL_EventWait.wakefd[1] = -1;
+		return(-1);
+	}
+	for ( i = 0; i < 2; ++i ) {
+		fcntl(SDL_EventWait.wakefd[i], F_SETFL, O_NONBLOCK);
+		fcntl(SDL_EventWait.wakefd[i], F_SETFD, FD_CLOEXEC);
+	}
+	return(0);
+}
+#endif /* SDL_EVENTS_WAIT_FD */
+
+/* Sleep until an event is added or 'ms' milliseconds pass (-1 is forever).
+   If nobody else is pumping events, wake up in time to pump them again.
+ */
+#define WAIT_POLL_INTERVAL	10	/* How often to pump without a descriptor */
+
+static int SDL_SleepForEvents(int ms)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+	int fd, poll, repeat;
+
+	if ( SDL_mutexP(SDL_EventQ.lock) < 0 ) {
+		SDL_SetError("Couldn't lock event queue");
+		return(-1);
+	}
+
+	/* Work out what can wake us, and how soon we have to pump again */
+	fd = -1;
+	poll = -1;
+	if ( ! SDL_EventThread ) {
+		if ( video ) {
+			if ( video->GetEventFD ) {
+				fd = video->GetEventFD(this);
+			}
+#if SDL_EVENTS_WAIT_FD
+			if ( (fd >= 0) && (SDL_OpenWakeupPipe() < 0) ) {
+				fd = -1;
+			}
+#else
+			fd = -1;
+#endif
+			if ( fd < 0 ) {
+				poll = WAIT_POLL_INTERVAL;
+			}
+		}
+		repeat = SDL_KeyRepeatTimeout();
+		if ( (repeat >= 0) && ((poll < 0) || (repeat < poll)) ) {
+			poll = repeat;
+		}
+#if !SDL_JOYSTICK_DISABLED
+		if ( SDL_numjoysticks && (SDL_eventstate & SDL_JOYEVENTMASK) ) {
+			poll = (poll < 0) ? WAIT_POLL_INTERVAL :
+			                    SDL_min(poll, WAIT_POLL_INTERVAL);
+		}
+#endif
+	}
+#if SDL_EVENTS_WAIT_FD
+	if ( (fd >= 0) && SDL_EventWait.selecting && SDL_EventWait.cond ) {
+		/* Another waiter has the descriptor, and will wake us */
+		fd = -1;
+	}
+#endif
+	if ( (fd < 0) && ! SDL_EventWait.cond ) {
+		/* No way to be woken up, so just nap */
+		poll = (poll < 0) ? WAIT_POLL_INTERVAL :
+		                    SDL_min(poll, WAIT_POLL_INTERVAL);
+	}
+	if ( (poll >= 0) && ((ms < 0) || (poll < ms)) ) {
+		ms = poll;
+	}
+
+	/* Let the threads adding events know we're here, then look again */
+#if SDL_HAVE_ATOMICS
+	SDL_AtomicAdd(&SDL_EventWait.waiting, 1);
+#else
+	++SDL_EventWait.waiting;
+#endif
+	SDL_FlushPushedEvents();
+	if ( (SDL_QueuedEvents() > 0) || (ms == 0) ) {
+		/* Don't sleep */ ;
+#if SDL_EVENTS_WAIT_FD
+	} else if ( fd >= 0 ) {
+		SDL_SleepOnEventFD(fd, ms);
+#endif
+	} else if ( SDL_EventWait.cond ) {
+		if ( ms < 0 ) {
+			SDL_CondWait(SDL_EventWait.cond, SDL_EventQ.lock);
+		} else {
+			SDL_CondWaitTimeout(SDL_EventWait.cond, SDL_EventQ.lock, ms);
+		}
+	} else {
+		SDL_mutexV(SDL_EventQ.lock);
+		SDL_Delay(ms);
+		SDL_mutexP(SDL_EventQ.lock);
+	}
+#if SDL_HAVE_ATOMICS
+	SDL_AtomicAdd(&SDL_EventWait.waiting, -1);
+#else
+	--SDL_EventWait.waiting;
+#endif
+	SDL_mutexV(SDL_EventQ.lock);
+	return(0);
+}
+
 /* Public functions */
 
 int SDL_PollEvent (SDL_Event *event)
@@ -402,12 +977,30 @@ int SDL_PollEvent (SDL_Event *event)
 
 int SDL_WaitEvent (SDL_Event *event)
 {
+	return SDL_WaitEventTimeout(event, -1);
+}
+
+int SDL_WaitEventTimeout (SDL_Event *event, int timeout)
+{
+	Uint32 start;
+	int left;
+
+	start = SDL_GetTicks();
+	left = timeout;
 	while ( 1 ) {
 		SDL_PumpEvents();
 		switch(SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_ALLEVENTS)) {
 		    case -1: return 0;
 		    case 1: return 1;
-		    case 0: SDL_Delay(10);
+		}
+		if ( timeout >= 0 ) {
+			left = timeout - (int)(SDL_GetTicks() - start);
+			if ( left <= 0 ) {
+				return 0;
+			}
+		}
+		if ( SDL_SleepForEvents(left) < 0 ) {
+			return 0;
 		}
 	}
 }
@@ -419,6 +1012,42 @@ int SDL_PushEvent(SDL_Event *event)
 	return 0;
 }
 
+int SDL_SetEventQueueSize(int maxevents)
+{
+	if ( maxevents <= 0 ) {
+		SDL_SetError("Event queue size must be positive");
+		return(-1);
+	}
+	SDL_EventQMax = maxevents;
+	if ( SDL_EventQ.active ) {
+		if ( SDL_mutexP(SDL_EventQ.lock) < 0 ) {
+			SDL_SetError("Couldn't lock event queue");
+			return(-1);
+		}
+		/* The queue never shrinks, it just stops growing */
+		SDL_EventQ.maxsize = SDL_max(maxevents+1, SDL_EventQ.size);
+		SDL_mutexV(SDL_EventQ.lock);
+	}
+	return(0);
+}
+
+void SDL_GetEventQueueStats(SDL_EventQueueStats *stats)
+{
+	SDL_memset(stats, 0, sizeof(*stats));
+	if ( ! SDL_EventQ.active || SDL_mutexP(SDL_EventQ.lock) < 0 ) {
+		return;
+	}
+	SDL_FlushPushedEvents();
+	stats->size = SDL_EventQ.size-1;
+	stats->maxsize = SDL_EventQ.maxsize-1;
+	stats->used = SDL_QueuedEvents();
+	stats->highwater = SDL_EventQ.highwater;
+	stats->dropped = SDL_EventQ.dropped;
+	SDL_memcpy(stats->dropped_type, SDL_EventQ.dropped_type,
+	           sizeof(stats->dropped_type));
+	SDL_mutexV(SDL_EventQ.lock);
+}
+
 void SDL_SetEventFilter (SDL_EventFilter filter)
 {
 	SDL_Event bitbucket;
@@ -593,6 +593,23 @@ void SDL_CheckKeyRepeat(void)
 	}
 }
 
+/* How long until SDL_CheckKeyRepeat() has an event to send, or -1 */
+int SDL_KeyRepeatTimeout(void)
+{
+	Uint32 interval, wait;
+
+	if ( ! SDL_KeyRepeat.timestamp ) {
+		return(-1);
+	}
+	interval = (SDL_GetTicks() - SDL_KeyRepeat.timestamp);
+	if ( SDL_KeyRepeat.firsttime ) {
+		wait = (Uint32)SDL_KeyRepeat.delay + 1;
+	} else {
+		wait = (Uint32)SDL_KeyRepeat.interval + 1;
+	}
+	return (interval >= wait) ? 0 : (int)(wait - interval);
+}
+
 int SDL_EnableKeyRepeat(int delay, int interval)
 {
 	if ( (delay < 0) || (interval < 0) ) {
@@ -27,6 +27,10 @@
 
 #include "SDL_endian.h"
 #include "SDL_rwops.h"
+#include "SDL_thread.h"
+#include "SDL_events.h"
+#include "SDL_timer.h"
+#include "../thread/SDL_atomic_c.h"
 
 
 #if defined(__WIN32__) && !defined(__SYMBIAN32__)
@@ -183,10 +187,11 @@ static int SDLCALL win32_file_open(SDL_RWops *context, const char *filename, con
 
 	return 0; /* ok */
 }
-static int SDLCALL win32_file_seek(SDL_RWops *context, int offset, int whence)
+static Sint64 SDLCALL win32_file_seek64(SDL_RWops *context, Sint64 offset, int whence)
 {
 	DWORD win32whence;
-	int   file_pos;
+	DWORD low;
+	LONG  high;
 	
 	if (!context || context->hidden.win32io.h == INVALID_HANDLE_VALUE) {
 		SDL_SetError("win32_file_seek: invalid context/file not opened");
@@ -211,14 +216,42 @@ static int SDLCALL win32_file_seek(SDL_RWops *context, int offset, int whence)
 			return -1;
 	}
 
-	file_pos = SetFilePointer(context->hidden.win32io.h,offset,NULL,win32whence);
+	high = (LONG)(offset >> 32);
+	low = SetFilePointer(context->hidden.win32io.h,(LONG)offset,&high,win32whence);
 
-	if ( file_pos != INVALID_SET_FILE_POINTER )
-		return file_pos; /* success */
+	/* The low part can be all ones without an error */
+	if ( low != INVALID_SET_FILE_POINTER || GetLastError() == NO_ERROR )
+		return ((Sint64)high << 32) | low; /* success */
 	
 	SDL_Error(SDL_EFSEEK);
 	return -1; /* error */
 }
+static int SDLCALL win32_file_seek(SDL_RWops *context, int offset, int whence)
+{
+	Sint64 file_pos;
+
+	file_pos = win32_file_seek64(context, offset, whence);
+	if ( file_pos > 0x7FFFFFFF ) {
+		SDL_SetError("File offset too large, use SDL_RWseek64()");
+		return -1;
+	}
+	return (int)file_pos;
+}
+static Sint64 SDLCALL win32_file_size(SDL_RWops *context)
+{
+	DWORD low, high;
+
+	if (!context || context->hidden.win32io.h == INVALID_HANDLE_VALUE) {
+		SDL_SetError("win32_file_size: invalid context/file not opened");
+		return -1;
+	}
+	low = GetFileSize(context->hidden.win32io.h, &high);
+	if ( low == INVALID_FILE_SIZE && GetLastError() != NO_ERROR ) {
+		SDL_Error(SDL_EFSEEK);
+		return -1;
+	}
+	return ((Sint64)high << 32) | low;
+}
 static int SDLCALL win32_file_read(SDL_RWops *context, void *ptr, int size, int maxnum)
 {
 	int		total_need; 
@@ -320,10 +353,57 @@ static int SDLCALL win32_file_close(SDL_RWops *context)
 
 /* Functions to read/write stdio file pointers */
 
+#ifdef SDL_HAS_64BIT_TYPE
+/* Whichever stdio functions can seek past 2 GB */
+#if defined(HAVE_FSEEKO64)
+#define fseek_64(fp, offset, whence)	fseeko64(fp, (off64_t)(offset), whence)
+#define ftell_64(fp)			((Sint64)ftello64(fp))
+#elif defined(HAVE_FSEEKO)
+#define fseek_64(fp, offset, whence)	fseeko(fp, (off_t)(offset), whence)
+#define ftell_64(fp)			((Sint64)ftello(fp))
+#elif defined(_MSC_VER) && (_MSC_VER >= 1400)
+#define fseek_64(fp, offset, whence)	_fseeki64(fp, offset, whence)
+#define ftell_64(fp)			((Sint64)_ftelli64(fp))
+#else
+#define fseek_64(fp, offset, whence)	fseek(fp, (long)(offset), whence)
+#define ftell_64(fp)			((Sint64)ftell(fp))
+#endif
+
+static Sint64 SDLCALL stdio_seek64(SDL_RWops *context, Sint64 offset, int whence)
+{
+	if ( fseek_64(context->hidden.stdio.fp, offset, whence) == 0 ) {
+		return(ftell_64(context->hidden.stdio.fp));
+	} else {
+		SDL_Error(SDL_EFSEEK);
+		return(-1);
+	}
+}
+static Sint64 SDLCALL stdio_size(SDL_RWops *context)
+{
+	Sint64 pos, size;
+
+	pos = ftell_64(context->hidden.stdio.fp);
+	if ( pos < 0 || fseek_64(context->hidden.stdio.fp, 0, SEEK_END) != 0 ) {
+		SDL_Error(SDL_EFSEEK);
+		return(-1);
+	}
+	size = ftell_64(context->hidden.stdio.fp);
+	fseek_64(context->hidden.stdio.fp, pos, SEEK_SET);
+	return(size);
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 static int SDLCALL stdio_seek(SDL_RWops *context, int offset, int whence)
 {
+	long pos;
+
 	if ( fseek(context->hidden.stdio.fp, offset, whence) == 0 ) {
-		return(ftell(context->hidden.stdio.fp));
+		pos = ftell(context->hidden.stdio.fp);
+		if ( pos > 0x7FFFFFFFL ) {
+			SDL_SetError("File offset too large, use SDL_RWseek64()");
+			return(-1);
+		}
+		return((int)pos);
 	} else {
 		SDL_Error(SDL_EFSEEK);
 		return(-1);
@@ -391,6 +471,41 @@ static int SDLCALL mem_seek(SDL_RWops *context, int offset, int whence)
 	context->hidden.mem.here = newpos;
 	return(context->hidden.mem.here-context->hidden.mem.base);
 }
+#ifdef SDL_HAS_64BIT_TYPE
+static Sint64 SDLCALL mem_seek64(SDL_RWops *context, Sint64 offset, int whence)
+{
+	Sint64 newpos;
+	Sint64 size = (context->hidden.mem.stop - context->hidden.mem.base);
+
+	switch (whence) {
+		case RW_SEEK_SET:
+			newpos = offset;
+			break;
+		case RW_SEEK_CUR:
+			newpos = (context->hidden.mem.here - context->hidden.mem.base) + offset;
+			break;
+		case RW_SEEK_END:
+			newpos = size + offset;
+			break;
+		default:
+			SDL_SetError("Unknown value for 'whence'");
+			return(-1);
+	}
+	if ( newpos < 0 ) {
+		newpos = 0;
+	}
+	if ( newpos > size ) {
+		newpos = size;
+	}
+	context->hidden.mem.here = context->hidden.mem.base + (size_t)newpos;
+	return(newpos);
+}
+static Sint64 SDLCALL mem_size(SDL_RWops *context)
+{
+	return(context->hidden.mem.stop - context->hidden.mem.base);
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 static int SDLCALL mem_read(SDL_RWops *context, void *ptr, int size, int maxnum)
 {
 	size_t total_bytes;
@@ -433,6 +548,352 @@ static int SDLCALL mem_close(SDL_RWops *context)
 	return(0);
 }
 
+/* Functions to read files mapped into memory, through the ones above */
+
+#if defined(__WIN32__) && !defined(__SYMBIAN32__) && !defined(_WIN32_WCE)
+#define MAP_WITH_WIN32
+#elif HAVE_MMAP
+#define MAP_WITH_MMAP
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static Uint8 *map_file(const char *file, int *size)
+{
+	Uint8 *base = NULL;
+#if defined(MAP_WITH_WIN32)
+	SDL_RWops *context;
+	HANDLE mapping;
+	DWORD high;
+
+	/* Open it the same way as any other file */
+	context = SDL_AllocRW();
+	if ( context == NULL ) {
+		return(NULL);
+	}
+	if ( win32_file_open(context, file, "rb") < 0 ) {
+		SDL_SetError("Couldn't open %s", file);
+		win32_file_close(context);
+		return(NULL);
+	}
+	*size = (int)GetFileSize(context->hidden.win32io.h, &high);
+	if ( high != 0 || *size < 0 ) {
+		SDL_SetError("%s is too large to map", file);
+		*size = -1;
+	} else if ( *size > 0 ) {
+		mapping = CreateFileMapping(context->hidden.win32io.h, NULL,
+		                            PAGE_READONLY, 0, 0, NULL);
+		if ( mapping != NULL ) {
+			/* The view keeps the mapping open */
+			base = (Uint8 *)MapViewOfFile(mapping, FILE_MAP_READ,
+			                              0, 0, 0);
+			CloseHandle(mapping);
+		}
+		if ( base == NULL ) {
+			SDL_SetError("Couldn't map %s", file);
+		}
+	}
+	win32_file_close(context);
+#elif defined(MAP_WITH_MMAP)
+	struct stat st;
+	void *addr;
+	int fd;
+
+	fd = open(file, O_RDONLY);
+	if ( fd < 0 ) {
+		SDL_SetError("Couldn't open %s", file);
+		return(NULL);
+	}
+	if ( fstat(fd, &st) < 0 ) {
+		SDL_SetError("Couldn't get the size of %s", file);
+	} else if ( st.st_size > 0x7FFFFFFF ) {
+		SDL_SetError("%s is too large to map", file);
+	} else if ( st.st_size > 0 ) {
+		*size = (int)st.st_size;
+		addr = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if ( addr == MAP_FAILED ) {
+			SDL_SetError("Couldn't map %s", file);
+		} else {
+			base = (Uint8 *)addr;
+		}
+	} else {
+		*size = 0;
+	}
+	/* The mapping stays after the file is closed */
+	close(fd);
+#else
+	SDL_RWops *context;
+
+	/* Without a way to map it, read it all in */
+	context = SDL_RWFromFile(file, "rb");
+	if ( context == NULL ) {
+		return(NULL);
+	}
+	*size = SDL_RWseek(context, 0, RW_SEEK_END);
+	if ( *size > 0 ) {
+		base = (Uint8 *)SDL_malloc(*size);
+		if ( base == NULL ) {
+			SDL_OutOfMemory();
+		} else if ( SDL_RWseek(context, 0, RW_SEEK_SET) < 0 ||
+		            SDL_RWread(context, base, *size, 1) != 1 ) {
+			SDL_Error(SDL_EFREAD);
+			SDL_free(base);
+			base = NULL;
+		}
+	}
+	SDL_RWclose(context);
+#endif
+	return(base);
+}
+
+static int SDLCALL mapped_close(SDL_RWops *context)
+{
+	if ( context ) {
+#if defined(MAP_WITH_WIN32)
+		UnmapViewOfFile(context->hidden.mem.base);
+#elif defined(MAP_WITH_MMAP)
+		munmap(context->hidden.mem.base,
+		       context->hidden.mem.stop - context->hidden.mem.base);
+#else
+		SDL_free(context->hidden.mem.base);
+#endif
+		SDL_FreeRW(context);
+	}
+	return(0);
+}
+
+/* Functions to read and write another data source in large blocks.
+
+   While reading, the buffer holds what was read from 'start' in the data
+   source up to 'start'+'len', and the position is 'start'+'here'.  While
+   writing, it holds 'here' bytes that still need to be written at
+   'start'.  The data source is always at 'start'+'len', or 'start' while
+   writing, so seeks within the buffer don't need to go to it at all.
+*/
+
+#define BUFFERED_DEFAULT_SIZE	4096
+
+#ifdef SDL_HAS_64BIT_TYPE
+typedef Sint64 buffered_offset;
+#define buffered_src_seek(src, offset, whence)	SDL_RWseek64(src, offset, whence)
+#else
+typedef int buffered_offset;
+#define buffered_src_seek(src, offset, whence)	SDL_RWseek(src, offset, whence)
+#endif
+
+struct buffered_data {
+	SDL_RWops *src;
+	int autoclose;
+	buffered_offset start;
+	int len;
+	int here;
+	int dirty;
+	int size;
+	Uint8 *buffer;
+};
+
+static int buffered_flush(struct buffered_data *data)
+{
+	if ( data->dirty ) {
+		if ( (data->here > 0) &&
+		     (SDL_RWwrite(data->src, data->buffer, data->here, 1) != 1) ) {
+			return(-1);
+		}
+		data->start += data->here;
+		data->here = 0;
+		data->len = 0;
+		data->dirty = 0;
+	}
+	return(0);
+}
+
+static buffered_offset buffered_seekto(SDL_RWops *context, buffered_offset offset, int whence)
+{
+	struct buffered_data *data = (struct buffered_data *)context->hidden.unknown.data1;
+	buffered_offset pos;
+
+	if ( buffered_flush(data) < 0 ) {
+		return(-1);
+	}
+	switch (whence) {
+		case RW_SEEK_SET:
+			if ( (offset >= data->start) &&
+			     (offset <= data->start + data->len) ) {
+				data->here = (int)(offset - data->start);
+				return(offset);
+			}
+			pos = buffered_src_seek(data->src, offset, RW_SEEK_SET);
+			break;
+		case RW_SEEK_CUR:
+			if ( (offset >= -data->here) &&
+			     (offset <= data->len - data->here) ) {
+				data->here += (int)offset;
+				return(data->start + data->here);
+			}
+			/* The data source is at the end of the buffer */
+			offset += data->here - data->len;
+			pos = buffered_src_seek(data->src, offset, RW_SEEK_CUR);
+			break;
+		case RW_SEEK_END:
+			pos = buffered_src_seek(data->src, offset, RW_SEEK_END);
+			break;
+		default:
+			SDL_SetError("Unknown value for 'whence'");
+			return(-1);
+	}
+	if ( pos >= 0 ) {
+		data->start = pos;
+		data->len = 0;
+		data->here = 0;
+	}
+	return(pos);
+}
+static int SDLCALL buffered_seek(SDL_RWops *context, int offset, int whence)
+{
+	buffered_offset pos = buffered_seekto(context, offset, whence);
+
+	if ( pos > 0x7FFFFFFF ) {
+		SDL_SetError("Offset too large, use SDL_RWseek64()");
+		return(-1);
+	}
+	return((int)pos);
+}
+#ifdef SDL_HAS_64BIT_TYPE
+static Sint64 SDLCALL buffered_seek64(SDL_RWops *context, Sint64 offset, int whence)
+{
+	return(buffered_seekto(context, offset, whence));
+}
+static Sint64 SDLCALL buffered_size(SDL_RWops *context)
+{
+	struct buffered_data *data = (struct buffered_data *)context->hidden.unknown.data1;
+
+	if ( buffered_flush(data) < 0 ) {
+		return(-1);
+	}
+	return(SDL_RWsize(data->src));
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+static int SDLCALL buffered_read(SDL_RWops *context, void *ptr, int size, int maxnum)
+{
+	struct buffered_data *data = (struct buffered_data *)context->hidden.unknown.data1;
+	Uint8 *dst = (Uint8 *)ptr;
+	size_t total_bytes;
+	size_t copied;
+	int n;
+
+	total_bytes = (maxnum * size);
+	if ( (maxnum <= 0) || (size <= 0) || ((total_bytes / maxnum) != (size_t) size) ) {
+		return 0;
+	}
+	if ( buffered_flush(data) < 0 ) {
+		return(-1);
+	}
+
+	copied = 0;
+	while ( copied < total_bytes ) {
+		n = data->len - data->here;
+		if ( n > 0 ) {
+			/* Take what we can from the buffer */
+			if ( (size_t)n > total_bytes - copied ) {
+				n = (int)(total_bytes - copied);
+			}
+			SDL_memcpy(dst + copied, data->buffer + data->here, n);
+			data->here += n;
+			copied += n;
+			continue;
+		}
+
+		/* Large reads go straight through, others fill the buffer */
+		data->start += data->len;
+		data->len = 0;
+		data->here = 0;
+		if ( total_bytes - copied >= (size_t)data->size ) {
+			n = SDL_RWread(data->src, dst + copied, 1,
+			               (int)(total_bytes - copied));
+			if ( n > 0 ) {
+				data->start += n;
+				copied += n;
+			}
+		} else {
+			n = SDL_RWread(data->src, data->buffer, 1, data->size);
+			if ( n > 0 ) {
+				data->len = n;
+			}
+		}
+		if ( n <= 0 ) {
+			if ( n < 0 && copied == 0 ) {
+				return(-1);
+			}
+			break;
+		}
+	}
+	return (copied / size);
+}
+static int SDLCALL buffered_write(SDL_RWops *context, const void *ptr, int size, int num)
+{
+	struct buffered_data *data = (struct buffered_data *)context->hidden.unknown.data1;
+	size_t total_bytes;
+
+	total_bytes = (num * size);
+	if ( (num <= 0) || (size <= 0) || ((total_bytes / num) != (size_t) size) ) {
+		return 0;
+	}
+
+	if ( ! data->dirty ) {
+		/* Put the data source back where we are, and start writing */
+		if ( (data->here != data->len) &&
+		     (buffered_src_seek(data->src, data->here - data->len, RW_SEEK_CUR) < 0) ) {
+			return(-1);
+		}
+		data->start += data->here;
+		data->len = 0;
+		data->here = 0;
+		data->dirty = 1;
+	}
+	if ( data->here + total_bytes > (size_t)data->size ) {
+		if ( buffered_flush(data) < 0 ) {
+			return(-1);
+		}
+		data->dirty = 1;
+	}
+	if ( total_bytes >= (size_t)data->size ) {
+		/* Too big to be worth copying */
+		if ( SDL_RWwrite(data->src, ptr, total_bytes, 1) != 1 ) {
+			return(-1);
+		}
+		data->start += total_bytes;
+	} else {
+		SDL_memcpy(data->buffer + data->here, ptr, total_bytes);
+		data->here += (int)total_bytes;
+	}
+	return(num);
+}
+static int SDLCALL buffered_close(SDL_RWops *context)
+{
+	struct buffered_data *data;
+	int status = 0;
+
+	if ( context ) {
+		data = (struct buffered_data *)context->hidden.unknown.data1;
+		if ( buffered_flush(data) < 0 ) {
+			status = -1;
+		}
+		if ( data->autoclose ) {
+			if ( SDL_RWclose(data->src) < 0 ) {
+				status = -1;
+			}
+		} else if ( data->len != data->here ) {
+			/* Leave the data source where we were */
+			buffered_src_seek(data->src, data->here - data->len, RW_SEEK_CUR);
+		}
+		SDL_free(data);
+		SDL_FreeRW(context);
+	}
+	return(status);
+}
 
 /* Functions to create SDL_RWops structures from various data sources */
 
@@ -504,6 +965,8 @@ SDL_RWops *SDL_RWFromFile(const char *file, const char *mode)
 	rwops->read  = win32_file_read;
 	rwops->write = win32_file_write;
 	rwops->close = win32_file_close;
+	rwops->seek64 = win32_file_seek64;
+	rwops->size = win32_file_size;
 
 #elif HAVE_STDIO_H
 
@@ -539,6 +1002,10 @@ SDL_RWops *SDL_RWFromFP(FILE *fp, int autoclose)
 		rwops->read = stdio_read;
 		rwops->write = stdio_write;
 		rwops->close = stdio_close;
+#ifdef SDL_HAS_64BIT_TYPE
+		rwops->seek64 = stdio_seek64;
+		rwops->size = stdio_size;
+#endif
 		rwops->hidden.stdio.fp = fp;
 		rwops->hidden.stdio.autoclose = autoclose;
 	}
@@ -556,6 +1023,10 @@ SDL_RWops *SDL_RWFromMem(void *mem, int size)
 		rwops->read = mem_read;
 		rwops->write = mem_write;
 		rwops->close = mem_close;
+#ifdef SDL_HAS_64BIT_TYPE
+		rwops->seek64 = mem_seek64;
+		rwops->size = mem_size;
+#endif
 		rwops->hidden.mem.base = (Uint8 *)mem;
 		rwops->hidden.mem.here = rwops->hidden.mem.base;
 		rwops->hidden.mem.stop = rwops->hidden.mem.base+size;
@@ -573,6 +1044,10 @@ SDL_RWops *SDL_RWFromConstMem(const void *mem, int size)
 		rwops->read = mem_read;
 		rwops->write = mem_writeconst;
 		rwops->close = mem_close;
+#ifdef SDL_HAS_64BIT_TYPE
+		rwops->seek64 = mem_seek64;
+		rwops->size = mem_size;
+#endif
 		rwops->hidden.mem.base = (Uint8 *)mem;
 		rwops->hidden.mem.here = rwops->hidden.mem.base;
 		rwops->hidden.mem.stop = rwops->hidden.mem.base+size;
@@ -580,6 +1055,110 @@ SDL_RWops *SDL_RWFromConstMem(const void *mem, int size)
 	return(rwops);
 }
 
+SDL_RWops *SDL_RWFromMappedFile(const char *file)
+{
+	SDL_RWops *rwops;
+	Uint8 *base;
+	int size = -1;
+
+	if ( !file || !*file ) {
+		SDL_SetError("SDL_RWFromMappedFile(): No file specified");
+		return NULL;
+	}
+	rwops = SDL_AllocRW();
+	if ( rwops == NULL ) {
+		return NULL;
+	}
+	base = map_file(file, &size);
+	if ( base == NULL ) {
+		SDL_FreeRW(rwops);
+		/* Empty files can't be mapped, but there's nothing to read */
+		if ( size == 0 ) {
+			return SDL_RWFromConstMem("", 0);
+		}
+		return NULL;
+	}
+	rwops->seek = mem_seek;
+	rwops->read = mem_read;
+	rwops->write = mem_writeconst;
+	rwops->close = mapped_close;
+#ifdef SDL_HAS_64BIT_TYPE
+	rwops->seek64 = mem_seek64;
+	rwops->size = mem_size;
+#endif
+	rwops->hidden.mem.base = base;
+	rwops->hidden.mem.here = rwops->hidden.mem.base;
+	rwops->hidden.mem.stop = rwops->hidden.mem.base+size;
+	return(rwops);
+}
+
+const void *SDL_RWGetMapping(SDL_RWops *context, int *size)
+{
+	if ( context == NULL || context->seek != mem_seek ) {
+		return NULL;
+	}
+	if ( size ) {
+		*size = (context->hidden.mem.stop - context->hidden.mem.base);
+	}
+	return context->hidden.mem.base;
+}
+
+SDL_RWops *SDL_RWFromBuffered(SDL_RWops *src, int bufsize, int autoclose)
+{
+	SDL_RWops *rwops;
+	struct buffered_data *data;
+
+	if ( src == NULL ) {
+		SDL_SetError("SDL_RWFromBuffered(): No data source");
+		return NULL;
+	}
+	if ( bufsize <= 0 ) {
+		bufsize = BUFFERED_DEFAULT_SIZE;
+	}
+	rwops = SDL_AllocRW();
+	if ( rwops == NULL ) {
+		return NULL;
+	}
+	data = (struct buffered_data *)SDL_malloc(sizeof(*data) + bufsize);
+	if ( data == NULL ) {
+		SDL_FreeRW(rwops);
+		SDL_OutOfMemory();
+		return NULL;
+	}
+	SDL_memset(data, 0, sizeof(*data));
+	data->src = src;
+	data->autoclose = autoclose;
+	data->size = bufsize;
+	data->buffer = (Uint8 *)(data + 1);
+	/* Where it starts, if the data source knows */
+	data->start = buffered_src_seek(src, 0, RW_SEEK_CUR);
+	if ( data->start < 0 ) {
+		data->start = 0;
+	}
+
+	rwops->seek = buffered_seek;
+	rwops->read = buffered_read;
+	rwops->write = buffered_write;
+	rwops->close = buffered_close;
+#ifdef SDL_HAS_64BIT_TYPE
+	rwops->seek64 = buffered_seek64;
+	rwops->size = buffered_size;
+#endif
+	rwops->hidden.unknown.data1 = data;
+	return(rwops);
+}
+
+/* Set in 'type' by SDL_AllocRW().  Applications can build data sources
+   themselves, with headers from before 'seek64' and 'size' were added, so
+   those are only trusted on data sources that have this.
+ */
+#define SDL_RWOPS_ALLOCATED	0x52573634	/* "RW64" */
+
+#define SDL_RWHasSeek64(ctx) \
+	(((ctx)->type == SDL_RWOPS_ALLOCATED) && (ctx)->seek64)
+#define SDL_RWHasSize(ctx) \
+	(((ctx)->type == SDL_RWOPS_ALLOCATED) && (ctx)->size)
+
 SDL_RWops *SDL_AllocRW(void)
 {
 	SDL_RWops *area;
@@ -587,6 +1166,10 @@ SDL_RWops *SDL_AllocRW(void)
 	area = (SDL_RWops *)SDL_malloc(sizeof *area);
 	if ( area == NULL ) {
 		SDL_OutOfMemory();
+	} else {
+		/* Data sources that don't know about them leave these NULL */
+		SDL_memset(area, 0, sizeof(*area));
+		area->type = SDL_RWOPS_ALLOCATED;
 	}
 	return(area);
 }
@@ -596,6 +1179,394 @@ void SDL_FreeRW(SDL_RWops *area)
 	SDL_free(area);
 }
 
+#ifdef SDL_HAS_64BIT_TYPE
+Sint64 SDL_RWseek64(SDL_RWops *context, Sint64 offset, int whence)
+{
+	if ( SDL_RWHasSeek64(context) ) {
+		return context->seek64(context, offset, whence);
+	}
+	if ( offset < -0x7FFFFFFF || offset > 0x7FFFFFFF ) {
+		SDL_SetError("Data source can't seek that far");
+		return(-1);
+	}
+	return context->seek(context, (int)offset, whence);
+}
+
+Sint64 SDL_RWsize(SDL_RWops *context)
+{
+	int pos, size;
+
+	if ( SDL_RWHasSize(context) ) {
+		return context->size(context);
+	}
+	pos = context->seek(context, 0, RW_SEEK_CUR);
+	if ( pos < 0 ) {
+		return(-1);
+	}
+	size = context->seek(context, 0, RW_SEEK_END);
+	context->seek(context, pos, RW_SEEK_SET);
+	return(size);
+}
+
+/*
+ * Asynchronous reads wait in a queue for a small pool of I/O threads,
+ * which start with the first request.  The number of threads can be set
+ * with the SDL_RWOPS_THREADS environment variable.  Each request seeks
+ * and reads while holding a lock for its data source, so requests for
+ * the same data source don't get mixed up, while different data sources
+ * are read at the same time.
+ */
+#define DEFAULT_IO_THREADS	2
+#define MAX_IO_THREADS		8
+#define NUM_IO_LOCKS		16
+
+#define ASYNC_QUEUED	0
+#define ASYNC_RUNNING	1
+#define ASYNC_DONE	2
+
+struct SDL_RWAsync {
+	SDL_RWops *context;
+	Sint64 offset;
+	void *ptr;
+	int size;
+	Uint8 event_type;
+	void *userdata;
+	int status;
+	int result;
+	SDL_RWAsync *next;
+};
+
+/* These are also called by SDL_Init() and SDL_Quit() */
+void SDL_RWInitAsync(void);
+void SDL_RWQuitAsync(void);
+
+#if !SDL_THREADS_DISABLED
+static struct {
+	int initialized;
+	int numthreads;
+	int quit;
+	SDL_mutex *lock;	/* Protects the queue and request status */
+	SDL_cond *work;		/* Signalled when a request is queued */
+	SDL_cond *done;		/* Broadcast when a request is done */
+	SDL_RWAsync *head;
+	SDL_RWAsync *tail;
+	SDL_mutex *io_locks[NUM_IO_LOCKS];
+	SDL_Thread *threads[MAX_IO_THREADS];
+} SDL_IOPool;
+#if SDL_HAVE_ATOMICS
+static volatile int SDL_IOPoolStarting;
+#endif
+#endif /* !SDL_THREADS_DISABLED */
+
+static void RunAsyncRead(SDL_RWAsync *request)
+{
+	SDL_RWops *context = request->context;
+#if !SDL_THREADS_DISABLED
+	SDL_mutex *io_lock = SDL_IOPool.io_locks[
+		((size_t)context / sizeof(SDL_RWops)) % NUM_IO_LOCKS];
+
+	if ( io_lock ) {
+		SDL_mutexP(io_lock);
+	}
+#endif
+	if ( (request->offset >= 0) &&
+	     (SDL_RWseek64(context, request->offset, RW_SEEK_SET) < 0) ) {
+		request->result = -1;
+	} else {
+		request->result = SDL_RWread(context, request->ptr, 1, request->size);
+	}
+#if !SDL_THREADS_DISABLED
+	if ( io_lock ) {
+		SDL_mutexV(io_lock);
+	}
+#endif
+}
+
+static void FinishAsyncRead(SDL_RWAsync *request)
+{
+	SDL_Event event;
+
+	/* Once it's done, the request can be freed at any time */
+	SDL_memset(&event, 0, sizeof(event));
+	event.type = request->event_type;
+	event.user.type = request->event_type;
+	event.user.code = request->result;
+	event.user.data1 = request;
+	event.user.data2 = request->userdata;
+#if !SDL_THREADS_DISABLED
+	if ( SDL_IOPool.lock ) {
+		SDL_mutexP(SDL_IOPool.lock);
+		request->status = ASYNC_DONE;
+		SDL_CondBroadcast(SDL_IOPool.done);
+		SDL_mutexV(SDL_IOPool.lock);
+	} else {
+		request->status = ASYNC_DONE;
+	}
+#else
+	request->status = ASYNC_DONE;
+#endif
+
+	if ( event.type != SDL_NOEVENT ) {
+		SDL_PushEvent(&event);
+	}
+}
+
+#if !SDL_THREADS_DISABLED
+static int SDLCALL SDL_IOThread(void *unused)
+{
+	SDL_RWAsync *request;
+
+	SDL_mutexP(SDL_IOPool.lock);
+	for ( ; ; ) {
+		while ( !SDL_IOPool.head && !SDL_IOPool.quit ) {
+			SDL_CondWait(SDL_IOPool.work, SDL_IOPool.lock);
+		}
+		if ( SDL_IOPool.quit ) {
+			break;
+		}
+		request = SDL_IOPool.head;
+		SDL_IOPool.head = request->next;
+		if ( SDL_IOPool.head == NULL ) {
+			SDL_IOPool.tail = NULL;
+		}
+		request->status = ASYNC_RUNNING;
+		SDL_mutexV(SDL_IOPool.lock);
+
+		RunAsyncRead(request);
+		FinishAsyncRead(request);
+
+		SDL_mutexP(SDL_IOPool.lock);
+	}
+	SDL_mutexV(SDL_IOPool.lock);
+	return(0);
+}
+
+static void SDL_StartIOThreads(void)
+{
+	const char *env;
+	int i, numthreads;
+
+#if SDL_HAVE_ATOMICS
+	/* Only one thread gets to start them */
+	while ( !SDL_AtomicCAS(&SDL_IOPoolStarting, 0, 1) ) {
+		SDL_Delay(0);
+	}
+	if ( SDL_IOPool.initialized ) {
+		SDL_AtomicSet(&SDL_IOPoolStarting, 0);
+		return;
+	}
+#endif
+	env = SDL_getenv("SDL_RWOPS_THREADS");
+	numthreads = env ? SDL_atoi(env) : DEFAULT_IO_THREADS;
+	if ( numthreads > MAX_IO_THREADS ) {
+		numthreads = MAX_IO_THREADS;
+	}
+
+	SDL_IOPool.quit = 0;
+	if ( numthreads > 0 ) {
+		SDL_IOPool.lock = SDL_CreateMutex();
+		SDL_IOPool.work = SDL_CreateCond();
+		SDL_IOPool.done = SDL_CreateCond();
+	}
+	if ( SDL_IOPool.lock && SDL_IOPool.work && SDL_IOPool.done ) {
+		for ( i = 0; i < NUM_IO_LOCKS; ++i ) {
+			SDL_IOPool.io_locks[i] = SDL_CreateMutex();
+			if ( SDL_IOPool.io_locks[i] == NULL ) {
+				numthreads = 0;
+			}
+		}
+		for ( i = 0; i < numthreads; ++i ) {
+			SDL_IOPool.threads[i] = SDL_CreateThread(SDL_IOThread, NULL);
+			if ( SDL_IOPool.threads[i] == NULL ) {
+				break;
+			}
+		}
+		SDL_IOPool.numthreads = i;
+	}
+	if ( SDL_IOPool.numthreads == 0 ) {
+		/* Requests will be read as they're made */
+		SDL_RWQuitAsync();
+	}
+	SDL_IOPool.initialized = 1;
+#if SDL_HAVE_ATOMICS
+	SDL_AtomicSet(&SDL_IOPoolStarting, 0);
+#endif
+}
+#endif /* !SDL_THREADS_DISABLED */
+
+/* Without atomic operations nothing keeps two threads from starting the
+   pool at once, so it's started here, before the application has other
+   threads using SDL.  Programs that don't call SDL_Init() start it on
+   their first request, as they do with atomic operations.
+ */
+void SDL_RWInitAsync(void)
+{
+#if !SDL_THREADS_DISABLED && !SDL_HAVE_ATOMICS
+	if ( ! SDL_IOPool.initialized ) {
+		SDL_StartIOThreads();
+	}
+#endif
+}
+
+void SDL_RWQuitAsync(void)
+{
+#if !SDL_THREADS_DISABLED
+	SDL_RWAsync *request;
+	int i;
+
+	if ( SDL_IOPool.lock ) {
+		SDL_mutexP(SDL_IOPool.lock);
+		SDL_IOPool.quit = 1;
+		/* Anything still waiting is cancelled */
+		for ( request = SDL_IOPool.head; request; request = request->next ) {
+			request->result = -1;
+			request->status = ASYNC_DONE;
+		}
+		SDL_IOPool.head = SDL_IOPool.tail = NULL;
+		SDL_CondBroadcast(SDL_IOPool.work);
+		SDL_CondBroadcast(SDL_IOPool.done);
+		SDL_mutexV(SDL_IOPool.lock);
+	}
+	for ( i = 0; i < SDL_IOPool.numthreads; ++i ) {
+		SDL_WaitThread(SDL_IOPool.threads[i], NULL);
+		SDL_IOPool.threads[i] = NULL;
+	}
+	SDL_IOPool.numthreads = 0;
+	for ( i = 0; i < NUM_IO_LOCKS; ++i ) {
+		if ( SDL_IOPool.io_locks[i] ) {
+			SDL_DestroyMutex(SDL_IOPool.io_locks[i]);
+			SDL_IOPool.io_locks[i] = NULL;
+		}
+	}
+	if ( SDL_IOPool.done ) {
+		SDL_DestroyCond(SDL_IOPool.done);
+		SDL_IOPool.done = NULL;
+	}
+	if ( SDL_IOPool.work ) {
+		SDL_DestroyCond(SDL_IOPool.work);
+		SDL_IOPool.work = NULL;
+	}
+	if ( SDL_IOPool.lock ) {
+		SDL_DestroyMutex(SDL_IOPool.lock);
+		SDL_IOPool.lock = NULL;
+	}
+	SDL_IOPool.initialized = 0;
+#endif /* !SDL_THREADS_DISABLED */
+}
+
+SDL_RWAsync *SDL_RWreadAsync(SDL_RWops *context, Sint64 offset, void *ptr,
+                             int size, Uint8 event_type, void *userdata)
+{
+	SDL_RWAsync *request;
+
+	if ( context == NULL || ptr == NULL || size < 0 ) {
+		SDL_SetError("SDL_RWreadAsync(): Invalid parameters");
+		return NULL;
+	}
+	request = (SDL_RWAsync *)SDL_malloc(sizeof(*request));
+	if ( request == NULL ) {
+		SDL_OutOfMemory();
+		return NULL;
+	}
+	request->context = context;
+	request->offset = offset;
+	request->ptr = ptr;
+	request->size = size;
+	request->event_type = event_type;
+	request->userdata = userdata;
+	request->status = ASYNC_QUEUED;
+	request->result = -1;
+	request->next = NULL;
+
+#if !SDL_THREADS_DISABLED
+	if ( ! SDL_IOPool.initialized ) {
+		SDL_StartIOThreads();
+	}
+	if ( SDL_IOPool.numthreads > 0 ) {
+		SDL_mutexP(SDL_IOPool.lock);
+		if ( SDL_IOPool.tail ) {
+			SDL_IOPool.tail->next = request;
+		} else {
+			SDL_IOPool.head = request;
+		}
+		SDL_IOPool.tail = request;
+		SDL_CondSignal(SDL_IOPool.work);
+		SDL_mutexV(SDL_IOPool.lock);
+		return(request);
+	}
+#endif
+	/* Without I/O threads, it's done before it's returned */
+	request->status = ASYNC_RUNNING;
+	RunAsyncRead(request);
+	FinishAsyncRead(request);
+	return(request);
+}
+
+int SDL_RWpollAsync(SDL_RWAsync *request)
+{
+	int done;
+
+#if !SDL_THREADS_DISABLED
+	if ( SDL_IOPool.lock ) {
+		SDL_mutexP(SDL_IOPool.lock);
+		done = (request->status == ASYNC_DONE);
+		SDL_mutexV(SDL_IOPool.lock);
+		return(done);
+	}
+#endif
+	done = (request->status == ASYNC_DONE);
+	return(done);
+}
+
+int SDL_RWwaitAsync(SDL_RWAsync *request)
+{
+	int result;
+
+#if !SDL_THREADS_DISABLED
+	if ( SDL_IOPool.lock ) {
+		SDL_mutexP(SDL_IOPool.lock);
+		while ( request->status != ASYNC_DONE ) {
+			SDL_CondWait(SDL_IOPool.done, SDL_IOPool.lock);
+		}
+		SDL_mutexV(SDL_IOPool.lock);
+	}
+#endif
+	result = request->result;
+	SDL_free(request);
+	return(result);
+}
+
+int SDL_RWcancelAsync(SDL_RWAsync *request)
+{
+#if !SDL_THREADS_DISABLED
+	SDL_RWAsync *prev, *here;
+
+	if ( SDL_IOPool.lock ) {
+		SDL_mutexP(SDL_IOPool.lock);
+		if ( request->status == ASYNC_QUEUED ) {
+			prev = NULL;
+			for ( here = SDL_IOPool.head; here != request; here = here->next ) {
+				prev = here;
+			}
+			if ( prev ) {
+				prev->next = request->next;
+			} else {
+				SDL_IOPool.head = request->next;
+			}
+			if ( SDL_IOPool.tail == request ) {
+				SDL_IOPool.tail = prev;
+			}
+			request->status = ASYNC_DONE;
+			request->result = -1;
+		}
+		SDL_mutexV(SDL_IOPool.lock);
+	}
+#endif
+	/* If it's already being read, that finishes first */
+	return SDL_RWwaitAsync(request);
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 /* Functions for dynamically reading and writing endian-specific values */
 
 Uint16 SDL_ReadLE16 (SDL_RWops *src)
@@ -0,0 +1,98 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2012 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_atomic_c_h
+#define _SDL_atomic_c_h
+
+#include "SDL_stdinc.h"
+
+/* Minimal atomic operations for SDL's internal lock-free queues.
+
+   These are only available where the compiler provides them; any code
+   using them must keep a mutex-based fallback for when SDL_HAVE_ATOMICS
+   is 0.  Every operation here is a full memory barrier.
+ */
+
+#if SDL_THREADS_DISABLED
+#define SDL_HAVE_ATOMICS	0
+#elif defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+#define SDL_HAVE_ATOMICS	1
+
+static __inline__ SDL_bool SDL_AtomicCAS(volatile int *a, int oldval, int newval)
+{
+	return __sync_bool_compare_and_swap(a, oldval, newval) ? SDL_TRUE : SDL_FALSE;
+}
+
+static __inline__ int SDL_AtomicAdd(volatile int *a, int value)
+{
+	return __sync_fetch_and_add(a, value);
+}
+
+static __inline__ void SDL_MemoryBarrier(void)
+{
+	__sync_synchronize();
+}
+
+#elif defined(_MSC_VER) && (_MSC_VER >= 1400)
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange, _InterlockedExchangeAdd, _InterlockedExchange)
+#define SDL_HAVE_ATOMICS	1
+
+static __inline__ SDL_bool SDL_AtomicCAS(volatile int *a, int oldval, int newval)
+{
+	return (_InterlockedCompareExchange((volatile long *)a, newval, oldval) == oldval) ? SDL_TRUE : SDL_FALSE;
+}
+
+static __inline__ int SDL_AtomicAdd(volatile int *a, int value)
+{
+	return _InterlockedExchangeAdd((volatile long *)a, value);
+}
+
+static __inline__ void SDL_MemoryBarrier(void)
+{
+	volatile long barrier = 0;
+	_InterlockedExchange(&barrier, 0);
+}
+
+#else
+#define SDL_HAVE_ATOMICS	0
+#endif
+
+#if SDL_HAVE_ATOMICS
+/* Read a value published by another thread, and anything written before it */
+static __inline__ int SDL_AtomicGet(volatile int *a)
+{
+	int value = *a;
+	SDL_MemoryBarrier();
+	return value;
+}
+
+/* Publish a value, along with everything written before it */
+static __inline__ void SDL_AtomicSet(volatile int *a, int value)
+{
+	SDL_MemoryBarrier();
+	*a = value;
+}
+#endif /* SDL_HAVE_ATOMICS */
+
+#endif /* _SDL_atomic_c_h */
@@ -43,12 +43,21 @@ struct _SDL_TimerID {
 	SDL_NewTimerCallback cb;
 	void *param;
 	Uint32 last_alarm;
-	struct _SDL_TimerID *next;
+	int index;	/* Position in SDL_timer_heap */
 };
 
-static SDL_TimerID SDL_timers = NULL;
+/* The timers are kept in a binary min-heap on their next deadline, so
+   the earliest one is always SDL_timer_heap[0].  SDL_timer_running is
+   the number of timers in the heap.
+ */
+#define TIMER_DEADLINE(t)	((t)->last_alarm + (t)->interval)
+#define TIMER_BEFORE(a, b)	((int)(TIMER_DEADLINE(a) - TIMER_DEADLINE(b)) < 0)
+
+static SDL_TimerID *SDL_timer_heap = NULL;
+static int SDL_timer_heapsize = 0;
+static SDL_TimerID SDL_timer_current = NULL;	/* The callback running now */
 static SDL_mutex *SDL_timer_mutex;
-static volatile SDL_bool list_changed = SDL_FALSE;
+static SDL_cond *SDL_timer_cond;	/* Wakes the timer thread early */
 
 /* Set whether or not the timer should use a thread.
    This should not be called while the timer subsystem is running.
@@ -80,6 +89,7 @@ int SDL_TimerInit(void)
 	}
 	if ( SDL_timer_threaded ) {
 		SDL_timer_mutex = SDL_CreateMutex();
+		SDL_timer_cond = SDL_CreateCond();
 	}
 	if ( retval == 0 ) {
 		SDL_timer_started = 1;
@@ -94,87 +104,207 @@ void SDL_TimerQuit(void)
 		SDL_SYS_TimerQuit();
 	}
 	if ( SDL_timer_threaded ) {
+		SDL_DestroyCond(SDL_timer_cond);
+		SDL_timer_cond = NULL;
 		SDL_DestroyMutex(SDL_timer_mutex);
 		SDL_timer_mutex = NULL;
 	}
+	if ( SDL_timer_heap ) {
+		SDL_free(SDL_timer_heap);
+		SDL_timer_heap = NULL;
+		SDL_timer_heapsize = 0;
+	}
 	SDL_timer_started = 0;
 	SDL_timer_threaded = 0;
 }
 
+/* Heap maintenance -- called with the timer mutex held */
+static void SDL_TimerHeapSet(int index, SDL_TimerID t)
+{
+	SDL_timer_heap[index] = t;
+	t->index = index;
+}
+
+static void SDL_TimerHeapUp(int index)
+{
+	SDL_TimerID t = SDL_timer_heap[index];
+
+	while ( index > 0 ) {
+		int parent = (index - 1) / 2;
+		if ( ! TIMER_BEFORE(t, SDL_timer_heap[parent]) ) {
+			break;
+		}
+		SDL_TimerHeapSet(index, SDL_timer_heap[parent]);
+		index = parent;
+	}
+	SDL_TimerHeapSet(index, t);
+}
+
+static void SDL_TimerHeapDown(int index)
+{
+	SDL_TimerID t = SDL_timer_heap[index];
+
+	for ( ; ; ) {
+		int child = index * 2 + 1;
+		if ( child >= SDL_timer_running ) {
+			break;
+		}
+		if ( (child + 1 < SDL_timer_running) &&
+		     TIMER_BEFORE(SDL_timer_heap[child + 1], SDL_timer_heap[child]) ) {
+			++child;
+		}
+		if ( ! TIMER_BEFORE(SDL_timer_heap[child], t) ) {
+			break;
+		}
+		SDL_TimerHeapSet(index, SDL_timer_heap[child]);
+		index = child;
+	}
+	SDL_TimerHeapSet(index, t);
+}
+
+/* Put a timer back in order after its deadline changed */
+static void SDL_TimerHeapFix(int index)
+{
+	SDL_TimerID t = SDL_timer_heap[index];
+
+	SDL_TimerHeapUp(index);
+	SDL_TimerHeapDown(t->index);
+}
+
+static void SDL_TimerHeapRemove(SDL_TimerID t)
+{
+	int index = t->index;
+
+	--SDL_timer_running;
+	if ( index != SDL_timer_running ) {
+		SDL_TimerHeapSet(index, SDL_timer_heap[SDL_timer_running]);
+		SDL_TimerHeapFix(index);
+	}
+	SDL_timer_heap[SDL_timer_running] = NULL;
+	if ( t == SDL_timer_current ) {
+		/* Let SDL_ThreadedTimerCheck() know it's gone */
+		SDL_timer_current = NULL;
+	}
+}
+/* Run the timers that are due -- each one at most once per call */
 void SDL_ThreadedTimerCheck(void)
 {
-	Uint32 now, ms;
-	SDL_TimerID t, prev, next;
-	SDL_bool removed;
+	Uint32 now, ms, interval, next_alarm;
+	SDL_NewTimerCallback cb;
+	void *param;
+	SDL_TimerID t;
+	int count;
 
 	SDL_mutexP(SDL_timer_mutex);
-	list_changed = SDL_FALSE;
 	now = SDL_GetTicks();
-	for ( prev = NULL, t = SDL_timers; t; t = next ) {
-		removed = SDL_FALSE;
-		ms = t->interval - SDL_TIMESLICE;
-		next = t->next;
-		if ( (int)(now - t->last_alarm) > (int)ms ) {
-			struct _SDL_TimerID timer;
-
-			if ( (now - t->last_alarm) < t->interval ) {
-				t->last_alarm += t->interval;
-			} else {
-				t->last_alarm = now;
-			}
+	for ( count = SDL_timer_running; count > 0 && SDL_timer_running; --count ) {
+		t = SDL_timer_heap[0];
+		if ( (int)(TIMER_DEADLINE(t) - now) > 0 ) {
+			break;
+		}
+
+		/* Stay on schedule, unless we've fallen a whole interval behind */
+		next_alarm = t->last_alarm + t->interval;
+		if ( (now - next_alarm) >= t->interval ) {
+			next_alarm = now;
+		}
 #ifdef DEBUG_TIMERS
-			printf("Executing timer %p (thread = %d)\n",
-				t, SDL_ThreadID());
+		printf("Executing timer %p (thread = %d)\n",
+			t, SDL_ThreadID());
 #endif
-			timer = *t;
-			SDL_mutexV(SDL_timer_mutex);
-			ms = timer.cb(timer.interval, timer.param);
-			SDL_mutexP(SDL_timer_mutex);
-			if ( list_changed ) {
-				/* Abort, list of timers modified */
-				/* FIXME: what if ms was changed? */
-				break;
+		interval = t->interval;
+		cb = t->cb;
+		param = t->param;
+		SDL_timer_current = t;
+		SDL_mutexV(SDL_timer_mutex);
+		ms = cb(interval, param);
+		SDL_mutexP(SDL_timer_mutex);
+		if ( SDL_timer_current != t ) {
+			/* The timer was removed while the callback ran */
+			continue;
+		}
+		SDL_timer_current = NULL;
+		if ( ms ) {
+			if ( ms != interval ) {
+				t->interval = ms;
 			}
-			if ( ms != t->interval ) {
-				if ( ms ) {
-					t->interval = ROUND_RESOLUTION(ms);
-				} else {
-					/* Remove timer from the list */
+			t->last_alarm = next_alarm;
+			SDL_TimerHeapFix(t->index);
+		} else {
+			/* Remove timer from the heap */
 #ifdef DEBUG_TIMERS
-					printf("SDL: Removing timer %p\n", t);
+			printf("SDL: Removing timer %p\n", t);
 #endif
-					if ( prev ) {
-						prev->next = next;
-					} else {
-						SDL_timers = next;
-					}
-					SDL_free(t);
-					--SDL_timer_running;
-					removed = SDL_TRUE;
-				}
-			}
+			SDL_TimerHeapRemove(t);
+			SDL_free(t);
 		}
-		/* Don't update prev if the timer has disappeared */
-		if ( ! removed ) {
-			prev = t;
+	}
+	SDL_mutexV(SDL_timer_mutex);
+}
+
+/* Sleep until the next timer is due, or the timers change.
+   This returns right away if '*alive' has been cleared.
+ */
+void SDL_ThreadedTimerSleep(const int *alive)
+{
+	int ms;
+
+	if ( ! SDL_timer_mutex || ! SDL_timer_cond ) {
+		/* Not set up yet, or no way to be woken up */
+		SDL_Delay(1);
+		return;
+	}
+	SDL_mutexP(SDL_timer_mutex);
+	if ( *alive ) {
+		if ( SDL_timer_running == 0 ) {
+			SDL_CondWait(SDL_timer_cond, SDL_timer_mutex);
+		} else {
+			ms = (int)(TIMER_DEADLINE(SDL_timer_heap[0]) - SDL_GetTicks());
+			if ( ms > 0 ) {
+				SDL_CondWaitTimeout(SDL_timer_cond, SDL_timer_mutex, ms);
+			}
 		}
 	}
 	SDL_mutexV(SDL_timer_mutex);
 }
 
+/* Have the timer thread look at the timers again */
+void SDL_ThreadedTimerWake(void)
+{
+	if ( SDL_timer_mutex && SDL_timer_cond ) {
+		SDL_mutexP(SDL_timer_mutex);
+		SDL_CondSignal(SDL_timer_cond);
+		SDL_mutexV(SDL_timer_mutex);
+	}
+}
+
 static SDL_TimerID SDL_AddTimerInternal(Uint32 interval, SDL_NewTimerCallback callback, void *param)
 {
 	SDL_TimerID t;
+
+	if ( SDL_timer_running == SDL_timer_heapsize ) {
+		int size = SDL_timer_heapsize ? SDL_timer_heapsize * 2 : 16;
+		SDL_TimerID *heap;
+
+		heap = (SDL_TimerID *) SDL_realloc(SDL_timer_heap, size * sizeof(*heap));
+		if ( ! heap ) {
+			SDL_OutOfMemory();
+			return NULL;
+		}
+		SDL_timer_heap = heap;
+		SDL_timer_heapsize = size;
+	}
 	t = (SDL_TimerID) SDL_malloc(sizeof(struct _SDL_TimerID));
 	if ( t ) {
-		t->interval = ROUND_RESOLUTION(interval);
+		t->interval = interval;
 		t->cb = callback;
 		t->param = param;
 		t->last_alarm = SDL_GetTicks();
-		t->next = SDL_timers;
-		SDL_timers = t;
-		++SDL_timer_running;
-		list_changed = SDL_TRUE;
+		SDL_TimerHeapSet(SDL_timer_running++, t);
+		SDL_TimerHeapUp(t->index);
+		if ( SDL_timer_cond ) {
+			SDL_CondSignal(SDL_timer_cond);
+		}
 	}
 #ifdef DEBUG_TIMERS
 	printf("SDL_AddTimer(%d) = %08x num_timers = %d\n", interval, (Uint32)t, SDL_timer_running);
@@ -205,23 +335,20 @@ SDL_TimerID SDL_AddTimer(Uint32 interval, SDL_NewTimerCallback callback, void *p
 
 SDL_bool SDL_RemoveTimer(SDL_TimerID id)
 {
-	SDL_TimerID t, prev = NULL;
 	SDL_bool removed;
+	int i;
 
 	removed = SDL_FALSE;
 	SDL_mutexP(SDL_timer_mutex);
-	/* Look for id in the linked list of timers */
-	for (t = SDL_timers; t; prev=t, t = t->next ) {
-		if ( t == id ) {
-			if(prev) {
-				prev->next = t->next;
-			} else {
-				SDL_timers = t->next;
-			}
-			SDL_free(t);
-			--SDL_timer_running;
+	/* Make sure id is a live timer before touching it */
+	for ( i = 0; i < SDL_timer_running; ++i ) {
+		if ( SDL_timer_heap[i] == id ) {
+			SDL_TimerHeapRemove(id);
+			SDL_free(id);
 			removed = SDL_TRUE;
-			list_changed = SDL_TRUE;
+			if ( SDL_timer_cond ) {
+				SDL_CondSignal(SDL_timer_cond);
+			}
 			break;
 		}
 	}
@@ -253,13 +380,15 @@ int SDL_SetTimer(Uint32 ms, SDL_TimerCallback callback)
 	}
 	if ( SDL_timer_running ) {	/* Stop any currently running timer */
 		if ( SDL_timer_threaded ) {
-			while ( SDL_timers ) {
-				SDL_TimerID freeme = SDL_timers;
-				SDL_timers = SDL_timers->next;
+			while ( SDL_timer_running ) {
+				SDL_TimerID freeme = SDL_timer_heap[--SDL_timer_running];
+				SDL_timer_heap[SDL_timer_running] = NULL;
 				SDL_free(freeme);
 			}
-			SDL_timer_running = 0;
-			list_changed = SDL_TRUE;
+			SDL_timer_current = NULL;
+			if ( SDL_timer_cond ) {
+				SDL_CondSignal(SDL_timer_cond);
+			}
 		} else {
 			SDL_SYS_StopTimer();
 			SDL_timer_running = 0;
@@ -44,3 +44,9 @@ extern void SDL_TimerQuit(void);
 
 /* This function is called from the SDL event thread if it is available */
 extern void SDL_ThreadedTimerCheck(void);
+
+/* Timer threads sleep in this until the next timer is due, and are woken
+   early by SDL_ThreadedTimerWake() or when timers are added or removed.
+ */
+extern void SDL_ThreadedTimerSleep(const int *alive);
+extern void SDL_ThreadedTimerWake(void);
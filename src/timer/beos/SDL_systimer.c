@@ -42,6 +42,18 @@ Uint32 SDL_GetTicks(void)
 	return((system_time()-start)/1000);
 }
 
+#ifdef SDL_HAS_64BIT_TYPE
+Uint64 SDL_GetPerformanceCounter(void)
+{
+	return(system_time());
+}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+{
+	return(1000000);
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 void SDL_Delay(Uint32 ms)
 {
 	snooze(ms*1000);
@@ -57,7 +69,7 @@ static int RunTimer(void *unused)
 		if ( SDL_timer_running ) {
 			SDL_ThreadedTimerCheck();
 		}
-		SDL_Delay(10);
+		SDL_ThreadedTimerSleep(&timer_alive);
 	}
 	return(0);
 }
@@ -75,6 +87,7 @@ int SDL_SYS_TimerInit(void)
 void SDL_SYS_TimerQuit(void)
 {
 	timer_alive = 0;
+	SDL_ThreadedTimerWake();
 	if ( timer ) {
 		SDL_WaitThread(timer, NULL);
 		timer = NULL;
@@ -47,6 +47,19 @@ Uint32 SDL_GetTicks(void)
 	return((jiffies-start)*1000/HZ);
 }
 
+#ifdef SDL_HAS_64BIT_TYPE
+/* There's no finer clock here, so count milliseconds */
+Uint64 SDL_GetPerformanceCounter(void)
+{
+	return(SDL_GetTicks());
+}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+{
+	return(1000);
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 void SDL_Delay(Uint32 ms)
 {
 	thd_sleep(ms);
@@ -62,7 +75,7 @@ static int RunTimer(void *unused)
 		if ( SDL_timer_running ) {
 			SDL_ThreadedTimerCheck();
 		}
-		SDL_Delay(10);
+		SDL_ThreadedTimerSleep(&timer_alive);
 	}
 	return(0);
 }
@@ -80,6 +93,7 @@ int SDL_SYS_TimerInit(void)
 void SDL_SYS_TimerQuit(void)
 {
 	timer_alive = 0;
+	SDL_ThreadedTimerWake();
 	if ( timer ) {
 		SDL_WaitThread(timer, NULL);
 		timer = NULL;
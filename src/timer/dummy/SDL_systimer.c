@@ -36,6 +36,19 @@ Uint32 SDL_GetTicks (void)
 	return 0;
 }
 
+#ifdef SDL_HAS_64BIT_TYPE
+/* There's no finer clock here, so count milliseconds */
+Uint64 SDL_GetPerformanceCounter(void)
+{
+	return(SDL_GetTicks());
+}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+{
+	return(1000);
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 void SDL_Delay (Uint32 ms)
 {
 	SDL_Unsupported();
@@ -53,7 +66,7 @@ static int RunTimer(void *unused)
 		if ( SDL_timer_running ) {
 			SDL_ThreadedTimerCheck();
 		}
-		SDL_Delay(1);
+		SDL_ThreadedTimerSleep(&timer_alive);
 	}
 	return(0);
 }
@@ -71,6 +84,7 @@ int SDL_SYS_TimerInit(void)
 void SDL_SYS_TimerQuit(void)
 {
 	timer_alive = 0;
+	SDL_ThreadedTimerWake();
 	if ( timer ) {
 		SDL_WaitThread(timer, NULL);
 		timer = NULL;
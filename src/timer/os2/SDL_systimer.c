@@ -90,6 +90,19 @@ DECLSPEC Uint32 SDLCALL SDL_GetTicks(void)
 
 }
 
+#ifdef SDL_HAS_64BIT_TYPE
+/* There's no finer clock here, so count milliseconds */
+DECLSPEC Uint64 SDLCALL SDL_GetPerformanceCounter(void)
+{
+        return(SDL_GetTicks());
+}
+
+DECLSPEC Uint64 SDLCALL SDL_GetPerformanceFrequency(void)
+{
+        return(1000);
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 /* High resolution sleep, originally made by Ilya Zakharevich */
 DECLSPEC void SDLCALL SDL_Delay(Uint32 ms)
 {
@@ -189,7 +202,7 @@ static int SDLCALL RunTimer(void *unused)
                 if ( SDL_timer_running ) {
                         SDL_ThreadedTimerCheck();
                 }
-                SDL_Delay(10);
+                SDL_ThreadedTimerSleep(&timer_alive);
         }
         return(0);
 }
@@ -207,6 +220,7 @@ int SDL_SYS_TimerInit(void)
 void SDL_SYS_TimerQuit(void)
 {
         timer_alive = 0;
+        SDL_ThreadedTimerWake();
         if ( timer ) {
                 SDL_WaitThread(timer, NULL);
                 timer = NULL;
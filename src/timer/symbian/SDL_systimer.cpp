@@ -56,6 +56,19 @@ Uint32 SDL_GetTicks(void)
 	return(deltaTics * tickPeriodMilliSeconds); 
 	}
 
+#ifdef SDL_HAS_64BIT_TYPE
+/* There's no finer clock here, so count milliseconds */
+Uint64 SDL_GetPerformanceCounter(void)
+	{
+	return(SDL_GetTicks());
+	}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+	{
+	return(1000);
+	}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 void SDL_Delay(Uint32 ms)
 	{     
     User::After(TTimeIntervalMicroSeconds32(ms*1000));
@@ -85,6 +85,30 @@ Uint32 SDL_GetTicks (void)
 #endif
 }
 
+#ifdef SDL_HAS_64BIT_TYPE
+Uint64 SDL_GetPerformanceCounter (void)
+{
+#if HAVE_CLOCK_GETTIME
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return((Uint64)now.tv_sec*1000000000 + now.tv_nsec);
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return((Uint64)now.tv_sec*1000000 + now.tv_usec);
+#endif
+}
+
+Uint64 SDL_GetPerformanceFrequency (void)
+{
+#if HAVE_CLOCK_GETTIME
+	return(1000000000);
+#else
+	return(1000000);
+#endif
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 void SDL_Delay (Uint32 ms)
 {
 #if SDL_THREAD_PTH
@@ -200,7 +224,7 @@ static int RunTimer(void *unused)
 		if ( SDL_timer_running ) {
 			SDL_ThreadedTimerCheck();
 		}
-		SDL_Delay(1);
+		SDL_ThreadedTimerSleep(&timer_alive);
 	}
 	return(0);
 }
@@ -218,6 +242,7 @@ int SDL_SYS_TimerInit(void)
 void SDL_SYS_TimerQuit(void)
 {
 	timer_alive = 0;
+	SDL_ThreadedTimerWake();
 	if ( timer ) {
 		SDL_WaitThread(timer, NULL);
 		timer = NULL;
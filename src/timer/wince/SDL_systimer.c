@@ -79,6 +79,19 @@ Uint32 SDL_GetTicks()
   return((Uint32)wce_rel_ticks());
 }
 
+#ifdef SDL_HAS_64BIT_TYPE
+/* There's no finer clock here, so count milliseconds */
+Uint64 SDL_GetPerformanceCounter(void)
+{
+	return(SDL_GetTicks());
+}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+{
+	return(1000);
+}
+#endif /* SDL_HAS_64BIT_TYPE */
+
 /* Give up approx. givem milliseconds to the OS. */
 void SDL_Delay(Uint32 ms)
 {
@@ -1592,13 +1592,6 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 #undef ADD_OPAQUE_COUNTS
 #undef ADD_TRANSL_COUNTS
 
-    /* Now that we have it encoded, release the original pixels */
-    if((surface->flags & SDL_PREALLOC) != SDL_PREALLOC
-       && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	SDL_free( surface->pixels );
-	surface->pixels = NULL;
-    }
-
     /* realloc the buffer to release unused memory */
     {
 	Uint8 *p = SDL_realloc(rlebuf, dst - rlebuf);
@@ -1749,13 +1742,6 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 
 #undef ADD_COUNTS
 
-	/* Now that we have it encoded, release the original pixels */
-	if((surface->flags & SDL_PREALLOC) != SDL_PREALLOC
-	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	    SDL_free( surface->pixels );
-	    surface->pixels = NULL;
-	}
-
 	/* realloc the buffer to release unused memory */
 	{
 	    /* If realloc returns NULL, the original block is left intact */
@@ -1768,13 +1754,63 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 	return(0);
 }
 
+/*
+ * Look for an encoding made earlier for the destination format, and make
+ * it the current one.  Colorkey encodings are in the format of the source,
+ * so there is only ever one of those.
+ */
+static SDL_bool FindRLECache(SDL_Surface *surface)
+{
+    SDL_BlitMap *map = surface->map;
+    SDL_PixelFormat *df;
+    void *rle;
+    int i;
+
+    if(!map->dst)
+	return SDL_FALSE;
+    df = map->dst->format;
+    for(i = 0; i < map->rle_cached; i++) {
+	rle = map->rle_cache[i];
+	if((surface->flags & SDL_SRCCOLORKEY) != SDL_SRCCOLORKEY) {
+	    RLEDestFormat *r = (RLEDestFormat *)rle;
+	    if(r->BytesPerPixel != df->BytesPerPixel
+	       || r->Rmask != df->Rmask
+	       || r->Gmask != df->Gmask
+	       || r->Bmask != df->Bmask)
+		continue;
+	}
+	/* move it to the front */
+	SDL_memmove(&map->rle_cache[1], &map->rle_cache[0],
+		    i * sizeof(map->rle_cache[0]));
+	map->rle_cache[0] = rle;
+	map->sw_data->aux_data = rle;
+	return SDL_TRUE;
+    }
+    return SDL_FALSE;
+}
+
+/* Keep the current encoding, dropping the least recently used if full */
+static void AddRLECache(SDL_Surface *surface)
+{
+    SDL_BlitMap *map = surface->map;
+
+    if(map->rle_cached == RLE_CACHE_SIZE) {
+	SDL_free(map->rle_cache[--map->rle_cached]);
+    }
+    SDL_memmove(&map->rle_cache[1], &map->rle_cache[0],
+		map->rle_cached * sizeof(map->rle_cache[0]));
+    map->rle_cache[0] = map->sw_data->aux_data;
+    if(++map->rle_cached > 1)
+	map->rle_keep_pixels = 1;
+}
+
 int SDL_RLESurface(SDL_Surface *surface)
 {
 	int retcode;
 
-	/* Clear any previous RLE conversion */
+	/* Put aside any previous RLE conversion */
 	if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
-		SDL_UnRLESurface(surface, 1);
+		SDL_SuspendRLESurface(surface);
 	}
 
 	/* We don't support RLE encoding of bitmaps */
@@ -1782,6 +1818,12 @@ int SDL_RLESurface(SDL_Surface *surface)
 		return(-1);
 	}
 
+	/* Reuse an encoding for this destination format, if there is one */
+	if ( FindRLECache(surface) ) {
+		surface->flags |= SDL_RLEACCEL;
+		return(0);
+	}
+
 	/* Lock the surface if it's in hardware */
 	if ( SDL_MUSTLOCK(surface) ) {
 		if ( SDL_LockSurface(surface) < 0 ) {
@@ -1808,6 +1850,16 @@ int SDL_RLESurface(SDL_Surface *surface)
 	if(retcode < 0)
 	    return -1;
 
+	/* Now that we have it encoded, release the original pixels, unless
+	   they're kept for encoding for other destination formats */
+	if(surface->map->rle_cached == 0 && !surface->map->rle_keep_pixels
+	   && (surface->flags & SDL_PREALLOC) != SDL_PREALLOC
+	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
+	    SDL_free( surface->pixels );
+	    surface->pixels = NULL;
+	}
+	AddRLECache(surface);
+
 	/* The surface is now accelerated */
 	surface->flags |= SDL_RLEACCEL;
 
@@ -1892,49 +1944,81 @@ static SDL_bool UnRLEAlpha(SDL_Surface *surface)
     return(SDL_TRUE);
 }
 
+/* Re-create the original pixels, if they were released after encoding */
+static SDL_bool UnRLEPixels(SDL_Surface *surface)
+{
+    if(surface->pixels
+       || (surface->flags & SDL_PREALLOC) == SDL_PREALLOC
+       || (surface->flags & SDL_HWSURFACE) == SDL_HWSURFACE)
+	return(SDL_TRUE);
+
+    if((surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY) {
+	SDL_Rect full;
+	unsigned alpha_flag;
+
+	/* re-create the original surface */
+	surface->pixels = SDL_malloc(surface->h * surface->pitch);
+	if ( !surface->pixels ) {
+		return(SDL_FALSE);
+	}
+
+	/* fill it with the background colour */
+	SDL_FillRect(surface, NULL, surface->format->colorkey);
+
+	/* now render the encoded surface */
+	full.x = full.y = 0;
+	full.w = surface->w;
+	full.h = surface->h;
+	alpha_flag = surface->flags & SDL_SRCALPHA;
+	surface->flags &= ~SDL_SRCALPHA; /* opaque blit */
+	SDL_RLEBlit(surface, &full, surface, &full);
+	surface->flags |= alpha_flag;
+	return(SDL_TRUE);
+    }
+    return UnRLEAlpha(surface);
+}
+
 void SDL_UnRLESurface(SDL_Surface *surface, int recode)
 {
+    int i;
+
     if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
 	surface->flags &= ~SDL_RLEACCEL;
 
-	if(recode && (surface->flags & SDL_PREALLOC) != SDL_PREALLOC
-	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	    if((surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY) {
-		SDL_Rect full;
-		unsigned alpha_flag;
-
-		/* re-create the original surface */
-		surface->pixels = SDL_malloc(surface->h * surface->pitch);
-		if ( !surface->pixels ) {
-			/* Oh crap... */
-			surface->flags |= SDL_RLEACCEL;
-			return;
-		}
+	if ( recode && !UnRLEPixels(surface) ) {
+	    /* Oh crap... */
+	    surface->flags |= SDL_RLEACCEL;
+	    return;
+	}
+    }
 
-		/* fill it with the background colour */
-		SDL_FillRect(surface, NULL, surface->format->colorkey);
-
-		/* now render the encoded surface */
-		full.x = full.y = 0;
-		full.w = surface->w;
-		full.h = surface->h;
-		alpha_flag = surface->flags & SDL_SRCALPHA;
-		surface->flags &= ~SDL_SRCALPHA; /* opaque blit */
-		SDL_RLEBlit(surface, &full, surface, &full);
-		surface->flags |= alpha_flag;
-	    } else {
-		if ( !UnRLEAlpha(surface) ) {
-		    /* Oh crap... */
-		    surface->flags |= SDL_RLEACCEL;
-		    return;
-		}
-	    }
+    /* The pixels may be about to change, so no encoding is kept */
+    if ( surface->map ) {
+	for ( i = 0; i < surface->map->rle_cached; ++i ) {
+	    SDL_free(surface->map->rle_cache[i]);
 	}
+	surface->map->rle_cached = 0;
+	surface->map->sw_data->aux_data = NULL;
+    }
+}
+
+/*
+ * Stop using the encoding for the current destination, but keep it for
+ * when the surface is blitted to that format again.  The encodings are
+ * only kept while the surface stays RLE accelerated, since until then
+ * its pixels can't change without locking it.
+ */
+void SDL_SuspendRLESurface(SDL_Surface *surface)
+{
+    if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
+	surface->flags &= ~SDL_RLEACCEL;
 
-	if ( surface->map && surface->map->sw_data->aux_data ) {
-	    SDL_free(surface->map->sw_data->aux_data);
-	    surface->map->sw_data->aux_data = NULL;
+	if ( !UnRLEPixels(surface) ) {
+	    /* Oh crap... */
+	    surface->flags |= SDL_RLEACCEL;
+	    return;
 	}
+	surface->map->sw_data->aux_data = NULL;
     }
 }
 
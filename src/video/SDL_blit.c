@@ -22,10 +22,13 @@
 #include "SDL_config.h"
 
 #include "SDL_video.h"
+#include "SDL_thread.h"
+#include "SDL_timer.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
 #include "SDL_RLEaccel_c.h"
 #include "SDL_pixels_c.h"
+#include "../thread/SDL_atomic_c.h"
 
 #if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && SDL_ASSEMBLY_ROUTINES
 #define MMX_ASMBLIT
@@ -39,6 +42,200 @@
 #include "mmx.h"
 #endif
 
+/*
+ * Large software blits can be split into bands of rows and run on a
+ * persistent pool of worker threads.  This is opt-in, by setting the
+ * SDL_VIDEO_BLIT_THREADS environment variable to the number of threads
+ * (including the calling one) that should share the work.
+ */
+#define MAX_BLIT_THREADS	16
+#define MIN_THREADED_BLIT	(256*1024)	/* pixels */
+#define MIN_BLIT_BAND		16		/* rows */
+
+typedef struct {
+	SDL_loblit RunBlit;
+	SDL_BlitInfo info;
+	SDL_sem *work;
+} SDL_BlitBand;
+
+static struct {
+	volatile int initialized;
+	int numthreads;
+	int quit;
+	SDL_mutex *lock;
+	SDL_sem *done;
+	SDL_Thread *threads[MAX_BLIT_THREADS];
+	SDL_BlitBand bands[MAX_BLIT_THREADS];
+} SDL_BlitPool;
+#if SDL_HAVE_ATOMICS
+static volatile int SDL_BlitPoolStarting;
+#endif
+
+static void SDL_BlitCopyOverlap(SDL_BlitInfo *info);
+
+static int SDLCALL SDL_BlitThread(void *data)
+{
+	SDL_BlitBand *band = (SDL_BlitBand *)data;
+
+	for ( ; ; ) {
+		SDL_SemWait(band->work);
+		if ( SDL_BlitPool.quit ) {
+			break;
+		}
+		band->RunBlit(&band->info);
+		SDL_SemPost(SDL_BlitPool.done);
+	}
+	return(0);
+}
+
+static void SDL_StartBlitThreads(void)
+{
+	const char *env;
+	int i, numthreads;
+
+#if SDL_HAVE_ATOMICS
+	/* Only one thread gets to start them */
+	while ( !SDL_AtomicCAS(&SDL_BlitPoolStarting, 0, 1) ) {
+		SDL_Delay(0);
+	}
+	if ( SDL_BlitPool.initialized ) {
+		SDL_AtomicSet(&SDL_BlitPoolStarting, 0);
+		return;
+	}
+#endif
+	env = SDL_getenv("SDL_VIDEO_BLIT_THREADS");
+	numthreads = env ? SDL_atoi(env) : 0;
+	if ( numthreads > MAX_BLIT_THREADS ) {
+		numthreads = MAX_BLIT_THREADS;
+	}
+
+	/* The calling thread runs the first band itself */
+	SDL_BlitPool.quit = 0;
+	i = 1;
+	if ( numthreads > 1 ) {
+		SDL_BlitPool.lock = SDL_CreateMutex();
+		SDL_BlitPool.done = SDL_CreateSemaphore(0);
+	}
+	if ( SDL_BlitPool.lock && SDL_BlitPool.done ) {
+		for ( ; i < numthreads; ++i ) {
+			SDL_BlitBand *band = &SDL_BlitPool.bands[i];
+
+			band->work = SDL_CreateSemaphore(0);
+			if ( band->work == NULL ) {
+				break;
+			}
+			SDL_BlitPool.threads[i] = SDL_CreateThread(SDL_BlitThread, band);
+			if ( SDL_BlitPool.threads[i] == NULL ) {
+				SDL_DestroySemaphore(band->work);
+				band->work = NULL;
+				break;
+			}
+		}
+	}
+	SDL_BlitPool.numthreads = i;
+
+	/* Blits on other threads can use the pool once this is set */
+#if SDL_HAVE_ATOMICS
+	SDL_AtomicSet(&SDL_BlitPool.initialized, 1);
+	SDL_AtomicSet(&SDL_BlitPoolStarting, 0);
+#else
+	SDL_BlitPool.initialized = 1;
+#endif
+}
+
+/* Without atomic operations nothing keeps two blits from starting the
+   pool at once, so it's started from SDL_Init() and SDL_VideoInit(),
+   before the application has other threads blitting.
+ */
+void SDL_InitBlitThreads(void)
+{
+#if !SDL_HAVE_ATOMICS
+	if ( ! SDL_BlitPool.initialized ) {
+		SDL_StartBlitThreads();
+	}
+#endif
+}
+
+/* This is called by both SDL_VideoQuit() and SDL_Quit() */
+void SDL_QuitBlitThreads(void)
+{
+	int i;
+
+	SDL_BlitPool.quit = 1;
+	for ( i = 1; i < SDL_BlitPool.numthreads; ++i ) {
+		SDL_SemPost(SDL_BlitPool.bands[i].work);
+		SDL_WaitThread(SDL_BlitPool.threads[i], NULL);
+		SDL_BlitPool.threads[i] = NULL;
+		SDL_DestroySemaphore(SDL_BlitPool.bands[i].work);
+		SDL_BlitPool.bands[i].work = NULL;
+	}
+	if ( SDL_BlitPool.done ) {
+		SDL_DestroySemaphore(SDL_BlitPool.done);
+		SDL_BlitPool.done = NULL;
+	}
+	if ( SDL_BlitPool.lock ) {
+		SDL_DestroyMutex(SDL_BlitPool.lock);
+		SDL_BlitPool.lock = NULL;
+	}
+	SDL_BlitPool.numthreads = 0;
+	SDL_BlitPool.initialized = 0;
+}
+
+/* Run a blit as bands of rows across the blit threads, if worthwhile */
+static int SDL_RunThreadedBlit(SDL_loblit RunBlit, SDL_BlitInfo *info,
+                               int srcpitch, int dstpitch)
+{
+	int i, numbands, row, rows, extra;
+
+	/* Overlapping copies depend on the order rows are written in */
+	if ( RunBlit == SDL_BlitCopyOverlap ) {
+		return(0);
+	}
+	if ( (info->d_width * info->d_height) < MIN_THREADED_BLIT ) {
+		return(0);
+	}
+#if SDL_HAVE_ATOMICS
+	if ( ! SDL_AtomicGet(&SDL_BlitPool.initialized) ) {
+#else
+	if ( ! SDL_BlitPool.initialized ) {
+#endif
+		SDL_StartBlitThreads();
+	}
+	numbands = SDL_BlitPool.numthreads;
+	if ( numbands > (info->d_height / MIN_BLIT_BAND) ) {
+		numbands = info->d_height / MIN_BLIT_BAND;
+	}
+	if ( numbands <= 1 ) {
+		return(0);
+	}
+
+	/* One threaded blit at a time, since the bands live in the pool */
+	SDL_mutexP(SDL_BlitPool.lock);
+	rows = info->d_height / numbands;
+	extra = info->d_height % numbands;
+	row = 0;
+	for ( i = 0; i < numbands; ++i ) {
+		SDL_BlitBand *band = &SDL_BlitPool.bands[i];
+
+		band->RunBlit = RunBlit;
+		band->info = *info;
+		band->info.s_pixels += row * srcpitch;
+		band->info.d_pixels += row * dstpitch;
+		band->info.d_height = rows + (i < extra);
+		band->info.s_height = band->info.d_height;
+		row += band->info.d_height;
+		if ( i > 0 ) {
+			SDL_SemPost(band->work);
+		}
+	}
+	SDL_BlitPool.bands[0].RunBlit(&SDL_BlitPool.bands[0].info);
+	for ( i = 1; i < numbands; ++i ) {
+		SDL_SemWait(SDL_BlitPool.done);
+	}
+	SDL_mutexV(SDL_BlitPool.lock);
+	return(1);
+}
+
 /* The general purpose software blit routine */
 static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 			SDL_Surface *dst, SDL_Rect *dstrect)
@@ -93,8 +290,11 @@ static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		info.dst = dst->format;
 		RunBlit = src->map->sw_data->blit;
 
-		/* Run the actual software blit */
-		RunBlit(&info);
+		/* Run the actual software blit, threaded if it's big enough */
+		if ( ! SDL_RunThreadedBlit(RunBlit, &info,
+		                           src->pitch, dst->pitch) ) {
+			RunBlit(&info);
+		}
 	}
 
 	/* We need to unlock the surfaces if they're locked */
@@ -236,7 +436,7 @@ int SDL_CalculateBlit(SDL_Surface *surface)
 
 	/* Clean everything out to start */
 	if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
-		SDL_UnRLESurface(surface, 1);
+		SDL_SuspendRLESurface(surface);
 	}
 	surface->map->sw_blit = NULL;
 
@@ -332,6 +532,7 @@ int SDL_CalculateBlit(SDL_Surface *surface)
 	}
 	/* Make sure we have a blit function */
 	if ( surface->map->sw_data->blit == NULL ) {
+		SDL_UnRLESurface(surface, 1);
 		SDL_InvalidateMap(surface->map);
 		SDL_SetError("Blit combination not supported");
 		return(-1);
@@ -353,6 +554,8 @@ int SDL_CalculateBlit(SDL_Surface *surface)
 	}
 	
 	if ( surface->map->sw_blit == NULL ) {
+		/* Encodings kept for other destinations are no longer safe */
+		SDL_UnRLESurface(surface, 1);
 		surface->map->sw_blit = SDL_SoftBlit;
 	}
 	return(0);
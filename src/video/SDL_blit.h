@@ -51,6 +51,9 @@ struct private_swaccel {
 	void *aux_data;
 };
 
+/* The number of RLE encodings kept for different destination formats */
+#define RLE_CACHE_SIZE	4
+
 /* Blit mapping definition */
 typedef struct SDL_BlitMap {
 	SDL_Surface *dst;
@@ -64,11 +67,21 @@ typedef struct SDL_BlitMap {
 	/* the version count matches the destination; mismatch indicates
 	   an invalid mapping */
         unsigned int format_version;
+
+	/* RLE encodings of the source for each destination format it has
+	   been blitted to, most recently used first */
+	void *rle_cache[RLE_CACHE_SIZE];
+	int rle_cached;
+	/* set once the source has been encoded for more than one format,
+	   since un-encoding may lose some of the colour depth */
+	int rle_keep_pixels;
 } SDL_BlitMap;
 
 
 /* Functions found in SDL_blit.c */
 extern int SDL_CalculateBlit(SDL_Surface *surface);
+extern void SDL_InitBlitThreads(void);
+extern void SDL_QuitBlitThreads(void);
 
 /* Functions found in SDL_blit_{0,1,N,A}.c */
 extern SDL_loblit SDL_CalculateBlit0(SDL_Surface *surface, int complex);
@@ -59,6 +59,7 @@
 #include <mmintrin.h>
 #include <mm3dnow.h>
 #endif
+#include "../cpuinfo/SDL_simd.h"
 
 /* Functions to perform alpha blended blitting */
 
@@ -1573,6 +1574,195 @@ static void BlitRGBtoRGBPixelAlpha(SDL_BlitInfo *info)
 	}
 }
 
+#if SDL_SSE2_INTRINSICS
+/*
+ * Blend up to four ARGB888 pixels held in the 32-bit lanes of s and d.
+ * This is the same arithmetic as BlitRGBtoRGBPixelAlphaMMX, two pixels
+ * per 16-bit unpack: d + ((s - d) * alpha >> 8) for each colour channel,
+ * with the destination alpha kept and opaque pixels copied exactly.
+ */
+static __inline__ __m128i BlendPixelAlphaSSE2(__m128i s, __m128i d,
+		__m128i chanmask, __m128i multmask, __m128i opaque, int ashift)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i alpha, alo, ahi, slo, shi, dlo, dhi, isopaque, copy;
+
+	/* 000A per pixel -> 0A0A per pixel -> 0A0A0A0A per 16-bit unpack */
+	alpha = _mm_and_si128(_mm_srli_epi32(s, ashift), _mm_set1_epi32(0xff));
+	isopaque = _mm_cmpeq_epi32(alpha, opaque);
+	alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+	alo = _mm_and_si128(_mm_unpacklo_epi32(alpha, alpha), multmask);
+	ahi = _mm_and_si128(_mm_unpackhi_epi32(alpha, alpha), multmask);
+
+	slo = _mm_unpacklo_epi8(s, zero);
+	shi = _mm_unpackhi_epi8(s, zero);
+	dlo = _mm_unpacklo_epi8(d, zero);
+	dhi = _mm_unpackhi_epi8(d, zero);
+
+	slo = _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(slo, dlo), alo), 8);
+	shi = _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(shi, dhi), ahi), 8);
+	dlo = _mm_add_epi8(slo, dlo);
+	dhi = _mm_add_epi8(shi, dhi);
+	d = _mm_packus_epi16(_mm_and_si128(dlo, _mm_set1_epi16(0xff)),
+	                     _mm_and_si128(dhi, _mm_set1_epi16(0xff)));
+
+	/* opaque alpha -- copy RGB, keep dst alpha */
+	copy = _mm_or_si128(_mm_and_si128(s, chanmask),
+	                    _mm_andnot_si128(chanmask, d));
+	return _mm_or_si128(_mm_and_si128(isopaque, copy),
+	                    _mm_andnot_si128(isopaque, d));
+}
+
+/* fast ARGB888->(A)RGB888 blending with pixel alpha, four pixels at a time */
+static void BlitRGBtoRGBPixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	SDL_PixelFormat* sf = info->src;
+	int ashift = sf->Ashift;
+	Uint64 multmask64 = ~((Uint64)0xffff << (ashift * 2));
+	Uint32 multlo = (Uint32)multmask64;
+	Uint32 multhi = (Uint32)(multmask64 >> 32);
+	__m128i chanmask = _mm_set1_epi32(sf->Rmask | sf->Gmask | sf->Bmask);
+	__m128i amask = _mm_set1_epi32(sf->Amask);
+	__m128i multmask = _mm_set_epi32(multhi, multlo, multhi, multlo);
+	__m128i opaque = _mm_set1_epi32(0xff);
+
+	while(height--) {
+		int n = width;
+		while(n >= 4) {
+			__m128i s = _mm_loadu_si128((__m128i *)srcp);
+			int alphas = _mm_movemask_epi8(
+				_mm_cmpeq_epi32(_mm_and_si128(s, amask), amask));
+			if(alphas == 0xffff) {
+				/* all opaque -- copy RGB, keep dst alpha */
+				__m128i d = _mm_loadu_si128((__m128i *)dstp);
+				d = _mm_or_si128(_mm_and_si128(s, chanmask),
+				                 _mm_andnot_si128(chanmask, d));
+				_mm_storeu_si128((__m128i *)dstp, d);
+			} else if(_mm_movemask_epi8(_mm_cmpeq_epi32(
+				_mm_and_si128(s, amask), _mm_setzero_si128())) != 0xffff) {
+				__m128i d = _mm_loadu_si128((__m128i *)dstp);
+				d = BlendPixelAlphaSSE2(s, d, chanmask, multmask,
+				                        opaque, ashift);
+				_mm_storeu_si128((__m128i *)dstp, d);
+			}
+			srcp += 4;
+			dstp += 4;
+			n -= 4;
+		}
+		while(n--) {
+			if(*srcp & sf->Amask) {
+				__m128i s = _mm_cvtsi32_si128(*srcp);
+				__m128i d = _mm_cvtsi32_si128(*dstp);
+				d = BlendPixelAlphaSSE2(s, d, chanmask, multmask,
+				                        opaque, ashift);
+				*dstp = _mm_cvtsi128_si32(d);
+			}
+			++srcp;
+			++dstp;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if SDL_AVX2_INTRINSICS
+/* fast ARGB888->(A)RGB888 blending with pixel alpha, eight pixels at a time */
+SDL_TARGETING_AVX2
+static void BlitRGBtoRGBPixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	SDL_PixelFormat* sf = info->src;
+	int ashift = sf->Ashift;
+	Uint64 multmask64 = ~((Uint64)0xffff << (ashift * 2));
+	Uint32 multlo = (Uint32)multmask64;
+	Uint32 multhi = (Uint32)(multmask64 >> 32);
+	__m256i chanmask = _mm256_set1_epi32(sf->Rmask | sf->Gmask | sf->Bmask);
+	__m256i amask = _mm256_set1_epi32(sf->Amask);
+	__m256i multmask = _mm256_set_epi32(multhi, multlo, multhi, multlo,
+	                                    multhi, multlo, multhi, multlo);
+	__m256i zero = _mm256_setzero_si256();
+	__m256i bytemask = _mm256_set1_epi16(0xff);
+	__m256i opaque = _mm256_set1_epi32(0xff);
+	__m128i chanmask4 = _mm_set1_epi32(sf->Rmask | sf->Gmask | sf->Bmask);
+	__m128i multmask4 = _mm_set_epi32(multhi, multlo, multhi, multlo);
+	__m128i opaque4 = _mm_set1_epi32(0xff);
+
+	while(height--) {
+		int n = width;
+		while(n >= 8) {
+			__m256i s = _mm256_loadu_si256((__m256i *)srcp);
+			__m256i a = _mm256_and_si256(s, amask);
+			if((Uint32)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi32(a, amask)) == 0xffffffff) {
+				/* all opaque -- copy RGB, keep dst alpha */
+				__m256i d = _mm256_loadu_si256((__m256i *)dstp);
+				d = _mm256_or_si256(_mm256_and_si256(s, chanmask),
+				                    _mm256_andnot_si256(chanmask, d));
+				_mm256_storeu_si256((__m256i *)dstp, d);
+			} else if((Uint32)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi32(a, zero)) != 0xffffffff) {
+				/* Unpacks work per 128-bit lane, which is harmless
+				   here since the packs undo them the same way */
+				__m256i d = _mm256_loadu_si256((__m256i *)dstp);
+				__m256i alpha, alo, ahi, slo, shi, dlo, dhi;
+				__m256i isopaque, copy;
+
+				alpha = _mm256_and_si256(_mm256_srli_epi32(s, ashift), opaque);
+				isopaque = _mm256_cmpeq_epi32(alpha, opaque);
+				alpha = _mm256_or_si256(alpha, _mm256_slli_epi32(alpha, 16));
+				alo = _mm256_and_si256(_mm256_unpacklo_epi32(alpha, alpha), multmask);
+				ahi = _mm256_and_si256(_mm256_unpackhi_epi32(alpha, alpha), multmask);
+
+				slo = _mm256_unpacklo_epi8(s, zero);
+				shi = _mm256_unpackhi_epi8(s, zero);
+				dlo = _mm256_unpacklo_epi8(d, zero);
+				dhi = _mm256_unpackhi_epi8(d, zero);
+
+				slo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(slo, dlo), alo), 8);
+				shi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(shi, dhi), ahi), 8);
+				dlo = _mm256_and_si256(_mm256_add_epi8(slo, dlo), bytemask);
+				dhi = _mm256_and_si256(_mm256_add_epi8(shi, dhi), bytemask);
+				d = _mm256_packus_epi16(dlo, dhi);
+
+				copy = _mm256_or_si256(_mm256_and_si256(s, chanmask),
+				                       _mm256_andnot_si256(chanmask, d));
+				d = _mm256_or_si256(_mm256_and_si256(isopaque, copy),
+				                    _mm256_andnot_si256(isopaque, d));
+				_mm256_storeu_si256((__m256i *)dstp, d);
+			}
+			srcp += 8;
+			dstp += 8;
+			n -= 8;
+		}
+		while(n--) {
+			if(*srcp & sf->Amask) {
+				__m128i s = _mm_cvtsi32_si128(*srcp);
+				__m128i d = _mm_cvtsi32_si128(*dstp);
+				d = BlendPixelAlphaSSE2(s, d, chanmask4, multmask4,
+				                        opaque4, ashift);
+				*dstp = _mm_cvtsi128_si32(d);
+			}
+			++srcp;
+			++dstp;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+#endif /* SDL_AVX2_INTRINSICS */
+
 #if GCC_ASMBLIT
 /* fast (as in MMX with prefetch) ARGB888->(A)RGB888 blending with pixel alpha */
 static void BlitRGBtoRGBPixelAlphaMMX3DNOW(SDL_BlitInfo *info)
@@ -2833,6 +3023,21 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	       && sf->Bmask == df->Bmask
 	       && sf->BytesPerPixel == 4)
 	    {
+#if SDL_SSE2_INTRINSICS
+		if(sf->Rshift % 8 == 0
+		   && sf->Gshift % 8 == 0
+		   && sf->Bshift % 8 == 0
+		   && sf->Ashift % 8 == 0
+		   && sf->Aloss == 0)
+		{
+#if SDL_AVX2_INTRINSICS
+			if(SDL_HasAVX2())
+				return BlitRGBtoRGBPixelAlphaAVX2;
+#endif
+			if(SDL_HasSSE2())
+				return BlitRGBtoRGBPixelAlphaSSE2;
+		}
+#endif
 #if MMX_ASMBLIT
 		if(sf->Rshift % 8 == 0
 		   && sf->Gshift % 8 == 0
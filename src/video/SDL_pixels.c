@@ -25,10 +25,284 @@
 
 #include "SDL_endian.h"
 #include "SDL_video.h"
+#include "SDL_timer.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
 #include "SDL_pixels_c.h"
 #include "SDL_RLEaccel_c.h"
+#include "../thread/SDL_atomic_c.h"
+
+/*
+ * Palettes allocated here get a cache to speed up SDL_FindColor().  The
+ * RGB cube is split into 8x8x8 cells, and each cell lists the colors that
+ * could be the nearest to some point in it: those no farther from the
+ * cell than the farthest point of the cell is from the color that's best
+ * for the worst case.  A lookup then only needs to check the few colors
+ * listed for its cell.  The lists are made the first time a color in the
+ * cell is looked up, and thrown away whenever the palette changes through
+ * SDL_SetPalette(), which calls SDL_FormatChanged().  Lookups notice a
+ * palette given new colors or a new size directly, and blits mapped to a
+ * palette compare it with a copy taken when the lists were started, so
+ * they notice colors written directly as well.
+ *
+ * The caches are found by palette, and shared by every thread, so each
+ * bucket of them has its own spinlock.  Without atomic operations there
+ * are no caches, unless there are no threads either.
+ */
+#if SDL_HAVE_ATOMICS
+#define PALETTE_CACHES		1
+#define LOCK_PALETTES(pal) \
+	while ( !SDL_AtomicCAS(&SDL_PaletteCaches.locks[PALETTE_BUCKET(pal)], 0, 1) ) { \
+		SDL_Delay(0); \
+	}
+#define UNLOCK_PALETTES(pal) \
+	SDL_AtomicSet(&SDL_PaletteCaches.locks[PALETTE_BUCKET(pal)], 0);
+#elif SDL_THREADS_DISABLED
+#define PALETTE_CACHES		1
+#define LOCK_PALETTES(pal)
+#define UNLOCK_PALETTES(pal)
+#else
+#define PALETTE_CACHES		0
+#endif
+
+#if PALETTE_CACHES
+#define PALETTE_BUCKETS		64
+#define PALETTE_CELL_BITS	3
+#define PALETTE_CELLS		(1<<(3*PALETTE_CELL_BITS))
+#define PALETTE_CELL_SIZE	(256>>PALETTE_CELL_BITS)
+
+typedef struct SDL_PaletteCache {
+	SDL_Palette *palette;
+	int valid;
+	SDL_Color *colors;	/* The palette the lists were made for */
+	int ncolors;
+	SDL_Color copy[256];
+	Uint32 *cells;		/* Where each cell's list starts, and ... */
+	Uint16 *lengths;	/* ... how long it is, or 0 if not made yet */
+	Uint8 *lists;		/* All the lists */
+	Uint32 used;
+	Uint32 size;
+	struct SDL_PaletteCache *next;
+} SDL_PaletteCache;
+
+static struct {
+	volatile int locks[PALETTE_BUCKETS];
+	SDL_PaletteCache *buckets[PALETTE_BUCKETS];
+} SDL_PaletteCaches;
+
+#define PALETTE_BUCKET(pal) \
+	(((size_t)(pal) / sizeof(SDL_Palette)) % PALETTE_BUCKETS)
+
+/* Must be called with the palette's bucket locked */
+static SDL_PaletteCache **SDL_FindPaletteCache(SDL_Palette *pal)
+{
+	SDL_PaletteCache **cache;
+
+	cache = &SDL_PaletteCaches.buckets[PALETTE_BUCKET(pal)];
+	while ( *cache && (*cache)->palette != pal ) {
+		cache = &(*cache)->next;
+	}
+	return(cache);
+}
+
+static void SDL_AddPaletteCache(SDL_Palette *pal)
+{
+	SDL_PaletteCache *cache;
+
+	/* Without a cache, lookups just search the whole palette */
+	if ( pal->ncolors > 256 ) {
+		return;
+	}
+	cache = (SDL_PaletteCache *)SDL_malloc(sizeof(*cache));
+	if ( cache == NULL ) {
+		return;
+	}
+	SDL_memset(cache, 0, sizeof(*cache));
+	cache->palette = pal;
+	LOCK_PALETTES(pal);
+	cache->next = SDL_PaletteCaches.buckets[PALETTE_BUCKET(pal)];
+	SDL_PaletteCaches.buckets[PALETTE_BUCKET(pal)] = cache;
+	UNLOCK_PALETTES(pal);
+}
+
+static void SDL_RemovePaletteCache(SDL_Palette *pal)
+{
+	SDL_PaletteCache **link, *cache;
+
+	LOCK_PALETTES(pal);
+	link = SDL_FindPaletteCache(pal);
+	cache = *link;
+	if ( cache ) {
+		*link = cache->next;
+	}
+	UNLOCK_PALETTES(pal);
+	if ( cache ) {
+		if ( cache->cells ) {
+			SDL_free(cache->cells);
+		}
+		if ( cache->lists ) {
+			SDL_free(cache->lists);
+		}
+		SDL_free(cache);
+	}
+}
+
+static void SDL_InvalidatePaletteCache(SDL_Palette *pal)
+{
+	SDL_PaletteCache *cache;
+
+	LOCK_PALETTES(pal);
+	cache = *SDL_FindPaletteCache(pal);
+	if ( cache ) {
+		cache->valid = 0;
+	}
+	UNLOCK_PALETTES(pal);
+}
+
+/* Throw away the cache if the palette's colors were written directly */
+static void SDL_CheckPaletteCache(SDL_Palette *pal)
+{
+	SDL_PaletteCache *cache;
+
+	LOCK_PALETTES(pal);
+	cache = *SDL_FindPaletteCache(pal);
+	if ( cache && cache->valid &&
+	     ((cache->colors != pal->colors) || (cache->ncolors != pal->ncolors) ||
+	      SDL_memcmp(cache->copy, pal->colors,
+	                 pal->ncolors * sizeof(SDL_Color)) != 0) ) {
+		cache->valid = 0;
+	}
+	UNLOCK_PALETTES(pal);
+}
+
+/* How far a color component is from the nearest and farthest point of
+   the cell that starts at 'lo', squared */
+#define CELL_DISTANCE(c, lo, near, far) \
+	do { \
+		int d0 = (c) - (lo); \
+		int d1 = (c) - ((lo) + PALETTE_CELL_SIZE-1); \
+		d0 *= d0; \
+		d1 *= d1; \
+		near += ((c) < (lo) || (c) > (lo)+PALETTE_CELL_SIZE-1) ? \
+		        SDL_min(d0, d1) : 0; \
+		far += SDL_max(d0, d1); \
+	} while ( 0 )
+
+/* Make the list of colors for a cell, in palette order */
+static int SDL_MakePaletteCell(SDL_PaletteCache *cache, int cell)
+{
+	SDL_Palette *pal = cache->palette;
+	unsigned int nearest[256];
+	unsigned int bound, farthest;
+	int rlo, glo, blo, i, n;
+
+	rlo = (cell >> (2*PALETTE_CELL_BITS)) * PALETTE_CELL_SIZE;
+	glo = ((cell >> PALETTE_CELL_BITS) & ((1<<PALETTE_CELL_BITS)-1)) *
+	      PALETTE_CELL_SIZE;
+	blo = (cell & ((1<<PALETTE_CELL_BITS)-1)) * PALETTE_CELL_SIZE;
+	bound = ~0;
+	for ( i=0; i<pal->ncolors; ++i ) {
+		SDL_Color *c = &pal->colors[i];
+		nearest[i] = farthest = 0;
+		CELL_DISTANCE(c->r, rlo, nearest[i], farthest);
+		CELL_DISTANCE(c->g, glo, nearest[i], farthest);
+		CELL_DISTANCE(c->b, blo, nearest[i], farthest);
+		if ( farthest < bound ) {
+			bound = farthest;
+		}
+	}
+
+	/* Make sure there's room for every color, then keep the close ones */
+	if ( cache->used + pal->ncolors > cache->size ) {
+		Uint32 size = SDL_max(cache->size * 2, cache->used + pal->ncolors);
+		Uint8 *lists = (Uint8 *)SDL_realloc(cache->lists, size);
+		if ( lists == NULL ) {
+			return(-1);
+		}
+		cache->lists = lists;
+		cache->size = size;
+	}
+	n = 0;
+	for ( i=0; i<pal->ncolors; ++i ) {
+		if ( nearest[i] <= bound ) {
+			cache->lists[cache->used + n++] = (Uint8)i;
+		}
+	}
+	cache->cells[cell] = cache->used;
+	cache->lengths[cell] = (Uint16)n;
+	cache->used += n;
+	return(0);
+}
+
+/* Return the palette's nearest color, or -1 if the palette has no cache */
+static int SDL_FindCachedColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
+{
+	SDL_PaletteCache *cache;
+	unsigned int smallest;
+	unsigned int distance;
+	int rd, gd, bd;
+	int cell, i, n;
+	Uint8 *list;
+	int pixel = -1;
+
+	cell = ((r >> (8-PALETTE_CELL_BITS)) << (2*PALETTE_CELL_BITS)) |
+	       ((g >> (8-PALETTE_CELL_BITS)) << PALETTE_CELL_BITS) |
+	       (b >> (8-PALETTE_CELL_BITS));
+	LOCK_PALETTES(pal);
+	cache = *SDL_FindPaletteCache(pal);
+	if ( cache && (pal->ncolors > 256) ) {
+		cache = NULL;
+	}
+	if ( cache && cache->valid &&
+	     ((cache->colors != pal->colors) || (cache->ncolors != pal->ncolors)) ) {
+		cache->valid = 0;
+	}
+	if ( cache && ! cache->valid ) {
+		if ( cache->cells == NULL ) {
+			cache->cells = (Uint32 *)SDL_malloc(PALETTE_CELLS *
+					(sizeof(Uint32) + sizeof(Uint16)));
+			cache->lengths = (Uint16 *)(cache->cells + PALETTE_CELLS);
+		}
+		if ( cache->cells ) {
+			SDL_memset(cache->lengths, 0,
+					PALETTE_CELLS * sizeof(Uint16));
+			cache->used = 0;
+			cache->colors = pal->colors;
+			cache->ncolors = pal->ncolors;
+			SDL_memcpy(cache->copy, pal->colors,
+					pal->ncolors * sizeof(SDL_Color));
+			cache->valid = 1;
+		}
+	}
+	if ( cache && cache->valid && pal->ncolors > 0 &&
+	     (cache->lengths[cell] || SDL_MakePaletteCell(cache, cell) == 0) ) {
+		/* The first of the nearest colors, like a full search */
+		list = cache->lists + cache->cells[cell];
+		n = cache->lengths[cell];
+		smallest = ~0;
+		for ( i=0; i<n; ++i ) {
+			SDL_Color *c = &pal->colors[list[i]];
+			rd = c->r - r;
+			gd = c->g - g;
+			bd = c->b - b;
+			distance = (rd*rd)+(gd*gd)+(bd*bd);
+			if ( distance < smallest ) {
+				pixel = list[i];
+				smallest = distance;
+			}
+		}
+	}
+	UNLOCK_PALETTES(pal);
+	return(pixel);
+}
+#else
+#define SDL_AddPaletteCache(pal)
+#define SDL_RemovePaletteCache(pal)
+#define SDL_InvalidatePaletteCache(pal)
+#define SDL_CheckPaletteCache(pal)
+#define SDL_FindCachedColor(pal, r, g, b)	(-1)
+#endif /* PALETTE_CACHES */
+
 
 /* Helper functions */
 /*
@@ -137,6 +411,7 @@ SDL_PixelFormat *SDL_AllocFormat(int bpp,
 			SDL_OutOfMemory();
 			return(NULL);
 		}
+		SDL_AddPaletteCache(format->palette);
 		if ( Rmask || Bmask || Gmask ) {
 			/* create palette according to masks */
 			int i;
@@ -226,6 +501,7 @@ SDL_PixelFormat *SDL_ReallocFormat(SDL_Surface *surface, int bpp,
 {
 	if ( surface->format ) {
 		SDL_FreeFormat(surface->format);
+		surface->format = NULL;
 		SDL_FormatChanged(surface);
 	}
 	surface->format = SDL_AllocFormat(bpp, Rmask, Gmask, Bmask, Amask);
@@ -244,6 +520,9 @@ void SDL_FormatChanged(SDL_Surface *surface)
 	}
 	surface->format_version = format_version;
 	SDL_InvalidateMap(surface->map);
+	if ( surface->format && surface->format->palette ) {
+		SDL_InvalidatePaletteCache(surface->format->palette);
+	}
 }
 /*
  * Free a previously allocated format structure
@@ -252,6 +531,7 @@ void SDL_FreeFormat(SDL_PixelFormat *format)
 {
 	if ( format ) {
 		if ( format->palette ) {
+			SDL_RemovePaletteCache(format->palette);
 			if ( format->palette->colors ) {
 				SDL_free(format->palette->colors);
 			}
@@ -318,7 +598,11 @@ Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
 	int rd, gd, bd;
 	int i;
 	Uint8 pixel=0;
-		
+
+	i = SDL_FindCachedColor(pal, r, g, b);
+	if ( i >= 0 ) {
+		return((Uint8)i);
+	}
 	smallest = ~0;
 	for ( i=0; i<pal->ncolors; ++i ) {
 		rd = pal->colors[i].r - r;
@@ -454,6 +738,7 @@ static Uint8 *Map1to1(SDL_Palette *src, SDL_Palette *dst, int *identical)
 		SDL_OutOfMemory();
 		return(NULL);
 	}
+	SDL_CheckPaletteCache(dst);
 	for ( i=0; i<src->ncolors; ++i ) {
 		map[i] = SDL_FindColor(dst,
 			src->colors[i].r, src->colors[i].g, src->colors[i].b);
@@ -548,7 +833,7 @@ int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst)
 	/* Clear out any previous mapping */
 	map = src->map;
 	if ( (src->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
-		SDL_UnRLESurface(src, 1);
+		SDL_SuspendRLESurface(src);
 	}
 	SDL_InvalidateMap(map);
 
@@ -616,8 +901,16 @@ int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst)
 }
 void SDL_FreeBlitMap(SDL_BlitMap *map)
 {
+	int i;
+
 	if ( map ) {
 		SDL_InvalidateMap(map);
+		/* RLE encodings put aside for other destinations, which are
+		   still here if the surface wasn't encoded again since */
+		for ( i = 0; i < map->rle_cached; ++i ) {
+			SDL_free(map->rle_cache[i]);
+		}
+		map->rle_cached = 0;
 		if ( map->sw_data != NULL ) {
 			SDL_free(map->sw_data);
 		}
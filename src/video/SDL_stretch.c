@@ -29,128 +29,13 @@
 
 #include "SDL_video.h"
 #include "SDL_blit.h"
+#include "SDL_cpuinfo.h"
+#include "../cpuinfo/SDL_simd.h"
 
 /* This isn't ready for general consumption yet - it should be folded
    into the general blitting mechanism.
 */
 
-#if ((defined(_MFC_VER) && defined(_M_IX86)/* && !defined(_WIN32_WCE) still needed? */) || \
-     defined(__WATCOMC__) || \
-     (defined(__GNUC__) && defined(__i386__))) && SDL_ASSEMBLY_ROUTINES
-/* There's a bug with gcc 4.4.1 and -O2 where srcp doesn't get the correct
- * value after the first scanline.  FIXME? */
-/*#define USE_ASM_STRETCH*/
-#endif
-
-#ifdef USE_ASM_STRETCH
-
-#ifdef HAVE_MPROTECT
-#include <sys/types.h>
-#include <sys/mman.h>
-#endif
-#ifdef __GNUC__
-#define PAGE_ALIGNED __attribute__((__aligned__(4096)))
-#else
-#define PAGE_ALIGNED
-#endif
-
-#if defined(_M_IX86) || defined(i386)
-#define PREFIX16	0x66
-#define STORE_BYTE	0xAA
-#define STORE_WORD	0xAB
-#define LOAD_BYTE	0xAC
-#define LOAD_WORD	0xAD
-#define RETURN		0xC3
-#else
-#error Need assembly opcodes for this architecture
-#endif
-
-static unsigned char copy_row[4096] PAGE_ALIGNED;
-
-static int generate_rowbytes(int src_w, int dst_w, int bpp)
-{
-	static struct {
-		int bpp;
-		int src_w;
-		int dst_w;
-		int status;
-	} last;
-
-	int i;
-	int pos, inc;
-	unsigned char *eip, *fence;
-	unsigned char load, store;
-
-	/* See if we need to regenerate the copy buffer */
-	if ( (src_w == last.src_w) &&
-	     (dst_w == last.dst_w) && (bpp == last.bpp) ) {
-		return(last.status);
-	}
-	last.bpp = bpp;
-	last.src_w = src_w;
-	last.dst_w = dst_w;
-	last.status = -1;
-
-	switch (bpp) {
-	    case 1:
-		load = LOAD_BYTE;
-		store = STORE_BYTE;
-		break;
-	    case 2:
-	    case 4:
-		load = LOAD_WORD;
-		store = STORE_WORD;
-		break;
-	    default:
-		SDL_SetError("ASM stretch of %d bytes isn't supported\n", bpp);
-		return(-1);
-	}
-#ifdef HAVE_MPROTECT
-	/* Make the code writeable */
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_WRITE) < 0 ) {
-		SDL_SetError("Couldn't make copy buffer writeable");
-		return(-1);
-	}
-#endif
-	pos = 0x10000;
-	inc = (src_w << 16) / dst_w;
-	eip = copy_row;
-	fence = copy_row+sizeof(copy_row)-2;
-	for ( i=0; i<dst_w && eip < end; ++i ) {
-		while ( pos >= 0x10000L ) {
-			if ( eip == fence ) {
-				return -1;
-			}
-			if ( bpp == 2 ) {
-				*eip++ = PREFIX16;
-			}
-			*eip++ = load;
-			pos -= 0x10000L;
-		}
-		if ( eip == fence ) {
-			return -1;
-		}
-		if ( bpp == 2 ) {
-			*eip++ = PREFIX16;
-		}
-		*eip++ = store;
-		pos += inc;
-	}
-	*eip++ = RETURN;
-
-#ifdef HAVE_MPROTECT
-	/* Make the code executable but not writeable */
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_EXEC) < 0 ) {
-		SDL_SetError("Couldn't make copy buffer executable");
-		return(-1);
-	}
-#endif
-	last.status = 0;
-	return(0);
-}
-
-#endif /* USE_ASM_STRETCH */
-
 #define DEFINE_COPY_ROW(name, type)			\
 void name(type *src, int src_w, type *dst, int dst_w)	\
 {							\
@@ -173,7 +58,6 @@ DEFINE_COPY_ROW(copy_row1, Uint8)
 DEFINE_COPY_ROW(copy_row2, Uint16)
 DEFINE_COPY_ROW(copy_row4, Uint32)
 
-/* The ASM code doesn't handle 24-bpp stretch blits */
 void copy_row3(Uint8 *src, int src_w, Uint8 *dst, int dst_w)
 {
 	int i;
@@ -196,33 +80,500 @@ void copy_row3(Uint8 *src, int src_w, Uint8 *dst, int dst_w)
 	}
 }
 
-/* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
-*/
-int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
-                    SDL_Surface *dst, SDL_Rect *dstrect)
+/* Stretch rows of pixels as they are, between surfaces of the same format */
+static void StretchNearest(SDL_Surface *src, SDL_Rect *srcrect,
+                           SDL_Surface *dst, SDL_Rect *dstrect)
 {
-	int src_locked;
-	int dst_locked;
 	int pos, inc;
 	int dst_maxrow;
 	int src_row, dst_row;
 	Uint8 *srcp = NULL;
 	Uint8 *dstp;
+	const int bpp = dst->format->BytesPerPixel;
+
+	/* Set up the data... */
+	pos = 0x10000;
+	inc = (srcrect->h << 16) / dstrect->h;
+	src_row = srcrect->y;
+	dst_row = dstrect->y;
+
+	/* Perform the stretch blit */
+	for ( dst_maxrow = dst_row+dstrect->h; dst_row<dst_maxrow; ++dst_row ) {
+		dstp = (Uint8 *)dst->pixels + (dst_row*dst->pitch)
+		                            + (dstrect->x*bpp);
+		while ( pos >= 0x10000L ) {
+			srcp = (Uint8 *)src->pixels + (src_row*src->pitch)
+			                            + (srcrect->x*bpp);
+			++src_row;
+			pos -= 0x10000L;
+		}
+		switch (bpp) {
+		    case 1:
+			copy_row1(srcp, srcrect->w, dstp, dstrect->w);
+			break;
+		    case 2:
+			copy_row2((Uint16 *)srcp, srcrect->w,
+			          (Uint16 *)dstp, dstrect->w);
+			break;
+		    case 3:
+			copy_row3(srcp, srcrect->w, dstp, dstrect->w);
+			break;
+		    case 4:
+			copy_row4((Uint32 *)srcp, srcrect->w,
+			          (Uint32 *)dstp, dstrect->w);
+			break;
+		}
+		pos += inc;
+	}
+}
+
+/*
+ * Filtered stretching, and stretching between different formats.
+ *
+ * Each axis gets a table giving, for every destination pixel, the first
+ * source pixel it takes from and a fixed number of weights ('taps') for
+ * that pixel and the ones after it, adding up to STRETCH_ONE.  Source
+ * rows are filtered across into a ring of rows as they're needed, and
+ * then filtered down into each destination row.  Rows are worked on as
+ * 32-bit pixels with a byte per channel: in the source's own layout if
+ * it already is one, otherwise converted to ARGB8888 first.
+ */
+#define STRETCH_BITS	14
+#define STRETCH_ONE	(1<<STRETCH_BITS)
+#define STRETCH_HALF	(1<<(STRETCH_BITS-1))
+
+typedef struct {
+	int taps;
+	int *first;		/* First source pixel for each one */
+	Sint16 *weights;	/* 'taps' weights for each one */
+} StretchAxis;
+
+static int BuildStretchAxis(StretchAxis *axis, int src_n, int dst_n,
+                            SDL_StretchFilter filter)
+{
+	double scale = (double)src_n / dst_n;
+	double pos, x0, x1, overlap;
+	int i, k, first, sum, largest;
+	Sint16 *w;
+
+	switch (filter) {
+	    case SDL_STRETCH_BILINEAR:
+		axis->taps = 2;
+		break;
+	    case SDL_STRETCH_BOX:
+		axis->taps = (src_n + dst_n - 1) / dst_n + 1;
+		break;
+	    default:
+		axis->taps = 1;
+		break;
+	}
+	if ( axis->taps > src_n ) {
+		axis->taps = src_n;
+	}
+	axis->first = (int *)SDL_malloc(dst_n * sizeof(int));
+	axis->weights = (Sint16 *)SDL_malloc(dst_n * axis->taps * sizeof(Sint16));
+	if ( axis->first == NULL || axis->weights == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+
+	for ( i=0; i<dst_n; ++i ) {
+		w = axis->weights + i * axis->taps;
+		SDL_memset(w, 0, axis->taps * sizeof(Sint16));
+		switch (filter) {
+		    case SDL_STRETCH_BILINEAR:
+			/* Between the two pixels either side of the center */
+			pos = (i + 0.5) * scale - 0.5;
+			if ( pos < 0.0 ) {
+				pos = 0.0;
+			}
+			first = (int)pos;
+			if ( first > src_n - axis->taps ) {
+				first = src_n - axis->taps;
+			}
+			if ( axis->taps == 2 ) {
+				pos -= first;
+				if ( pos > 1.0 ) {
+					pos = 1.0;
+				}
+				w[1] = (Sint16)(pos * STRETCH_ONE + 0.5);
+				w[0] = STRETCH_ONE - w[1];
+			} else {
+				w[0] = STRETCH_ONE;
+			}
+			break;
+		    case SDL_STRETCH_BOX:
+			/* Each pixel by how much of it is covered */
+			x0 = i * scale;
+			x1 = x0 + scale;
+			first = (int)x0;
+			if ( first > src_n - axis->taps ) {
+				first = src_n - axis->taps;
+			}
+			sum = 0;
+			largest = 0;
+			for ( k=0; k<axis->taps; ++k ) {
+				overlap = SDL_min(x1, first + k + 1.0) -
+				          SDL_max(x0, (double)(first + k));
+				if ( overlap > 0.0 ) {
+					w[k] = (Sint16)(overlap / scale * STRETCH_ONE + 0.5);
+				}
+				sum += w[k];
+				if ( w[k] > w[largest] ) {
+					largest = k;
+				}
+			}
+			/* Make up for rounding, where it shows the least */
+			w[largest] += STRETCH_ONE - sum;
+			break;
+		    default:
+			/* The same pixels as SDL_SoftStretch() picks */
+			first = (int)(i * (double)((src_n << 16) / dst_n) / 65536.0);
+			w[0] = STRETCH_ONE;
+			break;
+		}
+		axis->first[i] = first;
+	}
+	return(0);
+}
+
+static void FreeStretchAxis(StretchAxis *axis)
+{
+	if ( axis->first ) {
+		SDL_free(axis->first);
+	}
+	if ( axis->weights ) {
+		SDL_free(axis->weights);
+	}
+}
+
+/* Filter a row of 32-bit pixels across */
+static void StretchAcross(const Uint32 *src, Uint32 *dst, int dst_w,
+                          const StretchAxis *axis)
+{
+	const int taps = axis->taps;
+	const Sint16 *w = axis->weights;
+	const Uint32 *s;
+	Uint32 c0, c1, c2, c3, pixel;
+	int i, k;
+
+	for ( i=0; i<dst_w; ++i, w += taps ) {
+		s = src + axis->first[i];
+		c0 = c1 = c2 = c3 = STRETCH_HALF;
+		for ( k=0; k<taps; ++k ) {
+			pixel = s[k];
+			c0 += (pixel & 0xFF) * w[k];
+			c1 += ((pixel >> 8) & 0xFF) * w[k];
+			c2 += ((pixel >> 16) & 0xFF) * w[k];
+			c3 += (pixel >> 24) * w[k];
+		}
+		dst[i] = (c0 >> STRETCH_BITS) |
+		         ((c1 >> STRETCH_BITS) << 8) |
+		         ((c2 >> STRETCH_BITS) << 16) |
+		         ((c3 >> STRETCH_BITS) << 24);
+	}
+}
+
+/* Filter rows of 32-bit pixels down into one */
+static void StretchDown(Uint32 **rows, const Sint16 *w, int taps,
+                        Uint32 *dst, int dst_w)
+{
+	Uint32 c0, c1, c2, c3, pixel;
+	int i, k;
+
+	for ( i=0; i<dst_w; ++i ) {
+		c0 = c1 = c2 = c3 = STRETCH_HALF;
+		for ( k=0; k<taps; ++k ) {
+			pixel = rows[k][i];
+			c0 += (pixel & 0xFF) * w[k];
+			c1 += ((pixel >> 8) & 0xFF) * w[k];
+			c2 += ((pixel >> 16) & 0xFF) * w[k];
+			c3 += (pixel >> 24) * w[k];
+		}
+		dst[i] = (c0 >> STRETCH_BITS) |
+		         ((c1 >> STRETCH_BITS) << 8) |
+		         ((c2 >> STRETCH_BITS) << 16) |
+		         ((c3 >> STRETCH_BITS) << 24);
+	}
+}
+
+#if SDL_SSE2_INTRINSICS
+/*
+ * The same filters with the channels of a pixel in 16-bit lanes, two
+ * taps at a time: interleaving the channels of two pixels lets one
+ * _mm_madd_epi16 weigh them both and add them up into 32-bit sums.
+ */
+static void StretchAcrossSSE2(const Uint32 *src, Uint32 *dst, int dst_w,
+                              const StretchAxis *axis)
+{
+	const int taps = axis->taps;
+	const Sint16 *w = axis->weights;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i half = _mm_set1_epi32(STRETCH_HALF);
+	const Uint32 *s;
+	__m128i a, b, sum;
+	int i, k;
+
+	for ( i=0; i<dst_w; ++i, w += taps ) {
+		s = src + axis->first[i];
+		sum = half;
+		for ( k=0; k+1<taps; k+=2 ) {
+			a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(s[k]), zero);
+			b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(s[k+1]), zero);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(
+				_mm_unpacklo_epi16(a, b),
+				_mm_set1_epi32(((Uint16)w[k]) | (w[k+1] << 16))));
+		}
+		if ( k < taps ) {
+			a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(s[k]), zero);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(
+				_mm_unpacklo_epi16(a, zero),
+				_mm_set1_epi32((Uint16)w[k])));
+		}
+		sum = _mm_srli_epi32(sum, STRETCH_BITS);
+		sum = _mm_packs_epi32(sum, sum);
+		dst[i] = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+	}
+}
+
+static void StretchDownSSE2(Uint32 **rows, const Sint16 *w, int taps,
+                            Uint32 *dst, int dst_w)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i half = _mm_set1_epi32(STRETCH_HALF);
+	__m128i a, b, weights, lo, hi, s0, s1, s2, s3;
+	int i, k;
+
+	for ( i=0; i+4<=dst_w; i+=4 ) {
+		s0 = s1 = s2 = s3 = half;
+		for ( k=0; k<taps; k+=2 ) {
+			a = _mm_loadu_si128((__m128i *)(rows[k] + i));
+			if ( k+1 < taps ) {
+				b = _mm_loadu_si128((__m128i *)(rows[k+1] + i));
+				weights = _mm_set1_epi32(((Uint16)w[k]) | (w[k+1] << 16));
+			} else {
+				b = zero;
+				weights = _mm_set1_epi32((Uint16)w[k]);
+			}
+			lo = _mm_unpacklo_epi8(a, zero);
+			hi = _mm_unpacklo_epi8(b, zero);
+			s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi16(lo, hi), weights));
+			s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi16(lo, hi), weights));
+			lo = _mm_unpackhi_epi8(a, zero);
+			hi = _mm_unpackhi_epi8(b, zero);
+			s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi16(lo, hi), weights));
+			s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi16(lo, hi), weights));
+		}
+		s0 = _mm_packs_epi32(_mm_srli_epi32(s0, STRETCH_BITS),
+		                     _mm_srli_epi32(s1, STRETCH_BITS));
+		s2 = _mm_packs_epi32(_mm_srli_epi32(s2, STRETCH_BITS),
+		                     _mm_srli_epi32(s3, STRETCH_BITS));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(s0, s2));
+	}
+	if ( i < dst_w ) {
+		Uint32 *tail[256];
+
+		for ( k=0; k<taps; ++k ) {
+			tail[k] = rows[k] + i;
+		}
+		StretchDown(tail, w, taps, dst + i, dst_w - i);
+	}
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+/* Can pixels of this format be filtered as they are? */
+static int Is8888(SDL_PixelFormat *fmt)
+{
+	return ( (fmt->BytesPerPixel == 4) &&
+	         (fmt->Rloss == 0) && (fmt->Gloss == 0) && (fmt->Bloss == 0) &&
+	         (fmt->Amask == 0 || fmt->Aloss == 0) &&
+	         ((fmt->Rshift | fmt->Gshift | fmt->Bshift | fmt->Ashift) & 7) == 0 );
+}
+
+static int SameFormat(SDL_PixelFormat *a, SDL_PixelFormat *b)
+{
+	return ( (a->BitsPerPixel == b->BitsPerPixel) &&
+	         (a->Rmask == b->Rmask) && (a->Gmask == b->Gmask) &&
+	         (a->Bmask == b->Bmask) && (a->Amask == b->Amask) );
+}
+
+static int StretchFiltered(SDL_Surface *src, SDL_Rect *srcrect,
+                           SDL_Surface *dst, SDL_Rect *dstrect,
+                           SDL_StretchFilter filter)
+{
+	SDL_PixelFormat *sf = src->format;
+	SDL_PixelFormat *df = dst->format;
+	SDL_PixelFormat argb;
+	SDL_PixelFormat *wf;	/* The format rows are worked on in */
+	StretchAxis across, down;
+	Uint32 *buffer = NULL, *unpacked, *packed, *ring[256];
+	int tags[256], ntaps;
+	int x, y, k, row, status = -1;
+	int direct_src, direct_dst, src_alpha;
+	void (*across_fn)(const Uint32 *, Uint32 *, int, const StretchAxis *);
+	void (*down_fn)(Uint32 **, const Sint16 *, int, Uint32 *, int);
+
+	SDL_memset(&across, 0, sizeof(across));
+	SDL_memset(&down, 0, sizeof(down));
+	if ( BuildStretchAxis(&across, srcrect->w, dstrect->w, filter) < 0 ||
+	     BuildStretchAxis(&down, srcrect->h, dstrect->h, filter) < 0 ) {
+		goto done;
+	}
+	ntaps = down.taps;
+	if ( ntaps > (int)SDL_arraysize(ring) ) {
+		SDL_SetError("Can't shrink that much in one stretch");
+		goto done;
+	}
+
+	/* Work on the source's own pixels if possible, else ARGB8888 */
+	direct_src = Is8888(sf);
+	if ( direct_src ) {
+		wf = sf;
+	} else {
+		SDL_memset(&argb, 0, sizeof(argb));
+		argb.BitsPerPixel = 32;
+		argb.BytesPerPixel = 4;
+		argb.Rmask = 0x00FF0000;
+		argb.Gmask = 0x0000FF00;
+		argb.Bmask = 0x000000FF;
+		argb.Amask = 0xFF000000;
+		argb.Rshift = 16;
+		argb.Gshift = 8;
+		argb.Bshift = 0;
+		argb.Ashift = 24;
+		wf = &argb;
+	}
+	direct_dst = SameFormat(wf, df);
+	src_alpha = (sf->Amask != 0);
+
+	/* The ring of rows filtered across, then one for the source row
+	   converted, and one for the destination row before it's packed */
+	buffer = (Uint32 *)SDL_malloc((ntaps * dstrect->w + srcrect->w +
+	                               dstrect->w) * sizeof(Uint32));
+	if ( buffer == NULL ) {
+		SDL_OutOfMemory();
+		goto done;
+	}
+	for ( k=0; k<ntaps; ++k ) {
+		ring[k] = buffer + k * dstrect->w;
+		tags[k] = -1;
+	}
+	unpacked = buffer + ntaps * dstrect->w;
+	packed = unpacked + srcrect->w;
+
+	across_fn = StretchAcross;
+	down_fn = StretchDown;
+#if SDL_SSE2_INTRINSICS
+	if ( SDL_HasSSE2() ) {
+		across_fn = StretchAcrossSSE2;
+		down_fn = StretchDownSSE2;
+	}
+#endif
+
+	for ( y=0; y<dstrect->h; ++y ) {
+		Uint32 *rows[256];
+		Uint8 *dstp = (Uint8 *)dst->pixels +
+		              (dstrect->y + y) * dst->pitch +
+		              dstrect->x * df->BytesPerPixel;
+
+		/* Filter across whichever source rows aren't in the ring */
+		for ( k=0; k<ntaps; ++k ) {
+			row = down.first[y] + k;
+			rows[k] = ring[row % ntaps];
+			if ( tags[row % ntaps] == row ) {
+				continue;
+			}
+			tags[row % ntaps] = row;
+			if ( direct_src ) {
+				unpacked = (Uint32 *)((Uint8 *)src->pixels +
+				           (srcrect->y + row) * src->pitch) +
+				           srcrect->x;
+			} else {
+				Uint8 *srcp = (Uint8 *)src->pixels +
+				              (srcrect->y + row) * src->pitch +
+				              srcrect->x * sf->BytesPerPixel;
+				Uint32 pixel;
+				Uint8 r, g, b, a;
+
+				/* Widened as SDL_GetRGBA() does, so white
+				   stays white */
+				unpacked = packed - srcrect->w;
+				for ( x=0; x<srcrect->w; ++x ) {
+					RETRIEVE_RGB_PIXEL(srcp, sf->BytesPerPixel,
+					                   pixel);
+					SDL_GetRGBA(pixel, sf, &r, &g, &b, &a);
+					unpacked[x] = ((Uint32)a << 24) |
+					              (r << 16) | (g << 8) | b;
+					srcp += sf->BytesPerPixel;
+				}
+			}
+			across_fn(unpacked, rows[k], dstrect->w, &across);
+		}
+
+		/* Filter them down, straight into the destination if we can */
+		if ( direct_dst ) {
+			down_fn(rows, down.weights + y * ntaps, ntaps,
+			        (Uint32 *)dstp, dstrect->w);
+		} else {
+			down_fn(rows, down.weights + y * ntaps, ntaps,
+			        packed, dstrect->w);
+			for ( x=0; x<dstrect->w; ++x ) {
+				Uint32 pixel = packed[x];
+				unsigned r, g, b, a;
+
+				RGBA_FROM_8888(pixel, wf, r, g, b, a);
+				if ( ! src_alpha ) {
+					a = 0xFF;
+				}
+				ASSEMBLE_RGBA(dstp, df->BytesPerPixel, df,
+				              r, g, b, a);
+				dstp += df->BytesPerPixel;
+			}
+		}
+	}
+	status = 0;
+
+done:
+	if ( buffer ) {
+		SDL_free(buffer);
+	}
+	FreeStretchAxis(&across);
+	FreeStretchAxis(&down);
+	return(status);
+}
+
+/* Perform a stretch blit between two surfaces, with the given filter.
+   Surfaces with the same format are stretched as they are by the nearest
+   filter, otherwise both have to have 16, 24 or 32 bits per pixel.
+*/
+int SDL_SoftStretchFiltered(SDL_Surface *src, SDL_Rect *srcrect,
+                            SDL_Surface *dst, SDL_Rect *dstrect,
+                            SDL_StretchFilter filter)
+{
+	int src_locked;
+	int dst_locked;
+	int status;
 	SDL_Rect full_src;
 	SDL_Rect full_dst;
-#ifdef USE_ASM_STRETCH
-	SDL_bool use_asm = SDL_TRUE;
-#ifdef __GNUC__
-	int u1, u2;
-#endif
-#endif /* USE_ASM_STRETCH */
-	const int bpp = dst->format->BytesPerPixel;
 
-	if ( src->format->BitsPerPixel != dst->format->BitsPerPixel ) {
-		SDL_SetError("Only works with same format surfaces");
+	switch (filter) {
+	    case SDL_STRETCH_NEAREST:
+	    case SDL_STRETCH_BILINEAR:
+	    case SDL_STRETCH_BOX:
+		break;
+	    default:
+		SDL_SetError("Unknown stretch filter");
 		return(-1);
 	}
+	if ( filter != SDL_STRETCH_NEAREST ||
+	     ! SameFormat(src->format, dst->format) ) {
+		if ( src->format->BytesPerPixel < 2 ||
+		     dst->format->BytesPerPixel < 2 ) {
+			SDL_SetError("Only works with same format surfaces, "
+			             "or 16, 24 and 32 bits per pixel");
+			return(-1);
+		}
+	}
 
 	/* Verify the blit rectangles */
 	if ( srcrect ) {
@@ -253,6 +604,9 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 		full_dst.h = dst->h;
 		dstrect = &full_dst;
 	}
+	if ( !srcrect->w || !srcrect->h || !dstrect->w || !dstrect->h ) {
+		return(0);
+	}
 
 	/* Lock the destination if it's in hardware */
 	dst_locked = 0;
@@ -276,74 +630,12 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 		src_locked = 1;
 	}
 
-	/* Set up the data... */
-	pos = 0x10000;
-	inc = (srcrect->h << 16) / dstrect->h;
-	src_row = srcrect->y;
-	dst_row = dstrect->y;
-
-#ifdef USE_ASM_STRETCH
-	/* Write the opcodes for this stretch */
-	if ( (bpp == 3) ||
-	     (generate_rowbytes(srcrect->w, dstrect->w, bpp) < 0) ) {
-		use_asm = SDL_FALSE;
-	}
-#endif
-
-	/* Perform the stretch blit */
-	for ( dst_maxrow = dst_row+dstrect->h; dst_row<dst_maxrow; ++dst_row ) {
-		dstp = (Uint8 *)dst->pixels + (dst_row*dst->pitch)
-		                            + (dstrect->x*bpp);
-		while ( pos >= 0x10000L ) {
-			srcp = (Uint8 *)src->pixels + (src_row*src->pitch)
-			                            + (srcrect->x*bpp);
-			++src_row;
-			pos -= 0x10000L;
-		}
-#ifdef USE_ASM_STRETCH
-		if (use_asm) {
-#ifdef __GNUC__
-			__asm__ __volatile__ (
-			"call *%4"
-			: "=&D" (u1), "=&S" (u2)
-			: "0" (dstp), "1" (srcp), "r" (copy_row)
-			: "memory" );
-#elif defined(_MSC_VER) || defined(__WATCOMC__)
-		{ void *code = copy_row;
-			__asm {
-				push edi
-				push esi
-	
-				mov edi, dstp
-				mov esi, srcp
-				call dword ptr code
-
-				pop esi
-				pop edi
-			}
-		}
-#else
-#error Need inline assembly for this compiler
-#endif
-		} else
-#endif
-		switch (bpp) {
-		    case 1:
-			copy_row1(srcp, srcrect->w, dstp, dstrect->w);
-			break;
-		    case 2:
-			copy_row2((Uint16 *)srcp, srcrect->w,
-			          (Uint16 *)dstp, dstrect->w);
-			break;
-		    case 3:
-			copy_row3(srcp, srcrect->w, dstp, dstrect->w);
-			break;
-		    case 4:
-			copy_row4((Uint32 *)srcp, srcrect->w,
-			          (Uint32 *)dstp, dstrect->w);
-			break;
-		}
-		pos += inc;
+	status = 0;
+	if ( filter == SDL_STRETCH_NEAREST &&
+	     SameFormat(src->format, dst->format) ) {
+		StretchNearest(src, srcrect, dst, dstrect);
+	} else {
+		status = StretchFiltered(src, srcrect, dst, dstrect, filter);
 	}
 
 	/* We need to unlock the surfaces if they're locked */
@@ -353,6 +645,13 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	if ( src_locked ) {
 		SDL_UnlockSurface(src);
 	}
-	return(0);
+	return(status);
 }
 
+/* Perform a stretch blit with the nearest pixels */
+int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
+                    SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	return SDL_SoftStretchFiltered(src, srcrect, dst, dstrect,
+	                               SDL_STRETCH_NEAREST);
+}
@@ -21,9 +21,13 @@
 */
 #include "SDL_config.h"
 
-/* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
-*/
+/* Perform a stretch blit between two surfaces of the same format */
 extern int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                            SDL_Surface *dst, SDL_Rect *dstrect);
 
+/* Perform a stretch blit with the given filter, converting the pixels
+   if the surfaces have different formats */
+extern int SDL_SoftStretchFiltered(SDL_Surface *src, SDL_Rect *srcrect,
+                                   SDL_Surface *dst, SDL_Rect *dstrect,
+                                   SDL_StretchFilter filter);
+
@@ -258,6 +258,12 @@ struct SDL_VideoDevice {
 	/* Handle any queued OS events */
 	void (*PumpEvents)(_THIS);
 
+	/* If not NULL, returns a file descriptor that becomes readable when
+	   PumpEvents() has new OS events to handle, or -1 if there is none.
+	   SDL_WaitEvent() sleeps on it instead of polling.
+	 */
+	int (*GetEventFD)(_THIS);
+
 	/* * * */
 	/* Data common to all drivers */
 	SDL_Surface *screen;
@@ -282,6 +282,7 @@ int SDL_VideoInit (const char *driver_name, Uint32 flags)
 		return(-1);
 	}
 	SDL_CursorInit(flags & SDL_INIT_EVENTTHREAD);
+	SDL_InitBlitThreads();
 
 	/* We're ready to go! */
 	return(0);
@@ -722,6 +723,7 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 			SDL_DitherColors(vf->palette->colors, vf->BitsPerPixel);
 			video->SetColors(this, 0, vf->palette->ncolors,
 			                           vf->palette->colors);
+			SDL_FormatChanged(mode);
 		}
 
 		/* Clear the surface to black */
@@ -1178,6 +1180,7 @@ static void SetPalette_logical(SDL_Surface *screen, SDL_Color *colors,
 			 */
 			SDL_memcpy(vidpal->colors + firstcolor, colors,
 			       ncolors * sizeof(*colors));
+			SDL_FormatChanged(SDL_VideoSurface);
 		}
 	}
 	SDL_FormatChanged(screen);
@@ -1366,6 +1369,7 @@ void SDL_VideoQuit (void)
 
 		/* Clean up the system video */
 		video->VideoQuit(this);
+		SDL_QuitBlitThreads();
 
 		/* Free any lingering surfaces */
 		ready_to_go = SDL_ShadowSurface;
@@ -983,6 +983,15 @@ void X11_PumpEvents(_THIS)
 	}
 }
 
+int X11_GetEventFD(_THIS)
+{
+	/* A pending fullscreen switch needs polling to time it */
+	if ( switch_waiting ) {
+		return(-1);
+	}
+	return(ConnectionNumber(SDL_Display));
+}
+
 void X11_InitKeymap(void)
 {
 	int i;
@@ -0,0 +1,395 @@
+/*
+ * Checks SDL_ConvertAudio() to and from the 32-bit sample formats against
+ *  a plain C copy of the conversions, sample by sample, in both byte
+ *  orders and with lengths that leave some for the C code to finish.
+ *  Checks that the single pass conversions come out the same as a chain
+ *  of filters.  Then benchmarks a few conversions on a long buffer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static int seconds = 60;
+
+static const struct {
+    Uint16 format;
+    const char *name;
+} formats[] = {
+    { AUDIO_U8, "U8" },
+    { AUDIO_S8, "S8" },
+    { AUDIO_U16LSB, "U16LSB" },
+    { AUDIO_S16LSB, "S16LSB" },
+    { AUDIO_U16MSB, "U16MSB" },
+    { AUDIO_S16MSB, "S16MSB" },
+    { AUDIO_S32LSB, "S32LSB" },
+    { AUDIO_S32MSB, "S32MSB" },
+    { AUDIO_F32LSB, "F32LSB" },
+    { AUDIO_F32MSB, "F32MSB" },
+};
+
+typedef union {
+    Uint32 u;
+    float f;
+} Sample32;
+
+static int sample_size(Uint16 format)
+{
+    return (format & 0xFF) / 8;
+}
+
+/* Read and write samples of any format as raw bits */
+static Uint32 get_sample(const Uint8 *p, Uint16 format)
+{
+    Uint32 x = 0;
+    int i, size = sample_size(format);
+
+    for (i = 0; i < size; ++i) {
+        x |= (Uint32)p[(format & 0x1000) ? size - 1 - i : i] << (i * 8);
+    }
+    return x;
+}
+
+static void put_sample(Uint8 *p, Uint32 x, Uint16 format)
+{
+    int i, size = sample_size(format);
+
+    for (i = 0; i < size; ++i) {
+        p[(format & 0x1000) ? size - 1 - i : i] = (Uint8)(x >> (i * 8));
+    }
+}
+
+/* What SDL does to get a signed 16-bit sample out of any format */
+static Sint16 to_s16(Uint32 x, Uint16 format)
+{
+    Sample32 s;
+
+    switch (format & 0x81FF) {
+        case 0x0008: return (Sint16)((x ^ 0x80) << 8);
+        case 0x8008: return (Sint16)(x << 8);
+        case 0x0010: return (Sint16)(x ^ 0x8000);
+        case 0x8010: return (Sint16)x;
+        case 0x8020: return (Sint16)((Sint32)x >> 16);
+    }
+    s.u = x;
+    if (!(s.f >= -1.0f)) {
+        return -32768;
+    }
+    if (s.f >= 1.0f) {
+        return 32767;
+    }
+    return (Sint16)(s.f * 32768.0f);
+}
+
+static Uint32 from_s16(Sint16 sample, Uint16 format)
+{
+    Sample32 s;
+
+    switch (format & 0x81FF) {
+        case 0x0008: return ((Uint16)sample >> 8) ^ 0x80;
+        case 0x8008: return (Uint16)sample >> 8;
+        case 0x0010: return (Uint16)sample ^ 0x8000;
+        case 0x8010: return (Uint16)sample;
+        case 0x8020: return (Uint32)sample << 16;
+    }
+    s.f = sample * (1.0f / 32768.0f);
+    return s.u;
+}
+
+/* Between the 32-bit formats nothing goes through 16 bits */
+static Uint32 convert32(Uint32 x, Uint16 src_format, Uint16 dst_format)
+{
+    Sample32 s;
+
+    if ((src_format & 0x0100) == (dst_format & 0x0100)) {
+        return x;
+    }
+    s.u = x;
+    if (dst_format & 0x0100) {
+        s.f = (Sint32)x * (1.0f / 2147483648.0f);
+        return s.u;
+    }
+    if (!(s.f >= -1.0f)) {
+        return 0x80000000;
+    }
+    if (s.f >= 1.0f) {
+        return 0x7FFFFFFF;
+    }
+    return (Uint32)(Sint32)(s.f * 2147483648.0f);
+}
+
+static void fill_random(Uint8 *buf, int samples, Uint16 format)
+{
+    Sample32 s;
+    int i, size = sample_size(format);
+
+    for (i = 0; i < samples; ++i) {
+        if (format & 0x0100) {
+            /* Some past full scale, to be clipped */
+            s.f = (float)((rand() % 24001) - 12000) / 10000.0f;
+            if (rand() % 16 == 0) {
+                s.f = (rand() % 2) ? 1.0f : -1.0f;
+            }
+            put_sample(buf + i * size, s.u, format);
+        } else {
+            put_sample(buf + i * size, ((Uint32)rand() << 16) ^ (Uint32)rand(), format);
+        }
+    }
+}
+
+static int TestConvert(int from, int to)
+{
+    Uint16 src_format = formats[from].format;
+    Uint16 dst_format = formats[to].format;
+    SDL_AudioCVT cvt;
+    Uint8 *src, *expect;
+    Uint32 x;
+    int i, pass, samples, src_size, dst_size;
+
+    if (SDL_BuildAudioCVT(&cvt, src_format, 2, 44100, dst_format, 2, 44100) < 0) {
+        printf("Couldn't build %s -> %s: %s\n", formats[from].name, formats[to].name, SDL_GetError());
+        return 1;
+    }
+    src_size = sample_size(src_format);
+    dst_size = sample_size(dst_format);
+    for (pass = 0; pass < 20; ++pass) {
+        samples = ((pass < 10) ? rand() % 64 : 1000 + rand() % 64) * 2;
+        cvt.len = samples * src_size;
+        cvt.buf = (Uint8 *)malloc(cvt.len * cvt.len_mult + 4);
+        src = (Uint8 *)malloc(samples * src_size + 4);
+        expect = (Uint8 *)malloc(samples * dst_size + 4);
+        fill_random(src, samples, src_format);
+        memcpy(cvt.buf, src, samples * src_size);
+        for (i = 0; i < samples; ++i) {
+            x = get_sample(src + i * src_size, src_format);
+            if (src_size == 4 && dst_size == 4) {
+                x = convert32(x, src_format, dst_format);
+            } else {
+                x = from_s16(to_s16(x, src_format), dst_format);
+            }
+            put_sample(expect + i * dst_size, x, dst_format);
+        }
+        SDL_ConvertAudio(&cvt);
+        if (cvt.len_cvt != samples * dst_size ||
+            memcmp(cvt.buf, expect, samples * dst_size) != 0) {
+            printf("%s -> %s of %d samples came out wrong!\n",
+                   formats[from].name, formats[to].name, samples);
+            pass = -1;
+        }
+        free(cvt.buf);
+        free(src);
+        free(expect);
+        if (pass < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Conversions that SDL_BuildAudioCVT() can do in one pass */
+static const struct {
+    Uint16 src_format;
+    Uint8 src_channels;
+    int src_rate;
+    Uint16 dst_format;
+    Uint8 dst_channels;
+    int dst_rate;
+} fused[] = {
+    { AUDIO_U8, 1, 22050, AUDIO_S16SYS, 2, 44100 },
+    { AUDIO_U8, 2, 44100, AUDIO_S16SYS, 2, 44100 },
+    { AUDIO_S16SYS, 2, 44100, AUDIO_S16SYS, 1, 44100 },
+    { AUDIO_S16LSB, 1, 44100, AUDIO_U16MSB, 2, 44100 },
+    { AUDIO_S16SYS, 2, 44100, AUDIO_U8, 2, 44100 },
+    { AUDIO_S8, 2, 22050, AUDIO_U8, 1, 22050 },
+    { AUDIO_U16LSB, 2, 44100, AUDIO_S16MSB, 2, 48000 },
+    { AUDIO_S16SYS, 2, 48000, AUDIO_U8, 1, 22050 },
+    { AUDIO_S16MSB, 6, 48000, AUDIO_S16LSB, 6, 44100 },
+    { AUDIO_U8, 1, 11025, AUDIO_S16SYS, 2, 48000 },
+};
+
+static int BuildCVT(SDL_AudioCVT *cvt, int i, int single_pass)
+{
+    int status;
+
+    SDL_putenv(single_pass ? "SDL_AUDIO_FUSED=1" : "SDL_AUDIO_FUSED=0");
+    status = SDL_BuildAudioCVT(cvt,
+                 fused[i].src_format, fused[i].src_channels, fused[i].src_rate,
+                 fused[i].dst_format, fused[i].dst_channels, fused[i].dst_rate);
+    SDL_putenv("SDL_AUDIO_FUSED=1");
+    return status;
+}
+
+static int TestFused(int i)
+{
+    Uint16 dst_format = fused[i].dst_format;
+    SDL_AudioCVT one, chain;
+    Uint8 *src;
+    int k, pass, len, size, diff, most, slack;
+
+    if (BuildCVT(&one, i, 1) < 0 || BuildCVT(&chain, i, 0) < 0) {
+        printf("Couldn't build converter %d: %s\n", i, SDL_GetError());
+        return 1;
+    }
+
+    /* Mixing down and resampling round at 16 bits rather than 8 */
+    size = sample_size(dst_format);
+    slack = 0;
+    if (fused[i].src_channels > fused[i].dst_channels) {
+        slack = 1;
+    }
+    if (fused[i].src_rate != fused[i].dst_rate) {
+        slack = 2;
+    }
+    slack <<= 16 - size * 8;
+
+    most = 0;
+    for (pass = 0; pass < 10; ++pass) {
+        len = (1 + rand() % 2000) * sample_size(fused[i].src_format) * fused[i].src_channels;
+        src = (Uint8 *)malloc(len);
+        one.len = chain.len = len;
+        one.buf = (Uint8 *)malloc(len * one.len_mult);
+        chain.buf = (Uint8 *)malloc(len * chain.len_mult);
+        fill_random(src, len / sample_size(fused[i].src_format), fused[i].src_format);
+        memcpy(one.buf, src, len);
+        memcpy(chain.buf, src, len);
+        SDL_ConvertAudio(&one);
+        SDL_ConvertAudio(&chain);
+        if (one.len_cvt != chain.len_cvt) {
+            most = 0x10000;
+        } else {
+            for (k = 0; k < one.len_cvt / size; ++k) {
+                diff = to_s16(get_sample(one.buf + k * size, dst_format), dst_format) -
+                       to_s16(get_sample(chain.buf + k * size, dst_format), dst_format);
+                if (abs(diff) > most) {
+                    most = abs(diff);
+                }
+            }
+        }
+        free(src);
+        free(one.buf);
+        free(chain.buf);
+    }
+    if (most > slack) {
+        printf("%04x/%d/%5d -> %04x/%d/%5d in one pass came out wrong!\n",
+               fused[i].src_format, fused[i].src_channels, fused[i].src_rate,
+               dst_format, fused[i].dst_channels, fused[i].dst_rate);
+        return 1;
+    }
+    return 0;
+}
+
+static Uint32 Time(SDL_AudioCVT *cvt, Uint16 src_format, int samples)
+{
+    Uint32 start;
+
+    cvt->len = samples * sample_size(src_format);
+    cvt->buf = (Uint8 *)malloc(cvt->len * cvt->len_mult);
+    if (cvt->buf == NULL) {
+        return 0;
+    }
+    fill_random(cvt->buf, samples, src_format);
+    start = SDL_GetTicks();
+    SDL_ConvertAudio(cvt);
+    start = SDL_GetTicks() - start;
+    free(cvt->buf);
+    return start;
+}
+
+static void BenchmarkFused(int i)
+{
+    SDL_AudioCVT cvt;
+    int samples = fused[i].src_rate * fused[i].src_channels * seconds;
+    Uint32 one, chain;
+
+    if (BuildCVT(&cvt, i, 1) < 0) {
+        return;
+    }
+    one = Time(&cvt, fused[i].src_format, samples);
+    if (BuildCVT(&cvt, i, 0) < 0) {
+        return;
+    }
+    chain = Time(&cvt, fused[i].src_format, samples);
+    printf("%04x/%d/%5d -> %04x/%d/%5d %d seconds in %d ms, %d ms as a chain\n",
+           fused[i].src_format, fused[i].src_channels, fused[i].src_rate,
+           fused[i].dst_format, fused[i].dst_channels, fused[i].dst_rate,
+           seconds, (int)one, (int)chain);
+}
+
+static void Benchmark(Uint16 src_format, const char *src_name,
+                      Uint16 dst_format, const char *dst_name)
+{
+    SDL_AudioCVT cvt;
+    Uint32 start, elapsed;
+    int samples = 48000 * 2 * seconds;
+
+    if (SDL_BuildAudioCVT(&cvt, src_format, 2, 48000, dst_format, 2, 48000) < 0) {
+        return;
+    }
+    cvt.len = samples * sample_size(src_format);
+    cvt.buf = (Uint8 *)malloc(cvt.len * cvt.len_mult);
+    if (cvt.buf == NULL) {
+        return;
+    }
+    fill_random(cvt.buf, samples, src_format);
+    start = SDL_GetTicks();
+    SDL_ConvertAudio(&cvt);
+    elapsed = SDL_GetTicks() - start;
+    printf("%-6s -> %-6s %d seconds of 48000 Hz stereo in %d ms\n",
+           src_name, dst_name, seconds, (int)elapsed);
+    free(cvt.buf);
+}
+
+int main(int argc, char *argv[])
+{
+    int i, j, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && argv[i+1]) {
+            seconds = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--seconds N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+    printf("SSE2 %s\n", SDL_HasSSE2() ? "detected" : "not detected");
+
+    /* Everything to and from the 32-bit formats */
+    errors = 0;
+    for (i = 0; i < SDL_arraysize(formats); ++i) {
+        for (j = 0; j < SDL_arraysize(formats); ++j) {
+            if (sample_size(formats[i].format) == 4 ||
+                sample_size(formats[j].format) == 4) {
+                errors += TestConvert(i, j);
+            }
+        }
+    }
+    printf("Conversions to and from 32-bit samples %s\n", errors ? "FAILED" : "are exact");
+
+    j = 0;
+    for (i = 0; i < SDL_arraysize(fused); ++i) {
+        j += TestFused(i);
+    }
+    printf("Conversions in one pass %s\n", j ? "FAILED" : "match the chains");
+    errors += j;
+
+    Benchmark(AUDIO_F32SYS, "F32", AUDIO_S16SYS, "S16");
+    Benchmark(AUDIO_S16SYS, "S16", AUDIO_F32SYS, "F32");
+    Benchmark(AUDIO_S32SYS, "S32", AUDIO_S16SYS, "S16");
+    Benchmark(AUDIO_S16SYS, "S16", AUDIO_S32SYS, "S32");
+    Benchmark(AUDIO_S32SYS, "S32", AUDIO_F32SYS, "F32");
+    Benchmark(AUDIO_F32SYS, "F32", AUDIO_S32SYS, "S32");
+    BenchmarkFused(0);
+    BenchmarkFused(2);
+    BenchmarkFused(1);
+    BenchmarkFused(6);
+
+    SDL_Quit();
+    return (errors != 0);
+}
@@ -0,0 +1,228 @@
+/*
+ * Checks SDL_QueueAudio() by queueing a counting pattern through the disk
+ *  audio driver and reading back what it wrote, and checks that cleared
+ *  audio never plays.  Also compares how long queueing takes against
+ *  waiting on SDL_LockAudio() while a slow callback runs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define CHUNK	4096
+
+static int seconds = 2;
+static const char *outfile = "testaudioqueue.raw";
+
+static SDL_AudioSpec spec;
+
+static Sint16 pattern(int frame)
+{
+    return (Sint16)(frame % 32767 + 1);
+}
+
+static int OpenAudio(void (SDLCALL *callback)(void *, Uint8 *, int))
+{
+    SDL_memset(&spec, 0, sizeof(spec));
+    spec.freq = 44100;
+    spec.format = AUDIO_S16SYS;
+    spec.channels = 2;
+    spec.samples = 1024;
+    spec.callback = callback;
+    if (SDL_OpenAudio(&spec, NULL) < 0) {
+        fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
+        return -1;
+    }
+    return 0;
+}
+
+/* While paused, nothing is taken from the queue */
+static int TestPaused(void)
+{
+    Uint8 buf[CHUNK];
+    int n, total, errors = 0;
+
+    memset(buf, 0x7F, sizeof(buf));
+    if (SDL_QueueAudio(buf, 1000) != 1000 || SDL_QueueAudio(buf, 1002) != 1000) {
+        printf("Queueing came out the wrong size!\n");
+        ++errors;
+    }
+    if (SDL_GetQueuedAudioSize() != 2000) {
+        printf("Expected 2000 bytes queued, got %u\n", (unsigned int)SDL_GetQueuedAudioSize());
+        ++errors;
+    }
+    SDL_ClearQueuedAudio();
+    if (SDL_GetQueuedAudioSize() != 0) {
+        printf("The queue wasn't empty after clearing it!\n");
+        ++errors;
+    }
+
+    /* Fill it up, the cleared data doesn't take any space */
+    total = 0;
+    while ((n = SDL_QueueAudio(buf, sizeof(buf))) > 0) {
+        total += n;
+    }
+    printf("The queue holds %d bytes, %d ms\n", total,
+           total * 1000 / (spec.freq * 4));
+    if (total < spec.freq * 4 / 2) {
+        printf("That's less than half a second!\n");
+        ++errors;
+    }
+    SDL_ClearQueuedAudio();
+    return errors;
+}
+
+/* Queue the pattern as fast as the queue takes it */
+static int QueuePattern(int frames)
+{
+    Sint16 buf[CHUNK / 2];
+    Uint32 start, then, longest, elapsed;
+    int i, n, done, queued;
+
+    start = SDL_GetTicks();
+    longest = 0;
+    done = 0;
+    while (done < frames) {
+        n = SDL_min(frames - done, CHUNK / 4);
+        for (i = 0; i < n; ++i) {
+            buf[i*2+0] = pattern(done + i);
+            buf[i*2+1] = -pattern(done + i);
+        }
+        for (i = 0; i < n * 4; i += queued) {
+            then = SDL_GetTicks();
+            queued = SDL_QueueAudio((Uint8 *)buf + i, n * 4 - i);
+            then = SDL_GetTicks() - then;
+            if (then > longest) {
+                longest = then;
+            }
+            if (queued < 0) {
+                return -1;
+            }
+            if (queued == 0) {
+                SDL_Delay(1);
+            }
+        }
+        done += n;
+    }
+    elapsed = SDL_GetTicks() - start;
+    printf("Queued %d frames in %d ms, the longest call took %d ms\n",
+           frames, (int)elapsed, (int)longest);
+    while (SDL_GetQueuedAudioSize() > 0) {
+        SDL_Delay(10);
+    }
+    return 0;
+}
+
+/* Everything queued has to come out in order, with only silence between */
+static int CheckOutput(int frames)
+{
+    FILE *fp;
+    Sint16 frame[2];
+    int next = 0, errors = 0;
+
+    fp = fopen(outfile, "rb");
+    if (fp == NULL) {
+        printf("Couldn't read %s\n", outfile);
+        return 1;
+    }
+    while (fread(frame, sizeof(frame), 1, fp) == 1) {
+        if (frame[0] == 0 && frame[1] == 0) {
+            continue;
+        }
+        if (next >= frames || frame[0] != pattern(next) || frame[1] != -pattern(next)) {
+            ++errors;
+            break;
+        }
+        ++next;
+    }
+    fclose(fp);
+    if (next != frames) {
+        printf("Got %d of %d frames back in order!\n", next, frames);
+        ++errors;
+    }
+    return errors;
+}
+
+static void SDLCALL SlowCallback(void *userdata, Uint8 *stream, int len)
+{
+    /* Pretend mixing takes a while */
+    Uint32 start = SDL_GetTicks();
+    while (SDL_GetTicks() - start < 5) {
+    }
+}
+
+static void TestLocking(void)
+{
+    Uint32 start, then, longest;
+
+    if (OpenAudio(SlowCallback) < 0) {
+        return;
+    }
+    SDL_PauseAudio(0);
+    start = SDL_GetTicks();
+    longest = 0;
+    while (SDL_GetTicks() - start < 500) {
+        then = SDL_GetTicks();
+        SDL_LockAudio();
+        SDL_UnlockAudio();
+        then = SDL_GetTicks() - then;
+        if (then > longest) {
+            longest = then;
+        }
+    }
+    printf("With a callback, the longest wait for SDL_LockAudio() was %d ms\n",
+           (int)longest);
+    SDL_CloseAudio();
+}
+
+int main(int argc, char *argv[])
+{
+    int i, frames, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && argv[i+1]) {
+            seconds = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--seconds N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    /* The disk driver lets us see what was played */
+    SDL_putenv("SDL_AUDIODRIVER=disk");
+    if (getenv("SDL_DISKAUDIOFILE") == NULL) {
+        SDL_putenv("SDL_DISKAUDIOFILE=testaudioqueue.raw");
+    }
+    outfile = getenv("SDL_DISKAUDIOFILE");
+    if (getenv("SDL_DISKAUDIODELAY") == NULL) {
+        SDL_putenv("SDL_DISKAUDIODELAY=20");
+    }
+    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    if (OpenAudio(NULL) < 0) {
+        SDL_Quit();
+        return 1;
+    }
+    errors = TestPaused();
+    SDL_PauseAudio(0);
+    frames = spec.freq * seconds;
+    if (QueuePattern(frames) < 0) {
+        printf("Couldn't queue audio: %s\n", SDL_GetError());
+        ++errors;
+    }
+    SDL_CloseAudio();
+    errors += CheckOutput(frames);
+    remove(outfile);
+    printf("Queued audio %s\n", errors ? "FAILED" : "came out right");
+
+    TestLocking();
+    remove(outfile);
+
+    SDL_Quit();
+    return (errors != 0);
+}
@@ -0,0 +1,165 @@
+/*
+ * Checks and benchmarks per-pixel alpha blits of ARGB8888 onto RGB888,
+ *  comparing SDL's blitter against a plain C reference loop.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static int width = 1920;
+static int height = 1080;
+static int iterations = 100;
+
+static Uint32 blend_channel(Uint32 s, Uint32 d, Uint32 alpha)
+{
+    return (d + ((int)((s - d) * alpha) >> 8)) & 0xFF;
+}
+
+/* The blend every ARGB->RGB pixel alpha blitter is expected to produce */
+static void reference_blit(SDL_Surface *src, SDL_Surface *dst)
+{
+    int x, y;
+
+    for (y = 0; y < src->h; y++) {
+        Uint32 *s = (Uint32 *)((Uint8 *)src->pixels + y * src->pitch);
+        Uint32 *d = (Uint32 *)((Uint8 *)dst->pixels + y * dst->pitch);
+        for (x = 0; x < src->w; x++) {
+            Uint32 alpha = s[x] >> 24;
+            if (alpha == 255) {
+                d[x] = (s[x] & 0x00FFFFFF) | (d[x] & 0xFF000000);
+            } else if (alpha) {
+                d[x] = (d[x] & 0xFF000000) |
+                       (blend_channel((s[x] >> 16) & 0xFF, (d[x] >> 16) & 0xFF, alpha) << 16) |
+                       (blend_channel((s[x] >> 8) & 0xFF, (d[x] >> 8) & 0xFF, alpha) << 8) |
+                       blend_channel(s[x] & 0xFF, d[x] & 0xFF, alpha);
+            }
+        }
+    }
+}
+
+static void fill_random(SDL_Surface *surface, int sprite)
+{
+    int x, y;
+
+    for (y = 0; y < surface->h; y++) {
+        Uint32 *p = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+        for (x = 0; x < surface->w; x++) {
+            Uint32 pixel = ((Uint32)rand() << 16) ^ (Uint32)rand();
+            if (sprite) {
+                /* Sprites are mostly transparent or opaque with soft edges */
+                switch (rand() % 4) {
+                    case 0: pixel &= 0x00FFFFFF; break;
+                    case 1: pixel |= 0xFF000000; break;
+                    default: break;
+                }
+            }
+            p[x] = pixel;
+        }
+    }
+}
+
+static int compare(SDL_Surface *a, SDL_Surface *b)
+{
+    int x, y, i;
+    int maxdiff = 0;
+
+    for (y = 0; y < a->h; y++) {
+        Uint8 *p = (Uint8 *)a->pixels + y * a->pitch;
+        Uint8 *q = (Uint8 *)b->pixels + y * b->pitch;
+        for (x = 0; x < a->w; x++) {
+            for (i = 0; i < 4; i++) {
+                int diff = abs((int)p[x*4+i] - (int)q[x*4+i]);
+                if (diff > maxdiff) {
+                    maxdiff = diff;
+                }
+            }
+        }
+    }
+    return maxdiff;
+}
+
+static double mpixels(Uint32 ms)
+{
+    if (ms == 0) {
+        ms = 1;
+    }
+    return ((double)width * height * iterations) / (ms * 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    SDL_Surface *src, *dst, *ref;
+    Uint32 start, sdl_ms, ref_ms;
+    int i, maxdiff;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--width") == 0 && argv[i+1]) {
+            width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--height") == 0 && argv[i+1]) {
+            height = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && argv[i+1]) {
+            iterations = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--width N] [--height N] [--iterations N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    printf("MMX %s, SSE2 %s, AVX2 %s\n",
+           SDL_HasMMX() ? "detected" : "not detected",
+           SDL_HasSSE2() ? "detected" : "not detected",
+           SDL_HasAVX2() ? "detected" : "not detected");
+
+    src = SDL_CreateRGBSurface(SDL_SWSURFACE|SDL_SRCALPHA, width, height, 32,
+                               0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    dst = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32,
+                               0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+    ref = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32,
+                               0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+    if (!src || !dst || !ref) {
+        fprintf(stderr, "Couldn't create surfaces: %s\n", SDL_GetError());
+        SDL_Quit();
+        return 1;
+    }
+
+    /* First make sure a single blit gives the right answer */
+    fill_random(src, 1);
+    fill_random(dst, 0);
+    SDL_memcpy(ref->pixels, dst->pixels, dst->h * dst->pitch);
+    SDL_BlitSurface(src, NULL, dst, NULL);
+    reference_blit(src, ref);
+    maxdiff = compare(dst, ref);
+    printf("Largest channel difference from reference: %d\n", maxdiff);
+
+    start = SDL_GetTicks();
+    for (i = 0; i < iterations; i++) {
+        SDL_BlitSurface(src, NULL, dst, NULL);
+    }
+    sdl_ms = SDL_GetTicks() - start;
+
+    start = SDL_GetTicks();
+    for (i = 0; i < iterations; i++) {
+        reference_blit(src, ref);
+    }
+    ref_ms = SDL_GetTicks() - start;
+
+    printf("%d %dx%d blits: SDL %d ms (%.1f Mpixels/s), reference %d ms (%.1f Mpixels/s)\n",
+           iterations, width, height,
+           (int)sdl_ms, mpixels(sdl_ms), (int)ref_ms, mpixels(ref_ms));
+
+    SDL_FreeSurface(ref);
+    SDL_FreeSurface(dst);
+    SDL_FreeSurface(src);
+    SDL_Quit();
+
+    /* The generic C blitter rounds a little differently from the SIMD ones */
+    return (maxdiff > 1);
+}
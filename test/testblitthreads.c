@@ -0,0 +1,116 @@
+/*
+ * Checks that large blits split across SDL_VIDEO_BLIT_THREADS threads
+ *  come out byte for byte the same as single threaded blits, for a
+ *  format conversion and a per-pixel alpha blit.  The height isn't a
+ *  multiple of the number of threads, so the bands have uneven sizes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define BLIT_W	1024
+#define BLIT_H	517	/* more than 256K pixels */
+
+static int threads = 4;
+
+static SDL_Surface *CreateSource(int alpha, unsigned int seed)
+{
+    SDL_Surface *surface;
+    Uint32 *pixel;
+    int x, y;
+
+    surface = SDL_CreateRGBSurface(SDL_SWSURFACE, BLIT_W, BLIT_H, 32,
+                                   0x00FF0000, 0x0000FF00, 0x000000FF,
+                                   alpha ? 0xFF000000 : 0);
+    srand(seed);
+    for (y = 0; y < BLIT_H; ++y) {
+        pixel = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+        for (x = 0; x < BLIT_W; ++x) {
+            pixel[x] = ((Uint32)rand() << 16) ^ (Uint32)rand();
+        }
+    }
+    if (alpha) {
+        SDL_SetAlpha(surface, SDL_SRCALPHA, 255);
+    }
+    return surface;
+}
+
+/* The pixels of every blit destination, in the order they were made */
+static Uint8 *Run(const char *nthreads, size_t *size)
+{
+    char env[64];
+    SDL_Surface *src, *dst16, *dst32;
+    Uint8 *pixels;
+
+    /* The blit threads are started with the first large blit after SDL_Init() */
+    sprintf(env, "SDL_VIDEO_BLIT_THREADS=%s", nthreads);
+    SDL_putenv(env);
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        exit(1);
+    }
+
+    dst16 = SDL_CreateRGBSurface(SDL_SWSURFACE, BLIT_W, BLIT_H, 16, 0xF800, 0x07E0, 0x001F, 0);
+    dst32 = CreateSource(0, 2);
+
+    src = CreateSource(0, 1);
+    SDL_BlitSurface(src, NULL, dst16, NULL);
+    SDL_FreeSurface(src);
+
+    src = CreateSource(1, 3);
+    SDL_BlitSurface(src, NULL, dst32, NULL);
+    SDL_FreeSurface(src);
+
+    *size = dst16->pitch * BLIT_H + dst32->pitch * BLIT_H;
+    pixels = (Uint8 *)malloc(*size);
+    memcpy(pixels, dst16->pixels, dst16->pitch * BLIT_H);
+    memcpy(pixels + dst16->pitch * BLIT_H, dst32->pixels, dst32->pitch * BLIT_H);
+    SDL_FreeSurface(dst16);
+    SDL_FreeSurface(dst32);
+
+    /* This stops the blit threads, so the next run can pick a new count */
+    SDL_Quit();
+    return pixels;
+}
+
+int main(int argc, char *argv[])
+{
+    char nthreads[32];
+    Uint8 *single, *threaded;
+    size_t single_size, threaded_size, i;
+    int errors = 0;
+
+    for (i = 1; i < (size_t)argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && argv[i+1]) {
+            threads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--threads N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    single = Run("1", &single_size);
+    sprintf(nthreads, "%d", threads);
+    threaded = Run(nthreads, &threaded_size);
+
+    if (single_size != threaded_size) {
+        printf("Threaded blits made %d bytes, single threaded %d!\n",
+               (int)threaded_size, (int)single_size);
+        ++errors;
+    }
+    for (i = 0; i < single_size && !errors; ++i) {
+        if (single[i] != threaded[i]) {
+            printf("Threaded blits came out different at byte %d!\n", (int)i);
+            ++errors;
+        }
+    }
+    printf("Blits on %d threads %s\n", threads,
+           errors ? "FAILED" : "match single threaded blits");
+
+    free(single);
+    free(threaded);
+    return (errors != 0);
+}
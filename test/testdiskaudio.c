@@ -0,0 +1,157 @@
+/*
+ * Checks that the disk audio driver keeps to real time over a few seconds,
+ *  then renders audio as fast as it can and reads the WAV file back to
+ *  make sure it holds everything the callback gave it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static int seconds = 3;
+static const char *outfile = "testdiskaudio.wav";
+
+static volatile int frames_played;
+
+/* A counting pattern, written big-endian to make SDL convert it */
+static void SDLCALL Count(void *userdata, Uint8 *stream, int len)
+{
+    int i, frame = frames_played;
+
+    for (i = 0; i < len / 4; ++i, ++frame) {
+        stream[i*4+0] = (Uint8)(frame >> 8);
+        stream[i*4+1] = (Uint8)frame;
+        stream[i*4+2] = (Uint8)(~frame >> 8);
+        stream[i*4+3] = (Uint8)~frame;
+    }
+    frames_played = frame;
+}
+
+static int OpenAudio(const char *delay)
+{
+    SDL_AudioSpec spec;
+    char env[64];
+
+    SDL_snprintf(env, sizeof(env), "SDL_DISKAUDIODELAY=%s", delay);
+    SDL_putenv(env);
+    SDL_memset(&spec, 0, sizeof(spec));
+    spec.freq = 22050;
+    spec.format = AUDIO_S16MSB;
+    spec.channels = 2;
+    spec.samples = 512;
+    spec.callback = Count;
+    frames_played = 0;
+    if (SDL_OpenAudio(&spec, NULL) < 0) {
+        fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
+        return -1;
+    }
+    return 0;
+}
+
+/* 512 frames at 22050 Hz is 23.2 ms, which doesn't divide into whole ms */
+static int TestRealTime(void)
+{
+    Uint32 start, elapsed;
+    int frames;
+    double ratio;
+
+    if (OpenAudio("") < 0) {
+        return 1;
+    }
+    SDL_PauseAudio(0);
+    SDL_Delay(100);
+    start = SDL_GetTicks();
+    frames = frames_played;
+    SDL_Delay(seconds * 1000);
+    frames = frames_played - frames;
+    elapsed = SDL_GetTicks() - start;
+    SDL_CloseAudio();
+
+    ratio = (double)frames / 22050 * 1000 / elapsed;
+    printf("Played %d frames in %d ms, %.2f%% of real time\n",
+           frames, (int)elapsed, ratio * 100);
+    if (ratio < 0.98 || ratio > 1.02) {
+        printf("That's too far off!\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int TestRender(void)
+{
+    SDL_AudioSpec spec;
+    Uint8 *data;
+    Uint32 start, elapsed, len, i;
+    int frames, errors = 0;
+
+    if (OpenAudio("0") < 0) {
+        return 1;
+    }
+    start = SDL_GetTicks();
+    SDL_PauseAudio(0);
+    while (frames_played < seconds * 20 * 22050) {
+        SDL_Delay(1);
+    }
+    SDL_CloseAudio();
+    elapsed = SDL_GetTicks() - start;
+    frames = frames_played;
+    printf("Rendered %d seconds of audio in %d ms\n", frames / 22050, (int)elapsed);
+
+    if (SDL_LoadWAV(outfile, &spec, &data, &len) == NULL) {
+        printf("Couldn't load %s: %s\n", outfile, SDL_GetError());
+        return 1;
+    }
+    if (spec.freq != 22050 || spec.channels != 2 || spec.format != AUDIO_S16LSB) {
+        printf("The WAV file came out as %d Hz, %d channels, format %04x!\n",
+               spec.freq, spec.channels, spec.format);
+        ++errors;
+    }
+    if (len != (Uint32)frames * 4) {
+        printf("The WAV file holds %u frames, not %d!\n", (unsigned int)(len / 4), frames);
+        ++errors;
+    }
+    for (i = 0; i < len / 4; ++i) {
+        Uint16 left = (Uint16)(data[i*4+0] | (data[i*4+1] << 8));
+        Uint16 right = (Uint16)(data[i*4+2] | (data[i*4+3] << 8));
+        if (left != (Uint16)i || right != (Uint16)~i) {
+            printf("Frame %u came out wrong!\n", (unsigned int)i);
+            ++errors;
+            break;
+        }
+    }
+    SDL_FreeWAV(data);
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && argv[i+1]) {
+            seconds = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--seconds N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    SDL_putenv("SDL_AUDIODRIVER=disk");
+    if (getenv("SDL_DISKAUDIOFILE") == NULL) {
+        SDL_putenv("SDL_DISKAUDIOFILE=testdiskaudio.wav");
+    }
+    outfile = getenv("SDL_DISKAUDIOFILE");
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    errors = TestRealTime();
+    errors += TestRender();
+    remove(outfile);
+
+    SDL_Quit();
+    return (errors != 0);
+}
@@ -0,0 +1,267 @@
+/*
+ * Benchmarks SDL_PushEvent() from several threads at once, with the main
+ *  thread draining the queue, and checks that no events are lost or
+ *  reordered along the way.  Also checks how quickly SDL_WaitEventTimeout()
+ *  wakes up when another thread pushes an event.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_thread.h"
+#include "SDL_syswm.h"
+
+#define MAX_PRODUCERS	32
+
+static int num_producers = 4;
+static int events_per_producer = 100000;
+static int queue_size = 0;
+static int queue_full[MAX_PRODUCERS];
+
+/* Queue a mix of two event types, then pull out just one of them */
+static int TestMaskedGet(int count)
+{
+    SDL_Event event;
+    Uint32 start, elapsed;
+    int i, received, errors;
+
+    SDL_memset(&event, 0, sizeof(event));
+    for (i = 0; i < count; ++i) {
+        event.type = (i % 2) ? SDL_USEREVENT : SDL_USEREVENT + 1;
+        event.user.code = i;
+        if (SDL_PushEvent(&event) < 0) {
+            break;
+        }
+    }
+    count = i;
+
+    start = SDL_GetTicks();
+    received = 0;
+    errors = 0;
+    while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_EVENTMASK(SDL_USEREVENT)) > 0) {
+        if (event.user.code != received * 2 + 1) {
+            ++errors;
+        }
+        ++received;
+    }
+    elapsed = SDL_GetTicks() - start;
+
+    printf("Took %d of %d mixed events one at a time by mask in %d ms\n",
+           received, count, (int)elapsed);
+    if (received != count / 2) {
+        ++errors;
+    }
+    while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_ALLEVENTS) > 0) {
+        /* Throw away the rest */
+    }
+    return errors;
+}
+
+/* More window manager messages than the queue used to have room for
+   each have to come back as they went in */
+static int TestWMMessages(int count)
+{
+    SDL_Event event;
+    SDL_SysWMmsg msg;
+    int i, received = 0, errors = 0;
+
+    SDL_memset(&event, 0, sizeof(event));
+    SDL_memset(&msg, 0, sizeof(msg));
+    event.type = SDL_SYSWMEVENT;
+    event.syswm.msg = &msg;
+    for (i = 0; i < count; ++i) {
+        msg.version.major = (Uint8)i;
+        msg.version.minor = (Uint8)(i >> 8);
+        if (SDL_PushEvent(&event) < 0) {
+            break;
+        }
+    }
+    count = i;
+    while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_EVENTMASK(SDL_SYSWMEVENT)) > 0) {
+        if (event.syswm.msg->version.major != (Uint8)received ||
+            event.syswm.msg->version.minor != (Uint8)(received >> 8)) {
+            ++errors;
+        }
+        ++received;
+    }
+    if (received != count) {
+        ++errors;
+    }
+    return errors;
+}
+
+static volatile Uint32 pushed_at;
+
+static int SDLCALL DelayedPush(void *data)
+{
+    SDL_Event event;
+
+    SDL_Delay((Uint32)(size_t)data);
+    SDL_memset(&event, 0, sizeof(event));
+    event.type = SDL_USEREVENT;
+    pushed_at = SDL_GetTicks();
+    SDL_PushEvent(&event);
+    return 0;
+}
+
+/* Make sure waiting wakes up when it should, and not before */
+static int TestWait(void)
+{
+    SDL_Thread *thread;
+    SDL_Event event;
+    Uint32 start, elapsed;
+    int errors = 0;
+
+    start = SDL_GetTicks();
+    if (SDL_WaitEventTimeout(&event, 100)) {
+        printf("Got an event from an empty queue!\n");
+        ++errors;
+    }
+    elapsed = SDL_GetTicks() - start;
+    printf("Waiting on an empty queue timed out after %d ms\n", (int)elapsed);
+    if (elapsed < 100) {
+        ++errors;
+    }
+
+    thread = SDL_CreateThread(DelayedPush, (void *)(size_t)100);
+    if (thread == NULL) {
+        fprintf(stderr, "Couldn't create thread: %s\n", SDL_GetError());
+        return errors + 1;
+    }
+    if (!SDL_WaitEventTimeout(&event, 5000) || event.type != SDL_USEREVENT) {
+        printf("Didn't get the event pushed from another thread!\n");
+        ++errors;
+    } else {
+        printf("Woke up %d ms after another thread pushed an event\n",
+               (int)(SDL_GetTicks() - pushed_at));
+    }
+    SDL_WaitThread(thread, NULL);
+    return errors;
+}
+
+static int SDLCALL Producer(void *data)
+{
+    int id = (int)(size_t)data;
+    SDL_Event event;
+    int i;
+
+    SDL_memset(&event, 0, sizeof(event));
+    event.type = SDL_USEREVENT;
+    event.user.code = id;
+    for (i = 0; i < events_per_producer; ++i) {
+        event.user.data1 = (void *)(size_t)i;
+        while (SDL_PushEvent(&event) < 0) {
+            /* The queue is full, give the consumer a chance */
+            ++queue_full[id];
+            SDL_Delay(0);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    SDL_Thread *threads[MAX_PRODUCERS];
+    int next[MAX_PRODUCERS];
+    SDL_Event event;
+    SDL_EventQueueStats stats;
+    Uint32 start, elapsed;
+    int i, received, total, full, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--producers") == 0 && argv[i+1]) {
+            num_producers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--events") == 0 && argv[i+1]) {
+            events_per_producer = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--queuesize") == 0 && argv[i+1]) {
+            queue_size = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--producers N] [--events N] [--queuesize N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_producers < 1 || num_producers > MAX_PRODUCERS) {
+        fprintf(stderr, "Between 1 and %d producers, please\n", MAX_PRODUCERS);
+        return 1;
+    }
+
+    if (queue_size > 0 && SDL_SetEventQueueSize(queue_size) < 0) {
+        fprintf(stderr, "Couldn't set event queue size: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    /* The event queue comes with the video subsystem */
+    if (getenv("SDL_VIDEODRIVER") == NULL) {
+        SDL_putenv("SDL_VIDEODRIVER=dummy");
+    }
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    total = num_producers * events_per_producer;
+    printf("%d threads pushing %d events each\n", num_producers, events_per_producer);
+
+    start = SDL_GetTicks();
+    for (i = 0; i < num_producers; ++i) {
+        next[i] = 0;
+        threads[i] = SDL_CreateThread(Producer, (void *)(size_t)i);
+        if (threads[i] == NULL) {
+            fprintf(stderr, "Couldn't create thread: %s\n", SDL_GetError());
+            SDL_Quit();
+            return 1;
+        }
+    }
+
+    received = 0;
+    errors = 0;
+    while (received < total) {
+        if (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_EVENTMASK(SDL_USEREVENT)) <= 0) {
+            continue;
+        }
+        /* Each producer's events have to come out in the order they went in */
+        if ((int)(size_t)event.user.data1 != next[event.user.code]) {
+            ++errors;
+        }
+        next[event.user.code] = (int)(size_t)event.user.data1 + 1;
+        ++received;
+    }
+    elapsed = SDL_GetTicks() - start;
+
+    full = 0;
+    for (i = 0; i < num_producers; ++i) {
+        SDL_WaitThread(threads[i], NULL);
+        full += queue_full[i];
+    }
+
+    printf("%d events in %d ms (%.0f events/s), queue was full %d times\n",
+           received, (int)elapsed,
+           (double)received * 1000.0 / (elapsed ? elapsed : 1), full);
+    if (errors) {
+        printf("%d events arrived out of order!\n", errors);
+    }
+
+    if (TestMaskedGet(events_per_producer)) {
+        printf("Masked events came out wrong!\n");
+        ++errors;
+    }
+
+    if (TestWMMessages(1000)) {
+        printf("Window manager messages came out wrong!\n");
+        ++errors;
+    }
+
+    if (TestWait()) {
+        printf("Waiting for events went wrong!\n");
+        ++errors;
+    }
+
+    SDL_GetEventQueueStats(&stats);
+    printf("Queue grew to %d of %d events, at most %d were queued, %u dropped\n",
+           stats.size, stats.maxsize, stats.highwater, (unsigned int)stats.dropped);
+
+    SDL_Quit();
+    return (errors != 0);
+}
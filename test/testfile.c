@@ -40,12 +40,36 @@ static void rwops_error_quit( unsigned line, SDL_RWops *rwops) {
 
 #define RWOP_ERR_QUIT(x)	rwops_error_quit( __LINE__, (x) )
 
+/* A data source built by the application, on top of a memory one */
+static int SDLCALL app_seek(SDL_RWops *context, int offset, int whence)
+{
+	SDL_RWops *mem = (SDL_RWops *)context->hidden.unknown.data1;
+	return mem->seek(mem, offset, whence);
+}
+
+static int SDLCALL app_read(SDL_RWops *context, void *ptr, int size, int maxnum)
+{
+	SDL_RWops *mem = (SDL_RWops *)context->hidden.unknown.data1;
+	return mem->read(mem, ptr, size, maxnum);
+}
+
+static int SDLCALL app_write(SDL_RWops *context, const void *ptr, int size, int num)
+{
+	return -1;
+}
+
+static int SDLCALL app_close(SDL_RWops *context)
+{
+	return 0;
+}
+
 
 
 int main(int argc, char *argv[])
 {
 	SDL_RWops *rwops = NULL;
 	char test_buf[30];
+	Sint64 big;
 	
 	cleanup();
 
@@ -177,6 +201,71 @@ int main(int argc, char *argv[])
 														RWOP_ERR_QUIT(rwops);
 	rwops->close(rwops);
 	printf("test5 OK\n");
+
+/* test6 : sizes, and 64-bit offsets */
+	rwops = SDL_RWFromFile(FBASENAME1,"rb");
+	if (!rwops)											RWOP_ERR_QUIT(rwops);
+	if (20+27+7!=SDL_RWsize(rwops))					RWOP_ERR_QUIT(rwops);
+	if (0!=SDL_RWtell64(rwops))							RWOP_ERR_QUIT(rwops);
+	if (20+27+7!=SDL_RWseek64(rwops,0,RW_SEEK_END))		RWOP_ERR_QUIT(rwops);
+	rwops->close(rwops);
+
+	rwops = SDL_RWFromConstMem(test_buf,30);
+	if (!rwops)											RWOP_ERR_QUIT(rwops);
+	if (30!=SDL_RWsize(rwops))							RWOP_ERR_QUIT(rwops);
+	if (10!=SDL_RWseek64(rwops,10,RW_SEEK_SET))			RWOP_ERR_QUIT(rwops);
+	if (30!=SDL_RWseek64(rwops,(Sint64)1<<33,RW_SEEK_CUR))	RWOP_ERR_QUIT(rwops);
+	if (0!=SDL_RWseek64(rwops,-((Sint64)1<<33),RW_SEEK_END))	RWOP_ERR_QUIT(rwops);
+	rwops->close(rwops);
+
+	/* A sparse file with data past 4 GB, where the filesystem allows */
+	big = ((Sint64)5<<30);
+	rwops = SDL_RWFromFile(FBASENAME2,"wb+");
+	if (!rwops)											RWOP_ERR_QUIT(rwops);
+	if (big==SDL_RWseek64(rwops,big,RW_SEEK_SET) &&
+	    1==rwops->write(rwops,"1234567",7,1)) {
+		if (big+7!=SDL_RWsize(rwops))					RWOP_ERR_QUIT(rwops);
+		if (big+7!=SDL_RWtell64(rwops))					RWOP_ERR_QUIT(rwops);
+		if (-1!=rwops->seek(rwops,0,RW_SEEK_CUR))		RWOP_ERR_QUIT(rwops);
+		if (big!=SDL_RWseek64(rwops,-7,RW_SEEK_END))	RWOP_ERR_QUIT(rwops);
+		if (7!=rwops->read(rwops,test_buf,1,7))			RWOP_ERR_QUIT(rwops);
+		if (SDL_memcmp(test_buf,"1234567",7))			RWOP_ERR_QUIT(rwops);
+		if (big-3!=SDL_RWseek64(rwops,-10,RW_SEEK_CUR))	RWOP_ERR_QUIT(rwops);
+		if (10!=rwops->read(rwops,test_buf,1,10))		RWOP_ERR_QUIT(rwops);
+		if (SDL_memcmp(test_buf,"\0\0\0" "1234567",10))	RWOP_ERR_QUIT(rwops);
+		rwops->close(rwops);
+		printf("test6 OK\n");
+	} else {
+		rwops->close(rwops);
+		printf("test6 OK, without a file past 4 GB\n");
+	}
+
+/* test7 : a data source the application built itself, with garbage
+   where the members added for 64-bit seeking go */
+	{
+		SDL_RWops app, *mem, *buffered;
+
+		SDL_memset(&app, 0xA5, sizeof(app));
+		app.seek = app_seek;
+		app.read = app_read;
+		app.write = app_write;
+		app.close = app_close;
+		mem = SDL_RWFromConstMem("123456789012345678901234567890", 30);
+		app.hidden.unknown.data1 = mem;
+		rwops = &app;
+		if (30!=SDL_RWsize(rwops))						RWOP_ERR_QUIT(NULL);
+		if (10!=SDL_RWseek64(rwops,10,RW_SEEK_SET))		RWOP_ERR_QUIT(NULL);
+		if (-1!=SDL_RWseek64(rwops,(Sint64)1<<33,RW_SEEK_SET))	RWOP_ERR_QUIT(NULL);
+		buffered = SDL_RWFromBuffered(rwops, 8, 0);
+		if (!buffered)									RWOP_ERR_QUIT(NULL);
+		if (20!=SDL_RWseek64(buffered,20,RW_SEEK_SET))	RWOP_ERR_QUIT(buffered);
+		if (5!=buffered->read(buffered,test_buf,1,5))	RWOP_ERR_QUIT(buffered);
+		if (SDL_memcmp(test_buf,"12345",5))				RWOP_ERR_QUIT(buffered);
+		if (30!=SDL_RWsize(buffered))					RWOP_ERR_QUIT(buffered);
+		buffered->close(buffered);
+		mem->close(mem);
+		printf("test7 OK\n");
+	}
 	cleanup();
 	return 0; /* all ok */
 }
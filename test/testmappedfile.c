@@ -0,0 +1,202 @@
+/*
+ * Checks that a file opened with SDL_RWFromMappedFile() reads and seeks
+ *  the same as one opened with SDL_RWFromFile(), and that the mapping
+ *  holds the whole file.  Then compares how long reading a large file
+ *  takes each way.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define TESTFILE	"testmappedfile.dat"
+
+static int megabytes = 64;
+
+static int WriteFile(const char *file, int size)
+{
+    FILE *fp;
+    Uint8 buf[4096];
+    int i, n;
+
+    fp = fopen(file, "wb");
+    if (fp == NULL) {
+        printf("Couldn't create %s\n", file);
+        return -1;
+    }
+    for (n = 0; n < size; n += sizeof(buf)) {
+        for (i = 0; i < sizeof(buf); ++i) {
+            buf[i] = (Uint8)(rand() >> 4);
+        }
+        fwrite(buf, SDL_min(size - n, (int)sizeof(buf)), 1, fp);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/* Random reads and seeks have to come out the same both ways */
+static int TestReads(int size)
+{
+    SDL_RWops *file, *mapped;
+    Uint8 a[5000], b[5000];
+    const Uint8 *data;
+    int i, n, offset, whence, got_a, got_b, mapped_size, errors = 0;
+
+    if (WriteFile(TESTFILE, size) < 0) {
+        return 1;
+    }
+    file = SDL_RWFromFile(TESTFILE, "rb");
+    mapped = SDL_RWFromMappedFile(TESTFILE);
+    if (file == NULL || mapped == NULL) {
+        printf("Couldn't open %s: %s\n", TESTFILE, SDL_GetError());
+        return 1;
+    }
+
+    data = (const Uint8 *)SDL_RWGetMapping(mapped, &mapped_size);
+    if (data == NULL || mapped_size != size) {
+        printf("The mapping of a %d byte file is %d bytes!\n", size, mapped_size);
+        ++errors;
+    }
+    if (SDL_RWGetMapping(file, NULL) != NULL) {
+        printf("A stdio file claims to be mapped!\n");
+        ++errors;
+    }
+
+    for (i = 0; i < 2000 && !errors; ++i) {
+        whence = rand() % 3;
+        offset = (whence == RW_SEEK_SET) ? rand() % (size + 1) :
+                 (whence == RW_SEEK_CUR) ? rand() % 2000 - 1000 : -(rand() % (size + 1));
+        got_a = SDL_RWseek(file, offset, whence);
+        got_b = SDL_RWseek(mapped, offset, whence);
+        if (got_a < 0 || got_a > size) {
+            /* stdio can't seek before the start and can go past the
+               end, memory stops at either */
+            SDL_RWseek(file, got_b, RW_SEEK_SET);
+        } else if (got_a != got_b) {
+            printf("Seeking %d from %d went to %d, not %d\n", offset, whence, got_b, got_a);
+            ++errors;
+            break;
+        }
+        n = rand() % sizeof(a) + 1;
+        got_a = SDL_RWread(file, a, 1, n);
+        got_b = SDL_RWread(mapped, b, 1, n);
+        if (got_a != got_b || memcmp(a, b, got_a) != 0) {
+            printf("Reading %d bytes got %d, not %d\n", n, got_b, got_a);
+            ++errors;
+        } else if (got_b > 0 && memcmp(b, data + SDL_RWtell(mapped) - got_b, got_b) != 0) {
+            printf("The mapping doesn't match what was read!\n");
+            ++errors;
+        }
+    }
+    if (SDL_RWwrite(mapped, a, 1, 1) != -1) {
+        printf("Writing to a mapped file didn't fail!\n");
+        ++errors;
+    }
+    SDL_RWclose(file);
+    SDL_RWclose(mapped);
+    remove(TESTFILE);
+    return errors;
+}
+
+static int TestEdges(void)
+{
+    SDL_RWops *mapped;
+    Uint8 buf[16];
+    int size = -1, errors = 0;
+
+    WriteFile(TESTFILE, 0);
+    mapped = SDL_RWFromMappedFile(TESTFILE);
+    if (mapped == NULL) {
+        printf("Couldn't map an empty file: %s\n", SDL_GetError());
+        ++errors;
+    } else {
+        if (SDL_RWGetMapping(mapped, &size) == NULL || size != 0 ||
+            SDL_RWread(mapped, buf, 1, sizeof(buf)) != 0) {
+            printf("An empty file didn't read as empty!\n");
+            ++errors;
+        }
+        SDL_RWclose(mapped);
+    }
+    remove(TESTFILE);
+
+    if (SDL_RWFromMappedFile(TESTFILE) != NULL) {
+        printf("Mapping a file that doesn't exist didn't fail!\n");
+        ++errors;
+    }
+    return errors;
+}
+
+static void Benchmark(int size)
+{
+    SDL_RWops *src;
+    static Uint8 buf[65536];
+    const Uint8 *data;
+    Uint32 start, elapsed[3], sum = 0;
+    int i, n, total;
+
+    if (WriteFile(TESTFILE, size) < 0) {
+        return;
+    }
+
+    /* Reading a file copies it out of the cache as well */
+    start = SDL_GetTicks();
+    src = SDL_RWFromFile(TESTFILE, "rb");
+    for (total = 0; (n = SDL_RWread(src, buf, 1, sizeof(buf))) > 0; total += n) {
+        sum += buf[n - 1];
+    }
+    SDL_RWclose(src);
+    elapsed[0] = SDL_GetTicks() - start;
+
+    start = SDL_GetTicks();
+    src = SDL_RWFromMappedFile(TESTFILE);
+    for (total = 0; (n = SDL_RWread(src, buf, 1, sizeof(buf))) > 0; total += n) {
+        sum += buf[n - 1];
+    }
+    SDL_RWclose(src);
+    elapsed[1] = SDL_GetTicks() - start;
+
+    start = SDL_GetTicks();
+    src = SDL_RWFromMappedFile(TESTFILE);
+    data = (const Uint8 *)SDL_RWGetMapping(src, &total);
+    for (i = 0; i < total; i += 4096) {
+        sum += data[i];
+    }
+    SDL_RWclose(src);
+    elapsed[2] = SDL_GetTicks() - start;
+
+    printf("Reading %d MB: %d ms from a file, %d ms mapped, %d ms in place (%u)\n",
+           size >> 20, (int)elapsed[0], (int)elapsed[1], (int)elapsed[2],
+           (unsigned int)(sum & 1));
+    remove(TESTFILE);
+}
+
+int main(int argc, char *argv[])
+{
+    int i, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--megabytes") == 0 && argv[i+1]) {
+            megabytes = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--megabytes N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    errors = TestReads(100000);
+    errors += TestReads(4096);
+    errors += TestEdges();
+    printf("Mapped files %s\n", errors ? "FAILED" : "read the same as stdio");
+
+    Benchmark(megabytes << 20);
+
+    SDL_Quit();
+    return (errors != 0);
+}
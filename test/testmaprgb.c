@@ -0,0 +1,192 @@
+/*
+ * Checks that SDL_MapRGB() on 8-bit surfaces picks the same palette entry
+ *  as searching the whole palette, before and after the palette changes,
+ *  and that blits between palettes map the same way, even to a palette
+ *  written to directly.  Then compares how
+ *  fast it maps colors against the plain search.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static int colors_per_frame = 100000;
+
+/* The nearest color, and of those equally near, the first one */
+static Uint8 Nearest(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
+{
+    unsigned int smallest = ~0, distance;
+    int i, rd, gd, bd;
+    Uint8 pixel = 0;
+
+    for (i = 0; i < pal->ncolors; ++i) {
+        rd = pal->colors[i].r - r;
+        gd = pal->colors[i].g - g;
+        bd = pal->colors[i].b - b;
+        distance = rd * rd + gd * gd + bd * bd;
+        if (distance < smallest) {
+            smallest = distance;
+            pixel = (Uint8)i;
+        }
+    }
+    return pixel;
+}
+
+/* Palettes that make for close calls: random, few distinct colors, and
+   colors that all share the same green */
+static void MakePalette(SDL_Color *colors, int kind)
+{
+    int i;
+
+    for (i = 0; i < 256; ++i) {
+        switch (kind) {
+            case 0:
+                colors[i].r = (Uint8)rand();
+                colors[i].g = (Uint8)rand();
+                colors[i].b = (Uint8)rand();
+                break;
+            case 1:
+                colors[i].r = (Uint8)((rand() % 4) * 85);
+                colors[i].g = (Uint8)((rand() % 4) * 85);
+                colors[i].b = (Uint8)((rand() % 4) * 85);
+                break;
+            default:
+                colors[i].r = (Uint8)rand();
+                colors[i].g = 128;
+                colors[i].b = (Uint8)(i & 0xF0);
+                break;
+        }
+        colors[i].unused = 0;
+    }
+}
+
+static int CheckMapping(SDL_Surface *surface, int n)
+{
+    SDL_Palette *pal = surface->format->palette;
+    Uint8 r, g, b;
+    Uint32 pixel;
+    int i;
+
+    for (i = 0; i < n; ++i) {
+        /* Repeat some colors, as a renderer would */
+        if (i % 2) {
+            srand(i / 64);
+        }
+        r = (Uint8)rand();
+        g = (Uint8)rand();
+        b = (Uint8)rand();
+        if (i % 3 == 0) {
+            SDL_Color *c = &pal->colors[rand() % pal->ncolors];
+            r = c->r;
+            g = c->g;
+            b = c->b;
+        }
+        pixel = SDL_MapRGB(surface->format, r, g, b);
+        if (pixel != Nearest(pal, r, g, b)) {
+            printf("(%d,%d,%d) mapped to %u, not %u!\n", r, g, b,
+                   (unsigned int)pixel, (unsigned int)Nearest(pal, r, g, b));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int TestBlit(SDL_Surface *src, SDL_Surface *dst)
+{
+    Uint8 *s, *d;
+    int i;
+
+    for (i = 0, s = (Uint8 *)src->pixels; i < 256; ++i) {
+        s[i] = (Uint8)i;
+    }
+    SDL_BlitSurface(src, NULL, dst, NULL);
+    for (i = 0, d = (Uint8 *)dst->pixels; i < 256; ++i) {
+        SDL_Color *c = &src->format->palette->colors[i];
+        if (d[i] != Nearest(dst->format->palette, c->r, c->g, c->b)) {
+            printf("Blitting color %d mapped to %d!\n", i, d[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void Benchmark(SDL_Surface *surface)
+{
+    SDL_Palette *pal = surface->format->palette;
+    Uint32 start, mapped, searched, sum = 0;
+    int i;
+
+    start = SDL_GetTicks();
+    for (i = 0; i < colors_per_frame; ++i) {
+        sum += SDL_MapRGB(surface->format, (Uint8)(i * 7), (Uint8)(i >> 3), (Uint8)(i >> 9));
+    }
+    mapped = SDL_GetTicks() - start;
+    start = SDL_GetTicks();
+    for (i = 0; i < colors_per_frame; ++i) {
+        sum += Nearest(pal, (Uint8)(i * 7), (Uint8)(i >> 3), (Uint8)(i >> 9));
+    }
+    searched = SDL_GetTicks() - start;
+    printf("Mapping %d colors: %d ms, %d ms searching the palette (%u)\n",
+           colors_per_frame, (int)mapped, (int)searched, (unsigned int)(sum & 1));
+}
+
+int main(int argc, char *argv[])
+{
+    SDL_Surface *src, *dst;
+    SDL_Color colors[256];
+    int i, kind, errors = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--colors") == 0 && argv[i+1]) {
+            colors_per_frame = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--colors N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+    src = SDL_CreateRGBSurface(SDL_SWSURFACE, 256, 1, 8, 0, 0, 0, 0);
+    dst = SDL_CreateRGBSurface(SDL_SWSURFACE, 256, 1, 8, 0, 0, 0, 0);
+    if (src == NULL || dst == NULL) {
+        fprintf(stderr, "Couldn't create surfaces: %s\n", SDL_GetError());
+        SDL_Quit();
+        return 1;
+    }
+
+    /* Each palette change has to throw away what was cached before it */
+    for (kind = 0; kind < 3 && !errors; ++kind) {
+        MakePalette(colors, kind);
+        SDL_SetColors(dst, colors, 0, 256);
+        errors += CheckMapping(dst, 20000);
+        MakePalette(colors, (kind + 1) % 3);
+        SDL_SetColors(dst, colors, 0, 128);
+        errors += CheckMapping(dst, 20000);
+        /* Programs change palettes behind SDL's back too, which the
+           next blit mapped to them notices */
+        MakePalette(dst->format->palette->colors, (kind + 2) % 3);
+        dst->format->palette->colors[rand() % 256].g ^= 0x80;
+        MakePalette(colors, 0);
+        SDL_SetColors(src, colors, 0, 256);
+        errors += TestBlit(src, dst);
+        errors += CheckMapping(dst, 20000);
+        dst->format->palette->ncolors = 16;
+        errors += CheckMapping(dst, 20000);
+        dst->format->palette->ncolors = 256;
+    }
+    printf("Mapping colors %s\n", errors ? "FAILED" : "matches searching the palette");
+
+    MakePalette(colors, 0);
+    SDL_SetColors(dst, colors, 0, 256);
+    Benchmark(dst);
+
+    SDL_FreeSurface(src);
+    SDL_FreeSurface(dst);
+    SDL_Quit();
+    return (errors != 0);
+}
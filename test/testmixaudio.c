@@ -0,0 +1,410 @@
+/*
+ * Checks SDL_MixAudio() against a plain C copy of the original mixing
+ *  code, for every format it mixes, and benchmarks it.  SDL_MixAudio()
+ *  mixes in the format the audio device was opened with, so this opens
+ *  the dummy audio driver once for each format.  SDL_MixAudioMany() is
+ *  checked against a copy that sums every voice before scaling and
+ *  clipping, and raced against mixing the voices one at a time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SDL.h"
+
+static int length = 4096;
+static int iterations = 20000;
+static int voices = 32;
+
+#define MAX_VOICES	64
+
+static const struct {
+    Uint16 format;
+    const char *name;
+} formats[] = {
+    { AUDIO_U8, "U8" },
+    { AUDIO_S8, "S8" },
+    { AUDIO_S16LSB, "S16LSB" },
+    { AUDIO_S16MSB, "S16MSB" },
+    { AUDIO_S32LSB, "S32LSB" },
+    { AUDIO_S32MSB, "S32MSB" },
+    { AUDIO_F32LSB, "F32LSB" },
+    { AUDIO_F32MSB, "F32MSB" },
+};
+
+typedef union {
+    Uint32 u;
+    float f;
+} Sample32;
+
+/* Read and write 32-bit samples in either byte order */
+static Uint32 get32(const Uint8 *p, Uint16 format)
+{
+    if (format & 0x1000) {
+        return ((Uint32)p[0] << 24) | ((Uint32)p[1] << 16) | ((Uint32)p[2] << 8) | p[3];
+    }
+    return ((Uint32)p[3] << 24) | ((Uint32)p[2] << 16) | ((Uint32)p[1] << 8) | p[0];
+}
+
+static void put32(Uint8 *p, Uint32 x, Uint16 format)
+{
+    int i;
+
+    for (i = 0; i < 4; ++i) {
+        p[(format & 0x1000) ? 3 - i : i] = (Uint8)(x >> (i * 8));
+    }
+}
+
+static double clip(double x, double min, double max)
+{
+    return (x < min) ? min : (x > max) ? max : x;
+}
+
+/* What x/128 comes to, rounded towards zero */
+static double div128(double x)
+{
+    return (x < 0) ? -floor(-x / 128.0) : floor(x / 128.0);
+}
+
+static const int volumes[] = { 1, 17, 64, 100, 127, SDL_MIX_MAXVOLUME };
+
+static void reference_mix(Uint16 format, Uint8 *dst, const Uint8 *src, int len, int volume)
+{
+    int i, s, d;
+
+    switch (format) {
+        case AUDIO_U8:
+            for (i = 0; i < len; ++i) {
+                s = ((src[i] - 128) * volume) / SDL_MIX_MAXVOLUME + 128;
+                d = dst[i] + s - 128;
+                dst[i] = (Uint8)((d < 0) ? 0 : (d > 0xFE) ? 0xFE : d);
+            }
+            break;
+        case AUDIO_S8:
+            for (i = 0; i < len; ++i) {
+                s = (((Sint8)src[i]) * volume) / SDL_MIX_MAXVOLUME;
+                d = (Sint8)dst[i] + s;
+                dst[i] = (Uint8)((d < -128) ? -128 : (d > 127) ? 127 : d);
+            }
+            break;
+        case AUDIO_S16LSB:
+        case AUDIO_S16MSB:
+            for (i = 0; i + 1 < len; i += 2) {
+                int lo = (format == AUDIO_S16LSB) ? 0 : 1;
+                s = (Sint16)(src[i+lo] | (src[i+1-lo] << 8));
+                s = (s * volume) / SDL_MIX_MAXVOLUME;
+                d = (Sint16)(dst[i+lo] | (dst[i+1-lo] << 8)) + s;
+                d = (d < -32768) ? -32768 : (d > 32767) ? 32767 : d;
+                dst[i+lo] = (Uint8)(d & 0xFF);
+                dst[i+1-lo] = (Uint8)((d >> 8) & 0xFF);
+            }
+            break;
+        case AUDIO_S32LSB:
+        case AUDIO_S32MSB:
+            for (i = 0; i + 3 < len; i += 4) {
+                double x = (Sint32)get32(dst + i, format) +
+                           div128((double)(Sint32)get32(src + i, format) * volume);
+                put32(dst + i, (Uint32)(Sint32)clip(x, -2147483648.0, 2147483647.0), format);
+            }
+            break;
+        case AUDIO_F32LSB:
+        case AUDIO_F32MSB:
+            for (i = 0; i + 3 < len; i += 4) {
+                Sample32 s32, d32;
+                s32.u = get32(src + i, format);
+                d32.u = get32(dst + i, format);
+                d32.f = d32.f + s32.f * ((float)volume / SDL_MIX_MAXVOLUME);
+                d32.f = (float)clip(d32.f, -1.0, 1.0);
+                put32(dst + i, d32.u, format);
+            }
+            break;
+    }
+}
+
+/* Add up all the products first, then scale and clip once */
+static void reference_mix_many(Uint16 format, Uint8 *dst, Uint8 **src, const int *volume,
+                               int num_src, int len)
+{
+    int i, j, s, d, total, audible;
+
+    audible = 0;
+    for (j = 0; j < num_src; ++j) {
+        audible |= volume[j];
+    }
+    if (!audible) {
+        return;
+    }
+    switch (format) {
+        case AUDIO_U8:
+        case AUDIO_S8:
+            for (i = 0; i < len; ++i) {
+                d = (format == AUDIO_U8) ? dst[i] - 128 : (Sint8)dst[i];
+                total = 0;
+                for (j = 0; j < num_src; ++j) {
+                    s = (format == AUDIO_U8) ? src[j][i] - 128 : (Sint8)src[j][i];
+                    total += s * volume[j];
+                }
+                d += total / SDL_MIX_MAXVOLUME;
+                if (format == AUDIO_U8) {
+                    dst[i] = (Uint8)((d < -128) ? 0 : (d > 126) ? 0xFE : d + 128);
+                } else {
+                    dst[i] = (Uint8)((d < -128) ? -128 : (d > 127) ? 127 : d);
+                }
+            }
+            break;
+        case AUDIO_S16LSB:
+        case AUDIO_S16MSB:
+            for (i = 0; i + 1 < len; i += 2) {
+                int lo = (format == AUDIO_S16LSB) ? 0 : 1;
+                d = (Sint16)(dst[i+lo] | (dst[i+1-lo] << 8));
+                total = 0;
+                for (j = 0; j < num_src; ++j) {
+                    s = (Sint16)(src[j][i+lo] | (src[j][i+1-lo] << 8));
+                    total += s * volume[j];
+                }
+                d += total / SDL_MIX_MAXVOLUME;
+                d = (d < -32768) ? -32768 : (d > 32767) ? 32767 : d;
+                dst[i+lo] = (Uint8)(d & 0xFF);
+                dst[i+1-lo] = (Uint8)((d >> 8) & 0xFF);
+            }
+            break;
+        case AUDIO_S32LSB:
+        case AUDIO_S32MSB:
+            for (i = 0; i + 3 < len; i += 4) {
+                double x = 0.0;
+                for (j = 0; j < num_src; ++j) {
+                    x += (double)(Sint32)get32(src[j] + i, format) * volume[j];
+                }
+                x = (Sint32)get32(dst + i, format) + div128(x);
+                put32(dst + i, (Uint32)(Sint32)clip(x, -2147483648.0, 2147483647.0), format);
+            }
+            break;
+        case AUDIO_F32LSB:
+        case AUDIO_F32MSB:
+            for (i = 0; i + 3 < len; i += 4) {
+                Sample32 s32, d32;
+                d32.u = get32(dst + i, format);
+                for (j = 0; j < num_src; ++j) {
+                    s32.u = get32(src[j] + i, format);
+                    d32.f = d32.f + s32.f * ((float)volume[j] / SDL_MIX_MAXVOLUME);
+                }
+                d32.f = (float)clip(d32.f, -1.0, 1.0);
+                put32(dst + i, d32.u, format);
+            }
+            break;
+    }
+}
+
+static void fill_random(Uint8 *buf, int len, Uint16 format)
+{
+    int i;
+
+    if ((format & 0x0100) != 0) {
+        /* Floats a bit past full scale, which has to be clipped */
+        for (i = 0; i + 3 < len; i += 4) {
+            Sample32 x;
+            x.f = (float)((rand() % 2401) - 1200) / 1000.0f;
+            put32(buf + i, x.u, format);
+        }
+        return;
+    }
+    for (i = 0; i < len; ++i) {
+        /* Plenty of values near the ends, to exercise the clipping */
+        switch (rand() % 4) {
+            case 0: buf[i] = 0x00; break;
+            case 1: buf[i] = (Uint8)(0x7F + rand() % 3); break;
+            default: buf[i] = (Uint8)rand(); break;
+        }
+    }
+}
+
+static void SDLCALL fill_silence(void *userdata, Uint8 *stream, int len)
+{
+}
+
+static int TestFormat(Uint16 format, const char *name)
+{
+    SDL_AudioSpec spec;
+    Uint8 *src, *dst, *ref;
+    Uint32 start, elapsed;
+    int i, v, len, offset, errors;
+
+    SDL_memset(&spec, 0, sizeof(spec));
+    spec.freq = 44100;
+    spec.format = format;
+    spec.channels = 2;
+    spec.samples = 1024;
+    spec.callback = fill_silence;
+    if (SDL_OpenAudio(&spec, NULL) < 0) {
+        fprintf(stderr, "Couldn't open %s audio: %s\n", name, SDL_GetError());
+        return 1;
+    }
+
+    src = (Uint8 *)malloc(length + 64);
+    dst = (Uint8 *)malloc(length + 64);
+    ref = (Uint8 *)malloc(length + 64);
+    errors = 0;
+
+    /* Odd lengths and alignments leave some for the C code to finish */
+    for (i = 0; i < 200; ++i) {
+        v = volumes[i % SDL_arraysize(volumes)];
+        len = (i < 100) ? rand() % 100 : length - rand() % 64;
+        offset = rand() % 32;
+        if ((format & 0xFF) == 32) {
+            offset &= ~3;
+        }
+        len -= len % ((format & 0xFF) / 8);
+        fill_random(src, length + 64, format);
+        fill_random(dst, length + 64, format);
+        SDL_memcpy(ref, dst, length + 64);
+        SDL_MixAudio(dst + offset, src + offset, len, v);
+        reference_mix(format, ref + offset, src + offset, len, v);
+        if (SDL_memcmp(dst, ref, length + 64) != 0) {
+            printf("%s mixing %d bytes at volume %d came out wrong!\n", name, len, v);
+            ++errors;
+            break;
+        }
+    }
+
+    fill_random(src, length, format);
+    fill_random(dst, length, format);
+    start = SDL_GetTicks();
+    for (i = 0; i < iterations; ++i) {
+        SDL_MixAudio(dst, src, length, 100);
+    }
+    elapsed = SDL_GetTicks() - start;
+    start = SDL_GetTicks();
+    for (i = 0; i < iterations; ++i) {
+        reference_mix(format, ref, src, length, 100);
+    }
+    printf("%-6s %s, %d mixes of %d bytes: SDL %d ms, reference %d ms\n",
+           name, errors ? "WRONG" : "exact", iterations, length,
+           (int)elapsed, (int)(SDL_GetTicks() - start));
+
+    free(src);
+    free(dst);
+    free(ref);
+    return errors;
+}
+
+static int TestMany(Uint16 format, const char *name)
+{
+    Uint8 *src[MAX_VOICES], *dst, *ref;
+    int volume[MAX_VOICES];
+    Uint32 start, elapsed;
+    int i, j, n, len, errors;
+
+    dst = (Uint8 *)malloc(length + 64);
+    ref = (Uint8 *)malloc(length + 64);
+    for (j = 0; j < voices; ++j) {
+        src[j] = (Uint8 *)malloc(length + 64);
+        fill_random(src[j], length + 64, format);
+    }
+    errors = 0;
+
+    for (i = 0; i < 100; ++i) {
+        /* Include some out of range volumes, which get clamped */
+        n = 1 + rand() % voices;
+        for (j = 0; j < n; ++j) {
+            volume[j] = rand() % (SDL_MIX_MAXVOLUME + 20) - 10;
+        }
+        len = (i < 50) ? rand() % 100 : length - rand() % 64;
+        len -= len % ((format & 0xFF) / 8);
+        fill_random(dst, length + 64, format);
+        SDL_memcpy(ref, dst, length + 64);
+        SDL_MixAudioMany(dst, (const Uint8 * const *)src, volume, n, len);
+        for (j = 0; j < n; ++j) {
+            volume[j] = (volume[j] < 0) ? 0 :
+                        (volume[j] > SDL_MIX_MAXVOLUME) ? SDL_MIX_MAXVOLUME : volume[j];
+        }
+        reference_mix_many(format, ref, src, volume, n, len);
+        if (SDL_memcmp(dst, ref, length + 64) != 0) {
+            printf("%s mixing %d voices of %d bytes came out wrong!\n", name, n, len);
+            ++errors;
+            break;
+        }
+
+        /* One voice has to sound just like SDL_MixAudio() */
+        fill_random(dst, length + 64, format);
+        SDL_memcpy(ref, dst, length + 64);
+        SDL_MixAudioMany(dst, (const Uint8 * const *)src, volume, 1, len);
+        SDL_MixAudio(ref, src[0], len, volume[0]);
+        if (SDL_memcmp(dst, ref, length + 64) != 0) {
+            printf("%s mixing one voice of %d bytes differs from SDL_MixAudio()!\n", name, len);
+            ++errors;
+            break;
+        }
+    }
+
+    for (j = 0; j < voices; ++j) {
+        volume[j] = 100 / voices + 1;
+    }
+    n = iterations / voices;
+    start = SDL_GetTicks();
+    for (i = 0; i < n; ++i) {
+        SDL_MixAudioMany(dst, (const Uint8 * const *)src, volume, voices, length);
+    }
+    elapsed = SDL_GetTicks() - start;
+    start = SDL_GetTicks();
+    for (i = 0; i < n; ++i) {
+        for (j = 0; j < voices; ++j) {
+            SDL_MixAudio(dst, src[j], length, volume[j]);
+        }
+    }
+    printf("%-6s %s, %d mixes of %d voices: all at once %d ms, one at a time %d ms\n",
+           name, errors ? "WRONG" : "exact", n, voices,
+           (int)elapsed, (int)(SDL_GetTicks() - start));
+
+    for (j = 0; j < voices; ++j) {
+        free(src[j]);
+    }
+    free(dst);
+    free(ref);
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--length") == 0 && argv[i+1]) {
+            length = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && argv[i+1]) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--voices") == 0 && argv[i+1]) {
+            voices = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--length N] [--iterations N] [--voices N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    /* Any driver that takes the format as given will do */
+    if (getenv("SDL_AUDIODRIVER") == NULL) {
+        SDL_putenv("SDL_AUDIODRIVER=dummy");
+    }
+    if (voices < 1 || voices > MAX_VOICES) {
+        fprintf(stderr, "Between 1 and %d voices, please\n", MAX_VOICES);
+        return 1;
+    }
+    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+    printf("SSE2 %s, AVX2 %s\n",
+           SDL_HasSSE2() ? "detected" : "not detected",
+           SDL_HasAVX2() ? "detected" : "not detected");
+
+    errors = 0;
+    for (i = 0; i < SDL_arraysize(formats); ++i) {
+        errors += TestFormat(formats[i].format, formats[i].name);
+        errors += TestMany(formats[i].format, formats[i].name);
+        SDL_CloseAudio();
+    }
+
+    SDL_Quit();
+    return (errors != 0);
+}
@@ -0,0 +1,272 @@
+/*
+ * Checks and benchmarks sample rate conversion through SDL_ConvertAudio(),
+ *  measuring the signal to noise ratio of a resampled sine wave against
+ *  the ideal sine at the output rate.  Also checks that an audio stream
+ *  gives the same result however its input is broken up, and that many
+ *  different ratios, and converters built before the audio subsystem was
+ *  shut down, still get the right filter.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SDL.h"
+
+#ifndef M_PI
+#define M_PI	3.14159265358979323846
+#endif
+
+static int seconds = 10;
+static double min_snr = 70.0;
+
+static const struct {
+    int src_rate;
+    int dst_rate;
+    double freq;
+} tests[] = {
+    { 44100, 48000, 1000.0 },
+    { 48000, 44100, 1000.0 },
+    { 22050, 44100, 1000.0 },
+    { 44100, 22050, 1000.0 },
+    { 11025, 48000, 3000.0 },
+    { 48000, 8000, 440.0 },
+    { 44100, 48000, 15000.0 },
+    { 32000, 44100, 12000.0 },
+};
+
+static double ideal(double freq, int rate, int frame)
+{
+    return 16384.0 * sin(2.0 * M_PI * freq * frame / rate);
+}
+
+/* Resample a sine wave once and see how close it comes to the real thing.
+   With 'restart' set, the audio subsystem is started and shut down between
+   building the converter and using it. */
+static int TestSNR(int src_rate, int dst_rate, double freq, double *snr, int restart)
+{
+    SDL_AudioCVT cvt;
+    Sint16 *samples;
+    double signal, noise;
+    int frames, out_frames, skip;
+    int i;
+
+    if (SDL_BuildAudioCVT(&cvt, AUDIO_S16SYS, 2, src_rate,
+                                AUDIO_S16SYS, 2, dst_rate) < 0) {
+        fprintf(stderr, "Couldn't build converter: %s\n", SDL_GetError());
+        return -1;
+    }
+    if (restart) {
+        if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+            fprintf(stderr, "Couldn't initialize audio: %s\n", SDL_GetError());
+            return -1;
+        }
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
+    frames = src_rate / 4;
+    cvt.len = frames * 4;
+    cvt.buf = (Uint8 *)malloc(cvt.len * cvt.len_mult);
+    if (cvt.buf == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+    samples = (Sint16 *)cvt.buf;
+    for (i = 0; i < frames; ++i) {
+        samples[i*2+0] = (Sint16)floor(ideal(freq, src_rate, i) + 0.5);
+        samples[i*2+1] = -samples[i*2+0];
+    }
+    if (SDL_ConvertAudio(&cvt) < 0) {
+        fprintf(stderr, "Couldn't convert audio: %s\n", SDL_GetError());
+        free(cvt.buf);
+        return -1;
+    }
+    out_frames = cvt.len_cvt / 4;
+
+    /* Leave out the edges, where there's no input to filter */
+    skip = dst_rate / 100;
+    signal = noise = 0.0;
+    for (i = skip; i < out_frames - skip; ++i) {
+        double want = ideal(freq, dst_rate, i);
+        double diff = samples[i*2+0] - want;
+        signal += want * want;
+        noise += diff * diff;
+        diff = samples[i*2+1] + want;
+        noise += diff * diff;
+    }
+    signal *= 2.0;
+    *snr = (noise > 0.0) ? 10.0 * log10(signal / noise) : 200.0;
+    free(cvt.buf);
+    return out_frames;
+}
+
+/* Run a whole buffer through a stream, in pieces of up to 'chunk' bytes */
+static Uint8 *Stream(SDL_AudioStream *stream, const Uint8 *data, int len,
+                     int chunk, int *out_len)
+{
+    Uint8 *out;
+    int n, got, max;
+
+    max = len * 16 + 4096;
+    out = (Uint8 *)malloc(max);
+    got = 0;
+    while (len > 0) {
+        n = chunk ? 1 + rand() % chunk : len;
+        if (n > len) {
+            n = len;
+        }
+        SDL_AudioStreamPut(stream, data, n);
+        data += n;
+        len -= n;
+        /* Read some of it back now and then */
+        if (chunk && (rand() % 2)) {
+            got += SDL_AudioStreamGet(stream, out + got, rand() % (chunk * 4));
+        }
+    }
+    SDL_AudioStreamFlush(stream);
+    got += SDL_AudioStreamGet(stream, out + got, max - got);
+    *out_len = got;
+    return out;
+}
+
+/* Pieces of any size have to come out the same as one big piece */
+static int TestStream(Uint16 src_format, Uint8 src_channels, int src_rate,
+                      Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+    SDL_AudioStream *stream;
+    Uint8 *data, *whole, *pieces;
+    int i, len, whole_len, pieces_len, expect, frame, errors;
+
+    stream = SDL_NewAudioStream(src_format, src_channels, src_rate,
+                                dst_format, dst_channels, dst_rate);
+    if (stream == NULL) {
+        fprintf(stderr, "Couldn't create audio stream: %s\n", SDL_GetError());
+        return 1;
+    }
+    len = src_rate / 2 * src_channels * ((src_format & 0xFF) / 8);
+    data = (Uint8 *)malloc(len);
+    for (i = 0; i < len; ++i) {
+        data[i] = (Uint8)(128 + 100 * sin(i * 0.01));
+    }
+    whole = Stream(stream, data, len, 0, &whole_len);
+    SDL_AudioStreamClear(stream);
+    pieces = Stream(stream, data, len, 1000, &pieces_len);
+    SDL_FreeAudioStream(stream);
+
+    frame = (dst_format & 0xFF) / 8 * dst_channels;
+    expect = (int)ceil((double)(src_rate / 2) * dst_rate / src_rate) * frame;
+    printf("Stream %04x/%d/%5d -> %04x/%d/%5d: %d bytes whole, %d bytes in pieces\n",
+           src_format, src_channels, src_rate, dst_format, dst_channels, dst_rate,
+           whole_len, pieces_len);
+    errors = 0;
+    if (whole_len != expect || pieces_len != whole_len) {
+        printf("  Expected %d bytes!\n", expect);
+        ++errors;
+    } else if (memcmp(whole, pieces, whole_len) != 0) {
+        printf("  The data came out different!\n");
+        ++errors;
+    }
+    free(data);
+    free(whole);
+    free(pieces);
+    return errors;
+}
+
+/* Resample a long noisy buffer to see how fast it goes */
+static double Benchmark(int src_rate, int dst_rate, int channels)
+{
+    SDL_AudioCVT cvt;
+    Sint16 *samples;
+    Uint32 start, elapsed;
+    int i, n;
+
+    if (SDL_BuildAudioCVT(&cvt, AUDIO_S16SYS, channels, src_rate,
+                                AUDIO_S16SYS, channels, dst_rate) < 0) {
+        return 0.0;
+    }
+    n = src_rate * seconds * channels;
+    cvt.buf = (Uint8 *)malloc(n * 2 * cvt.len_mult);
+    if (cvt.buf == NULL) {
+        return 0.0;
+    }
+    samples = (Sint16 *)cvt.buf;
+    for (i = 0; i < n; ++i) {
+        samples[i] = (Sint16)(rand() - RAND_MAX / 2);
+    }
+    cvt.len = n * 2;
+    start = SDL_GetTicks();
+    SDL_ConvertAudio(&cvt);
+    elapsed = SDL_GetTicks() - start;
+    free(cvt.buf);
+    return (double)src_rate * seconds * 1000.0 / (elapsed ? elapsed : 1);
+}
+
+int main(int argc, char *argv[])
+{
+    double snr;
+    int i, frames, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && argv[i+1]) {
+            seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--min-snr") == 0 && argv[i+1]) {
+            min_snr = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--seconds N] [--min-snr dB]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (getenv("SDL_AUDIODRIVER") == NULL) {
+        SDL_putenv("SDL_AUDIODRIVER=dummy");
+    }
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+    printf("SSE2 %s\n", SDL_HasSSE2() ? "detected" : "not detected");
+
+    errors = 0;
+    for (i = 0; i < SDL_arraysize(tests); ++i) {
+        frames = TestSNR(tests[i].src_rate, tests[i].dst_rate, tests[i].freq, &snr, 0);
+        if (frames < 0) {
+            ++errors;
+            continue;
+        }
+        printf("%5d -> %5d Hz, %5.0f Hz sine: %d frames, SNR %.1f dB\n",
+               tests[i].src_rate, tests[i].dst_rate, tests[i].freq, frames, snr);
+        if (frames != (int)((double)(tests[i].src_rate / 4) * tests[i].dst_rate / tests[i].src_rate) ||
+            snr < min_snr) {
+            printf("  That's not good enough!\n");
+            ++errors;
+        }
+    }
+
+    /* Each of these needs a filter of its own, with its cutoff close
+       above the sine.  Odd ratios come out a little noisier. */
+    for (i = 0; i < 40; ++i) {
+        int dst_rate = 8000 + i * 1000;
+        double freq = dst_rate * 0.4;
+        frames = TestSNR(48000, dst_rate, freq, &snr, (i % 10) == 9);
+        if (frames < 0 || snr < min_snr - 10.0) {
+            printf("48000 -> %5d Hz, %5.0f Hz sine: SNR %.1f dB, that's not good enough!\n",
+                   dst_rate, freq, snr);
+            ++errors;
+        }
+    }
+
+    errors += TestStream(AUDIO_S16SYS, 2, 44100, AUDIO_S16SYS, 2, 48000);
+    errors += TestStream(AUDIO_S16SYS, 2, 48000, AUDIO_S16SYS, 2, 8000);
+    errors += TestStream(AUDIO_U8, 1, 22050, AUDIO_S16MSB, 2, 44100);
+    errors += TestStream(AUDIO_S16LSB, 6, 48000, AUDIO_U8, 2, 32000);
+    errors += TestStream(AUDIO_U16LSB, 2, 44100, AUDIO_S8, 1, 44100);
+    errors += TestStream(AUDIO_F32SYS, 2, 44100, AUDIO_S16SYS, 2, 48000);
+    errors += TestStream(AUDIO_S16SYS, 1, 22050, AUDIO_F32MSB, 2, 48000);
+
+    printf("44100 -> 48000 Hz stereo: %.0f frames/s\n", Benchmark(44100, 48000, 2));
+    printf("48000 -> 44100 Hz stereo: %.0f frames/s\n", Benchmark(48000, 44100, 2));
+    printf("48000 ->  8000 Hz mono:   %.0f frames/s\n", Benchmark(48000, 8000, 1));
+
+    SDL_Quit();
+    return (errors != 0);
+}
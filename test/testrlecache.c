@@ -0,0 +1,238 @@
+/*
+ * Checks that RLE accelerated sprites blitted back and forth between
+ *  destinations of different formats come out the same as sprites that
+ *  are only ever blitted to one of them, and that changing the sprite
+ *  throws away what was encoded before.  Then compares how long blits
+ *  take when they keep changing destination against a single destination.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define SPRITE_W	64
+#define SPRITE_H	64
+
+static int blits = 2000;
+
+static SDL_Surface *CreateDest(int bpp)
+{
+    if (bpp == 16) {
+        return SDL_CreateRGBSurface(SDL_SWSURFACE, 256, 256, 16, 0xF800, 0x07E0, 0x001F, 0);
+    }
+    return SDL_CreateRGBSurface(SDL_SWSURFACE, 256, 256, 32, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+}
+
+/* Random translucent blobs on a transparent background */
+static SDL_Surface *CreateAlphaSprite(unsigned int seed)
+{
+    SDL_Surface *sprite;
+    Uint32 *pixel;
+    int x, y, dx, dy;
+    Uint8 a;
+
+    sprite = SDL_CreateRGBSurface(SDL_SWSURFACE, SPRITE_W, SPRITE_H, 32,
+                                  0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    srand(seed);
+    for (y = 0; y < SPRITE_H; ++y) {
+        pixel = (Uint32 *)((Uint8 *)sprite->pixels + y * sprite->pitch);
+        for (x = 0; x < SPRITE_W; ++x) {
+            dx = x - SPRITE_W / 2;
+            dy = y - SPRITE_H / 2;
+            if (dx * dx + dy * dy > (SPRITE_W / 2) * (SPRITE_W / 2)) {
+                a = 0;
+            } else if (rand() % 4 == 0) {
+                a = (Uint8)rand();
+            } else {
+                a = 255;
+            }
+            pixel[x] = ((Uint32)a << 24) | (rand() & 0xFFFFFF);
+        }
+    }
+    SDL_SetAlpha(sprite, SDL_SRCALPHA | SDL_RLEACCEL, 255);
+    return sprite;
+}
+
+static SDL_Surface *CreateColorkeySprite(unsigned int seed)
+{
+    SDL_Surface *sprite;
+    Uint16 *pixel;
+    int x, y;
+
+    sprite = SDL_CreateRGBSurface(SDL_SWSURFACE, SPRITE_W, SPRITE_H, 16, 0xF800, 0x07E0, 0x001F, 0);
+    srand(seed);
+    for (y = 0; y < SPRITE_H; ++y) {
+        pixel = (Uint16 *)((Uint8 *)sprite->pixels + y * sprite->pitch);
+        for (x = 0; x < SPRITE_W; ++x) {
+            pixel[x] = (rand() % 3 == 0) ? 0 : (Uint16)(rand() | 1);
+        }
+    }
+    SDL_SetColorKey(sprite, SDL_SRCCOLORKEY | SDL_RLEACCEL, 0);
+    return sprite;
+}
+
+static void Blit(SDL_Surface *sprite, SDL_Surface *dst, int x, int y)
+{
+    SDL_Rect rect;
+
+    rect.x = x;
+    rect.y = y;
+    SDL_BlitSurface(sprite, NULL, dst, &rect);
+}
+
+static int Compare(SDL_Surface *a, SDL_Surface *b, const char *what)
+{
+    int y;
+
+    for (y = 0; y < a->h; ++y) {
+        if (memcmp((Uint8 *)a->pixels + y * a->pitch, (Uint8 *)b->pixels + y * b->pitch,
+                   a->w * a->format->BytesPerPixel) != 0) {
+            printf("%s came out different at row %d!\n", what, y);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Change the middle of the sprite, the way a program would */
+static void Scribble(SDL_Surface *sprite)
+{
+    SDL_Rect rect;
+
+    rect.x = SPRITE_W / 4;
+    rect.y = SPRITE_H / 4;
+    rect.w = SPRITE_W / 2;
+    rect.h = 4;
+    SDL_FillRect(sprite, &rect, SDL_MapRGBA(sprite->format, 0x12, 0x34, 0x56, 0xFF));
+}
+
+/* One sprite goes back and forth, the others stay on their own format */
+static int TestSprites(SDL_Surface *(*create)(unsigned int), int bpp[2], const char *what)
+{
+    SDL_Surface *sprite, *single[2], *dst[2], *expected[2];
+    int i, j, errors = 0;
+
+    sprite = create(1);
+    for (j = 0; j < 2; ++j) {
+        single[j] = create(1);
+        dst[j] = CreateDest(bpp[j]);
+        expected[j] = CreateDest(bpp[j]);
+    }
+    for (i = 0; i < 20; ++i) {
+        if (i == 10) {
+            Scribble(sprite);
+            Scribble(single[0]);
+            Scribble(single[1]);
+        }
+        for (j = 0; j < 2; ++j) {
+            Blit(sprite, dst[j], i * 9, i * 7);
+            Blit(single[j], expected[j], i * 9, i * 7);
+        }
+    }
+    if (!(sprite->flags & SDL_RLEACCEL)) {
+        printf("%s sprite isn't RLE accelerated!\n", what);
+        ++errors;
+    }
+    for (j = 0; j < 2 && !errors; ++j) {
+        errors += Compare(dst[j], expected[j], what);
+    }
+    SDL_FreeSurface(sprite);
+    for (j = 0; j < 2; ++j) {
+        SDL_FreeSurface(single[j]);
+        SDL_FreeSurface(dst[j]);
+        SDL_FreeSurface(expected[j]);
+    }
+    return errors;
+}
+
+/* Changing the colorkey makes it encode again */
+static int TestColorkeyChange(void)
+{
+    SDL_Surface *sprite, *single, *dst[2], *expected;
+    int i, errors = 0;
+
+    sprite = CreateColorkeySprite(2);
+    single = CreateColorkeySprite(2);
+    dst[0] = CreateDest(16);
+    dst[1] = CreateDest(16);
+    expected = CreateDest(16);
+    for (i = 0; i < 4; ++i) {
+        Blit(sprite, dst[i % 2], 0, 0);
+    }
+    SDL_SetColorKey(sprite, SDL_SRCCOLORKEY | SDL_RLEACCEL, 0xFFFF);
+    SDL_SetColorKey(single, SDL_SRCCOLORKEY | SDL_RLEACCEL, 0xFFFF);
+    SDL_FillRect(dst[0], NULL, 0);
+    Blit(sprite, dst[1], 0, 0);
+    Blit(sprite, dst[0], 0, 0);
+    Blit(single, expected, 0, 0);
+    errors += Compare(dst[0], expected, "A sprite with a new colorkey");
+
+    SDL_FreeSurface(sprite);
+    SDL_FreeSurface(single);
+    SDL_FreeSurface(dst[0]);
+    SDL_FreeSurface(dst[1]);
+    SDL_FreeSurface(expected);
+    return errors;
+}
+
+static void Benchmark(void)
+{
+    SDL_Surface *sprite, *dst[2];
+    Uint32 start, elapsed[2];
+    int i;
+
+    sprite = CreateAlphaSprite(3);
+    dst[0] = CreateDest(16);
+    dst[1] = CreateDest(32);
+
+    start = SDL_GetTicks();
+    for (i = 0; i < blits; ++i) {
+        Blit(sprite, dst[0], i % 192, i % 160);
+    }
+    elapsed[0] = SDL_GetTicks() - start;
+
+    start = SDL_GetTicks();
+    for (i = 0; i < blits; ++i) {
+        Blit(sprite, dst[i % 2], i % 192, i % 160);
+    }
+    elapsed[1] = SDL_GetTicks() - start;
+
+    printf("%d blits of a %dx%d sprite: %d ms to one destination, %d ms alternating 16 and 32 bit\n",
+           blits, SPRITE_W, SPRITE_H, (int)elapsed[0], (int)elapsed[1]);
+    SDL_FreeSurface(sprite);
+    SDL_FreeSurface(dst[0]);
+    SDL_FreeSurface(dst[1]);
+}
+
+int main(int argc, char *argv[])
+{
+    int alpha_bpp[2] = { 32, 16 };
+    int colorkey_bpp[2] = { 16, 16 };
+    int i, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--blits") == 0 && argv[i+1]) {
+            blits = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--blits N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    errors = TestSprites(CreateAlphaSprite, alpha_bpp, "An alpha");
+    errors += TestSprites(CreateColorkeySprite, colorkey_bpp, "A colorkey");
+    errors += TestColorkeyChange();
+    printf("RLE sprites %s\n", errors ? "FAILED" : "match blitting to one destination");
+
+    Benchmark();
+
+    SDL_Quit();
+    return (errors != 0);
+}
@@ -0,0 +1,243 @@
+/*
+ * Checks that reads made with SDL_RWreadAsync() get the same data as
+ *  reading the same places in order, that requests still waiting can be
+ *  cancelled, and that finished reads come back as events.  Then compares
+ *  how long the calling thread is kept busy each way with a slow file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define DATA_SIZE	100000
+#define MAX_REQUESTS	64
+
+static int delay = 5;
+
+/* A memory data source that takes a while to read */
+static int SDLCALL slow_seek(SDL_RWops *context, int offset, int whence)
+{
+    SDL_RWops *mem = (SDL_RWops *)context->hidden.unknown.data1;
+    return SDL_RWseek(mem, offset, whence);
+}
+
+static int SDLCALL slow_read(SDL_RWops *context, void *ptr, int size, int maxnum)
+{
+    SDL_RWops *mem = (SDL_RWops *)context->hidden.unknown.data1;
+    SDL_Delay(delay);
+    return SDL_RWread(mem, ptr, size, maxnum);
+}
+
+static int SDLCALL slow_write(SDL_RWops *context, const void *ptr, int size, int num)
+{
+    return -1;
+}
+
+static int SDLCALL slow_close(SDL_RWops *context)
+{
+    SDL_RWclose((SDL_RWops *)context->hidden.unknown.data1);
+    SDL_FreeRW(context);
+    return 0;
+}
+
+static SDL_RWops *SlowMem(void *mem, int size)
+{
+    SDL_RWops *rwops = SDL_AllocRW();
+
+    rwops->seek = slow_seek;
+    rwops->read = slow_read;
+    rwops->write = slow_write;
+    rwops->close = slow_close;
+    rwops->hidden.unknown.data1 = SDL_RWFromMem(mem, size);
+    return rwops;
+}
+
+static Uint8 data[DATA_SIZE];
+static Uint8 got[MAX_REQUESTS][2000];
+
+/* Random reads from two data sources at once */
+static int TestReads(void)
+{
+    SDL_RWops *src[2];
+    SDL_RWAsync *requests[MAX_REQUESTS];
+    int offsets[MAX_REQUESTS], sizes[MAX_REQUESTS];
+    int i, result, expected, errors = 0;
+
+    src[0] = SDL_RWFromConstMem(data, DATA_SIZE);
+    src[1] = SlowMem(data, DATA_SIZE);
+    for (i = 0; i < MAX_REQUESTS; ++i) {
+        offsets[i] = rand() % (DATA_SIZE + 1);
+        sizes[i] = rand() % sizeof(got[i]) + 1;
+        requests[i] = SDL_RWreadAsync(src[i % 2], offsets[i], got[i], sizes[i], SDL_NOEVENT, NULL);
+        if (requests[i] == NULL) {
+            printf("Couldn't start a read: %s\n", SDL_GetError());
+            return 1;
+        }
+    }
+    for (i = 0; i < MAX_REQUESTS; ++i) {
+        /* Some of them are waited for, some polled */
+        if (i % 3 == 0) {
+            while (!SDL_RWpollAsync(requests[i])) {
+                SDL_Delay(1);
+            }
+        }
+        result = SDL_RWwaitAsync(requests[i]);
+        expected = SDL_min(sizes[i], DATA_SIZE - offsets[i]);
+        if (result != expected || memcmp(got[i], data + offsets[i], expected) != 0) {
+            printf("Reading %d bytes at %d got %d, not %d\n", sizes[i], offsets[i], result, expected);
+            ++errors;
+        }
+    }
+
+    /* Reading from where it is carries on from the last read */
+    SDL_RWseek(src[0], 1000, RW_SEEK_SET);
+    for (i = 0; i < 4; ++i) {
+        requests[i] = SDL_RWreadAsync(src[0], -1, got[i], 100, SDL_NOEVENT, NULL);
+    }
+    for (i = 0; i < 4; ++i) {
+        if (SDL_RWwaitAsync(requests[i]) != 100) {
+            ++errors;
+        }
+    }
+    if (SDL_RWtell(src[0]) != 1400) {
+        printf("Reading from the current position ended at %d, not 1400\n", SDL_RWtell(src[0]));
+        ++errors;
+    }
+    SDL_RWclose(src[0]);
+    SDL_RWclose(src[1]);
+    return errors;
+}
+
+static int TestCancel(void)
+{
+    SDL_RWops *src;
+    SDL_RWAsync *requests[MAX_REQUESTS];
+    const char *threads;
+    int i, result, cancelled = 0, errors = 0;
+
+    src = SlowMem(data, DATA_SIZE);
+    for (i = 0; i < MAX_REQUESTS; ++i) {
+        requests[i] = SDL_RWreadAsync(src, i * 100, got[i], 100, SDL_NOEVENT, NULL);
+    }
+    for (i = MAX_REQUESTS - 1; i >= 0; --i) {
+        result = SDL_RWcancelAsync(requests[i]);
+        if (result < 0) {
+            ++cancelled;
+        } else if (result != 100 || memcmp(got[i], data + i * 100, 100) != 0) {
+            printf("A read that wasn't cancelled got %d bytes\n", result);
+            ++errors;
+        }
+    }
+    /* Without I/O threads, each one is read before it can be cancelled */
+    threads = SDL_getenv("SDL_RWOPS_THREADS");
+    if (cancelled == 0 && !(threads && atoi(threads) == 0)) {
+        printf("None of %d slow reads could be cancelled!\n", MAX_REQUESTS);
+        ++errors;
+    }
+    SDL_RWclose(src);
+    return errors;
+}
+
+static int TestEvents(void)
+{
+    SDL_RWops *src;
+    SDL_RWAsync *requests[8];
+    SDL_Event event;
+    int i, received = 0, errors = 0;
+
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
+        printf("Couldn't initialize video, skipping events: %s\n", SDL_GetError());
+        return 0;
+    }
+    src = SDL_RWFromConstMem(data, DATA_SIZE);
+    for (i = 0; i < 8; ++i) {
+        requests[i] = SDL_RWreadAsync(src, i * 500, got[i], 500, SDL_USEREVENT, &requests[i]);
+    }
+    while (received < 8 && SDL_WaitEvent(&event)) {
+        if (event.type != SDL_USEREVENT) {
+            continue;
+        }
+        if (*(SDL_RWAsync **)event.user.data2 != event.user.data1 || event.user.code != 500) {
+            printf("A read came back with the wrong request or result!\n");
+            ++errors;
+        }
+        if (SDL_RWwaitAsync((SDL_RWAsync *)event.user.data1) != 500) {
+            ++errors;
+        }
+        ++received;
+    }
+    for (i = 0; i < 8; ++i) {
+        if (memcmp(got[i], data + i * 500, 500) != 0) {
+            printf("Read %d got the wrong data!\n", i);
+            ++errors;
+        }
+    }
+    SDL_RWclose(src);
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    return errors;
+}
+
+/* How long until the calling thread can get on with other things */
+static void Benchmark(void)
+{
+    SDL_RWops *src;
+    SDL_RWAsync *requests[16];
+    Uint32 start, elapsed[3];
+    int i;
+
+    src = SlowMem(data, DATA_SIZE);
+    start = SDL_GetTicks();
+    for (i = 0; i < 16; ++i) {
+        SDL_RWseek(src, i * 1000, RW_SEEK_SET);
+        SDL_RWread(src, got[i], 1, 1000);
+    }
+    elapsed[0] = SDL_GetTicks() - start;
+
+    start = SDL_GetTicks();
+    for (i = 0; i < 16; ++i) {
+        requests[i] = SDL_RWreadAsync(src, i * 1000, got[i], 1000, SDL_NOEVENT, NULL);
+    }
+    elapsed[1] = SDL_GetTicks() - start;
+    for (i = 0; i < 16; ++i) {
+        SDL_RWwaitAsync(requests[i]);
+    }
+    elapsed[2] = SDL_GetTicks() - start;
+    SDL_RWclose(src);
+
+    printf("Reading 16 blocks taking %d ms each: %d ms, %d ms to start async, %d ms to finish\n",
+           delay, (int)elapsed[0], (int)elapsed[1], (int)elapsed[2]);
+}
+
+int main(int argc, char *argv[])
+{
+    int i, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--delay") == 0 && argv[i+1]) {
+            delay = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--delay MS]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+    for (i = 0; i < DATA_SIZE; ++i) {
+        data[i] = (Uint8)rand();
+    }
+
+    errors = TestReads();
+    errors += TestCancel();
+    errors += TestEvents();
+    printf("Asynchronous reads %s\n", errors ? "FAILED" : "match reading in order");
+
+    Benchmark();
+
+    SDL_Quit();
+    return (errors != 0);
+}
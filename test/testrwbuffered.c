@@ -0,0 +1,239 @@
+/*
+ * Checks that SDL_RWFromBuffered() reads, writes and seeks the same as the
+ *  data source under it, over random sequences of calls, and compares how
+ *  many calls loading a BMP file makes to a data source with and without
+ *  a buffer in between.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define DATA_SIZE	10000
+
+static int loads = 200;
+
+/* A memory data source that counts the calls made to it */
+static int calls;
+
+static int SDLCALL counted_seek(SDL_RWops *context, int offset, int whence)
+{
+    SDL_RWops *mem = (SDL_RWops *)context->hidden.unknown.data1;
+    ++calls;
+    return SDL_RWseek(mem, offset, whence);
+}
+
+static int SDLCALL counted_read(SDL_RWops *context, void *ptr, int size, int maxnum)
+{
+    SDL_RWops *mem = (SDL_RWops *)context->hidden.unknown.data1;
+    ++calls;
+    return SDL_RWread(mem, ptr, size, maxnum);
+}
+
+static int SDLCALL counted_write(SDL_RWops *context, const void *ptr, int size, int num)
+{
+    SDL_RWops *mem = (SDL_RWops *)context->hidden.unknown.data1;
+    ++calls;
+    return SDL_RWwrite(mem, ptr, size, num);
+}
+
+static int SDLCALL counted_close(SDL_RWops *context)
+{
+    SDL_RWclose((SDL_RWops *)context->hidden.unknown.data1);
+    SDL_FreeRW(context);
+    return 0;
+}
+
+static SDL_RWops *CountedMem(void *mem, int size)
+{
+    SDL_RWops *rwops = SDL_AllocRW();
+
+    rwops->seek = counted_seek;
+    rwops->read = counted_read;
+    rwops->write = counted_write;
+    rwops->close = counted_close;
+    rwops->hidden.unknown.data1 = SDL_RWFromMem(mem, size);
+    return rwops;
+}
+
+/* Do the same random things to both, and make sure they agree */
+static int TestRandom(int bufsize)
+{
+    static Uint8 a[DATA_SIZE], b[DATA_SIZE];
+    Uint8 got_a[500], got_b[500];
+    SDL_RWops *plain, *buffered;
+    int i, n, pos, offset, whence, result_a, result_b, errors = 0;
+
+    for (i = 0; i < DATA_SIZE; ++i) {
+        a[i] = b[i] = (Uint8)rand();
+    }
+    plain = SDL_RWFromMem(a, DATA_SIZE);
+    buffered = SDL_RWFromBuffered(CountedMem(b, DATA_SIZE), bufsize, 1);
+
+    for (i = 0; i < 5000 && !errors; ++i) {
+        n = rand() % sizeof(got_a) + 1;
+        switch (rand() % 4) {
+            case 0:
+            case 1:
+                result_a = SDL_RWread(plain, got_a, 1, n);
+                result_b = SDL_RWread(buffered, got_b, 1, n);
+                if (result_a != result_b || memcmp(got_a, got_b, result_a) != 0) {
+                    printf("Reading %d bytes got %d, not %d\n", n, result_b, result_a);
+                    ++errors;
+                }
+                break;
+            case 2:
+                /* Memory can't grow, so stay inside it */
+                pos = SDL_RWtell(plain);
+                n = SDL_min(n, DATA_SIZE - pos);
+                if (n == 0) {
+                    break;
+                }
+                memset(got_a, i, n);
+                result_a = SDL_RWwrite(plain, got_a, 1, n);
+                result_b = SDL_RWwrite(buffered, got_a, 1, n);
+                if (result_a != result_b) {
+                    printf("Writing %d bytes wrote %d, not %d\n", n, result_b, result_a);
+                    ++errors;
+                }
+                break;
+            default:
+                whence = rand() % 3;
+                offset = (whence == RW_SEEK_SET) ? rand() % (DATA_SIZE + 1) :
+                         (whence == RW_SEEK_CUR) ? rand() % 2000 - 1000 : -(rand() % 100);
+                result_a = SDL_RWseek(plain, offset, whence);
+                result_b = SDL_RWseek(buffered, offset, whence);
+                if (result_a != result_b) {
+                    printf("Seeking %d from %d went to %d, not %d\n", offset, whence, result_b, result_a);
+                    ++errors;
+                }
+                break;
+        }
+    }
+    if (SDL_RWsize(buffered) != DATA_SIZE) {
+        printf("The size came out wrong!\n");
+        ++errors;
+    }
+    SDL_RWclose(plain);
+    SDL_RWclose(buffered);
+    if (memcmp(a, b, DATA_SIZE) != 0) {
+        printf("What was written came out different!\n");
+        ++errors;
+    }
+    return errors;
+}
+
+/* Without closing the data source under it, that's left where we were */
+static int TestNoClose(void)
+{
+    static Uint8 data[DATA_SIZE];
+    SDL_RWops *mem, *buffered;
+    Uint8 buf[10];
+    int errors = 0;
+
+    mem = SDL_RWFromMem(data, DATA_SIZE);
+    SDL_RWseek(mem, 100, RW_SEEK_SET);
+    buffered = SDL_RWFromBuffered(mem, 1000, 0);
+    SDL_RWread(buffered, buf, 1, sizeof(buf));
+    if (SDL_RWtell(buffered) != 110 || SDL_RWtell(mem) != 1100) {
+        printf("The buffer didn't read ahead from the right place!\n");
+        ++errors;
+    }
+    SDL_RWclose(buffered);
+    if (SDL_RWtell(mem) != 110) {
+        printf("The data source was left at %d, not 110\n", SDL_RWtell(mem));
+        ++errors;
+    }
+    SDL_RWclose(mem);
+    return errors;
+}
+
+static void *SaveBMP(int *size)
+{
+    SDL_Surface *surface;
+    static Uint8 file[300000];
+    SDL_RWops *dst;
+    int i;
+
+    surface = SDL_CreateRGBSurface(SDL_SWSURFACE, 255, 255, 24, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+    for (i = 0; i < surface->h * surface->pitch; ++i) {
+        ((Uint8 *)surface->pixels)[i] = (Uint8)rand();
+    }
+    dst = SDL_RWFromMem(file, sizeof(file));
+    SDL_SaveBMP_RW(surface, dst, 0);
+    *size = SDL_RWtell(dst);
+    SDL_RWclose(dst);
+    SDL_FreeSurface(surface);
+    return file;
+}
+
+static int Benchmark(void)
+{
+    SDL_Surface *plain, *buffered;
+    Uint32 start, elapsed[2];
+    int i, plain_calls, buffered_calls, size, errors = 0;
+    void *file;
+
+    file = SaveBMP(&size);
+    plain = SDL_LoadBMP_RW(CountedMem(file, size), 1);
+    buffered = SDL_LoadBMP_RW(SDL_RWFromBuffered(CountedMem(file, size), 0, 1), 1);
+    if (plain == NULL || buffered == NULL ||
+        memcmp(plain->pixels, buffered->pixels, plain->h * plain->pitch) != 0) {
+        printf("Loading through a buffer came out different!\n");
+        ++errors;
+    }
+    SDL_FreeSurface(plain);
+    SDL_FreeSurface(buffered);
+
+    calls = 0;
+    start = SDL_GetTicks();
+    for (i = 0; i < loads; ++i) {
+        SDL_FreeSurface(SDL_LoadBMP_RW(CountedMem(file, size), 1));
+    }
+    elapsed[0] = SDL_GetTicks() - start;
+    plain_calls = calls / loads;
+
+    calls = 0;
+    start = SDL_GetTicks();
+    for (i = 0; i < loads; ++i) {
+        SDL_FreeSurface(SDL_LoadBMP_RW(SDL_RWFromBuffered(CountedMem(file, size), 0, 1), 1));
+    }
+    elapsed[1] = SDL_GetTicks() - start;
+    buffered_calls = calls / loads;
+
+    printf("Loading a %d byte BMP: %d calls, %d ms for %d loads; buffered, %d calls, %d ms\n",
+           size, plain_calls, (int)elapsed[0], loads, buffered_calls, (int)elapsed[1]);
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loads") == 0 && argv[i+1]) {
+            loads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--loads N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    errors = TestRandom(7);
+    errors += TestRandom(100);
+    errors += TestRandom(4096);
+    errors += TestNoClose();
+    printf("Buffered data sources %s\n", errors ? "FAILED" : "match the data source");
+
+    errors += Benchmark();
+
+    SDL_Quit();
+    return (errors != 0);
+}
@@ -0,0 +1,310 @@
+/*
+ * Checks SDL_SoftStretchFiltered() against a straightforward version of
+ *  each filter, between surfaces of the same and different formats, and
+ *  that SDL_STRETCH_NEAREST picks the same pixels as SDL_SoftStretch().
+ *  Then times stretching a 640x480 surface up to 1920x1080 and back down.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+static int frames = 10;
+
+static const char *filter_names[] = { "nearest", "bilinear", "box" };
+
+static SDL_Surface *CreateSurface(int w, int h, int bpp, int alpha)
+{
+    if (bpp == 16) {
+        return SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 16, 0xF800, 0x07E0, 0x001F, 0);
+    }
+    if (bpp == 24) {
+        return SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 24, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+    }
+    return SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32, 0x000000FF, 0x0000FF00,
+                                0x00FF0000, alpha ? 0xFF000000 : 0);
+}
+
+static Uint32 GetPixel(SDL_Surface *surface, int x, int y)
+{
+    Uint8 *p = (Uint8 *)surface->pixels + y * surface->pitch + x * surface->format->BytesPerPixel;
+
+    switch (surface->format->BytesPerPixel) {
+        case 2:
+            return *(Uint16 *)p;
+        case 3:
+            if (SDL_BYTEORDER == SDL_LIL_ENDIAN) {
+                return p[0] | (p[1] << 8) | (p[2] << 16);
+            } else {
+                return (p[0] << 16) | (p[1] << 8) | p[2];
+            }
+        default:
+            return *(Uint32 *)p;
+    }
+}
+
+static void Fill(SDL_Surface *surface)
+{
+    Uint8 r, g, b, a;
+    int x, y;
+
+    SDL_LockSurface(surface);
+    for (y = 0; y < surface->h; ++y) {
+        for (x = 0; x < surface->w; ++x) {
+            Uint8 *p = (Uint8 *)surface->pixels + y * surface->pitch + x * surface->format->BytesPerPixel;
+            Uint32 pixel;
+
+            r = (Uint8)rand();
+            g = (Uint8)(x * 255 / surface->w);
+            b = (Uint8)(y * 255 / surface->h);
+            a = (Uint8)(rand() | 0x0F);
+            pixel = SDL_MapRGBA(surface->format, r, g, b, a);
+            switch (surface->format->BytesPerPixel) {
+                case 2:
+                    *(Uint16 *)p = (Uint16)pixel;
+                    break;
+                case 3:
+                    SDL_memcpy(p, &pixel, 3);
+                    if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+                        p[0] = (Uint8)(pixel >> 16);
+                        p[1] = (Uint8)(pixel >> 8);
+                        p[2] = (Uint8)pixel;
+                    }
+                    break;
+                default:
+                    *(Uint32 *)p = pixel;
+                    break;
+            }
+        }
+    }
+    SDL_UnlockSurface(surface);
+}
+
+/* The weight each source pixel gets for destination pixel i */
+static void Weights(double *w, int i, int src_n, int dst_n, int filter)
+{
+    double scale = (double)src_n / dst_n;
+    double pos, x0, x1, overlap;
+    int k;
+
+    for (k = 0; k < src_n; ++k) {
+        w[k] = 0.0;
+    }
+    switch (filter) {
+        case SDL_STRETCH_BILINEAR:
+            pos = (i + 0.5) * scale - 0.5;
+            if (pos < 0.0) {
+                pos = 0.0;
+            }
+            if (pos > src_n - 1) {
+                pos = src_n - 1;
+            }
+            k = (int)pos;
+            w[k] = 1.0 - (pos - k);
+            if (k + 1 < src_n) {
+                w[k + 1] = pos - k;
+            }
+            break;
+        case SDL_STRETCH_BOX:
+            x0 = i * scale;
+            x1 = x0 + scale;
+            for (k = (int)x0; k < src_n && k < x1; ++k) {
+                overlap = SDL_min(x1, k + 1.0) - SDL_max(x0, (double)k);
+                if (overlap > 0.0) {
+                    w[k] = overlap / scale;
+                }
+            }
+            break;
+        default:
+            w[(i * ((src_n << 16) / dst_n)) >> 16] = 1.0;
+            break;
+    }
+}
+
+/* Stretch the slow way, and see if the surface came out the same */
+static int Check(SDL_Surface *src, SDL_Surface *dst, int filter, int tolerance)
+{
+    double *wx, *wy, sum[4];
+    int x, y, i, j, errors = 0;
+    Uint8 c[4], got[4];
+    Uint32 pixel;
+
+    wx = (double *)malloc(src->w * sizeof(double));
+    wy = (double *)malloc(src->h * sizeof(double));
+    for (y = 0; y < dst->h && !errors; ++y) {
+        Weights(wy, y, src->h, dst->h, filter);
+        for (x = 0; x < dst->w && !errors; ++x) {
+            Weights(wx, x, src->w, dst->w, filter);
+            sum[0] = sum[1] = sum[2] = sum[3] = 0.0;
+            for (j = 0; j < src->h; ++j) {
+                if (wy[j] == 0.0) {
+                    continue;
+                }
+                for (i = 0; i < src->w; ++i) {
+                    if (wx[i] == 0.0) {
+                        continue;
+                    }
+                    pixel = GetPixel(src, i, j);
+                    SDL_GetRGBA(pixel, src->format, &c[0], &c[1], &c[2], &c[3]);
+                    sum[0] += c[0] * wx[i] * wy[j];
+                    sum[1] += c[1] * wx[i] * wy[j];
+                    sum[2] += c[2] * wx[i] * wy[j];
+                    sum[3] += c[3] * wx[i] * wy[j];
+                }
+            }
+            /* What the destination can hold of the color */
+            pixel = SDL_MapRGBA(dst->format, (Uint8)(sum[0] + 0.5), (Uint8)(sum[1] + 0.5),
+                                (Uint8)(sum[2] + 0.5), (Uint8)(sum[3] + 0.5));
+            SDL_GetRGBA(pixel, dst->format, &c[0], &c[1], &c[2], &c[3]);
+            SDL_GetRGBA(GetPixel(dst, x, y), dst->format, &got[0], &got[1], &got[2], &got[3]);
+            for (i = 0; i < 4; ++i) {
+                if (abs(got[i] - c[i]) > tolerance) {
+                    printf("%d bpp to %d bpp %s, %dx%d to %dx%d: pixel %d,%d is %d,%d,%d,%d not %d,%d,%d,%d\n",
+                           src->format->BitsPerPixel, dst->format->BitsPerPixel,
+                           filter_names[filter], src->w, src->h, dst->w, dst->h, x, y,
+                           got[0], got[1], got[2], got[3], c[0], c[1], c[2], c[3]);
+                    ++errors;
+                    break;
+                }
+            }
+        }
+    }
+    free(wx);
+    free(wy);
+    return errors;
+}
+
+static int TestFilters(void)
+{
+    static const int sizes[][4] = {
+        { 13, 7, 41, 29 },      /* Up, with widths that aren't a multiple of 4 */
+        { 64, 48, 64, 48 },     /* The same size */
+        { 90, 70, 30, 21 },     /* Down by 3, and by 3.33 */
+        { 37, 50, 5, 9 },       /* A long way down */
+        { 1, 1, 9, 3 },         /* A single pixel */
+        { 20, 1, 7, 6 }
+    };
+    static const int formats[][3] = {
+        { 32, 32, 1 }, { 32, 32, 0 }, { 16, 16, 0 }, { 16, 32, 1 }, { 32, 16, 1 }, { 24, 32, 0 }
+    };
+    SDL_Surface *src, *dst;
+    int s, f, filter, tolerance, errors = 0;
+
+    for (s = 0; s < SDL_arraysize(sizes); ++s) {
+        for (f = 0; f < SDL_arraysize(formats); ++f) {
+            src = CreateSurface(sizes[s][0], sizes[s][1], formats[f][0], formats[f][2]);
+            dst = CreateSurface(sizes[s][2], sizes[s][3], formats[f][1], formats[f][2]);
+            Fill(src);
+            for (filter = SDL_STRETCH_NEAREST; filter <= SDL_STRETCH_BOX; ++filter) {
+                if (SDL_SoftStretchFiltered(src, NULL, dst, NULL, filter) < 0) {
+                    printf("Couldn't stretch: %s\n", SDL_GetError());
+                    ++errors;
+                    continue;
+                }
+                /* Filtering rounds once across and once down */
+                tolerance = (filter == SDL_STRETCH_NEAREST) ? 0 : 1;
+                if (dst->format->BitsPerPixel == 16 && filter != SDL_STRETCH_NEAREST) {
+                    tolerance = 9;  /* Which is one step of 5 bits */
+                }
+                errors += Check(src, dst, filter, tolerance);
+            }
+            SDL_FreeSurface(src);
+            SDL_FreeSurface(dst);
+        }
+    }
+    return errors;
+}
+
+/* Part of one surface into part of another, leaving the rest alone */
+static int TestRects(void)
+{
+    SDL_Surface *src, *dst, *ref;
+    SDL_Rect srcrect, dstrect;
+    int errors = 0;
+
+    src = CreateSurface(100, 80, 32, 0);
+    dst = CreateSurface(200, 150, 32, 0);
+    ref = CreateSurface(200, 150, 32, 0);
+    Fill(src);
+    Fill(dst);
+    SDL_BlitSurface(dst, NULL, ref, NULL);
+    srcrect.x = 10; srcrect.y = 20; srcrect.w = 50; srcrect.h = 30;
+    dstrect.x = 33; dstrect.y = 17; dstrect.w = 120; dstrect.h = 90;
+    SDL_SoftStretch(src, &srcrect, ref, &dstrect);
+    SDL_SoftStretchFiltered(src, &srcrect, dst, &dstrect, SDL_STRETCH_NEAREST);
+    if (memcmp(dst->pixels, ref->pixels, dst->h * dst->pitch) != 0) {
+        printf("SDL_STRETCH_NEAREST doesn't match SDL_SoftStretch()!\n");
+        ++errors;
+    }
+    Fill(dst);
+    SDL_BlitSurface(dst, NULL, ref, NULL);
+    SDL_SoftStretchFiltered(src, &srcrect, dst, &dstrect, SDL_STRETCH_BOX);
+    if (memcmp(dst->pixels, ref->pixels, dstrect.y * dst->pitch) != 0 ||
+        memcmp((Uint8 *)dst->pixels + (dstrect.y + 10) * dst->pitch,
+               (Uint8 *)ref->pixels + (dstrect.y + 10) * ref->pitch, dstrect.x * 4) != 0) {
+        printf("Stretching wrote outside the rectangle!\n");
+        ++errors;
+    }
+    srcrect.w = 200;
+    if (SDL_SoftStretchFiltered(src, &srcrect, dst, NULL, SDL_STRETCH_BILINEAR) == 0) {
+        printf("Stretching from outside the surface didn't fail!\n");
+        ++errors;
+    }
+    SDL_FreeSurface(src);
+    SDL_FreeSurface(dst);
+    SDL_FreeSurface(ref);
+    return errors;
+}
+
+static void Benchmark(int src_w, int src_h, int dst_w, int dst_h)
+{
+    SDL_Surface *src, *dst;
+    Uint32 start, elapsed;
+    int filter, i;
+
+    src = CreateSurface(src_w, src_h, 32, 0);
+    dst = CreateSurface(dst_w, dst_h, 32, 0);
+    Fill(src);
+    for (filter = SDL_STRETCH_NEAREST; filter <= SDL_STRETCH_BOX; ++filter) {
+        start = SDL_GetTicks();
+        for (i = 0; i < frames; ++i) {
+            SDL_SoftStretchFiltered(src, NULL, dst, NULL, filter);
+        }
+        elapsed = SDL_GetTicks() - start;
+        printf("%dx%d to %dx%d, %s: %.1f ms a frame\n", src_w, src_h, dst_w, dst_h,
+               filter_names[filter], (double)elapsed / frames);
+    }
+    SDL_FreeSurface(src);
+    SDL_FreeSurface(dst);
+}
+
+int main(int argc, char *argv[])
+{
+    int i, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && argv[i+1]) {
+            frames = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--frames N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    errors = TestFilters();
+    errors += TestRects();
+    printf("Stretching %s\n", errors ? "FAILED" : "matches the reference");
+
+    Benchmark(640, 480, 1920, 1080);
+    Benchmark(1920, 1080, 640, 480);
+
+    SDL_Quit();
+    return (errors != 0);
+}
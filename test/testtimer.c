@@ -5,6 +5,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "SDL.h"
 
@@ -24,6 +25,21 @@ static Uint32 SDLCALL callback(Uint32 interval, void *param)
   return interval;
 }
 
+#define NUM_TIMERS	500
+
+static int fired[NUM_TIMERS];
+
+static Uint32 SDLCALL counter(Uint32 interval, void *param)
+{
+	++fired[(int)(uintptr_t)param];
+	return(interval);
+}
+
+static Uint32 SDLCALL never(Uint32 interval, void *param)
+{
+	return(interval);
+}
+
 int main(int argc, char *argv[])
 {
 	int desired;
@@ -58,6 +74,20 @@ int main(int argc, char *argv[])
 					desired, (double)(10*1000)/ticks);
 	}
 	
+#ifdef SDL_HAS_64BIT_TYPE
+	/* Time a short delay with the high resolution counter */
+	{
+		Uint64 start, now, freq;
+
+		freq = SDL_GetPerformanceFrequency();
+		start = SDL_GetPerformanceCounter();
+		SDL_Delay(1);
+		now = SDL_GetPerformanceCounter();
+		printf("Performance counter runs at %.0f Hz, SDL_Delay(1) took %.3f ms\n",
+			(double)(Sint64)freq, (double)(Sint64)(now - start) * 1000.0 / (Sint64)freq);
+	}
+#endif
+
 	/* Test multiple timers */
 	printf("Testing multiple timers...\n");
 	t1 = SDL_AddTimer(100, callback, (void*)1);
@@ -82,6 +112,38 @@ int main(int argc, char *argv[])
 	SDL_RemoveTimer(t2);
 	SDL_RemoveTimer(t3);
 
+	/* Test lots of timers at once */
+	{
+		SDL_TimerID timers[NUM_TIMERS];
+		int i, total, expected;
+		clock_t cpu;
+
+		printf("Running %d timers for 3 seconds\n", NUM_TIMERS);
+		expected = 0;
+		for ( i=0; i<NUM_TIMERS; ++i ) {
+			Uint32 interval = 100 + (i % 10) * 100;
+			fired[i] = 0;
+			expected += 3000 / interval;
+			timers[i] = SDL_AddTimer(interval, counter, (void *)(uintptr_t)i);
+		}
+		SDL_Delay(3*1000 + 50);
+		total = 0;
+		for ( i=0; i<NUM_TIMERS; ++i ) {
+			SDL_RemoveTimer(timers[i]);
+			total += fired[i];
+		}
+		printf("Timers fired %d times, expected %d\n", total, expected);
+
+		/* An idle timer thread shouldn't use any CPU */
+		t1 = SDL_AddTimer(60*1000, never, NULL);
+		cpu = clock();
+		SDL_Delay(2*1000);
+		cpu = clock() - cpu;
+		SDL_RemoveTimer(t1);
+		printf("CPU time used waiting 2 seconds for a timer: %.1f ms\n",
+				(double)cpu * 1000.0 / CLOCKS_PER_SEC);
+	}
+
 	SDL_Quit();
 	return(0);
 }
@@ -0,0 +1,463 @@
+/*
+ * Checks that SDL_LoadWAV_RW() decodes ADPCM files the way a plain decoder
+ *  does, on one thread or several, and that reading a WAV stream gives the
+ *  same audio for PCM and ADPCM files, read in pieces of any size and after
+ *  seeking.  Then compares how long it takes to load a long file on one
+ *  thread and several, and to get to its first audio by streaming it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define PCM_CODE	0x0001
+#define MS_ADPCM_CODE	0x0002
+#define IMA_ADPCM_CODE	0x0011
+
+static int seconds = 600;
+
+static const struct {
+    const char *name;
+    Uint16 encoding;
+    Uint16 channels;
+    Uint16 bits;
+} files[] = {
+    { "PCM 8-bit mono", PCM_CODE, 1, 8 },
+    { "PCM 16-bit stereo", PCM_CODE, 2, 16 },
+    { "MS ADPCM mono", MS_ADPCM_CODE, 1, 4 },
+    { "MS ADPCM stereo", MS_ADPCM_CODE, 2, 4 },
+    { "IMA ADPCM mono", IMA_ADPCM_CODE, 1, 4 },
+    { "IMA ADPCM stereo", IMA_ADPCM_CODE, 2, 4 },
+};
+
+static const Sint16 ms_coeff[7][2] = {
+    { 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 },
+    { 240, 0 }, { 460, -208 }, { 392, -232 }
+};
+
+static Uint8 *put16(Uint8 *p, Uint16 x)
+{
+    p[0] = (Uint8)x;
+    p[1] = (Uint8)(x >> 8);
+    return p + 2;
+}
+
+static Uint8 *put32(Uint8 *p, Uint32 x)
+{
+    p = put16(p, (Uint16)x);
+    return put16(p, (Uint16)(x >> 16));
+}
+
+/* Random audio data, with block headers a decoder will take */
+static void FillBlock(Uint8 *p, int blockalign, int encoding, int channels)
+{
+    int c;
+
+    for (c = 0; c < blockalign; ++c) {
+        p[c] = (Uint8)rand();
+    }
+    if (encoding == MS_ADPCM_CODE) {
+        for (c = 0; c < channels; ++c) {
+            p[c] = (Uint8)(rand() % 7);
+            put16(p + channels + c * 2, (Uint16)(16 + rand() % 1000));
+        }
+    } else if (encoding == IMA_ADPCM_CODE) {
+        for (c = 0; c < channels; ++c) {
+            p[c * 4 + 2] = (Uint8)(rand() % 89);
+            p[c * 4 + 3] = 0;
+        }
+    }
+}
+
+/* The decoders the way the file format describes them, one sample at a time */
+static int RefDecodeMS(Uint8 *p, int channels, int spb, Sint16 *out)
+{
+    static const int adaptive[16] = {
+        230, 230, 230, 230, 307, 409, 512, 614,
+        768, 614, 512, 409, 307, 230, 230, 230
+    };
+    int delta[2], s1[2], s2[2], pred[2];
+    int c, i, n, sample;
+
+    for (c = 0; c < channels; ++c) {
+        pred[c] = p[c];
+        delta[c] = (Uint16)(p[channels + c*2] | (p[channels + c*2 + 1] << 8));
+        s1[c] = (Sint16)(p[channels*3 + c*2] | (p[channels*3 + c*2 + 1] << 8));
+        s2[c] = (Sint16)(p[channels*5 + c*2] | (p[channels*5 + c*2 + 1] << 8));
+        out[c] = (Sint16)s2[c];
+        out[channels + c] = (Sint16)s1[c];
+    }
+    p += channels * 7;
+    out += channels * 2;
+    for (i = 0; i < (spb - 2) * channels; ++i) {
+        c = i % channels;
+        n = (i % 2) ? (p[i/2] & 0x0F) : (p[i/2] >> 4);
+        sample = (s1[c] * ms_coeff[pred[c]][0] + s2[c] * ms_coeff[pred[c]][1]) / 256;
+        sample += delta[c] * ((n & 8) ? n - 16 : n);
+        if (sample > 32767) {
+            sample = 32767;
+        } else if (sample < -32768) {
+            sample = -32768;
+        }
+        delta[c] = delta[c] * adaptive[n] / 256;
+        if (delta[c] < 16) {
+            delta[c] = 16;
+        }
+        delta[c] = (Uint16)delta[c];
+        s2[c] = s1[c];
+        s1[c] = sample;
+        *out++ = (Sint16)sample;
+    }
+    return spb;
+}
+
+static int RefDecodeIMA(Uint8 *p, int channels, int spb, Sint16 *out)
+{
+    static const int index_table[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+    static const int step_table[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+        34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
+        143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
+        449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282,
+        1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+        3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+        9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+        22385, 24623, 27086, 29794, 32767
+    };
+    int sample[2], index[2];
+    int c, i, n, step, delta, frame;
+
+    for (c = 0; c < channels; ++c) {
+        sample[c] = (Sint16)(p[c*4] | (p[c*4 + 1] << 8));
+        index[c] = p[c*4 + 2];
+        out[c] = (Sint16)sample[c];
+    }
+    p += channels * 4;
+    for (i = 0; i < (spb - 1) * channels; ++i) {
+        /* Groups of 8 samples, 4 bytes per channel, low nybble first */
+        c = (i / 8) % channels;
+        frame = 1 + (i / (8 * channels)) * 8 + i % 8;
+        n = (i % 2) ? (p[i/2] >> 4) : (p[i/2] & 0x0F);
+        step = step_table[index[c]];
+        delta = step >> 3;
+        if (n & 4) delta += step;
+        if (n & 2) delta += step >> 1;
+        if (n & 1) delta += step >> 2;
+        sample[c] += (n & 8) ? -delta : delta;
+        if (sample[c] > 32767) {
+            sample[c] = 32767;
+        } else if (sample[c] < -32768) {
+            sample[c] = -32768;
+        }
+        index[c] += index_table[n & 7];
+        if (index[c] < 0) {
+            index[c] = 0;
+        } else if (index[c] > 88) {
+            index[c] = 88;
+        }
+        out[frame * channels + c] = (Sint16)sample[c];
+    }
+    return spb;
+}
+
+/* The size of a block in a file, and the frames in it for ADPCM */
+static int BlockSize(int i, int *spb)
+{
+    int channels = files[i].channels;
+
+    switch (files[i].encoding) {
+        case MS_ADPCM_CODE:
+            *spb = (256 - 7) * 2 + 2;
+            return 256 * channels;
+        case IMA_ADPCM_CODE:
+            *spb = (256 - 4) * 2 + 1;
+            return 256 * channels;
+        default:
+            *spb = 0;
+            return files[i].bits / 8 * channels;
+    }
+}
+
+/* Make a WAVE file in memory, with some chunks to skip over */
+static Uint8 *MakeWAV(int i, int blocks, int *len)
+{
+    int channels = files[i].channels;
+    int blockalign, spb, fmtlen = 16, datalen;
+    Uint8 *wav, *p;
+
+    blockalign = BlockSize(i, &spb);
+    if (files[i].encoding == MS_ADPCM_CODE) {
+        fmtlen = 16 + 2 + 4 + sizeof(ms_coeff);
+    } else if (files[i].encoding == IMA_ADPCM_CODE) {
+        fmtlen = 16 + 4;
+    }
+    datalen = blocks * blockalign;
+    *len = 12 + 8 + 6 + 8 + fmtlen + 8 + 4 + 8 + datalen;
+    wav = (Uint8 *)malloc(*len);
+    if (wav == NULL) {
+        return NULL;
+    }
+
+    p = wav;
+    memcpy(p, "RIFF", 4);
+    p = put32(p + 4, *len - 8);
+    memcpy(p, "WAVELIST", 8);
+    p = put32(p + 8, 6);
+    memcpy(p, "nothing", 6);
+    p += 6;
+    memcpy(p, "fmt ", 4);
+    p = put32(p + 4, fmtlen);
+    p = put16(p, files[i].encoding);
+    p = put16(p, channels);
+    p = put32(p, 22050);
+    p = put32(p, 22050 * blockalign / (spb ? spb : 1));
+    p = put16(p, blockalign);
+    p = put16(p, files[i].bits);
+    if (files[i].encoding == MS_ADPCM_CODE) {
+        int c;
+        p = put16(p, 4 + sizeof(ms_coeff));
+        p = put16(p, spb);
+        p = put16(p, 7);
+        for (c = 0; c < 7; ++c) {
+            p = put16(p, ms_coeff[c][0]);
+            p = put16(p, ms_coeff[c][1]);
+        }
+    } else if (files[i].encoding == IMA_ADPCM_CODE) {
+        p = put16(p, 2);
+        p = put16(p, spb);
+    }
+    memcpy(p, "fact", 4);
+    p = put32(p + 4, 4);
+    p = put32(p, blocks * (spb ? spb : 1));
+    memcpy(p, "data", 4);
+    p = put32(p + 4, datalen);
+    if (files[i].encoding == PCM_CODE) {
+        int n;
+        for (n = 0; n < datalen; ++n) {
+            p[n] = (Uint8)rand();
+        }
+    } else {
+        int b;
+        for (b = 0; b < blocks; ++b) {
+            FillBlock(p + b * blockalign, blockalign, files[i].encoding, channels);
+        }
+    }
+    return wav;
+}
+
+static int TestFile(int i)
+{
+    SDL_AudioSpec spec, stream_spec;
+    SDL_WAVStream *stream;
+    Uint8 *wav, *audio, *buf;
+    Uint32 len, frames, frame, got;
+    int wavlen, framesize, n, pass, errors = 0;
+    int blocks, blockalign, spb;
+
+    blocks = 20 + rand() % 20;
+    blockalign = BlockSize(i, &spb);
+    wav = MakeWAV(i, blocks, &wavlen);
+    if (SDL_LoadWAV_RW(SDL_RWFromMem(wav, wavlen), 1, &spec, &audio, &len) == NULL) {
+        printf("Couldn't load %s: %s\n", files[i].name, SDL_GetError());
+        free(wav);
+        return 1;
+    }
+    stream = SDL_OpenWAVStream(SDL_RWFromMem(wav, wavlen), 1, &stream_spec);
+    if (stream == NULL) {
+        printf("Couldn't stream %s: %s\n", files[i].name, SDL_GetError());
+        SDL_FreeWAV(audio);
+        free(wav);
+        return 1;
+    }
+    if (memcmp(&spec, &stream_spec, sizeof(spec)) != 0) {
+        printf("%s came out as a different format!\n", files[i].name);
+        ++errors;
+    }
+    framesize = (spec.format & 0xFF) / 8 * spec.channels;
+    frames = len / framesize;
+    buf = (Uint8 *)malloc(len + framesize);
+
+    /* What the file format says it decodes to */
+    if (files[i].encoding != PCM_CODE) {
+        Sint16 *ref = (Sint16 *)buf;
+        Uint8 *data = wav + wavlen - blocks * blockalign;
+        int b;
+
+        for (b = 0; b < blocks; ++b, data += blockalign) {
+            if (files[i].encoding == MS_ADPCM_CODE) {
+                ref += RefDecodeMS(data, spec.channels, spb, ref) * spec.channels;
+            } else {
+                ref += RefDecodeIMA(data, spec.channels, spb, ref) * spec.channels;
+            }
+        }
+        for (ref = (Sint16 *)buf; (Uint8 *)ref < buf + len; ++ref) {
+            *ref = SDL_SwapLE16(*ref);
+        }
+        if (blocks * spb * framesize != len || memcmp(buf, audio, len) != 0) {
+            printf("Loading %s decoded it wrong!\n", files[i].name);
+            ++errors;
+        }
+    }
+
+    /* Straight through, in pieces of any size */
+    for (got = 0; (n = SDL_ReadWAVStream(stream, buf + got * framesize, 1 + rand() % 1000)) > 0; got += n) {
+    }
+    if (got != frames || memcmp(buf, audio, len) != 0) {
+        printf("Reading %s came out wrong, %u of %u frames!\n", files[i].name,
+               (unsigned int)got, (unsigned int)frames);
+        ++errors;
+    }
+
+    /* Here and there */
+    for (pass = 0; pass < 100 && !errors; ++pass) {
+        frame = rand() % (frames + 1);
+        n = 1 + rand() % 2000;
+        if (SDL_SeekWAVStream(stream, frame) < 0) {
+            printf("Couldn't seek %s: %s\n", files[i].name, SDL_GetError());
+            ++errors;
+            break;
+        }
+        n = SDL_ReadWAVStream(stream, buf, n);
+        if (n < 0 || (n == 0 && frame < frames) ||
+            memcmp(buf, audio + frame * framesize, n * framesize) != 0) {
+            printf("Seeking %s to frame %u came out wrong!\n", files[i].name, (unsigned int)frame);
+            ++errors;
+        }
+    }
+    if (SDL_SeekWAVStream(stream, frames + 1) == 0) {
+        printf("Seeking %s past the end worked!\n", files[i].name);
+        ++errors;
+    }
+
+    SDL_CloseWAVStream(stream);
+    SDL_FreeWAV(audio);
+    free(buf);
+    free(wav);
+    return errors;
+}
+
+static Uint8 *Load(Uint8 *wav, int wavlen, const char *threads,
+                   Uint32 *len, Uint32 *elapsed)
+{
+    SDL_AudioSpec spec;
+    Uint8 *audio;
+    char env[64];
+
+    SDL_snprintf(env, sizeof(env), "SDL_AUDIO_WAVE_THREADS=%s", threads);
+    SDL_putenv(env);
+    *elapsed = SDL_GetTicks();
+    if (SDL_LoadWAV_RW(SDL_RWFromMem(wav, wavlen), 1, &spec, &audio, len) == NULL) {
+        printf("Couldn't load: %s\n", SDL_GetError());
+        return NULL;
+    }
+    *elapsed = SDL_GetTicks() - *elapsed;
+    return audio;
+}
+
+/* Long ADPCM files, which are four times the size once decoded */
+static int Benchmark(int i)
+{
+    SDL_AudioSpec spec;
+    SDL_WAVStream *stream;
+    Uint8 *wav, *audio, *threaded, buf[4096 * 4];
+    Uint32 len, threaded_len, start, first, all;
+    int wavlen, n, spb, errors = 0;
+
+    BlockSize(i, &spb);
+    wav = MakeWAV(i, seconds * 22050 / spb, &wavlen);
+    if (wav == NULL) {
+        return 0;
+    }
+
+    audio = Load(wav, wavlen, "", &len, &first);
+    threaded = Load(wav, wavlen, "4", &threaded_len, &all);
+    if (audio == NULL || threaded == NULL) {
+        ++errors;
+    } else {
+        printf("Loading %d seconds of %s: %d ms, %d ms on 4 threads, %u bytes of memory\n",
+               seconds, files[i].name, (int)first, (int)all, (unsigned int)len);
+        if (threaded_len != len || memcmp(audio, threaded, len) != 0) {
+            printf("Loading it on 4 threads came out different!\n");
+            ++errors;
+        }
+    }
+    SDL_FreeWAV(audio);
+    SDL_FreeWAV(threaded);
+    SDL_putenv("SDL_AUDIO_WAVE_THREADS=");
+
+    start = SDL_GetTicks();
+    stream = SDL_OpenWAVStream(SDL_RWFromMem(wav, wavlen), 1, &spec);
+    if (stream == NULL) {
+        free(wav);
+        return errors + 1;
+    }
+    SDL_ReadWAVStream(stream, buf, 4096);
+    first = SDL_GetTicks() - start;
+    while ((n = SDL_ReadWAVStream(stream, buf, 4096)) > 0) {
+    }
+    all = SDL_GetTicks() - start;
+    printf("Streaming it: %d ms to the first audio, %d ms to the end\n",
+           (int)first, (int)all);
+    SDL_CloseWAVStream(stream);
+    free(wav);
+    return errors;
+}
+
+/* Files that end before the data chunk have to fail, not hang */
+static int TestTruncated(void)
+{
+    SDL_WAVStream *stream;
+    SDL_AudioSpec spec;
+    Uint8 *wav;
+    int wavlen, datalen, spb, cut, errors = 0;
+
+    wav = MakeWAV(0, 4, &wavlen);
+    if (wav == NULL) {
+        return 1;
+    }
+    datalen = 4 * BlockSize(0, &spb);
+    for (cut = 0; cut < wavlen - datalen; ++cut) {
+        stream = SDL_OpenWAVStream(SDL_RWFromMem(wav, cut), 1, &spec);
+        if (stream != NULL) {
+            printf("A WAV file cut off after %d bytes opened!\n", cut);
+            SDL_CloseWAVStream(stream);
+            ++errors;
+        }
+    }
+    free(wav);
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && argv[i+1]) {
+            seconds = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--seconds N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    errors = 0;
+    for (i = 0; i < SDL_arraysize(files); ++i) {
+        errors += TestFile(i);
+    }
+    errors += TestTruncated();
+    printf("WAV streams %s\n", errors ? "FAILED" : "match SDL_LoadWAV_RW()");
+
+    errors += Benchmark(3);
+    errors += Benchmark(5);
+
+    SDL_Quit();
+    return (errors != 0);
+}